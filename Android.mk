@@ -34,10 +34,15 @@ DEFS = \
 	-DMTY_GL_ES \
 	-DMTY_GL_EXTERNAL
 
+ifdef METRICS
+DEFS := $(DEFS) -DMTY_METRICS
+endif
+
 LOCAL_CFLAGS = $(DEFS) $(FLAGS)
 
 LOCAL_SRC_FILES := \
 	src/app.c \
+	src/cpu.c \
 	src/crypto.c \
 	src/file.c \
 	src/hash.c \
@@ -46,15 +51,20 @@ LOCAL_SRC_FILES := \
 	src/list.c \
 	src/log.c \
 	src/memory.c \
+	src/metrics.c \
+	src/pool.c \
 	src/queue.c \
 	src/render.c \
 	src/system.c \
 	src/thread.c \
+	src/timer.c \
 	src/tlocal.c \
 	src/tls.c \
+	src/url.c \
 	src/version.c \
 	src/gfx/gl.c \
 	src/gfx/gl-ui.c \
+	src/hid/replay.c \
 	src/hid/utils.c \
 	src/net/async.c \
 	src/net/gzip.c \
@@ -66,6 +76,7 @@ LOCAL_SRC_FILES := \
 	src/unix/file.c \
 	src/unix/image.c \
 	src/unix/memory.c \
+	src/unix/record.c \
 	src/unix/system.c \
 	src/unix/thread.c \
 	src/unix/time.c \
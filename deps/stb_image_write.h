@@ -449,17 +449,6 @@ static unsigned char *stbi_write_png_to_mem(const unsigned char *pixels, int str
 	return out;
 }
 
-static int stbi_write_png_to_func(stbi_write_func *func, void *context, int x, int y, int comp, const void *data, int stride_bytes)
-{
-	int len;
-	unsigned char *png = stbi_write_png_to_mem((const unsigned char *) data, stride_bytes, x, y, comp, &len);
-	if (png == NULL)
-		return 0;
-	func(context, png, len);
-	STBIW_FREE(png);
-	return 1;
-}
-
 
 /* ***************************************************************************
  *
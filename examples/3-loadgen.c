@@ -0,0 +1,810 @@
+#include "matoya.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+	#include <winsock2.h>
+	#include <ws2tcpip.h>
+
+	typedef SOCKET lg_socket;
+
+	#define LG_INVALID_SOCKET INVALID_SOCKET
+	#define LG_SHUT_RDWR      SD_BOTH
+	#define lg_close          closesocket
+
+#else
+	#include <sys/socket.h>
+	#include <netinet/in.h>
+	#include <arpa/inet.h>
+	#include <unistd.h>
+
+	typedef int lg_socket;
+
+	#define LG_INVALID_SOCKET -1
+	#define LG_SHUT_RDWR      SHUT_RDWR
+	#define lg_close          close
+#endif
+
+#define LG_HEADER_MAX (16 * 1024)
+#define LG_FIELDS     64
+#define LG_TIMEOUT    5000
+#define LG_ORIGIN     "http://127.0.0.1"
+
+// Latency histogram in nanoseconds with HdrHistogram style log-linear buckets:
+// values below HIST_SUB are exact, larger values keep 6 significant bits
+// (a relative error under 1.6%) up to 2^46 ns
+#define HIST_SUB  128
+#define HIST_HALF (HIST_SUB / 2)
+#define HIST_LEN  (HIST_SUB + 40 * HIST_HALF)
+
+enum mode {
+	MODE_HTTP,
+	MODE_HTTP_ASYNC,
+	MODE_WS,
+};
+
+struct worker {
+	struct context *ctx;
+	MTY_Thread *thread;
+	uint64_t hist[HIST_LEN];
+	uint64_t requests;
+	uint64_t errors;
+	uint64_t bytes;
+	uint32_t rng;
+};
+
+struct context {
+	// Options
+	enum mode mode;
+	const char *host;
+	uint16_t port;
+	bool tls;
+	uint32_t concurrency;
+	float duration;
+	size_t size;
+	uint32_t post;
+	bool json;
+
+	// Loopback servers
+	bool loopback;
+	lg_socket listener;
+	MTY_Thread **http_threads;
+	MTY_WebSocketServer *ws_server;
+	MTY_Thread *ws_thread;
+	MTY_Atomic32 ws_echoes;
+	char *response;
+	size_t response_len;
+
+	// Load
+	char *payload;
+	struct worker *workers;
+	MTY_Atomic32 stop;
+};
+
+
+// Histogram
+
+static uint32_t hist_index(uint64_t v)
+{
+	if (v < HIST_SUB)
+		return (uint32_t) v;
+
+	uint32_t shift = 0;
+	while ((v >> shift) >= HIST_SUB)
+		shift++;
+
+	uint32_t index = HIST_SUB + (shift - 1) * HIST_HALF + (uint32_t) ((v >> shift) - HIST_HALF);
+
+	return index < HIST_LEN ? index : HIST_LEN - 1;
+}
+
+static uint64_t hist_value(uint32_t index)
+{
+	if (index < HIST_SUB)
+		return index;
+
+	uint32_t shift = (index - HIST_SUB) / HIST_HALF + 1;
+	uint64_t sub = (index - HIST_SUB) % HIST_HALF + HIST_HALF;
+
+	// Highest value that maps to this bucket
+	return ((sub + 1) << shift) - 1;
+}
+
+static void hist_record(struct worker *w, MTY_Time start)
+{
+	uint64_t ns = (uint64_t) (MTY_TimeDiff(start, MTY_GetTime()) * 1000000.0);
+
+	w->hist[hist_index(ns)]++;
+}
+
+static float hist_percentile(const uint64_t *hist, uint64_t total, double p)
+{
+	uint64_t target = (uint64_t) (p / 100.0 * (double) total + 0.5);
+	if (target == 0)
+		target = 1;
+
+	uint64_t count = 0;
+
+	for (uint32_t x = 0; x < HIST_LEN; x++) {
+		count += hist[x];
+
+		if (count >= target)
+			return (float) hist_value(x) / 1000000.0f;
+	}
+
+	return 0.0f;
+}
+
+
+// Loopback HTTP server
+
+static bool server_send(lg_socket s, const char *buf, size_t size)
+{
+	while (size > 0) {
+		int32_t n = send(s, buf, (int32_t) size, 0);
+		if (n <= 0)
+			return false;
+
+		buf += n;
+		size -= n;
+	}
+
+	return true;
+}
+
+static void server_handle(struct context *ctx, lg_socket s, char *buf)
+{
+	MTY_HttpField fields[LG_FIELDS];
+	MTY_HttpMessage msg = {0};
+	MTY_HttpParseResult r = MTY_HTTP_PARSE_PARTIAL;
+	size_t len = 0;
+
+	// Read until the request header is complete
+	while (r == MTY_HTTP_PARSE_PARTIAL && len < LG_HEADER_MAX) {
+		int32_t n = recv(s, buf + len, (int32_t) (LG_HEADER_MAX - len), 0);
+		if (n <= 0)
+			return;
+
+		size_t prev = len;
+		len += n;
+
+		r = MTY_HttpParseMessage(buf, len, prev, false, fields, LG_FIELDS, &msg);
+	}
+
+	if (r != MTY_HTTP_PARSE_OK)
+		return;
+
+	// Discard the request body, the value is always followed by CRLF
+	const MTY_HttpField *cl = MTY_HttpGetField(&msg, "Content-Length");
+	size_t body = cl ? strtoul(cl->value, NULL, 10) : 0;
+
+	for (size_t have = len - msg.size; have < body;) {
+		int32_t n = recv(s, buf, LG_HEADER_MAX, 0);
+		if (n <= 0)
+			return;
+
+		have += n;
+	}
+
+	server_send(s, ctx->response, ctx->response_len);
+}
+
+static void *server_http_thread(void *opaque)
+{
+	struct context *ctx = opaque;
+	char *buf = MTY_Alloc(LG_HEADER_MAX, 1);
+
+	// Every server thread blocks in accept on the shared listener, which fails
+	// once the listener is shut down
+	while (true) {
+		lg_socket s = accept(ctx->listener, NULL, NULL);
+		if (s == LG_INVALID_SOCKET)
+			break;
+
+		server_handle(ctx, s, buf);
+		lg_close(s);
+	}
+
+	MTY_Free(buf);
+
+	return NULL;
+}
+
+static bool server_http_start(struct context *ctx)
+{
+	ctx->listener = socket(AF_INET, SOCK_STREAM, 0);
+	if (ctx->listener == LG_INVALID_SOCKET)
+		return false;
+
+	int32_t opt = 1;
+	setsockopt(ctx->listener, SOL_SOCKET, SO_REUSEADDR, (const char *) &opt, sizeof(opt));
+
+	struct sockaddr_in addr = {0};
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	addr.sin_port = htons(ctx->port);
+
+	if (bind(ctx->listener, (struct sockaddr *) &addr, sizeof(addr)) != 0)
+		return false;
+
+	if (listen(ctx->listener, SOMAXCONN) != 0)
+		return false;
+
+	// Port 0 picks an ephemeral port
+	socklen_t addr_len = sizeof(addr);
+	getsockname(ctx->listener, (struct sockaddr *) &addr, &addr_len);
+	ctx->port = ntohs(addr.sin_port);
+
+	// Connection: close on every response keeps the client's view of it simple
+	const char *fmt = "HTTP/1.1 200 OK\r\nContent-Length: %zu\r\nConnection: close\r\n\r\n";
+
+	size_t hlen = snprintf(NULL, 0, fmt, ctx->size);
+	ctx->response_len = hlen + ctx->size;
+	ctx->response = MTY_Alloc(ctx->response_len + 1, 1);
+
+	snprintf(ctx->response, hlen + 1, fmt, ctx->size);
+	memset(ctx->response + hlen, 'x', ctx->size);
+
+	ctx->http_threads = MTY_Alloc(ctx->concurrency, sizeof(MTY_Thread *));
+
+	for (uint32_t x = 0; x < ctx->concurrency; x++)
+		ctx->http_threads[x] = MTY_ThreadCreate(server_http_thread, ctx);
+
+	return true;
+}
+
+static void server_http_stop(struct context *ctx)
+{
+	if (ctx->listener != LG_INVALID_SOCKET) {
+		shutdown(ctx->listener, LG_SHUT_RDWR);
+		lg_close(ctx->listener);
+	}
+
+	if (ctx->http_threads) {
+		for (uint32_t x = 0; x < ctx->concurrency; x++)
+			MTY_ThreadDestroy(&ctx->http_threads[x]);
+
+		MTY_Free(ctx->http_threads);
+	}
+
+	MTY_Free(ctx->response);
+}
+
+
+// Loopback WebSocket server
+
+struct echo {
+	struct context *ctx;
+	MTY_WebSocket *ws;
+};
+
+static void *server_echo_thread(void *opaque)
+{
+	struct echo *echo = opaque;
+	char *buf = MTY_Alloc(echo->ctx->size + 1, 1);
+
+	while (true) {
+		MTY_Async r = MTY_WebSocketRead(echo->ws, 100, buf, echo->ctx->size + 1);
+
+		if (r == MTY_ASYNC_OK) {
+			if (!MTY_WebSocketWrite(echo->ws, buf))
+				break;
+
+		} else if (r == MTY_ASYNC_ERROR || MTY_Atomic32Get(&echo->ctx->stop)) {
+			break;
+		}
+	}
+
+	MTY_WebSocketDestroy(&echo->ws);
+	MTY_Atomic32Add(&echo->ctx->ws_echoes, -1);
+	MTY_Free(buf);
+	MTY_Free(echo);
+
+	return NULL;
+}
+
+static void *server_ws_thread(void *opaque)
+{
+	struct context *ctx = opaque;
+
+	while (!MTY_Atomic32Get(&ctx->stop)) {
+		MTY_WebSocket *ws = MTY_WebSocketServerAccept(ctx->ws_server, 100);
+		if (!ws)
+			continue;
+
+		struct echo *echo = MTY_Alloc(1, sizeof(struct echo));
+		echo->ctx = ctx;
+		echo->ws = ws;
+
+		MTY_Atomic32Add(&ctx->ws_echoes, 1);
+		MTY_ThreadDetach(server_echo_thread, echo);
+	}
+
+	return NULL;
+}
+
+static bool server_ws_start(struct context *ctx)
+{
+	// MTY_WebSocketServer needs a fixed port
+	if (ctx->port == 0)
+		ctx->port = 5380;
+
+	const char *origins[] = {"127.0.0.1"};
+
+	MTY_WebSocketServerDesc desc = {
+		.ip = "127.0.0.1",
+		.port = ctx->port,
+		.origins = origins,
+		.numOrigins = 1,
+		.maxPending = ctx->concurrency,
+	};
+
+	ctx->ws_server = MTY_WebSocketServerCreate(&desc);
+	if (!ctx->ws_server)
+		return false;
+
+	ctx->ws_thread = MTY_ThreadCreate(server_ws_thread, ctx);
+
+	return true;
+}
+
+static void server_ws_stop(struct context *ctx)
+{
+	MTY_ThreadDestroy(&ctx->ws_thread);
+
+	// Echo threads exit once their client disconnects or the stop flag is seen
+	while (MTY_Atomic32Get(&ctx->ws_echoes) > 0)
+		MTY_Sleep(10);
+
+	MTY_WebSocketServerDestroy(&ctx->ws_server);
+}
+
+
+// Load
+
+static const char *load_method(struct worker *w, size_t *body_size)
+{
+	w->rng ^= w->rng << 13;
+	w->rng ^= w->rng >> 17;
+	w->rng ^= w->rng << 5;
+
+	bool post = w->rng % 100 < w->ctx->post;
+	*body_size = post ? w->ctx->size : 0;
+
+	return post ? "POST" : "GET";
+}
+
+static void *load_http_thread(void *opaque)
+{
+	struct worker *w = opaque;
+	struct context *ctx = w->ctx;
+
+	while (!MTY_Atomic32Get(&ctx->stop)) {
+		size_t body_size = 0;
+		const char *method = load_method(w, &body_size);
+
+		void *res = NULL;
+		size_t res_size = 0;
+		uint16_t status = 0;
+
+		MTY_Time start = MTY_GetTime();
+
+		bool ok = MTY_HttpRequest(ctx->host, ctx->port, ctx->tls, method, "/", NULL,
+			ctx->payload, body_size, LG_TIMEOUT, &res, &res_size, &status);
+
+		if (ok && status == 200) {
+			hist_record(w, start);
+			w->requests++;
+			w->bytes += body_size + res_size;
+
+		} else {
+			w->errors++;
+		}
+
+		MTY_Free(res);
+	}
+
+	return NULL;
+}
+
+static void *load_ws_thread(void *opaque)
+{
+	struct worker *w = opaque;
+	struct context *ctx = w->ctx;
+
+	uint16_t status = 0;
+	MTY_WebSocket *ws = MTY_WebSocketConnect(ctx->host, ctx->port, ctx->tls, "/",
+		"Origin: " LG_ORIGIN, LG_TIMEOUT, &status);
+
+	if (!ws) {
+		w->errors++;
+		return NULL;
+	}
+
+	char *buf = MTY_Alloc(ctx->size + 1, 1);
+
+	// Each message round trips through the echo server before the next is sent
+	while (!MTY_Atomic32Get(&ctx->stop)) {
+		MTY_Time start = MTY_GetTime();
+
+		if (!MTY_WebSocketWrite(ws, ctx->payload) ||
+			MTY_WebSocketRead(ws, LG_TIMEOUT, buf, ctx->size + 1) != MTY_ASYNC_OK)
+		{
+			w->errors++;
+			break;
+		}
+
+		hist_record(w, start);
+		w->requests++;
+		w->bytes += ctx->size * 2;
+	}
+
+	MTY_Free(buf);
+	MTY_WebSocketDestroy(&ws);
+
+	return NULL;
+}
+
+static void load_http_async(struct context *ctx)
+{
+	// A single worker's histogram collects everything since polling happens here
+	struct worker *w = &ctx->workers[0];
+
+	uint32_t *index = MTY_Alloc(ctx->concurrency, sizeof(uint32_t));
+	MTY_Time *start = MTY_Alloc(ctx->concurrency, sizeof(MTY_Time));
+	size_t *body_size = MTY_Alloc(ctx->concurrency, sizeof(size_t));
+
+	MTY_HttpAsyncCreate(ctx->concurrency);
+
+	MTY_Time begin = MTY_GetTime();
+	uint32_t pending = 0;
+
+	for (bool running = true; running || pending > 0;) {
+		running = MTY_TimeDiff(begin, MTY_GetTime()) < ctx->duration * 1000.0f;
+		bool idle = true;
+
+		for (uint32_t x = 0; x < ctx->concurrency; x++) {
+			if (index[x] == 0) {
+				if (!running)
+					continue;
+
+				const char *method = load_method(w, &body_size[x]);
+
+				start[x] = MTY_GetTime();
+				MTY_HttpAsyncRequest(&index[x], ctx->host, ctx->port, ctx->tls, method, "/",
+					NULL, ctx->payload, body_size[x], LG_TIMEOUT, NULL);
+
+				if (index[x] != 0)
+					pending++;
+
+				continue;
+			}
+
+			void *res = NULL;
+			size_t res_size = 0;
+			uint16_t status = 0;
+
+			MTY_Async r = MTY_HttpAsyncPoll(index[x], &res, &res_size, &status);
+			if (r == MTY_ASYNC_CONTINUE)
+				continue;
+
+			if (r == MTY_ASYNC_OK && status == 200) {
+				hist_record(w, start[x]);
+				w->requests++;
+				w->bytes += body_size[x] + res_size;
+
+			} else {
+				w->errors++;
+			}
+
+			MTY_HttpAsyncClear(&index[x]);
+			pending--;
+			idle = false;
+		}
+
+		// Completions are only observed when polled, so latency includes up to
+		// this much polling delay
+		if (idle)
+			MTY_Sleep(1);
+	}
+
+	MTY_HttpAsyncDestroy();
+
+	MTY_Free(body_size);
+	MTY_Free(start);
+	MTY_Free(index);
+}
+
+
+// Report
+
+static const double REPORT_PERCENTILES[] = {50.0, 90.0, 99.0, 99.9, 99.99};
+static const char *REPORT_KEYS[] = {"p50", "p90", "p99", "p99.9", "p99.99"};
+
+#define REPORT_LEN (sizeof(REPORT_PERCENTILES) / sizeof(REPORT_PERCENTILES[0]))
+
+static const char *report_mode(enum mode mode)
+{
+	switch (mode) {
+		case MODE_HTTP:       return "http";
+		case MODE_HTTP_ASYNC: return "http-async";
+		case MODE_WS:         return "ws";
+	}
+
+	return "";
+}
+
+static void report(struct context *ctx, float elapsed)
+{
+	uint64_t *hist = MTY_Alloc(HIST_LEN, sizeof(uint64_t));
+	uint64_t requests = 0;
+	uint64_t errors = 0;
+	uint64_t bytes = 0;
+
+	for (uint32_t x = 0; x < ctx->concurrency; x++) {
+		struct worker *w = &ctx->workers[x];
+
+		for (uint32_t y = 0; y < HIST_LEN; y++)
+			hist[y] += w->hist[y];
+
+		requests += w->requests;
+		errors += w->errors;
+		bytes += w->bytes;
+	}
+
+	float seconds = elapsed / 1000.0f;
+	float rate = seconds > 0.0f ? (float) requests / seconds : 0.0f;
+	float mbps = seconds > 0.0f ? (float) bytes / seconds / (1024.0f * 1024.0f) : 0.0f;
+
+	double sum = 0.0;
+	float min = 0.0f;
+	float max = 0.0f;
+
+	for (uint32_t x = 0; x < HIST_LEN; x++) {
+		if (hist[x] == 0)
+			continue;
+
+		float v = (float) hist_value(x) / 1000000.0f;
+
+		if (min == 0.0f)
+			min = v;
+
+		max = v;
+		sum += (double) v * (double) hist[x];
+	}
+
+	float mean = requests > 0 ? (float) (sum / (double) requests) : 0.0f;
+
+	float pct[REPORT_LEN];
+	for (uint32_t x = 0; x < REPORT_LEN; x++)
+		pct[x] = requests > 0 ? hist_percentile(hist, requests, REPORT_PERCENTILES[x]) : 0.0f;
+
+	if (ctx->json) {
+		MTY_JSON *j = MTY_JSONObjCreate();
+		MTY_JSONObjSetString(j, "mode", report_mode(ctx->mode));
+		MTY_JSONObjSetString(j, "host", ctx->host);
+		MTY_JSONObjSetUInt(j, "port", ctx->port);
+		MTY_JSONObjSetBool(j, "tls", ctx->tls);
+		MTY_JSONObjSetBool(j, "loopback", ctx->loopback);
+		MTY_JSONObjSetUInt(j, "concurrency", ctx->concurrency);
+		MTY_JSONObjSetUInt(j, "size", (uint32_t) ctx->size);
+		MTY_JSONObjSetUInt(j, "post", ctx->post);
+		MTY_JSONObjSetFloat(j, "seconds", seconds);
+		MTY_JSONObjSetUInt(j, "requests", (uint32_t) requests);
+		MTY_JSONObjSetUInt(j, "errors", (uint32_t) errors);
+		MTY_JSONObjSetFloat(j, "rate", rate);
+		MTY_JSONObjSetFloat(j, "mbps", mbps);
+
+		MTY_JSON *lat = MTY_JSONObjCreate();
+		MTY_JSONObjSetFloat(lat, "min", min);
+		MTY_JSONObjSetFloat(lat, "mean", mean);
+
+		for (uint32_t x = 0; x < REPORT_LEN; x++)
+			MTY_JSONObjSetFloat(lat, REPORT_KEYS[x], pct[x]);
+
+		MTY_JSONObjSetFloat(lat, "max", max);
+
+		// The object takes ownership of the item
+		MTY_JSONObjSetItem(j, "latencyMs", lat);
+
+		char *str = MTY_JSONSerialize(j);
+		printf("%s\n", str);
+
+		MTY_Free(str);
+		MTY_JSONDestroy(&j);
+
+	} else {
+		printf("mode         %s%s\n", report_mode(ctx->mode), ctx->tls ? " (TLS)" : "");
+		printf("target       %s:%u%s\n", ctx->host, ctx->port, ctx->loopback ? " (loopback)" : "");
+		printf("concurrency  %u\n", ctx->concurrency);
+		printf("size         %zu bytes, %u%% POST\n", ctx->size, ctx->post);
+		printf("duration     %.2f s\n", seconds);
+		printf("requests     %" PRIu64 " (%" PRIu64 " errors)\n", requests, errors);
+		printf("throughput   %.1f req/s, %.2f MiB/s\n", rate, mbps);
+		printf("latency ms   min %.3f, mean %.3f, max %.3f\n", min, mean, max);
+
+		for (uint32_t x = 0; x < REPORT_LEN; x++)
+			printf("  %-10s %.3f\n", REPORT_KEYS[x], pct[x]);
+	}
+
+	MTY_Free(hist);
+}
+
+
+// Main
+
+static void usage(void)
+{
+	printf(
+		"Usage: loadgen [options]\n"
+		"  --mode <http|http-async|ws>  Request type (default http)\n"
+		"  --host <host>                Target host, omit to use an in-process loopback server\n"
+		"  --port <port>                Target or loopback port\n"
+		"  --tls                        Use HTTPS or WSS, requires --host\n"
+		"  --concurrency <n>            Concurrent requests or connections (default 8)\n"
+		"  --duration <seconds>         Length of the run (default 5)\n"
+		"  --size <bytes>               Response body, POST body, or message size (default 64)\n"
+		"  --post <percent>             Percentage of HTTP requests that are POSTs (default 0)\n"
+		"  --json                       Print the report as JSON\n"
+	);
+}
+
+static bool parse_args(struct context *ctx, int argc, char **argv)
+{
+	ctx->concurrency = 8;
+	ctx->duration = 5.0f;
+	ctx->size = 64;
+
+	for (int x = 1; x < argc; x++) {
+		const char *arg = argv[x];
+		const char *val = x + 1 < argc ? argv[x + 1] : NULL;
+
+		if (!strcmp(arg, "--tls")) {
+			ctx->tls = true;
+
+		} else if (!strcmp(arg, "--json")) {
+			ctx->json = true;
+
+		} else if (!val) {
+			return false;
+
+		} else {
+			if (!strcmp(arg, "--mode")) {
+				if (!strcmp(val, "http")) {
+					ctx->mode = MODE_HTTP;
+
+				} else if (!strcmp(val, "http-async")) {
+					ctx->mode = MODE_HTTP_ASYNC;
+
+				} else if (!strcmp(val, "ws")) {
+					ctx->mode = MODE_WS;
+
+				} else {
+					return false;
+				}
+
+			} else if (!strcmp(arg, "--host")) {
+				ctx->host = val;
+
+			} else if (!strcmp(arg, "--port")) {
+				ctx->port = (uint16_t) atoi(val);
+
+			} else if (!strcmp(arg, "--concurrency")) {
+				ctx->concurrency = (uint32_t) atoi(val);
+
+			} else if (!strcmp(arg, "--duration")) {
+				ctx->duration = (float) atof(val);
+
+			} else if (!strcmp(arg, "--size")) {
+				ctx->size = (size_t) atol(val);
+
+			} else if (!strcmp(arg, "--post")) {
+				ctx->post = (uint32_t) atoi(val);
+
+			} else {
+				return false;
+			}
+
+			x++;
+		}
+	}
+
+	if (ctx->concurrency == 0 || ctx->duration <= 0.0f || ctx->post > 100)
+		return false;
+
+	// The loopback servers do not implement TLS
+	if (ctx->tls && !ctx->host) {
+		printf("--tls requires --host\n");
+		return false;
+	}
+
+	return true;
+}
+
+int main(int argc, char **argv)
+{
+	struct context ctx = {0};
+	ctx.listener = LG_INVALID_SOCKET;
+
+	if (!parse_args(&ctx, argc, argv)) {
+		usage();
+		return 1;
+	}
+
+	#if defined(_WIN32)
+		WSADATA wsa = {0};
+		WSAStartup(MAKEWORD(2, 2), &wsa);
+	#endif
+
+	// Without a target host, a matching server runs in this process
+	int32_t r = 0;
+
+	if (!ctx.host) {
+		ctx.loopback = true;
+		ctx.host = "127.0.0.1";
+
+		bool ok = ctx.mode == MODE_WS ? server_ws_start(&ctx) : server_http_start(&ctx);
+
+		if (!ok) {
+			printf("Failed to start the loopback server on port %u\n", ctx.port);
+			r = 1;
+			goto except;
+		}
+	}
+
+	// WebSocket messages are strings
+	ctx.payload = MTY_Alloc(ctx.size + 1, 1);
+	memset(ctx.payload, 'x', ctx.size);
+
+	ctx.workers = MTY_Alloc(ctx.concurrency, sizeof(struct worker));
+
+	for (uint32_t x = 0; x < ctx.concurrency; x++) {
+		ctx.workers[x].ctx = &ctx;
+		ctx.workers[x].rng = 0x9E3779B9 + x;
+	}
+
+	MTY_Time begin = MTY_GetTime();
+
+	if (ctx.mode == MODE_HTTP_ASYNC) {
+		load_http_async(&ctx);
+
+	} else {
+		MTY_ThreadFunc func = ctx.mode == MODE_WS ? load_ws_thread : load_http_thread;
+
+		for (uint32_t x = 0; x < ctx.concurrency; x++)
+			ctx.workers[x].thread = MTY_ThreadCreate(func, &ctx.workers[x]);
+
+		MTY_Sleep((uint32_t) (ctx.duration * 1000.0f));
+		MTY_Atomic32Set(&ctx.stop, 1);
+
+		for (uint32_t x = 0; x < ctx.concurrency; x++)
+			MTY_ThreadDestroy(&ctx.workers[x].thread);
+	}
+
+	report(&ctx, MTY_TimeDiff(begin, MTY_GetTime()));
+
+	except:
+
+	MTY_Atomic32Set(&ctx.stop, 1);
+
+	if (ctx.loopback) {
+		if (ctx.mode == MODE_WS) {
+			server_ws_stop(&ctx);
+
+		} else {
+			server_http_stop(&ctx);
+		}
+	}
+
+	MTY_Free(ctx.workers);
+	MTY_Free(ctx.payload);
+
+	#if defined(_WIN32)
+		WSACleanup();
+	#endif
+
+	return r;
+}
@@ -0,0 +1,96 @@
+// Copyright (c) Christopher D. Dickson <cdd@matoya.group>
+//
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+#include "matoya.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "targets.h"
+
+// Built once per target with -DFUZZ_TARGET="name". With libFuzzer
+// (-fsanitize=fuzzer) only LLVMFuzzerTestOneInput is used, otherwise
+// FUZZ_STANDALONE adds a main that runs each file or directory given on the
+// command line, or stdin with no arguments, which is what AFL expects.
+
+#if !defined(FUZZ_TARGET)
+	#error FUZZ_TARGET must name one of the targets in targets.h
+#endif
+
+static FUZZ_FUNC fuzz_find(const char *name)
+{
+	for (size_t x = 0; x < FUZZ_TARGETS_LEN; x++)
+		if (!strcmp(FUZZ_TARGETS[x].name, name))
+			return FUZZ_TARGETS[x].func;
+
+	return NULL;
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+	static FUZZ_FUNC func;
+
+	if (!func) {
+		func = fuzz_find(FUZZ_TARGET);
+		if (!func)
+			abort();
+	}
+
+	return func(data, size);
+}
+
+#if defined(FUZZ_STANDALONE)
+
+static void fuzz_run_file(const char *path)
+{
+	size_t size = 0;
+	void *data = MTY_ReadFile(path, &size);
+
+	if (data) {
+		LLVMFuzzerTestOneInput(data, size);
+		MTY_Free(data);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	if (argc < 2) {
+		uint8_t *data = NULL;
+		size_t size = 0;
+
+		for (size_t n = 1; n > 0; size += n) {
+			data = MTY_Realloc(data, size + 4096, 1);
+			n = fread(data + size, 1, 4096, stdin);
+		}
+
+		LLVMFuzzerTestOneInput(data, size);
+		MTY_Free(data);
+
+		return 0;
+	}
+
+	for (int x = 1; x < argc; x++) {
+		MTY_FileList *list = MTY_GetFileList(argv[x], NULL);
+
+		if (list && list->len > 0) {
+			for (uint32_t y = 0; y < list->len; y++)
+				if (!list->files[y].dir)
+					fuzz_run_file(list->files[y].path);
+
+		} else {
+			fuzz_run_file(argv[x]);
+		}
+
+		MTY_FreeFileList(&list);
+	}
+
+	return 0;
+}
+
+#endif
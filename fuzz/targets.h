@@ -0,0 +1,295 @@
+// Copyright (c) Christopher D. Dickson <cdd@matoya.group>
+//
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+// Fuzz targets shared by the libFuzzer/AFL harness in fuzz/main.c and the
+// corpus replay in test/fuzz.h. Each target must accept arbitrary input, a
+// failed invariant calls abort() so the fuzzer records the input.
+
+#include "matoya.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "net/net.h"
+#include "net/http.h"
+#include "net/gzip.h"
+#include "net/ws.h"
+
+#define FUZZ_FIELDS 32
+
+typedef int (*FUZZ_FUNC)(const uint8_t *data, size_t size);
+
+static char *fuzz_str(const uint8_t *data, size_t size)
+{
+	char *str = MTY_Alloc(size + 1, 1);
+	memcpy(str, data, size);
+
+	return str;
+}
+
+
+// HTTP headers
+
+static int fuzz_http(const uint8_t *data, size_t size)
+{
+	MTY_HttpField fields[FUZZ_FIELDS];
+
+	for (uint8_t x = 0; x < 2; x++) {
+		MTY_HttpMessage msg = {0};
+		MTY_HttpParseResult r = MTY_HttpParseMessage(data, size, 0, x == 1, fields, FUZZ_FIELDS, &msg);
+
+		if (r == MTY_HTTP_PARSE_OK) {
+			if (msg.size > size || msg.numFields > FUZZ_FIELDS)
+				abort();
+
+			MTY_HttpGetField(&msg, "Content-Length");
+		}
+
+		// Feeding the same bytes in two reads must reach the same result
+		if (size > 0) {
+			size_t split = data[0] % size;
+
+			MTY_HttpMessage imsg = {0};
+			MTY_HttpParseResult ir = MTY_HttpParseMessage(data, split, 0, x == 1, fields, FUZZ_FIELDS, &imsg);
+
+			if (ir == MTY_HTTP_PARSE_PARTIAL)
+				ir = MTY_HttpParseMessage(data, size, split, x == 1, fields, FUZZ_FIELDS, &imsg);
+
+			if ((ir == MTY_HTTP_PARSE_OK) != (r == MTY_HTTP_PARSE_OK) ||
+				(r == MTY_HTTP_PARSE_OK && imsg.size != msg.size))
+				abort();
+		}
+	}
+
+	// Internal wrapper used by the request and WebSocket code
+	char *str = fuzz_str(data, size);
+	struct http_header *hdr = mty_http_parse_header(str);
+
+	if (hdr) {
+		uint16_t status = 0;
+		int32_t len = 0;
+		const char *val = NULL;
+
+		mty_http_get_status_code(hdr, &status);
+		mty_http_get_header_int(hdr, "Content-Length", &len);
+		mty_http_get_header_str(hdr, "Transfer-Encoding", &val);
+		mty_http_header_destroy(&hdr);
+	}
+
+	MTY_Free(str);
+
+	return 0;
+}
+
+
+// Response bodies (Content-Length, chunked, gzip)
+
+static int fuzz_chunked(const uint8_t *data, size_t size)
+{
+	struct net *net = mty_net_wrap_buffer(data, size);
+	struct http_header *hdr = mty_http_read_header(net, 0);
+
+	if (hdr) {
+		void *res = NULL;
+		size_t res_size = 0;
+
+		if (mty_http_read_body(net, hdr, 0, &res, &res_size) && res_size > 0 && !res)
+			abort();
+
+		MTY_Free(res);
+		mty_http_header_destroy(&hdr);
+	}
+
+	mty_net_destroy(&net);
+
+	return 0;
+}
+
+
+// WebSocket frames
+
+static int fuzz_ws(const uint8_t *data, size_t size)
+{
+	MTY_WebSocket *ws = mty_ws_wrap(mty_net_wrap_buffer(data, size), true);
+
+	char msg[1024];
+	MTY_Async r = MTY_ASYNC_OK;
+
+	while (r == MTY_ASYNC_OK || r == MTY_ASYNC_CONTINUE) {
+		r = MTY_WebSocketRead(ws, 0, msg, sizeof(msg));
+
+		if (r == MTY_ASYNC_OK && msg[sizeof(msg) - 1] != '\0')
+			abort();
+	}
+
+	MTY_WebSocketGetCloseCode(ws);
+	MTY_WebSocketDestroy(&ws);
+
+	return 0;
+}
+
+
+// URLs
+
+static int fuzz_url(const uint8_t *data, size_t size)
+{
+	char *url = fuzz_str(data, size);
+
+	// Small buffers so truncation paths are reached
+	char host[32];
+	char path[64];
+
+	if (MTY_HttpParseUrl(url, host, sizeof(host), path, sizeof(path)))
+		if (!memchr(host, '\0', sizeof(host)) || !memchr(path, '\0', sizeof(path)))
+			abort();
+
+	// Every component must lie within the input
+	MTY_HttpUrl parts = {0};
+	if (MTY_HttpSplitUrl((const char *) data, size, &parts)) {
+		const char *end = (const char *) data + size;
+
+		if (parts.path < (const char *) data || parts.path + parts.pathLen > end)
+			abort();
+
+		if (parts.host && (parts.host < (const char *) data || parts.host + parts.hostLen > end))
+			abort();
+
+		size_t iter = 0;
+		MTY_HttpField param = {0};
+
+		while (MTY_HttpGetNextQueryParam(parts.query, parts.queryLen, &iter, &param))
+			if (param.value + param.valueLen > parts.query + parts.queryLen)
+				abort();
+	}
+
+	// Decoding what was encoded gives back the input
+	size_t enc_size = size * 3 + 1;
+	char *enc = MTY_Alloc(enc_size, 1);
+	char *dec = MTY_Alloc(size + 1, 1);
+
+	if (!MTY_HttpPercentEncode(data, size, MTY_URL_ENCODE_COMPONENT, enc, enc_size))
+		abort();
+
+	if (!MTY_HttpPercentDecode(enc, strlen(enc), false, dec, size + 1) || memcmp(dec, data, size))
+		abort();
+
+	MTY_Free(dec);
+	MTY_Free(enc);
+	MTY_Free(url);
+
+	return 0;
+}
+
+
+// gzip
+
+static int fuzz_gzip(const uint8_t *data, size_t size)
+{
+	size_t out_size = 0;
+	void *out = mty_gzip_decompress(data, size, &out_size);
+
+	MTY_Free(out);
+
+	return 0;
+}
+
+
+// JSON
+
+static int fuzz_json(const uint8_t *data, size_t size)
+{
+	char *str = fuzz_str(data, size);
+	MTY_JSON *j = MTY_JSONParse(str);
+
+	// Anything that parses must serialize to something that parses again
+	if (j) {
+		char *ser = MTY_JSONSerialize(j);
+		MTY_JSON *j2 = MTY_JSONParse(ser);
+		if (!j2)
+			abort();
+
+		MTY_JSONDestroy(&j2);
+		MTY_Free(ser);
+		MTY_JSONDestroy(&j);
+	}
+
+	MTY_Free(str);
+
+	return 0;
+}
+
+
+// Images
+
+static int fuzz_image(const uint8_t *data, size_t size)
+{
+	uint32_t w = 0;
+	uint32_t h = 0;
+	void *image = MTY_DecompressImage(data, size, &w, &h);
+
+	if (image && (w == 0 || h == 0))
+		abort();
+
+	MTY_Free(image);
+
+	return 0;
+}
+
+
+// HID reports, via controller recordings so every driver is reachable
+
+static int fuzz_hid(const uint8_t *data, size_t size)
+{
+	uint8_t *buf = MTY_Alloc(size + 8, 1);
+	memcpy(buf, "MTYCTRL1", 8);
+	memcpy(buf + 8, data, size);
+
+	MTY_ControllerReplay *ctx = MTY_ControllerReplayCreate(buf, size + 8);
+
+	if (ctx) {
+		MTY_Event evt = {0};
+		uint64_t ts = 0;
+
+		while (MTY_ControllerReplayNext(ctx, &evt, &ts)) {
+			if (evt.type != MTY_EVENT_CONTROLLER)
+				continue;
+
+			if (evt.controller.numButtons > MTY_CBUTTON_MAX || evt.controller.numAxes > MTY_CAXIS_MAX)
+				abort();
+
+			uint8_t out[128];
+			size_t touch = 0;
+
+			MTY_ControllerReplayRumble(ctx, evt.controller.id, 0xFFFF, 0x8000, out, sizeof(out));
+			MTY_ControllerReplayGetTouchpad(ctx, evt.controller.id, &touch);
+		}
+
+		MTY_ControllerReplayDestroy(&ctx);
+	}
+
+	MTY_Free(buf);
+
+	return 0;
+}
+
+
+// Registry
+
+static const struct fuzz_target {
+	const char *name;
+	FUZZ_FUNC func;
+} FUZZ_TARGETS[] = {
+	{"http",    fuzz_http},
+	{"chunked", fuzz_chunked},
+	{"ws",      fuzz_ws},
+	{"url",     fuzz_url},
+	{"gzip",    fuzz_gzip},
+	{"json",    fuzz_json},
+	{"image",   fuzz_image},
+	{"hid",     fuzz_hid},
+};
+
+#define FUZZ_TARGETS_LEN (sizeof(FUZZ_TARGETS) / sizeof(FUZZ_TARGETS[0]))
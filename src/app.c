@@ -8,6 +8,8 @@
 
 #include <stdio.h>
 
+#include "metrics.h"
+
 
 // GFX
 
@@ -75,6 +77,15 @@ bool MTY_WindowSetUITexture(MTY_App *app, MTY_Window window, uint32_t id, const
 	return api != MTY_GFX_NONE && GFX_CTX_API[api].set_ui_texture(gfx_ctx, id, rgba, width, height);
 }
 
+void MTY_WindowSetUIAtlas(MTY_App *app, MTY_Window window, uint32_t pageSize)
+{
+	struct gfx_ctx *gfx_ctx = NULL;
+	MTY_GFX api = mty_window_get_gfx(app, window, &gfx_ctx);
+
+	if (api != MTY_GFX_NONE)
+		GFX_CTX_API[api].set_ui_atlas(gfx_ctx, pageSize);
+}
+
 bool MTY_WindowMakeCurrent(MTY_App *app, MTY_Window window, bool current)
 {
 	struct gfx_ctx *gfx_ctx = NULL;
@@ -88,8 +99,34 @@ void MTY_WindowPresent(MTY_App *app, MTY_Window window, uint32_t numFrames)
 	struct gfx_ctx *gfx_ctx = NULL;
 	MTY_GFX api = mty_window_get_gfx(app, window, &gfx_ctx);
 
+	if (api == MTY_GFX_NONE)
+		return;
+
+	#if defined(MTY_METRICS)
+		MTY_Time start = MTY_GetTime();
+	#endif
+
+	GFX_CTX_API[api].present(gfx_ctx, numFrames);
+
+	METRIC_OBSERVE("mty_present_ms", "Time spent in MTY_WindowPresent in milliseconds.",
+		MTY_TimeDiff(start, MTY_GetTime()), 1, 2, 4, 8, 12, 16, 20, 25, 33, 50, 100);
+}
+
+void MTY_WindowSetFramesInFlight(MTY_App *app, MTY_Window window, uint32_t frames)
+{
+	struct gfx_ctx *gfx_ctx = NULL;
+	MTY_GFX api = mty_window_get_gfx(app, window, &gfx_ctx);
+
 	if (api != MTY_GFX_NONE)
-		GFX_CTX_API[api].present(gfx_ctx, numFrames);
+		GFX_CTX_API[api].set_frames_in_flight(gfx_ctx, frames);
+}
+
+bool MTY_WindowGetPresentStats(MTY_App *app, MTY_Window window, MTY_PresentStats *stats)
+{
+	struct gfx_ctx *gfx_ctx = NULL;
+	MTY_GFX api = mty_window_get_gfx(app, window, &gfx_ctx);
+
+	return api != MTY_GFX_NONE && GFX_CTX_API[api].get_present_stats(gfx_ctx, stats);
 }
 
 MTY_GFX MTY_WindowGetGFX(MTY_App *app, MTY_Window window)
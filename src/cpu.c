@@ -0,0 +1,327 @@
+// Copyright (c) Christopher D. Dickson <cdd@matoya.group>
+//
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+#define _DARWIN_C_SOURCE // sysctlbyname
+
+#include "matoya.h"
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cpuinfo.h"
+
+#define CPU_ENV "MTY_CPU_DISABLE"
+
+static MTY_Atomic32 CPU_GLOCK;
+static MTY_Atomic32 CPU_INIT;
+static MTY_CPUInfo CPU_INFO;
+
+static const struct {
+	const char *name;
+	MTY_CPUFeature feature;
+} CPU_NAMES[] = {
+	{"sse42",   MTY_CPU_SSE42},
+	{"avx2",    MTY_CPU_AVX2},
+	{"avx512",  MTY_CPU_AVX512},
+	{"pclmul",  MTY_CPU_PCLMUL},
+	{"aes",     MTY_CPU_AES},
+	{"sha",     MTY_CPU_SHA},
+	{"neon",    MTY_CPU_NEON},
+	{"crc32",   MTY_CPU_CRC32},
+	{"arm-aes", MTY_CPU_ARM_AES},
+	{"pmull",   MTY_CPU_PMULL},
+	{"arm-sha", MTY_CPU_ARM_SHA},
+};
+
+#define CPU_NAMES_LEN (sizeof(CPU_NAMES) / sizeof(CPU_NAMES[0]))
+
+
+// x86
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+
+#if defined(_MSC_VER)
+
+#include <intrin.h>
+
+static void cpu_cpuid(uint32_t leaf, uint32_t sub, uint32_t regs[4])
+{
+	int32_t r[4];
+	__cpuidex(r, leaf, sub);
+
+	memcpy(regs, r, sizeof(r));
+}
+
+static uint64_t cpu_xgetbv(void)
+{
+	return _xgetbv(0);
+}
+
+#else
+
+#include <cpuid.h>
+
+static void cpu_cpuid(uint32_t leaf, uint32_t sub, uint32_t regs[4])
+{
+	__cpuid_count(leaf, sub, regs[0], regs[1], regs[2], regs[3]);
+}
+
+static uint64_t cpu_xgetbv(void)
+{
+	uint32_t eax = 0;
+	uint32_t edx = 0;
+
+	__asm__ __volatile__ ("xgetbv" : "=a" (eax), "=d" (edx) : "c" (0));
+
+	return (uint64_t) edx << 32 | eax;
+}
+
+#endif
+
+static void cpu_get_arch_info(MTY_CPUInfo *info)
+{
+	uint32_t r[4] = {0};
+	cpu_cpuid(0, 0, r);
+
+	uint32_t max = r[0];
+	if (max < 1)
+		return;
+
+	cpu_cpuid(1, 0, r);
+
+	uint32_t ecx1 = r[2];
+
+	if (info->cacheLine == 0)
+		info->cacheLine = ((r[1] >> 8) & 0xFF) * 8;
+
+	if (ecx1 & (1 << 20))
+		info->features |= MTY_CPU_SSE42;
+
+	if (ecx1 & (1 << 1))
+		info->features |= MTY_CPU_PCLMUL;
+
+	if (ecx1 & (1 << 25))
+		info->features |= MTY_CPU_AES;
+
+	// AVX state must be enabled by the OS via XCR0 before any AVX instruction
+	// can be used, regardless of what the CPU reports
+	uint64_t xcr0 = (ecx1 & (1 << 27)) ? cpu_xgetbv() : 0;
+	bool os_ymm = (xcr0 & 0x6) == 0x6;
+	bool os_zmm = (xcr0 & 0xE6) == 0xE6;
+
+	if (max < 7)
+		return;
+
+	cpu_cpuid(7, 0, r);
+
+	uint32_t ebx7 = r[1];
+
+	if (os_ymm && (ecx1 & (1 << 28)) && (ebx7 & (1 << 5)))
+		info->features |= MTY_CPU_AVX2;
+
+	// F, DQ, BW, VL
+	uint32_t avx512 = (1 << 16) | (1 << 17) | (1 << 30) | (1u << 31);
+
+	if (os_zmm && (info->features & MTY_CPU_AVX2) && (ebx7 & avx512) == avx512)
+		info->features |= MTY_CPU_AVX512;
+
+	if (ebx7 & (1 << 29))
+		info->features |= MTY_CPU_SHA;
+}
+
+#else
+
+static void cpu_get_arch_info(MTY_CPUInfo *info)
+{
+}
+
+#endif
+
+
+// Environment override
+
+static void cpu_get_env(char *buf, size_t size)
+{
+	#if defined(_WIN32)
+		size_t len = 0;
+		if (getenv_s(&len, buf, size, CPU_ENV) != 0 || len == 0)
+			buf[0] = '\0';
+	#else
+		const char *env = getenv(CPU_ENV);
+		snprintf(buf, size, "%s", env ? env : "");
+	#endif
+}
+
+static uint32_t cpu_get_disabled(void)
+{
+	char env[256];
+	cpu_get_env(env, sizeof(env));
+
+	uint32_t disabled = 0;
+	char *ptr = NULL;
+
+	for (char *tok = MTY_Strtok(env, ",", &ptr); tok; tok = MTY_Strtok(NULL, ",", &ptr)) {
+		if (!strcmp(tok, "all"))
+			return UINT32_MAX;
+
+		bool found = false;
+
+		for (size_t x = 0; x < CPU_NAMES_LEN && !found; x++) {
+			if (!strcmp(tok, CPU_NAMES[x].name)) {
+				disabled |= CPU_NAMES[x].feature;
+				found = true;
+			}
+		}
+
+		if (!found)
+			MTY_Log("Unknown CPU feature '%s' in %s", tok, CPU_ENV);
+	}
+
+	return disabled;
+}
+
+
+// Topology
+
+static uint32_t cpu_densify(MTY_LogicalCPU *cpus, uint32_t len, size_t offset)
+{
+	// Replace platform keys with indices assigned in order of first appearance
+	uint32_t *keys = MTY_Alloc(len, sizeof(uint32_t));
+	uint32_t n = 0;
+
+	for (uint32_t x = 0; x < len; x++) {
+		uint32_t *val = (uint32_t *) ((uint8_t *) &cpus[x] + offset);
+		uint32_t y = 0;
+
+		while (y < n && keys[y] != *val)
+			y++;
+
+		if (y == n)
+			keys[n++] = *val;
+
+		*val = y;
+	}
+
+	MTY_Free(keys);
+
+	return n;
+}
+
+static uint32_t cpu_count_nodes(const MTY_LogicalCPU *cpus, uint32_t len)
+{
+	uint32_t n = 0;
+
+	for (uint32_t x = 0; x < len; x++) {
+		bool found = false;
+
+		for (uint32_t y = 0; y < x && !found; y++)
+			found = cpus[y].node == cpus[x].node;
+
+		if (!found)
+			n++;
+	}
+
+	return n;
+}
+
+
+// Public
+
+static const MTY_CPUInfo *cpu_get_info(void)
+{
+	if (MTY_Atomic32Get(&CPU_INIT))
+		return &CPU_INFO;
+
+	MTY_GlobalLock(&CPU_GLOCK);
+
+	if (!MTY_Atomic32Get(&CPU_INIT)) {
+		MTY_CPUInfo info = {0};
+
+		mty_cpu_get_os_info(&info);
+		cpu_get_arch_info(&info);
+
+		if (info.cacheLine == 0)
+			info.cacheLine = 64;
+
+		if (info.threads == 0)
+			info.threads = 1;
+
+		if (info.cores == 0)
+			info.cores = info.threads;
+
+		info.features &= ~cpu_get_disabled();
+
+		CPU_INFO = info;
+		MTY_Atomic32Set(&CPU_INIT, 1);
+	}
+
+	MTY_GlobalUnlock(&CPU_GLOCK);
+
+	return &CPU_INFO;
+}
+
+uint32_t MTY_GetCPUFeatures(void)
+{
+	return cpu_get_info()->features;
+}
+
+void MTY_GetCPUInfo(MTY_CPUInfo *info)
+{
+	*info = *cpu_get_info();
+}
+
+void *MTY_SelectCPUImpl(const MTY_CPUImpl *impls, uint32_t count)
+{
+	uint32_t features = MTY_GetCPUFeatures();
+
+	for (uint32_t x = 0; x < count; x++)
+		if ((impls[x].features & features) == impls[x].features)
+			return impls[x].func;
+
+	return NULL;
+}
+
+MTY_CPUTopology *MTY_GetCPUTopology(void)
+{
+	MTY_CPUTopology *topo = MTY_Alloc(1, sizeof(MTY_CPUTopology));
+
+	if (mty_cpu_get_os_topology(topo)) {
+		topo->numCores = cpu_densify(topo->cpus, topo->numCPUs, offsetof(MTY_LogicalCPU, core));
+		topo->numLLCs = cpu_densify(topo->cpus, topo->numCPUs, offsetof(MTY_LogicalCPU, llc));
+		topo->numNodes = cpu_count_nodes(topo->cpus, topo->numCPUs);
+
+	} else {
+		// Each logical processor is its own core sharing a single cache and node
+		MTY_Free(topo->cpus);
+
+		topo->numCPUs = cpu_get_info()->threads;
+		topo->cpus = MTY_Alloc(topo->numCPUs, sizeof(MTY_LogicalCPU));
+
+		for (uint32_t x = 0; x < topo->numCPUs; x++)
+			topo->cpus[x].id = topo->cpus[x].core = x;
+
+		topo->numCores = topo->numCPUs;
+		topo->numLLCs = 1;
+		topo->numNodes = 1;
+	}
+
+	return topo;
+}
+
+void MTY_FreeCPUTopology(MTY_CPUTopology **topology)
+{
+	if (!topology || !*topology)
+		return;
+
+	MTY_CPUTopology *topo = *topology;
+
+	MTY_Free(topo->cpus);
+
+	MTY_Free(topo);
+	*topology = NULL;
+}
@@ -40,6 +40,11 @@ void *MTY_ReadFile(const char *path, size_t *size)
 	return buf;
 }
 
+size_t MTY_GetFileSize(const char *path)
+{
+	return fsutil_size(path);
+}
+
 bool MTY_WriteFile(const char *path, const void *buf, size_t size)
 {
 	FILE *f = fsutil_open(path, "wb");
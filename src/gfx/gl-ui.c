@@ -31,6 +31,9 @@ struct gl_ui {
 	GLint loc_col;
 	GLuint vb;
 	GLuint eb;
+
+	// The program belongs to the parent in a share group
+	bool shared;
 };
 
 static int32_t GL_UI_ORIGIN_Y;
@@ -125,6 +128,21 @@ struct gfx_ui *mty_gl_ui_create(MTY_Device *device)
 	return (struct gfx_ui *) ctx;
 }
 
+struct gfx_ui *mty_gl_ui_create_shared(struct gfx_ui *parent)
+{
+	// The vertex and index buffers are resized and rewritten by every draw, so
+	// only the program is taken from the parent
+	struct gl_ui *ctx = MTY_Alloc(1, sizeof(struct gl_ui));
+	*ctx = *((struct gl_ui *) parent);
+
+	ctx->shared = true;
+
+	glGenBuffers(1, &ctx->vb);
+	glGenBuffers(1, &ctx->eb);
+
+	return (struct gfx_ui *) ctx;
+}
+
 bool mty_gl_ui_render(struct gfx_ui *gfx_ui, MTY_Device *device, MTY_Context *context,
 	const MTY_DrawData *dd, MTY_Hash *cache, MTY_Surface *dest)
 {
@@ -257,6 +275,18 @@ void *mty_gl_ui_create_texture(MTY_Device *device, const void *rgba, uint32_t wi
 	return (void *) (uintptr_t) texture;
 }
 
+bool mty_gl_ui_update_texture(MTY_Device *device, MTY_Context *context, void *texture,
+	const void *rgba, uint32_t stride, uint32_t x, uint32_t y, uint32_t width, uint32_t height)
+{
+	glBindTexture(GL_TEXTURE_2D, (GLuint) (uintptr_t) texture);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, stride);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, width, height, GL_RGBA, GL_UNSIGNED_BYTE, rgba);
+	glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+
+	return true;
+}
+
 void mty_gl_ui_destroy_texture(void **texture)
 {
 	if (!texture || !*texture)
@@ -281,22 +311,25 @@ void mty_gl_ui_destroy(struct gfx_ui **gfx_ui)
 	if (ctx->eb)
 		glDeleteBuffers(1, &ctx->eb);
 
-	if (ctx->prog) {
-		if (ctx->vs)
-			glDetachShader(ctx->prog, ctx->vs);
+	// Shared objects are deleted by the parent
+	if (!ctx->shared) {
+		if (ctx->prog) {
+			if (ctx->vs)
+				glDetachShader(ctx->prog, ctx->vs);
 
-		if (ctx->fs)
-			glDetachShader(ctx->prog, ctx->fs);
-	}
+			if (ctx->fs)
+				glDetachShader(ctx->prog, ctx->fs);
+		}
 
-	if (ctx->vs)
-		glDeleteShader(ctx->vs);
+		if (ctx->vs)
+			glDeleteShader(ctx->vs);
 
-	if (ctx->fs)
-		glDeleteShader(ctx->fs);
+		if (ctx->fs)
+			glDeleteShader(ctx->fs);
 
-	if (ctx->prog)
-		glDeleteProgram(ctx->prog);
+		if (ctx->prog)
+			glDeleteProgram(ctx->prog);
+	}
 
 	free(ctx);
 	*gfx_ui = NULL;
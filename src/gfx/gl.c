@@ -8,6 +8,7 @@
 GFX_PROTOTYPES(_gl_)
 
 #include <stdio.h>
+#include <string.h>
 
 #include "glproc.h"
 #include "gfx/viewport.h"
@@ -18,6 +19,7 @@ GFX_PROTOTYPES(_gl_)
 #define GL_NUM_STAGING 3
 
 struct gl_rtv {
+	GLint internal;
 	GLenum format;
 	GLuint texture;
 	GLuint fb;
@@ -29,6 +31,9 @@ struct gl {
 	MTY_ColorFormat format;
 	struct gl_rtv staging[GL_NUM_STAGING];
 
+	// The program and static buffers belong to the parent in a share group
+	bool shared;
+
 	GLuint vs;
 	GLuint fs;
 	GLuint prog;
@@ -40,6 +45,9 @@ struct gl {
 	GLuint loc_uv;
 	GLuint loc_fcb;
 	GLuint loc_icb;
+	GLuint loc_ccb;
+	GLuint loc_hcb;
+	GLuint loc_tcb;
 };
 
 static int32_t GL_ORIGIN_Y;
@@ -111,6 +119,9 @@ struct gfx *mty_gl_create(MTY_Device *device)
 	ctx->loc_uv = glGetAttribLocation(ctx->prog, "texcoord");
 	ctx->loc_fcb = glGetUniformLocation(ctx->prog, "fcb");
 	ctx->loc_icb = glGetUniformLocation(ctx->prog, "icb");
+	ctx->loc_ccb = glGetUniformLocation(ctx->prog, "ccb");
+	ctx->loc_hcb = glGetUniformLocation(ctx->prog, "hcb");
+	ctx->loc_tcb = glGetUniformLocation(ctx->prog, "tcb");
 
 	for (uint8_t x = 0; x < GL_NUM_STAGING; x++) {
 		char name[32];
@@ -157,6 +168,19 @@ struct gfx *mty_gl_create(MTY_Device *device)
 	return (struct gfx *) ctx;
 }
 
+struct gfx *mty_gl_create_shared(struct gfx *parent)
+{
+	// Objects are shared between contexts in the same share group except for the
+	// staging textures, which are rewritten by every draw
+	struct gl *ctx = MTY_Alloc(1, sizeof(struct gl));
+	*ctx = *((struct gl *) parent);
+
+	memset(ctx->staging, 0, sizeof(ctx->staging));
+	ctx->shared = true;
+
+	return (struct gfx *) ctx;
+}
+
 static void gl_rtv_destroy(struct gl_rtv *rtv)
 {
 	if (rtv->texture) {
@@ -167,7 +191,7 @@ static void gl_rtv_destroy(struct gl_rtv *rtv)
 
 static void gl_rtv_refresh(struct gl_rtv *rtv, GLint internal, GLenum format, GLenum type, uint32_t w, uint32_t h)
 {
-	if (!rtv->texture || rtv->w != w || rtv->h != h || rtv->format != format) {
+	if (!rtv->texture || rtv->w != w || rtv->h != h || rtv->format != format || rtv->internal != internal) {
 		gl_rtv_destroy(rtv);
 
 		glGenTextures(1, &rtv->texture);
@@ -177,6 +201,7 @@ static void gl_rtv_refresh(struct gl_rtv *rtv, GLint internal, GLenum format, GL
 		rtv->w = w;
 		rtv->h = h;
 		rtv->format = format;
+		rtv->internal = internal;
 	}
 }
 
@@ -186,7 +211,10 @@ static void gl_reload_textures(struct gl *ctx, const void *image, const MTY_Rend
 		case MTY_COLOR_FORMAT_BGRA:
 		case MTY_COLOR_FORMAT_AYUV:
 		case MTY_COLOR_FORMAT_BGR565:
-		case MTY_COLOR_FORMAT_BGRA5551: {
+		case MTY_COLOR_FORMAT_BGRA5551:
+		case MTY_COLOR_FORMAT_Y410:
+		case MTY_COLOR_FORMAT_RGB10A2:
+		case MTY_COLOR_FORMAT_RGBA16F: {
 			GLenum internal = GL_RGBA;
 			GLenum format = GL_BGRA;
 			GLenum type = GL_UNSIGNED_BYTE;
@@ -201,6 +229,17 @@ static void gl_reload_textures(struct gl *ctx, const void *image, const MTY_Rend
 			} else if (desc->format == MTY_COLOR_FORMAT_BGRA5551) {
 				type = GL_UNSIGNED_SHORT_1_5_5_5_REV;
 				bpp = 2;
+
+			} else if (desc->format == MTY_COLOR_FORMAT_Y410 || desc->format == MTY_COLOR_FORMAT_RGB10A2) {
+				internal = GL_RGB10_A2;
+				format = GL_RGBA;
+				type = GL_UNSIGNED_INT_2_10_10_10_REV;
+
+			} else if (desc->format == MTY_COLOR_FORMAT_RGBA16F) {
+				internal = GL_RGBA16F;
+				format = GL_RGBA;
+				type = GL_HALF_FLOAT;
+				bpp = 8;
 			}
 
 			// BGRA
@@ -212,53 +251,144 @@ static void gl_reload_textures(struct gl *ctx, const void *image, const MTY_Rend
 			break;
 		}
 		case MTY_COLOR_FORMAT_NV12:
-		case MTY_COLOR_FORMAT_NV16: {
-			uint32_t div = desc->format == MTY_COLOR_FORMAT_NV12 ? 2 : 1;
+		case MTY_COLOR_FORMAT_NV16:
+		case MTY_COLOR_FORMAT_P010:
+		case MTY_COLOR_FORMAT_P016: {
+			uint32_t div = desc->format == MTY_COLOR_FORMAT_NV16 ? 1 : 2;
+			bool wide = desc->format == MTY_COLOR_FORMAT_P010 || desc->format == MTY_COLOR_FORMAT_P016;
+			GLenum type = wide ? GL_UNSIGNED_SHORT : GL_UNSIGNED_BYTE;
+			uint32_t bpc = wide ? 2 : 1;
 
 			// Y
-			gl_rtv_refresh(&ctx->staging[0], GL_R8, GL_RED, GL_UNSIGNED_BYTE, desc->cropWidth, desc->cropHeight);
+			gl_rtv_refresh(&ctx->staging[0], wide ? GL_R16 : GL_R8, GL_RED, type, desc->cropWidth, desc->cropHeight);
 			glBindTexture(GL_TEXTURE_2D, ctx->staging[0].texture);
-			glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+			glPixelStorei(GL_UNPACK_ALIGNMENT, bpc);
 			glPixelStorei(GL_UNPACK_ROW_LENGTH, desc->imageWidth);
-			glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, desc->cropWidth, desc->cropHeight, GL_RED, GL_UNSIGNED_BYTE, image);
+			glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, desc->cropWidth, desc->cropHeight, GL_RED, type, image);
 
 			// UV
-			gl_rtv_refresh(&ctx->staging[1], GL_RG8, GL_RG, GL_UNSIGNED_BYTE, desc->cropWidth / 2, desc->cropHeight / div);
+			gl_rtv_refresh(&ctx->staging[1], wide ? GL_RG16 : GL_RG8, GL_RG, type, desc->cropWidth / 2, desc->cropHeight / div);
 			glBindTexture(GL_TEXTURE_2D, ctx->staging[1].texture);
-			glPixelStorei(GL_UNPACK_ALIGNMENT, 2);
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 2 * bpc);
 			glPixelStorei(GL_UNPACK_ROW_LENGTH, desc->imageWidth / 2);
-			glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, desc->cropWidth / 2, desc->cropHeight / div, GL_RG, GL_UNSIGNED_BYTE, (uint8_t *) image + desc->imageWidth * desc->imageHeight);
+			glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, desc->cropWidth / 2, desc->cropHeight / div, GL_RG, type, (uint8_t *) image + desc->imageWidth * desc->imageHeight * bpc);
 			break;
 		}
 		case MTY_COLOR_FORMAT_I420:
-		case MTY_COLOR_FORMAT_I444: {
-			uint32_t div = desc->format == MTY_COLOR_FORMAT_I420 ? 2 : 1;
+		case MTY_COLOR_FORMAT_I444:
+		case MTY_COLOR_FORMAT_I010:
+		case MTY_COLOR_FORMAT_I410: {
+			uint32_t div = desc->format == MTY_COLOR_FORMAT_I420 || desc->format == MTY_COLOR_FORMAT_I010 ? 2 : 1;
+			bool wide = desc->format == MTY_COLOR_FORMAT_I010 || desc->format == MTY_COLOR_FORMAT_I410;
+			GLint internal = wide ? GL_R16 : GL_R8;
+			GLenum type = wide ? GL_UNSIGNED_SHORT : GL_UNSIGNED_BYTE;
+			uint32_t bpc = wide ? 2 : 1;
 
 			// Y
-			gl_rtv_refresh(&ctx->staging[0], GL_R8, GL_RED, GL_UNSIGNED_BYTE, desc->cropWidth, desc->cropHeight);
+			gl_rtv_refresh(&ctx->staging[0], internal, GL_RED, type, desc->cropWidth, desc->cropHeight);
 			glBindTexture(GL_TEXTURE_2D, ctx->staging[0].texture);
-			glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+			glPixelStorei(GL_UNPACK_ALIGNMENT, bpc);
 			glPixelStorei(GL_UNPACK_ROW_LENGTH, desc->imageWidth);
-			glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, desc->cropWidth, desc->cropHeight, GL_RED, GL_UNSIGNED_BYTE, image);
+			glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, desc->cropWidth, desc->cropHeight, GL_RED, type, image);
 
 			// U
-			uint8_t *p = (uint8_t *) image + desc->imageWidth * desc->imageHeight;
-			gl_rtv_refresh(&ctx->staging[1], GL_R8, GL_RED, GL_UNSIGNED_BYTE, desc->cropWidth / div, desc->cropHeight / div);
+			uint8_t *p = (uint8_t *) image + desc->imageWidth * desc->imageHeight * bpc;
+			gl_rtv_refresh(&ctx->staging[1], internal, GL_RED, type, desc->cropWidth / div, desc->cropHeight / div);
 			glBindTexture(GL_TEXTURE_2D, ctx->staging[1].texture);
 			glPixelStorei(GL_UNPACK_ROW_LENGTH, desc->imageWidth / div);
-			glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, desc->cropWidth / div, desc->cropHeight / div, GL_RED, GL_UNSIGNED_BYTE, p);
+			glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, desc->cropWidth / div, desc->cropHeight / div, GL_RED, type, p);
 
 			// V
-			p += (desc->imageWidth / div) * (desc->imageHeight / div);
-			gl_rtv_refresh(&ctx->staging[2], GL_R8, GL_RED, GL_UNSIGNED_BYTE, desc->cropWidth / div, desc->cropHeight / div);
+			p += (desc->imageWidth / div) * (desc->imageHeight / div) * bpc;
+			gl_rtv_refresh(&ctx->staging[2], internal, GL_RED, type, desc->cropWidth / div, desc->cropHeight / div);
 			glBindTexture(GL_TEXTURE_2D, ctx->staging[2].texture);
 			glPixelStorei(GL_UNPACK_ROW_LENGTH, desc->imageWidth / div);
-			glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, desc->cropWidth / div, desc->cropHeight / div, GL_RED, GL_UNSIGNED_BYTE, p);
+			glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, desc->cropWidth / div, desc->cropHeight / div, GL_RED, type, p);
 			break;
 		}
 	}
 }
 
+static void gl_color_space(MTY_ColorFormat format, const MTY_RenderDesc *desc, float ccb[4], float hcb[4])
+{
+	// Bits per component as sampled, high bit aligned 16-bit formats behave as 16-bit
+	uint32_t bits = 8;
+	float sample_scale = 1.0f;
+
+	switch (format) {
+		case MTY_COLOR_FORMAT_P010:
+		case MTY_COLOR_FORMAT_P016:
+			bits = 16;
+			break;
+		case MTY_COLOR_FORMAT_I010:
+		case MTY_COLOR_FORMAT_I410:
+			bits = 10;
+			sample_scale = 65535.0f / 1023.0f;
+			break;
+		case MTY_COLOR_FORMAT_Y410:
+			bits = 10;
+			break;
+		default:
+			break;
+	}
+
+	float max = (float) ((1u << bits) - 1);
+	float step = (float) (1u << (bits - 8));
+
+	if (desc->fullRange) {
+		ccb[0] = 0.0f;
+		ccb[1] = 1.0f;
+		ccb[2] = 128.0f * step / max;
+		ccb[3] = 1.0f;
+
+	} else {
+		ccb[0] = 16.0f * step / max;
+		ccb[1] = max / (219.0f * step);
+		ccb[2] = 128.0f * step / max;
+		ccb[3] = max / (224.0f * step);
+	}
+
+	switch (desc->matrix) {
+		case MTY_COLOR_MATRIX_BT601:
+			hcb[0] = 0.299f;
+			hcb[1] = 0.114f;
+			break;
+		case MTY_COLOR_MATRIX_BT2020:
+			hcb[0] = 0.2627f;
+			hcb[1] = 0.0593f;
+			break;
+		default:
+			hcb[0] = 0.2126f;
+			hcb[1] = 0.0722f;
+			break;
+	}
+
+	// Content peak relative to the 203 nit reference white (ITU-R BT.2408)
+	hcb[2] = sample_scale;
+	hcb[3] = (desc->maxLuminance > 0.0f ? desc->maxLuminance : 1000.0f) / 203.0f;
+}
+
+static bool gl_format_supported(MTY_ColorFormat format)
+{
+	#if defined(MTY_GL_ES)
+		// GLES 2 has no 16-bit normalized, half float, or 10-bit packed textures
+		switch (format) {
+			case MTY_COLOR_FORMAT_P010:
+			case MTY_COLOR_FORMAT_P016:
+			case MTY_COLOR_FORMAT_I010:
+			case MTY_COLOR_FORMAT_I410:
+			case MTY_COLOR_FORMAT_Y410:
+			case MTY_COLOR_FORMAT_RGB10A2:
+			case MTY_COLOR_FORMAT_RGBA16F:
+				return false;
+			default:
+				break;
+		}
+	#endif
+
+	return true;
+}
+
 bool mty_gl_render(struct gfx *gfx, MTY_Device *device, MTY_Context *context,
 	const void *image, const MTY_RenderDesc *desc, MTY_Surface *dest)
 {
@@ -266,6 +396,11 @@ bool mty_gl_render(struct gfx *gfx, MTY_Device *device, MTY_Context *context,
 	GLuint _dest = dest ? *((GLuint *) dest) : 0;
 
 	// Don't do anything until we have real data
+	if (!gl_format_supported(desc->format)) {
+		MTY_Log("MTY_ColorFormat %d is unsupported", desc->format);
+		return false;
+	}
+
 	if (desc->format != MTY_COLOR_FORMAT_UNKNOWN)
 		ctx->format = desc->format;
 
@@ -325,6 +460,14 @@ bool mty_gl_render(struct gfx *gfx, MTY_Device *device, MTY_Context *context,
 	glUniform4f(ctx->loc_fcb, (GLfloat) desc->cropWidth, (GLfloat) desc->cropHeight, vph, 0.0f);
 	glUniform4i(ctx->loc_icb, desc->filter, desc->effect, ctx->format, desc->rotation);
 
+	float ccb[4];
+	float hcb[4];
+	gl_color_space(ctx->format, desc, ccb, hcb);
+
+	glUniform4f(ctx->loc_ccb, ccb[0], ccb[1], ccb[2], ccb[3]);
+	glUniform4f(ctx->loc_hcb, hcb[0], hcb[1], hcb[2], hcb[3]);
+	glUniform4i(ctx->loc_tcb, desc->transfer, desc->matrix, 0, 0);
+
 	// Draw
 	glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, 0);
 
@@ -341,28 +484,31 @@ void mty_gl_destroy(struct gfx **gfx)
 	for (uint8_t x = 0; x < GL_NUM_STAGING; x++)
 		gl_rtv_destroy(&ctx->staging[x]);
 
-	if (ctx->vb)
-		glDeleteBuffers(1, &ctx->vb);
+	// Shared objects are deleted by the parent
+	if (!ctx->shared) {
+		if (ctx->vb)
+			glDeleteBuffers(1, &ctx->vb);
 
-	if (ctx->eb)
-		glDeleteBuffers(1, &ctx->eb);
+		if (ctx->eb)
+			glDeleteBuffers(1, &ctx->eb);
 
-	if (ctx->prog) {
-		if (ctx->vs)
-			glDetachShader(ctx->prog, ctx->vs);
+		if (ctx->prog) {
+			if (ctx->vs)
+				glDetachShader(ctx->prog, ctx->vs);
 
-		if (ctx->fs)
-			glDetachShader(ctx->prog, ctx->fs);
-	}
+			if (ctx->fs)
+				glDetachShader(ctx->prog, ctx->fs);
+		}
 
-	if (ctx->vs)
-		glDeleteShader(ctx->vs);
+		if (ctx->vs)
+			glDeleteShader(ctx->vs);
 
-	if (ctx->fs)
-		glDeleteShader(ctx->fs);
+		if (ctx->fs)
+			glDeleteShader(ctx->fs);
 
-	if (ctx->prog)
-		glDeleteProgram(ctx->prog);
+		if (ctx->prog)
+			glDeleteProgram(ctx->prog);
+	}
 
 	MTY_Free(ctx);
 	*gfx = NULL;
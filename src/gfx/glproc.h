@@ -80,6 +80,7 @@ static PFNGLCLEARCOLORPROC              glClearColor;
 static PFNGLGETERRORPROC                glGetError;
 static PFNGLGETSHADERINFOLOGPROC        glGetShaderInfoLog;
 static PFNGLFINISHPROC                  glFinish;
+static PFNGLFLUSHPROC                   glFlush;
 static PFNGLSCISSORPROC                 glScissor;
 static PFNGLBLENDFUNCPROC               glBlendFunc;
 static PFNGLBLENDEQUATIONPROC           glBlendEquation;
@@ -153,6 +154,7 @@ static bool glproc_global_init(void)
 		GLPROC_LOAD_SYM(glGetError);
 		GLPROC_LOAD_SYM(glGetShaderInfoLog);
 		GLPROC_LOAD_SYM(glFinish);
+		GLPROC_LOAD_SYM(glFlush);
 		GLPROC_LOAD_SYM(glScissor);
 		GLPROC_LOAD_SYM(glBlendFunc);
 		GLPROC_LOAD_SYM(glBlendEquation);
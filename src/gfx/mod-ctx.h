@@ -31,7 +31,10 @@ struct gfx_ctx;
 	bool wrap(api, set_ui_texture)(struct gfx_ctx *gfx_ctx, uint32_t id, const void *rgba, \
 		uint32_t width, uint32_t height); \
 	bool wrap(api, has_ui_texture)(struct gfx_ctx *gfx_ctx, uint32_t id); \
-	bool wrap(api, make_current)(struct gfx_ctx *gfx_ctx, bool current);
+	void wrap(api, set_ui_atlas)(struct gfx_ctx *gfx_ctx, uint32_t page_size); \
+	bool wrap(api, make_current)(struct gfx_ctx *gfx_ctx, bool current); \
+	void wrap(api, set_frames_in_flight)(struct gfx_ctx *gfx_ctx, uint32_t frames); \
+	bool wrap(api, get_present_stats)(struct gfx_ctx *gfx_ctx, MTY_PresentStats *stats);
 
 #define GFX_CTX_PROTOTYPES(api) \
 	GFX_CTX_DECLARE_API(api, GFX_CTX_PROTO)
@@ -48,5 +51,8 @@ struct gfx_ctx;
 		mty##api##ctx_draw_ui, \
 		mty##api##ctx_set_ui_texture, \
 		mty##api##ctx_has_ui_texture, \
+		mty##api##ctx_set_ui_atlas, \
 		mty##api##ctx_make_current, \
+		mty##api##ctx_set_frames_in_flight, \
+		mty##api##ctx_get_present_stats, \
 	},
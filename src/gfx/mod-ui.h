@@ -29,6 +29,9 @@ struct gfx_ui;
 		MTY_Surface *dest); \
 	void *wrap(api, create_texture)(MTY_Device *device, const void *rgba, \
 		uint32_t width, uint32_t height); \
+	bool wrap(api, update_texture)(MTY_Device *device, MTY_Context *context, \
+		void *texture, const void *rgba, uint32_t stride, uint32_t x, uint32_t y, \
+		uint32_t width, uint32_t height); \
 	void wrap(api, destroy_texture)(void **texture);
 
 #define GFX_UI_PROTOTYPES(api) \
@@ -40,5 +43,9 @@ struct gfx_ui;
 		mty##api##ui_destroy, \
 		mty##api##ui_render, \
 		mty##api##ui_create_texture, \
+		mty##api##ui_update_texture, \
 		mty##api##ui_destroy_texture, \
 	},
+
+// MTY_GFX_GL only, a child in the same share group as `parent`
+struct gfx_ui *mty_gl_ui_create_shared(struct gfx_ui *parent);
@@ -39,3 +39,6 @@ struct gfx;
 		mty##api##set_state, \
 		mty##api##free_state, \
 	},
+
+// MTY_GFX_GL only, a child in the same share group as `parent`
+struct gfx *mty_gl_create_shared(struct gfx *parent);
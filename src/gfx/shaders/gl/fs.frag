@@ -21,24 +21,107 @@ uniform sampler2D tex2;
 // width, height, vp_height
 uniform vec4 fcb;
 
-// filter, effect, format
+// filter, effect, format, rotation
 uniform ivec4 icb;
 
+// y offset, y scale, uv offset, uv scale
+uniform vec4 ccb;
+
+// kr, kb, sample scale, peak / reference white
+uniform vec4 hcb;
+
+// transfer, matrix
+uniform ivec4 tcb;
+
 void yuv_to_rgba(float y, float u, float v, out vec4 rgba)
 {
-	// Using "RGB to YCbCr color conversion for HDTV" (ITU-R BT.709)
+	// Low bit aligned formats are expanded to the full range of the sampled value
+	y *= hcb[2];
+	u *= hcb[2];
+	v *= hcb[2];
 
-	y = (y - 0.0625) * 1.164;
-	u = u - 0.5;
-	v = v - 0.5;
+	// Range
+	y = (y - ccb[0]) * ccb[1];
+	u = (u - ccb[2]) * ccb[3];
+	v = (v - ccb[2]) * ccb[3];
 
-	float r = y + 1.793 * v;
-	float g = y - 0.213 * u - 0.533 * v;
-	float b = y + 2.112 * u;
+	// Matrix coefficients (ITU-R BT.601, BT.709, BT.2020 non-constant luminance)
+	float kr = hcb[0];
+	float kb = hcb[1];
+	float kg = 1.0 - kr - kb;
+
+	float r = y + 2.0 * (1.0 - kr) * v;
+	float b = y + 2.0 * (1.0 - kb) * u;
+	float g = (y - kr * r - kb * b) / kg;
 
 	rgba = vec4(r, g, b, 1.0);
 }
 
+vec3 pq_to_nits(vec3 e)
+{
+	// SMPTE ST 2084 EOTF
+	vec3 p = pow(max(e, 0.0), vec3(1.0 / 78.84375));
+	vec3 l = max(p - 0.8359375, 0.0) / (18.8515625 - 18.6875 * p);
+
+	return pow(l, vec3(1.0 / 0.1593017578125)) * 10000.0;
+}
+
+float hlg_inverse_oetf(float e)
+{
+	return e <= 0.5 ? e * e / 3.0 : (exp((e - 0.55991073) / 0.17883277) + 0.28466892) / 12.0;
+}
+
+vec3 hlg_to_nits(vec3 e, float peak)
+{
+	// ARIB STD-B67 inverse OETF followed by the BT.2100 OOTF with a system gamma of 1.2
+	vec3 s = vec3(hlg_inverse_oetf(e.r), hlg_inverse_oetf(e.g), hlg_inverse_oetf(e.b));
+	float ys = dot(s, vec3(0.2627, 0.6780, 0.0593));
+
+	return s * peak * pow(max(ys, 1e-6), 0.2);
+}
+
+float srgb_oetf(float l)
+{
+	return l <= 0.0031308 ? l * 12.92 : 1.055 * pow(l, 1.0 / 2.4) - 0.055;
+}
+
+void tone_map(int transfer, int matrix, inout vec4 rgba)
+{
+	float white = hcb[3];
+	vec3 nits = rgba.rgb;
+
+	if (transfer == 1) {
+		nits = pq_to_nits(nits);
+
+	} else if (transfer == 2) {
+		nits = hlg_to_nits(nits, white * 203.0);
+
+	} else {
+		nits *= 80.0;
+	}
+
+	// BT.2020 to BT.709 primaries
+	if (matrix == 2 && transfer != 3) {
+		nits = vec3(
+			dot(nits, vec3( 1.6605, -0.5876, -0.0728)),
+			dot(nits, vec3(-0.1246,  1.1329, -0.0083)),
+			dot(nits, vec3(-0.0182, -0.1006,  1.1187))
+		);
+	}
+
+	// Extended Reinhard on the max channel relative to 203 nit reference white,
+	// preserving hue while mapping the content peak to SDR white
+	vec3 rgb = max(nits / 203.0, 0.0);
+	float m = max(rgb.r, max(rgb.g, rgb.b));
+
+	if (m > 0.0)
+		rgb *= (1.0 + m / (white * white)) / (1.0 + m);
+
+	rgb = min(rgb, 1.0);
+
+	rgba.rgb = vec3(srgb_oetf(rgb.r), srgb_oetf(rgb.g), srgb_oetf(rgb.b));
+}
+
 void gaussian(int type, float w, float h, inout vec2 uv)
 {
 	vec2 res = vec2(w, h);
@@ -78,6 +161,8 @@ void main(void)
 	int effect = icb[1];
 	int format = icb[2];
 	int rotation = icb[3];
+	int transfer = tcb[0];
+	int matrix = tcb[1];
 
 	vec2 uv = vs_texcoord;
 
@@ -100,16 +185,16 @@ void main(void)
 	if (filter == 3 || filter == 4)
 		gaussian(filter, width, height, uv);
 
-	// NV12, NV16
-	if (format == 2 || format == 5) {
+	// NV12, NV16, P010, P016
+	if (format == 2 || format == 5 || format == 9 || format == 10) {
 		float y = texture2D(tex0, uv).r;
 		float u = texture2D(tex1, uv).r;
 		float v = texture2D(tex1, uv).g;
 
 		yuv_to_rgba(y, u, v, gl_FragColor);
 
-	// I420, I444
-	} else if (format == 3 || format == 4) {
+	// I420, I444, I010, I410
+	} else if (format == 3 || format == 4 || format == 11 || format == 12) {
 		float y = texture2D(tex0, uv).r;
 		float u = texture2D(tex1, uv).r;
 		float v = texture2D(tex2, uv).r;
@@ -124,11 +209,21 @@ void main(void)
 
 		yuv_to_rgba(y, u, v, gl_FragColor);
 
+	// Y410
+	} else if (format == 13) {
+		vec4 uyva = texture2D(tex0, uv);
+
+		yuv_to_rgba(uyva.g, uyva.r, uyva.b, gl_FragColor);
+
 	// BGRA
 	} else {
 		gl_FragColor = texture2D(tex0, uv);
 	}
 
+	// HDR to SDR
+	if (transfer != 0)
+		tone_map(transfer, matrix, gl_FragColor);
+
 	// Scanlines
 	if (effect == 1 || effect == 2)
 		scanline(effect, vs_texcoord[1], vp_height, gl_FragColor);
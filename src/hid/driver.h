@@ -0,0 +1,106 @@
+// Copyright (c) Christopher D. Dickson <cdd@matoya.group>
+//
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+#pragma once
+
+#include "hid.h"
+#include "utils.h"
+
+#include <math.h>
+#include <string.h>
+
+// The drivers bind to the mty_hid_device_* transport functions by name. This is
+// included by hid.c for live devices and by replay.c for recorded ones.
+
+#include "ps4.h"
+#include "ps5.h"
+#include "nx.h"
+#include "xbox.h"
+#include "xboxw.h"
+
+static MTY_CType hid_driver(struct hid_dev *device)
+{
+	return mty_hid_driver_type(mty_hid_device_get_vid(device), mty_hid_device_get_pid(device));
+}
+
+static void hid_driver_init(struct hid_dev *device)
+{
+	switch (hid_driver(device)) {
+		case MTY_CTYPE_SWITCH:
+			nx_init(device);
+			break;
+		case MTY_CTYPE_PS4:
+			ps4_init(device);
+			break;
+		case MTY_CTYPE_XBOX:
+			xbox_init(device);
+			break;
+	}
+}
+
+// Drivers index reports at fixed offsets, so short reports are zero padded.
+// Checks against `size` for optional trailing data still see the real length.
+#define HID_REPORT_MIN 64
+
+static bool hid_driver_state(struct hid_dev *device, const void *buf, size_t size, MTY_ControllerEvent *c)
+{
+	uint8_t padded[HID_REPORT_MIN];
+
+	if (size < HID_REPORT_MIN) {
+		memset(padded, 0, HID_REPORT_MIN);
+		memcpy(padded, buf, size);
+		buf = padded;
+	}
+
+	switch (hid_driver(device)) {
+		case MTY_CTYPE_SWITCH:
+			return nx_state(device, buf, size, c);
+		case MTY_CTYPE_PS4:
+			return ps4_state(device, buf, size, c);
+		case MTY_CTYPE_PS5:
+			return ps5_state(device, buf, size, c);
+		case MTY_CTYPE_XBOX:
+			return xbox_state(device, buf, size, c);
+		case MTY_CTYPE_XBOXW:
+			return xboxw_state(device, buf, size, c);
+		case MTY_CTYPE_DEFAULT:
+			mty_hid_default_state(device, buf, size, c);
+			mty_hid_map_axes(c);
+			return true;
+	}
+
+	return false;
+}
+
+static void hid_driver_rumble(struct hid_dev *device, uint16_t low, uint16_t high)
+{
+	switch (hid_driver(device)) {
+		case MTY_CTYPE_SWITCH:
+			nx_rumble(device, low > 0, high > 0);
+			break;
+		case MTY_CTYPE_PS4:
+			ps4_rumble(device, low, high);
+			break;
+		case MTY_CTYPE_PS5:
+			ps5_rumble(device, low, high);
+			break;
+		case MTY_CTYPE_XBOX:
+			xbox_rumble(device, low, high);
+			break;
+	}
+}
+
+static const void *hid_driver_touchpad(struct hid_dev *device, size_t *size)
+{
+	switch (hid_driver(device)) {
+		case MTY_CTYPE_PS4:
+			return ps4_get_touchpad(device, size);
+		case MTY_CTYPE_PS5:
+			return ps5_get_touchpad(device, size);
+	}
+
+	return NULL;
+}
@@ -32,6 +32,7 @@ uint32_t mty_hid_device_get_input_report_size(struct hid_dev *ctx);
 void mty_hid_default_state(struct hid_dev *ctx, const void *buf, size_t size, MTY_ControllerEvent *c);
 void mty_hid_default_rumble(struct hid *ctx, uint32_t id, uint16_t low, uint16_t high);
 
+bool mty_hid_driver_is_supported(uint16_t vid, uint16_t pid);
 void mty_hid_driver_init(struct hid_dev *device);
 bool mty_hid_driver_state(struct hid_dev *device, const void *buf, size_t size, MTY_ControllerEvent *c);
 void mty_hid_driver_rumble(struct hid *hid, uint32_t id, uint16_t low, uint16_t high);
@@ -41,3 +42,7 @@ const void *mty_hid_device_get_touchpad(struct hid *hid, uint32_t id, size_t *si
 void mty_hid_win32_listen(void *hwnd);
 void mty_hid_win32_device_change(struct hid *ctx, intptr_t wparam, intptr_t lparam);
 void mty_hid_win32_report(struct hid *ctx, intptr_t device, const void *buf, size_t size);
+
+// Linux specific, hidraw is polled from the app loop alongside evdev
+void mty_hid_linux_poll(struct hid *ctx);
+bool mty_hid_linux_has_device(struct hid *ctx, uint16_t vid, uint16_t pid);
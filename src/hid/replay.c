@@ -0,0 +1,539 @@
+// Copyright (c) Christopher D. Dickson <cdd@matoya.group>
+//
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+#include "replay.h"
+
+#include <string.h>
+#include <math.h>
+
+#include "hid.h"
+#include "utils.h"
+
+#if defined(__linux__) && !defined(__ANDROID__)
+	#define REPLAY_EVDEV
+	#include "evdev.h"
+#endif
+
+// A recording is the 8 byte REPLAY_MAGIC followed by records, each a struct
+// replay_header and `size` bytes of payload. All fields are little endian.
+
+#define REPLAY_MAGIC   "MTYCTRL1"
+#define REPLAY_ABS_MAX 64 // ABS_CNT
+#define REPLAY_OUT_MAX 128
+
+enum replay_type {
+	REPLAY_HID_CONNECT   = 1,
+	REPLAY_HID_REPORT    = 2,
+	REPLAY_DISCONNECT    = 3,
+	REPLAY_EVDEV_CONNECT = 4,
+	REPLAY_EVDEV_EVENT   = 5,
+};
+
+struct replay_header {
+	uint8_t type;
+	uint8_t reserved;
+	uint16_t size;
+	uint32_t id;
+	uint64_t timestamp;
+};
+
+struct replay_hid_connect {
+	uint16_t vid;
+	uint16_t pid;
+	uint32_t input_size;
+};
+
+// Followed by `len` struct replay_evdev_abs
+struct replay_evdev_connect {
+	uint16_t vid;
+	uint16_t pid;
+	uint16_t len;
+	uint16_t reserved;
+};
+
+struct replay_evdev_abs {
+	int32_t code;
+	int32_t min;
+	int32_t max;
+};
+
+struct replay_evdev_event {
+	uint16_t type;
+	uint16_t code;
+	int32_t value;
+};
+
+
+// Replay transport, the drivers are compiled a second time against these
+
+struct hid_dev {
+	void *state;
+	uint32_t id;
+	uint32_t input_size;
+	uint16_t vid;
+	uint16_t pid;
+
+	// Last output report, kept so rumble encoding can be checked
+	uint8_t output[REPLAY_OUT_MAX];
+	size_t output_size;
+};
+
+static void replay_device_write(struct hid_dev *ctx, const void *buf, size_t size)
+{
+	ctx->output_size = size < REPLAY_OUT_MAX ? size : REPLAY_OUT_MAX;
+	memcpy(ctx->output, buf, ctx->output_size);
+}
+
+static bool replay_device_feature(struct hid_dev *ctx, void *buf, size_t size, size_t *size_out)
+{
+	return false;
+}
+
+static void *replay_device_get_state(struct hid_dev *ctx)
+{
+	return ctx->state;
+}
+
+static uint16_t replay_device_get_vid(struct hid_dev *ctx)
+{
+	return ctx->vid;
+}
+
+static uint16_t replay_device_get_pid(struct hid_dev *ctx)
+{
+	return ctx->pid;
+}
+
+static uint32_t replay_device_get_id(struct hid_dev *ctx)
+{
+	return ctx->id;
+}
+
+static uint32_t replay_device_get_input_report_size(struct hid_dev *ctx)
+{
+	return ctx->input_size;
+}
+
+static void replay_default_state(struct hid_dev *ctx, const void *buf, size_t size, MTY_ControllerEvent *c)
+{
+}
+
+#define mty_hid_device_write                 replay_device_write
+#define mty_hid_device_feature               replay_device_feature
+#define mty_hid_device_get_state             replay_device_get_state
+#define mty_hid_device_get_vid               replay_device_get_vid
+#define mty_hid_device_get_pid               replay_device_get_pid
+#define mty_hid_device_get_id                replay_device_get_id
+#define mty_hid_device_get_input_report_size replay_device_get_input_report_size
+#define mty_hid_default_state                replay_default_state
+
+#include "driver.h"
+
+
+// Record
+
+static MTY_Atomic32 REPLAY_GLOCK;
+static MTY_Atomic32 REPLAY_ACTIVE;
+static char *REPLAY_PATH;
+static uint8_t *REPLAY_BUF;
+static size_t REPLAY_SIZE;
+static size_t REPLAY_LEN;
+static MTY_Time REPLAY_START;
+
+static void replay_append(const void *buf, size_t size)
+{
+	if (REPLAY_LEN + size > REPLAY_SIZE) {
+		REPLAY_SIZE = (REPLAY_LEN + size) * 2;
+		REPLAY_BUF = MTY_Realloc(REPLAY_BUF, REPLAY_SIZE, 1);
+	}
+
+	memcpy(REPLAY_BUF + REPLAY_LEN, buf, size);
+	REPLAY_LEN += size;
+}
+
+static void replay_record(uint8_t type, uint32_t id, const void *payload, size_t size,
+	const void *extra, size_t extra_size)
+{
+	if (!MTY_Atomic32Get(&REPLAY_ACTIVE))
+		return;
+
+	if (size + extra_size > UINT16_MAX)
+		return;
+
+	MTY_GlobalLock(&REPLAY_GLOCK);
+
+	// Input threads only ever touch memory, the file is written when recording stops
+	if (REPLAY_PATH) {
+		struct replay_header hdr = {0};
+		hdr.type = type;
+		hdr.size = (uint16_t) (size + extra_size);
+		hdr.id = id;
+		hdr.timestamp = llround(MTY_TimeDiff(REPLAY_START, MTY_GetTime()) * 1000.0);
+
+		replay_append(&hdr, sizeof(hdr));
+
+		if (size > 0)
+			replay_append(payload, size);
+
+		if (extra_size > 0)
+			replay_append(extra, extra_size);
+	}
+
+	MTY_GlobalUnlock(&REPLAY_GLOCK);
+}
+
+void mty_hid_record_connect(uint32_t id, uint16_t vid, uint16_t pid, uint32_t input_size)
+{
+	struct replay_hid_connect c = {0};
+	c.vid = vid;
+	c.pid = pid;
+	c.input_size = input_size;
+
+	replay_record(REPLAY_HID_CONNECT, id, &c, sizeof(c), NULL, 0);
+}
+
+void mty_hid_record_report(uint32_t id, const void *buf, size_t size)
+{
+	replay_record(REPLAY_HID_REPORT, id, buf, size, NULL, 0);
+}
+
+void mty_hid_record_disconnect(uint32_t id)
+{
+	replay_record(REPLAY_DISCONNECT, id, NULL, 0, NULL, 0);
+}
+
+void mty_hid_record_evdev_connect(uint32_t id, uint16_t vid, uint16_t pid, const int32_t (*abs)[2], uint32_t len)
+{
+	if (!MTY_Atomic32Get(&REPLAY_ACTIVE))
+		return;
+
+	// Only axes the device reports a range for are stored
+	struct replay_evdev_abs axes[REPLAY_ABS_MAX];
+	struct replay_evdev_connect c = {0};
+	c.vid = vid;
+	c.pid = pid;
+
+	for (uint32_t x = 0; x < len && c.len < REPLAY_ABS_MAX; x++) {
+		if (abs[x][0] != 0 || abs[x][1] != 0) {
+			axes[c.len].code = x;
+			axes[c.len].min = abs[x][0];
+			axes[c.len].max = abs[x][1];
+			c.len++;
+		}
+	}
+
+	replay_record(REPLAY_EVDEV_CONNECT, id, &c, sizeof(c), axes, c.len * sizeof(struct replay_evdev_abs));
+}
+
+void mty_hid_record_evdev_event(uint32_t id, uint16_t type, uint16_t code, int32_t value)
+{
+	struct replay_evdev_event e = {0};
+	e.type = type;
+	e.code = code;
+	e.value = value;
+
+	replay_record(REPLAY_EVDEV_EVENT, id, &e, sizeof(e), NULL, 0);
+}
+
+bool MTY_ControllerRecordStart(const char *path)
+{
+	MTY_GlobalLock(&REPLAY_GLOCK);
+
+	bool r = !REPLAY_PATH;
+
+	if (r) {
+		REPLAY_PATH = MTY_Strdup(path);
+		REPLAY_LEN = 0;
+		replay_append(REPLAY_MAGIC, 8);
+
+		REPLAY_START = MTY_GetTime();
+		MTY_Atomic32Set(&REPLAY_ACTIVE, 1);
+
+	} else {
+		MTY_Log("A controller recording is already active");
+	}
+
+	MTY_GlobalUnlock(&REPLAY_GLOCK);
+
+	return r;
+}
+
+bool MTY_ControllerRecordStop(void)
+{
+	MTY_GlobalLock(&REPLAY_GLOCK);
+
+	MTY_Atomic32Set(&REPLAY_ACTIVE, 0);
+
+	bool r = REPLAY_PATH && MTY_WriteFile(REPLAY_PATH, REPLAY_BUF, REPLAY_LEN);
+
+	MTY_Free(REPLAY_PATH);
+	MTY_Free(REPLAY_BUF);
+	REPLAY_PATH = NULL;
+	REPLAY_BUF = NULL;
+	REPLAY_SIZE = 0;
+	REPLAY_LEN = 0;
+
+	MTY_GlobalUnlock(&REPLAY_GLOCK);
+
+	return r;
+}
+
+
+// Replay
+
+struct replay_dev {
+	struct hid_dev hid;
+
+	#if defined(REPLAY_EVDEV)
+		struct evdev_dev *evdev;
+	#endif
+};
+
+struct MTY_ControllerReplay {
+	uint8_t *buf;
+	size_t size;
+	size_t offset;
+	MTY_Hash *devices;
+};
+
+static void replay_device_destroy(void *opaque)
+{
+	if (!opaque)
+		return;
+
+	struct replay_dev *dev = opaque;
+
+	#if defined(REPLAY_EVDEV)
+		mty_evdev_replay_destroy(&dev->evdev);
+	#endif
+
+	MTY_Free(dev->hid.state);
+	MTY_Free(dev);
+}
+
+static struct replay_dev *replay_device_create(MTY_ControllerReplay *ctx, uint32_t id, uint16_t vid, uint16_t pid)
+{
+	// A recycled id without a disconnect in between replaces the old device
+	replay_device_destroy(MTY_HashPopInt(ctx->devices, id));
+
+	struct replay_dev *dev = MTY_Alloc(1, sizeof(struct replay_dev));
+	dev->hid.state = MTY_Alloc(HID_STATE_MAX, 1);
+	dev->hid.id = id;
+	dev->hid.vid = vid;
+	dev->hid.pid = pid;
+
+	MTY_HashSetInt(ctx->devices, id, dev);
+
+	return dev;
+}
+
+static void replay_controller(struct replay_dev *dev, MTY_Event *evt)
+{
+	#if defined(REPLAY_EVDEV)
+		if (dev->evdev) {
+			evt->controller = mty_evdev_state(dev->evdev);
+			mty_hid_map_axes(&evt->controller);
+			return;
+		}
+	#endif
+
+	evt->controller.vid = dev->hid.vid;
+	evt->controller.pid = dev->hid.pid;
+	evt->controller.id = dev->hid.id;
+}
+
+static bool replay_record_event(MTY_ControllerReplay *ctx, const struct replay_header *hdr,
+	const uint8_t *payload, MTY_Event *evt)
+{
+	struct replay_dev *dev = MTY_HashGetInt(ctx->devices, hdr->id);
+
+	switch (hdr->type) {
+		case REPLAY_HID_CONNECT: {
+			struct replay_hid_connect c = {0};
+			if (hdr->size < sizeof(c))
+				return false;
+
+			memcpy(&c, payload, sizeof(c));
+
+			dev = replay_device_create(ctx, hdr->id, c.vid, c.pid);
+			dev->hid.input_size = c.input_size;
+
+			hid_driver_init(&dev->hid);
+
+			evt->type = MTY_EVENT_CONNECT;
+			replay_controller(dev, evt);
+
+			return true;
+		}
+		case REPLAY_HID_REPORT:
+			// Devices without a driver are parsed from the report descriptor, which is not recorded
+			if (!dev || hdr->size == 0 || hid_driver(&dev->hid) == MTY_CTYPE_DEFAULT)
+				return false;
+
+			#if defined(REPLAY_EVDEV)
+				if (dev->evdev)
+					return false;
+			#endif
+
+			evt->type = MTY_EVENT_CONTROLLER;
+
+			return hid_driver_state(&dev->hid, payload, hdr->size, &evt->controller);
+
+		case REPLAY_DISCONNECT:
+			if (!dev)
+				return false;
+
+			evt->type = MTY_EVENT_DISCONNECT;
+			replay_controller(dev, evt);
+
+			replay_device_destroy(MTY_HashPopInt(ctx->devices, hdr->id));
+
+			return true;
+
+		#if defined(REPLAY_EVDEV)
+		case REPLAY_EVDEV_CONNECT: {
+			struct replay_evdev_connect c = {0};
+			if (hdr->size < sizeof(c))
+				return false;
+
+			memcpy(&c, payload, sizeof(c));
+
+			if (hdr->size < sizeof(c) + c.len * sizeof(struct replay_evdev_abs))
+				return false;
+
+			int32_t abs[REPLAY_ABS_MAX][2] = {0};
+
+			for (uint16_t x = 0; x < c.len; x++) {
+				struct replay_evdev_abs a = {0};
+				memcpy(&a, payload + sizeof(c) + x * sizeof(a), sizeof(a));
+
+				if (a.code >= 0 && a.code < REPLAY_ABS_MAX) {
+					abs[a.code][0] = a.min;
+					abs[a.code][1] = a.max;
+				}
+			}
+
+			dev = replay_device_create(ctx, hdr->id, c.vid, c.pid);
+			dev->evdev = mty_evdev_replay_create(hdr->id, c.vid, c.pid, abs, REPLAY_ABS_MAX);
+
+			evt->type = MTY_EVENT_CONNECT;
+			replay_controller(dev, evt);
+
+			return true;
+		}
+		case REPLAY_EVDEV_EVENT: {
+			struct replay_evdev_event e = {0};
+			if (!dev || !dev->evdev || hdr->size < sizeof(e))
+				return false;
+
+			memcpy(&e, payload, sizeof(e));
+
+			if (!mty_evdev_replay_event(dev->evdev, e.type, e.code, e.value))
+				return false;
+
+			evt->type = MTY_EVENT_CONTROLLER;
+			replay_controller(dev, evt);
+
+			return true;
+		}
+		#endif
+	}
+
+	return false;
+}
+
+MTY_ControllerReplay *MTY_ControllerReplayCreate(const void *buf, size_t size)
+{
+	if (size < 8 || memcmp(buf, REPLAY_MAGIC, 8)) {
+		MTY_Log("Controller recording has an unrecognized header");
+		return NULL;
+	}
+
+	MTY_ControllerReplay *ctx = MTY_Alloc(1, sizeof(MTY_ControllerReplay));
+	ctx->buf = MTY_Dup(buf, size);
+	ctx->size = size;
+	ctx->offset = 8;
+	ctx->devices = MTY_HashCreate(0);
+
+	return ctx;
+}
+
+void MTY_ControllerReplayDestroy(MTY_ControllerReplay **replay)
+{
+	if (!replay || !*replay)
+		return;
+
+	MTY_ControllerReplay *ctx = *replay;
+
+	MTY_HashDestroy(&ctx->devices, replay_device_destroy);
+	MTY_Free(ctx->buf);
+
+	MTY_Free(ctx);
+	*replay = NULL;
+}
+
+bool MTY_ControllerReplayNext(MTY_ControllerReplay *ctx, MTY_Event *evt, uint64_t *timestamp)
+{
+	while (ctx->size - ctx->offset >= sizeof(struct replay_header)) {
+		struct replay_header hdr = {0};
+		memcpy(&hdr, ctx->buf + ctx->offset, sizeof(hdr));
+
+		if (ctx->size - ctx->offset - sizeof(hdr) < hdr.size) {
+			MTY_Log("Controller recording is truncated");
+			ctx->offset = ctx->size;
+			break;
+		}
+
+		const uint8_t *payload = ctx->buf + ctx->offset + sizeof(hdr);
+		ctx->offset += sizeof(hdr) + hdr.size;
+
+		memset(evt, 0, sizeof(MTY_Event));
+
+		if (replay_record_event(ctx, &hdr, payload, evt)) {
+			if (timestamp)
+				*timestamp = hdr.timestamp;
+
+			return true;
+		}
+	}
+
+	return false;
+}
+
+size_t MTY_ControllerReplayRumble(MTY_ControllerReplay *ctx, uint32_t id, uint16_t low, uint16_t high,
+	void *report, size_t size)
+{
+	struct replay_dev *dev = MTY_HashGetInt(ctx->devices, id);
+	if (!dev)
+		return 0;
+
+	#if defined(REPLAY_EVDEV)
+		if (dev->evdev)
+			return 0;
+	#endif
+
+	dev->hid.output_size = 0;
+	hid_driver_rumble(&dev->hid, low, high);
+
+	size_t n = dev->hid.output_size < size ? dev->hid.output_size : size;
+	memcpy(report, dev->hid.output, n);
+
+	return dev->hid.output_size;
+}
+
+const void *MTY_ControllerReplayGetTouchpad(MTY_ControllerReplay *ctx, uint32_t id, size_t *size)
+{
+	struct replay_dev *dev = MTY_HashGetInt(ctx->devices, id);
+	if (!dev)
+		return NULL;
+
+	#if defined(REPLAY_EVDEV)
+		if (dev->evdev)
+			return NULL;
+	#endif
+
+	return hid_driver_touchpad(&dev->hid, size);
+}
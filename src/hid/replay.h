@@ -0,0 +1,16 @@
+// Copyright (c) Christopher D. Dickson <cdd@matoya.group>
+//
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+#pragma once
+
+#include "matoya.h"
+
+// Recording hooks, these are no-ops unless MTY_ControllerRecordStart is active
+void mty_hid_record_connect(uint32_t id, uint16_t vid, uint16_t pid, uint32_t input_size);
+void mty_hid_record_report(uint32_t id, const void *buf, size_t size);
+void mty_hid_record_disconnect(uint32_t id);
+void mty_hid_record_evdev_connect(uint32_t id, uint16_t vid, uint16_t pid, const int32_t (*abs)[2], uint32_t len);
+void mty_hid_record_evdev_event(uint32_t id, uint16_t type, uint16_t code, int32_t value);
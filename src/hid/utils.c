@@ -226,3 +226,55 @@ bool mty_hid_dedupe(MTY_Hash *h, MTY_ControllerEvent *c)
 
 	return button_diff || axes_diff;
 }
+
+
+// Drivers
+
+MTY_CType mty_hid_driver_type(uint16_t vid, uint16_t pid)
+{
+	uint32_t id = ((uint32_t) vid << 16) | pid;
+
+	switch (id) {
+		// Switch
+		case 0x057E2009: // Nintendo Switch Pro
+		case 0x057E2006: // Nintendo Switch Joycon
+		case 0x057E2007: // Nintendo Switch Joycon
+		case 0x057E2017: // Nintendo Switch SNES Controller
+			return MTY_CTYPE_SWITCH;
+
+		// PS4
+		case 0x054C05C4: // Sony DualShock 4 Gen1
+		case 0x054C09CC: // Sony DualShock 4 Gen2
+		case 0x054C0BA0: // Sony PS4 Controller (Wireless dongle)
+			return MTY_CTYPE_PS4;
+
+		// PS5
+		case 0x054C0CE6: // Sony DualSense
+			return MTY_CTYPE_PS5;
+
+		// Xbox
+		case 0x045E02E0: // Microsoft X-Box One S pad (Bluetooth)
+		case 0x045E02FD: // Microsoft X-Box One S pad (Bluetooth)
+		case 0x045E0B05: // Microsoft X-Box One Elite Series 2 pad (Bluetooth)
+		case 0x045E0B13: // Microsoft X-Box Series X (Bluetooth)
+			return MTY_CTYPE_XBOX;
+
+		// Xbox Wired
+		case 0x045E028E: // Microsoft XBox 360
+		case 0x045E028F: // Microsoft XBox 360 v2
+		case 0x045E02A1: // Microsoft XBox 360
+		case 0x045E0291: // Microsoft XBox 360 Wireless Dongle
+		case 0x045E0719: // Microsoft XBox 360 Wireless Dongle
+		case 0x045E02A0: // Microsoft Xbox 360 Big Button IR
+		case 0x045E02DD: // Microsoft XBox One
+		case 0x044FB326: // Microsoft XBox One Firmware 2015
+		case 0x045E02E3: // Microsoft XBox One Elite
+		case 0x045E02FF: // Microsoft XBox One Elite
+		case 0x045E02EA: // Microsoft XBox One S
+		case 0x046DC21D: // Logitech F310
+		case 0x0E6F02A0: // PDP Xbox One
+			return MTY_CTYPE_XBOXW;
+	}
+
+	return MTY_CTYPE_DEFAULT;
+}
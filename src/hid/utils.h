@@ -13,3 +13,4 @@ void mty_hid_s_to_s16(MTY_Axis *v);
 void mty_hid_u_to_u8(MTY_Axis *v);
 void mty_hid_map_axes(MTY_ControllerEvent *c);
 bool mty_hid_dedupe(MTY_Hash *h, MTY_ControllerEvent *c);
+MTY_CType mty_hid_driver_type(uint16_t vid, uint16_t pid);
@@ -75,6 +75,15 @@ static void xbox_init(struct hid_dev *device)
 	ctx->rumble = true;
 }
 
+static uint16_t xbox_u16(const uint8_t *d8)
+{
+	// Report fields are not aligned
+	uint16_t v = 0;
+	memcpy(&v, d8, 2);
+
+	return v;
+}
+
 static bool xbox_state(struct hid_dev *device, const void *data, size_t dsize, MTY_ControllerEvent *c)
 {
 	bool r = false;
@@ -108,34 +117,34 @@ static bool xbox_state(struct hid_dev *device, const void *data, size_t dsize, M
 		c->buttons[MTY_CBUTTON_GUIDE] = ctx->guide;
 		c->buttons[MTY_CBUTTON_TOUCHPAD] = ctx->series_x ? d8[16] & 0x01 : 0;
 
-		c->axes[MTY_CAXIS_THUMB_LX].value = *((int16_t *) (d8 + 1)) - 0x8000;
+		c->axes[MTY_CAXIS_THUMB_LX].value = (int16_t) xbox_u16(d8 + 1) - 0x8000;
 		c->axes[MTY_CAXIS_THUMB_LX].usage = 0x30;
 		c->axes[MTY_CAXIS_THUMB_LX].min = INT16_MIN;
 		c->axes[MTY_CAXIS_THUMB_LX].max = INT16_MAX;
 
-		int16_t ly = *((int16_t *) (d8 + 3)) - 0x8000;
+		int16_t ly = (int16_t) xbox_u16(d8 + 3) - 0x8000;
 		c->axes[MTY_CAXIS_THUMB_LY].value = (int16_t) ((int32_t) (ly + 1) * -1);
 		c->axes[MTY_CAXIS_THUMB_LY].usage = 0x31;
 		c->axes[MTY_CAXIS_THUMB_LY].min = INT16_MIN;
 		c->axes[MTY_CAXIS_THUMB_LY].max = INT16_MAX;
 
-		c->axes[MTY_CAXIS_THUMB_RX].value = *((int16_t *) (d8 + 5)) - 0x8000;
+		c->axes[MTY_CAXIS_THUMB_RX].value = (int16_t) xbox_u16(d8 + 5) - 0x8000;
 		c->axes[MTY_CAXIS_THUMB_RX].usage = 0x32;
 		c->axes[MTY_CAXIS_THUMB_RX].min = INT16_MIN;
 		c->axes[MTY_CAXIS_THUMB_RX].max = INT16_MAX;
 
-		int16_t ry = *((int16_t *) (d8 + 7)) - 0x8000;
+		int16_t ry = (int16_t) xbox_u16(d8 + 7) - 0x8000;
 		c->axes[MTY_CAXIS_THUMB_RY].value = (int16_t) ((int32_t) (ry + 1) * -1);
 		c->axes[MTY_CAXIS_THUMB_RY].usage = 0x35;
 		c->axes[MTY_CAXIS_THUMB_RY].min = INT16_MIN;
 		c->axes[MTY_CAXIS_THUMB_RY].max = INT16_MAX;
 
-		c->axes[MTY_CAXIS_TRIGGER_L].value = *((uint16_t *) (d8 + 9)) >> 2;;
+		c->axes[MTY_CAXIS_TRIGGER_L].value = xbox_u16(d8 + 9) >> 2;
 		c->axes[MTY_CAXIS_TRIGGER_L].usage = 0x33;
 		c->axes[MTY_CAXIS_TRIGGER_L].min = 0;
 		c->axes[MTY_CAXIS_TRIGGER_L].max = UINT8_MAX;
 
-		c->axes[MTY_CAXIS_TRIGGER_R].value = *((uint16_t *) (d8 + 11)) >> 2;;
+		c->axes[MTY_CAXIS_TRIGGER_R].value = xbox_u16(d8 + 11) >> 2;
 		c->axes[MTY_CAXIS_TRIGGER_R].usage = 0x34;
 		c->axes[MTY_CAXIS_TRIGGER_R].min = 0;
 		c->axes[MTY_CAXIS_TRIGGER_R].max = UINT8_MAX;
@@ -30,7 +30,13 @@ static void image_center_crop(uint32_t w, uint32_t h, uint32_t target_w, uint32_
 	*crop_h = (target_h > 0 && h > target_h) ? lrint((float) (h - target_h) / m) : 0;
 }
 
-void *MTY_CropImage(const void *image, uint32_t cropWidth, uint32_t cropHeight, uint32_t *width, uint32_t *height)
+static void *image_alloc(MTY_BufferPool *pool, size_t size)
+{
+	return pool ? MTY_BufferPoolAlloc(pool, size, false) : MTY_Alloc(size, 1);
+}
+
+static void *image_crop(const void *image, uint32_t cropWidth, uint32_t cropHeight, uint32_t *width,
+	uint32_t *height, MTY_BufferPool *pool)
 {
 	uint32_t crop_width = 0;
 	uint32_t crop_height = 0;
@@ -42,7 +48,7 @@ void *MTY_CropImage(const void *image, uint32_t cropWidth, uint32_t cropHeight,
 		uint32_t crop_w = *width - crop_width;
 		uint32_t crop_h = *height - crop_height;
 
-		uint8_t *cropped = MTY_Alloc(crop_w * crop_h, 4);
+		uint8_t *cropped = image_alloc(pool, (size_t) crop_w * crop_h * 4);
 		for (uint32_t h = y; h < *height - y && h - y < crop_h; h++)
 			memcpy(cropped + ((h - y) * crop_w * 4), (uint8_t *) image + (h * *width * 4) + (x * 4), crop_w * 4);
 
@@ -54,3 +60,409 @@ void *MTY_CropImage(const void *image, uint32_t cropWidth, uint32_t cropHeight,
 
 	return NULL;
 }
+
+void *MTY_CropImage(const void *image, uint32_t cropWidth, uint32_t cropHeight, uint32_t *width, uint32_t *height)
+{
+	return image_crop(image, cropWidth, cropHeight, width, height, NULL);
+}
+
+static void *image_resize(const void *image, uint32_t width, uint32_t height, uint32_t newWidth,
+	uint32_t newHeight, MTY_BufferPool *pool)
+{
+	const uint8_t *src = image;
+	uint8_t *dst = image_alloc(pool, (size_t) newWidth * newHeight * 4);
+
+	// Span of input columns covered by each output column, at least one wide
+	uint32_t *xs = MTY_Alloc(newWidth + 1, sizeof(uint32_t));
+	for (uint32_t x = 0; x <= newWidth; x++)
+		xs[x] = (uint32_t) ((uint64_t) x * width / newWidth);
+
+	uint64_t *sum = MTY_Alloc(newWidth * 4, sizeof(uint64_t));
+
+	for (uint32_t y = 0; y < newHeight; y++) {
+		uint32_t y0 = (uint32_t) ((uint64_t) y * height / newHeight);
+		uint32_t y1 = (uint32_t) ((uint64_t) (y + 1) * height / newHeight);
+		if (y1 == y0)
+			y1 = y0 + 1;
+
+		memset(sum, 0, newWidth * 4 * sizeof(uint64_t));
+
+		for (uint32_t sy = y0; sy < y1; sy++) {
+			const uint8_t *row = src + (size_t) sy * width * 4;
+
+			for (uint32_t x = 0; x < newWidth; x++) {
+				uint32_t x1 = xs[x + 1] > xs[x] ? xs[x + 1] : xs[x] + 1;
+
+				for (uint32_t sx = xs[x]; sx < x1; sx++)
+					for (uint8_t c = 0; c < 4; c++)
+						sum[x * 4 + c] += row[sx * 4 + c];
+			}
+		}
+
+		uint8_t *out = dst + (size_t) y * newWidth * 4;
+
+		for (uint32_t x = 0; x < newWidth; x++) {
+			uint32_t x1 = xs[x + 1] > xs[x] ? xs[x + 1] : xs[x] + 1;
+			uint64_t n = (uint64_t) (y1 - y0) * (x1 - xs[x]);
+
+			for (uint8_t c = 0; c < 4; c++)
+				out[x * 4 + c] = (uint8_t) ((sum[x * 4 + c] + n / 2) / n);
+		}
+	}
+
+	MTY_Free(sum);
+	MTY_Free(xs);
+
+	return dst;
+}
+
+void *MTY_ResizeImage(const void *image, uint32_t width, uint32_t height, uint32_t newWidth,
+	uint32_t newHeight)
+{
+	if (width == 0 || height == 0 || newWidth == 0 || newHeight == 0) {
+		MTY_Log("Image dimensions must be greater than 0");
+		return NULL;
+	}
+
+	return image_resize(image, width, height, newWidth, newHeight, NULL);
+}
+
+
+// Batch
+
+#define IMAGE_BATCH_PENDING 4
+
+struct image_job {
+	MTY_ImageJob job;
+	char *path;
+};
+
+struct MTY_ImageBatch {
+	MTY_ImageBatchFunc func;
+	void *opaque;
+
+	MTY_BufferPool *pool;
+	MTY_Mutex *mutex;
+	MTY_Cond *cond;
+	MTY_Thread **threads;
+	uint32_t num_threads;
+
+	struct image_job *jobs;
+	uint32_t len;
+	uint32_t head;
+	uint32_t pending;
+	uint32_t active;
+	bool stop;
+
+	size_t max_memory;
+	size_t memory;
+	size_t inputs;
+};
+
+static uint32_t image_be(const uint8_t *b, uint8_t n)
+{
+	uint32_t v = 0;
+
+	for (uint8_t x = 0; x < n; x++)
+		v = v << 8 | b[x];
+
+	return v;
+}
+
+static bool image_probe(const uint8_t *b, size_t size, uint32_t *width, uint32_t *height)
+{
+	// PNG, IHDR is always the first chunk
+	if (size >= 24 && !memcmp(b, "\x89PNG", 4)) {
+		*width = image_be(b + 16, 4);
+		*height = image_be(b + 20, 4);
+		return true;
+	}
+
+	// JPEG, walk the markers until a start of frame
+	if (size >= 4 && b[0] == 0xFF && b[1] == 0xD8) {
+		for (size_t pos = 2; pos + 9 < size;) {
+			uint8_t marker = b[pos + 1];
+
+			if (b[pos] != 0xFF || marker == 0xFF) {
+				pos++;
+
+			} else if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD9)) {
+				pos += 2;
+
+			} else if (marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC) {
+				*height = image_be(b + pos + 5, 2);
+				*width = image_be(b + pos + 7, 2);
+				return true;
+
+			} else {
+				pos += 2 + image_be(b + pos + 2, 2);
+			}
+		}
+	}
+
+	return false;
+}
+
+static void image_batch_reserve(MTY_ImageBatch *ctx, size_t size, bool input)
+{
+	MTY_MutexLock(ctx->mutex);
+
+	// An image larger than the limit still proceeds once it's the only one in flight
+	while (ctx->max_memory > 0 && ctx->memory > 0 && ctx->memory + size > ctx->max_memory)
+		MTY_CondWait(ctx->cond, ctx->mutex, -1);
+
+	ctx->memory += size;
+
+	if (input)
+		ctx->inputs += size;
+
+	MTY_MutexUnlock(ctx->mutex);
+}
+
+static void image_batch_grow(MTY_ImageBatch *ctx, size_t input, size_t size)
+{
+	MTY_MutexLock(ctx->mutex);
+
+	// Turns an input reservation into one of `size` for decoding. Only jobs already
+	// decoding are waited on, jobs holding just their input may be waiting here too
+	if (size > input) {
+		while (ctx->max_memory > 0 && ctx->memory > ctx->inputs && ctx->memory + size - input > ctx->max_memory)
+			MTY_CondWait(ctx->cond, ctx->mutex, -1);
+
+		ctx->memory += size - input;
+
+	} else {
+		ctx->memory -= input - size;
+		MTY_CondSignalAll(ctx->cond);
+	}
+
+	ctx->inputs -= input;
+
+	MTY_MutexUnlock(ctx->mutex);
+}
+
+static void image_batch_release(MTY_ImageBatch *ctx, size_t size)
+{
+	MTY_MutexLock(ctx->mutex);
+
+	ctx->memory -= size;
+	ctx->active--;
+	MTY_CondSignalAll(ctx->cond);
+
+	MTY_MutexUnlock(ctx->mutex);
+}
+
+static void image_batch_free(MTY_ImageBatch *ctx, void *image, bool pooled)
+{
+	if (pooled) {
+		MTY_BufferPoolFree(ctx->pool, image);
+
+	} else {
+		MTY_Free(image);
+	}
+}
+
+static void image_batch_run(MTY_ImageBatch *ctx, struct image_job *ij)
+{
+	MTY_ImageJob *job = &ij->job;
+	job->path = ij->path;
+
+	const void *input = job->input;
+	size_t size = job->size;
+	void *file = NULL;
+
+	// The compressed file counts against the limit before it's read
+	size_t file_size = 0;
+
+	if (!input && job->path) {
+		file_size = MTY_GetFileSize(job->path);
+		image_batch_reserve(ctx, file_size, true);
+
+		file = MTY_ReadFile(job->path, &size);
+		input = file;
+	}
+
+	// Reserve the decoded size plus a processed copy, or a guess from the compressed size
+	uint32_t w = 0;
+	uint32_t h = 0;
+	size_t reserve = 0;
+
+	if (input)
+		reserve = image_probe(input, size, &w, &h) ? size + (size_t) w * h * 8 : size * 8;
+
+	// A failed read releases the file reservation
+	if (job->path && !job->input) {
+		image_batch_grow(ctx, file_size, reserve);
+
+	} else {
+		image_batch_reserve(ctx, reserve, false);
+	}
+
+	void *output = NULL;
+	size_t output_size = 0;
+	void *image = input ? MTY_DecompressImage(input, size, &w, &h) : NULL;
+	bool pooled = false;
+
+	MTY_Free(file);
+
+	// Cropped and resized copies are recycled across jobs, the decoded image
+	// comes from the decoder's own allocator
+	if (image && (job->cropWidth > 0 || job->cropHeight > 0)) {
+		void *cropped = image_crop(image, job->cropWidth, job->cropHeight, &w, &h, ctx->pool);
+
+		if (cropped) {
+			MTY_Free(image);
+			image = cropped;
+			pooled = true;
+		}
+	}
+
+	if (image && ((job->maxWidth > 0 && w > job->maxWidth) || (job->maxHeight > 0 && h > job->maxHeight))) {
+		float sw = job->maxWidth > 0 ? (float) job->maxWidth / (float) w : 1.0f;
+		float sh = job->maxHeight > 0 ? (float) job->maxHeight / (float) h : 1.0f;
+		float s = fminf(sw, sh);
+
+		uint32_t nw = lrint((float) w * s);
+		uint32_t nh = lrint((float) h * s);
+		nw = nw > 0 ? nw : 1;
+		nh = nh > 0 ? nh : 1;
+
+		void *resized = image_resize(image, w, h, nw, nh, ctx->pool);
+		image_batch_free(ctx, image, pooled);
+
+		image = resized;
+		pooled = true;
+		w = nw;
+		h = nh;
+	}
+
+	if (image && job->compress) {
+		output = MTY_CompressImage(job->method, image, w, h, &output_size);
+		image_batch_free(ctx, image, pooled);
+		pooled = false;
+
+	} else if (image) {
+		output = image;
+		output_size = (size_t) w * h * 4;
+	}
+
+	ctx->func(job, output, output_size, output ? w : 0, output ? h : 0, ctx->opaque);
+
+	image_batch_free(ctx, output, pooled);
+	MTY_Free(ij->path);
+
+	image_batch_release(ctx, reserve);
+}
+
+static void *image_batch_thread(void *opaque)
+{
+	MTY_ImageBatch *ctx = opaque;
+
+	while (true) {
+		MTY_MutexLock(ctx->mutex);
+
+		while (ctx->pending == 0 && !ctx->stop)
+			MTY_CondWait(ctx->cond, ctx->mutex, -1);
+
+		if (ctx->pending == 0) {
+			MTY_MutexUnlock(ctx->mutex);
+			break;
+		}
+
+		struct image_job ij = ctx->jobs[ctx->head];
+		ctx->head = (ctx->head + 1) % ctx->len;
+		ctx->pending--;
+		ctx->active++;
+
+		MTY_CondSignalAll(ctx->cond);
+		MTY_MutexUnlock(ctx->mutex);
+
+		image_batch_run(ctx, &ij);
+	}
+
+	return NULL;
+}
+
+MTY_ImageBatch *MTY_ImageBatchCreate(uint32_t threads, size_t maxMemory, MTY_ImageBatchFunc func,
+	void *opaque)
+{
+	if (threads == 0) {
+		MTY_CPUInfo info = {0};
+		MTY_GetCPUInfo(&info);
+
+		threads = info.threads > 0 ? info.threads : 1;
+	}
+
+	MTY_ImageBatch *ctx = MTY_Alloc(1, sizeof(MTY_ImageBatch));
+	ctx->func = func;
+	ctx->opaque = opaque;
+	ctx->max_memory = maxMemory;
+
+	ctx->pool = MTY_BufferPoolCreate(maxMemory, true);
+	ctx->mutex = MTY_MutexCreate();
+	ctx->cond = MTY_CondCreate();
+
+	ctx->len = threads * IMAGE_BATCH_PENDING;
+	ctx->jobs = MTY_Alloc(ctx->len, sizeof(struct image_job));
+
+	ctx->num_threads = threads;
+	ctx->threads = MTY_Alloc(threads, sizeof(MTY_Thread *));
+
+	for (uint32_t x = 0; x < threads; x++)
+		ctx->threads[x] = MTY_ThreadCreate(image_batch_thread, ctx);
+
+	return ctx;
+}
+
+void MTY_ImageBatchDestroy(MTY_ImageBatch **batch)
+{
+	if (!batch || !*batch)
+		return;
+
+	MTY_ImageBatch *ctx = *batch;
+
+	MTY_MutexLock(ctx->mutex);
+	ctx->stop = true;
+	MTY_CondSignalAll(ctx->cond);
+	MTY_MutexUnlock(ctx->mutex);
+
+	for (uint32_t x = 0; x < ctx->num_threads; x++)
+		MTY_ThreadDestroy(&ctx->threads[x]);
+
+	MTY_CondDestroy(&ctx->cond);
+	MTY_MutexDestroy(&ctx->mutex);
+	MTY_BufferPoolDestroy(&ctx->pool);
+
+	MTY_Free(ctx->threads);
+	MTY_Free(ctx->jobs);
+
+	MTY_Free(ctx);
+	*batch = NULL;
+}
+
+void MTY_ImageBatchSubmit(MTY_ImageBatch *ctx, const MTY_ImageJob *job)
+{
+	MTY_MutexLock(ctx->mutex);
+
+	while (ctx->pending == ctx->len)
+		MTY_CondWait(ctx->cond, ctx->mutex, -1);
+
+	struct image_job *ij = &ctx->jobs[(ctx->head + ctx->pending) % ctx->len];
+	ij->job = *job;
+	ij->path = job->path && !job->input ? MTY_Strdup(job->path) : NULL;
+
+	ctx->pending++;
+
+	MTY_CondSignalAll(ctx->cond);
+	MTY_MutexUnlock(ctx->mutex);
+}
+
+void MTY_ImageBatchWait(MTY_ImageBatch *ctx)
+{
+	MTY_MutexLock(ctx->mutex);
+
+	while (ctx->pending > 0 || ctx->active > 0)
+		MTY_CondWait(ctx->cond, ctx->mutex, -1);
+
+	MTY_MutexUnlock(ctx->mutex);
+}
@@ -5,12 +5,21 @@
 // You can obtain one at https://spdx.org/licenses/MIT.html.
 
 #include "matoya.h"
+#include "log.h"
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "tlocal.h"
 
+#define LOG_RECENT_SIZE 256
+
+struct log_recent {
+	MTY_Atomic64 seq;
+	char msg[LOG_RECENT_SIZE];
+};
+
 static void log_none(const char *msg, void *opaque);
 
 static MTY_Atomic32 LOG_DISABLED;
@@ -20,10 +29,58 @@ static void *LOG_OPAQUE;
 static TLOCAL char *LOG_MSG;
 static TLOCAL bool LOG_PREVENT_RECURSIVE;
 
+static struct log_recent LOG_RECENT[LOG_RECENT_MAX];
+static MTY_Atomic64 LOG_RECENT_HEAD;
+
 static void log_none(const char *msg, void *opaque)
 {
 }
 
+
+// Recent messages, a lock-free ring readable from a signal handler
+
+static void log_recent_push(const char *msg)
+{
+	int64_t seq = MTY_Atomic64Add(&LOG_RECENT_HEAD, 1);
+	struct log_recent *r = &LOG_RECENT[(seq - 1) % LOG_RECENT_MAX];
+
+	// The sequence is cleared while the message is being written
+	MTY_Atomic64Set(&r->seq, 0);
+
+	size_t len = strlen(msg);
+	if (len > LOG_RECENT_SIZE - 1)
+		len = LOG_RECENT_SIZE - 1;
+
+	memcpy(r->msg, msg, len);
+	r->msg[len] = '\0';
+
+	MTY_Atomic64Set(&r->seq, seq);
+}
+
+bool mty_log_get_recent(uint32_t index, char *msg, size_t size)
+{
+	int64_t seq = MTY_Atomic64Get(&LOG_RECENT_HEAD) - index;
+	if (index >= LOG_RECENT_MAX || seq <= 0 || size == 0)
+		return false;
+
+	struct log_recent *r = &LOG_RECENT[(seq - 1) % LOG_RECENT_MAX];
+
+	if (MTY_Atomic64Get(&r->seq) != seq)
+		return false;
+
+	size_t len = 0;
+	for (; len < size - 1 && len < LOG_RECENT_SIZE - 1 && r->msg[len]; len++)
+		msg[len] = r->msg[len];
+
+	msg[len] = '\0';
+
+	// The slot may have been reused while it was being copied
+	return MTY_Atomic64Get(&r->seq) == seq;
+}
+
+
+// Log
+
 static void log_internal(const char *func, const char *fmt, va_list args)
 {
 	if (MTY_Atomic32Get(&LOG_DISABLED) || LOG_PREVENT_RECURSIVE)
@@ -33,6 +90,7 @@ static void log_internal(const char *func, const char *fmt, va_list args)
 	char *msg = MTY_VsprintfD(fmt_name, args);
 
 	LOG_MSG = mty_tlocal_strcpy(msg);
+	log_recent_push(msg);
 
 	MTY_Free(msg);
 	MTY_Free(fmt_name);
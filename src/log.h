@@ -0,0 +1,14 @@
+// Copyright (c) Christopher D. Dickson <cdd@matoya.group>
+//
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+#pragma once
+
+#include "matoya.h"
+
+#define LOG_RECENT_MAX 64
+
+// Async-signal-safe, `index` 0 is the most recent message
+bool mty_log_get_recent(uint32_t index, char *msg, size_t size);
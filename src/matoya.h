@@ -69,9 +69,42 @@ typedef enum {
 	MTY_COLOR_FORMAT_BGR565   = 6, ///< 5-bits blue, 6-bits green, 5-bits red.
 	MTY_COLOR_FORMAT_BGRA5551 = 7, ///< 5-bits per BGR channels, 1-bit alpha.
 	MTY_COLOR_FORMAT_AYUV     = 8, ///< 4:4:4 full W/H interleaved Y, U, V.
+	MTY_COLOR_FORMAT_P010     = 9, ///< NV12 layout with 16-bits per component, 10-bit values stored
+	                               ///<   in the high bits. MTY_GFX_GL only.
+	MTY_COLOR_FORMAT_P016     = 10, ///< NV12 layout with 16-bits per component. MTY_GFX_GL only.
+	MTY_COLOR_FORMAT_I010     = 11, ///< I420 layout with 16-bits per component, 10-bit values stored
+	                                ///<   in the low bits. MTY_GFX_GL only.
+	MTY_COLOR_FORMAT_I410     = 12, ///< I444 layout with 16-bits per component, 10-bit values stored
+	                                ///<   in the low bits. MTY_GFX_GL only.
+	MTY_COLOR_FORMAT_Y410     = 13, ///< 4:4:4 full W/H packed 32-bit U, Y, V with 10-bits each from
+	                                ///<   the least significant bit, followed by 2-bit alpha.
+	                                ///<   MTY_GFX_GL only.
+	MTY_COLOR_FORMAT_RGB10A2  = 14, ///< Packed 32-bit R, G, B with 10-bits each from the least
+	                                ///<   significant bit, followed by 2-bit alpha. MTY_GFX_GL only.
+	MTY_COLOR_FORMAT_RGBA16F  = 15, ///< 16-bit half float per channel RGBA. MTY_GFX_GL only.
 	MTY_COLOR_FORMAT_MAKE_32 = INT32_MAX,
 } MTY_ColorFormat;
 
+/// @brief YUV to RGB conversion matrices.
+typedef enum {
+	MTY_COLOR_MATRIX_BT709   = 0, ///< ITU-R BT.709, HD video.
+	MTY_COLOR_MATRIX_BT601   = 1, ///< ITU-R BT.601, SD video.
+	MTY_COLOR_MATRIX_BT2020  = 2, ///< ITU-R BT.2020 non-constant luminance, UHD and HDR video.
+	                              ///<   With an HDR transfer, BT.2020 primaries are also converted
+	                              ///<   to BT.709.
+	MTY_COLOR_MATRIX_MAKE_32 = INT32_MAX,
+} MTY_ColorMatrix;
+
+/// @brief Transfer characteristics of a raw image.
+/// @details HDR transfers are tone mapped to SDR for display.
+typedef enum {
+	MTY_TRANSFER_SDR     = 0, ///< Gamma encoded SDR, displayed as is.
+	MTY_TRANSFER_PQ      = 1, ///< SMPTE ST 2084 perceptual quantizer (HDR10).
+	MTY_TRANSFER_HLG     = 2, ///< ARIB STD-B67 hybrid log-gamma.
+	MTY_TRANSFER_LINEAR  = 3, ///< Linear light where 1.0 is 80 nits (scRGB).
+	MTY_TRANSFER_MAKE_32 = INT32_MAX,
+} MTY_Transfer;
+
 /// @brief Quad texture filtering.
 typedef enum {
 	MTY_FILTER_NEAREST        = 0, ///< Nearest neighbor filter by the GPU, can cause shimmering.
@@ -115,6 +148,13 @@ typedef struct {
 	float scale;            ///< Multiplier applied to the dimensions of the image, producing an
 	                        ///<   minimized or magnified image. This can be set to 0
 	                        ///<   if unnecessary.
+	MTY_ColorMatrix matrix; ///< Matrix used to convert YUV formats to RGB. MTY_GFX_GL only,
+	                        ///<   other APIs always use BT.709.
+	MTY_Transfer transfer;  ///< Transfer characteristics of the image. MTY_GFX_GL only.
+	bool fullRange;         ///< YUV components use the full range of values rather than the
+	                        ///<   limited (video) range. MTY_GFX_GL only.
+	float maxLuminance;     ///< Peak luminance of the content in nits used when tone mapping
+	                        ///<   HDR transfers. This can be set to 0 to use 1000 nits.
 } MTY_RenderDesc;
 
 /// @brief A point with an `x` and `y` coordinate.
@@ -229,6 +269,23 @@ MTY_RendererSetUITexture(MTY_Renderer *ctx, MTY_GFX api, MTY_Device *device,
 MTY_EXPORT bool
 MTY_RendererHasUITexture(MTY_Renderer *ctx, uint32_t id);
 
+/// @brief Pack small UI textures into shared atlas pages.
+/// @details When enabled, textures set via MTY_RendererSetUITexture whose dimensions
+///   are at most a quarter of `pageSize` are packed into shared pages rather than
+///   receiving their own texture. Texture coordinates are remapped during
+///   MTY_RendererDrawUI, and consecutive commands that end up sharing a page and clip
+///   rectangle are merged into a single draw.\n\n
+///   Atlased textures must only be sampled with texture coordinates between 0 and 1,
+///   and their vertices must not be shared with commands using other textures.
+///   Texture ids from 0xFFFFFF00 and up are reserved for atlas pages.\n\n
+///   Textures already set are not affected. Removing or replacing an atlased texture
+///   frees its space, and pages are repacked when they become too fragmented to
+///   accept new textures. Textures that don't fit are given their own texture.
+/// @param ctx An MTY_Renderer.
+/// @param pageSize Width and height of each atlas page in pixels, or 0 to disable.
+MTY_EXPORT void
+MTY_RendererSetUIAtlas(MTY_Renderer *ctx, uint32_t pageSize);
+
 /// @brief Get a list of available graphics APIs on the current OS.
 /// @param apis Array to receive the list of available graphics APIs. This buffer
 ///   should be MTY_GFX_MAX elements.
@@ -294,6 +351,7 @@ MTY_FreeRenderState(MTY_RenderState **state);
 	(MTY_DPAD(c) == 5 || MTY_DPAD(c) == 6 || MTY_DPAD(c) == 7)
 
 typedef struct MTY_App MTY_App;
+typedef struct MTY_ControllerReplay MTY_ControllerReplay;
 typedef int8_t MTY_Window;
 
 /// @brief Function called once per message cycle.
@@ -741,6 +799,27 @@ typedef struct {
 	                    ///<   index is already taken, the first available is used.
 } MTY_WindowDesc;
 
+/// @brief Statistics about presentation to a window.
+/// @details Each call to MTY_WindowPresent is assigned an increasing present ID starting
+///   at 1. When the platform reports vblank timestamps they are used for `displayTime`,
+///   `missedFrames`, and `refreshInterval`, otherwise these values are estimated from
+///   when each present completes and `estimated` is set.
+typedef struct {
+	float cpuWait;           ///< Milliseconds the calling thread was blocked inside
+	                         ///<   MTY_WindowPresent, including any wait for queued frames.
+	float refreshInterval;   ///< Measured milliseconds between display refreshes, 0 if
+	                         ///<   not yet known.
+	uint32_t framesInFlight; ///< Number of presented frames the GPU had not yet finished
+	                         ///<   when MTY_WindowPresent returned.
+	uint64_t presentID;      ///< ID of the most recent call to MTY_WindowPresent.
+	uint64_t displayedID;    ///< ID of the most recent present known to be on screen.
+	int64_t displayTime;     ///< MTY_Time at which `displayedID` reached the screen,
+	                         ///<   comparable with MTY_GetTime.
+	uint64_t missedFrames;   ///< Total refreshes presents have been late by compared to
+	                         ///<   their requested swap interval.
+	bool estimated;          ///< Timing values are estimates rather than vblank timestamps.
+} MTY_PresentStats;
+
 /// @brief Function called for each event sent to the app.
 /// @param evt The MTY_Event received by the app.
 /// @param opaque Pointer set via MTY_AppCreate.
@@ -1201,6 +1280,9 @@ MTY_EXPORT bool
 MTY_WindowHasUITexture(MTY_App *app, MTY_Window window, uint32_t id);
 
 /// @brief Wrapped MTY_RendererSetUITexture for the window.
+/// @details On Linux with MTY_GFX_GL, windows share a single set of UI textures, so a
+///   texture set on one window is visible to all of them. Use MTY_WindowHasUITexture
+///   to avoid uploading the same texture more than once.
 /// @param app The MTY_App.
 /// @param window An MTY_Window.
 /// @param id The desired `id` for the texture.
@@ -1212,6 +1294,13 @@ MTY_EXPORT bool
 MTY_WindowSetUITexture(MTY_App *app, MTY_Window window, uint32_t id, const void *rgba,
 	uint32_t width, uint32_t height);
 
+/// @brief Wrapped MTY_RendererSetUIAtlas for the window.
+/// @param app The MTY_App.
+/// @param window An MTY_Window.
+/// @param pageSize Width and height of each atlas page in pixels, or 0 to disable.
+MTY_EXPORT void
+MTY_WindowSetUIAtlas(MTY_App *app, MTY_Window window, uint32_t pageSize);
+
 /// @brief Make the window's context current or not current on the calling thread.
 /// @details This has no effect if the window is not using MTY_GFX_GL. It is
 ///   recommended that you first make the context not current on one thread before
@@ -1233,6 +1322,30 @@ MTY_WindowMakeCurrent(MTY_App *app, MTY_Window window, bool current);
 MTY_EXPORT void
 MTY_WindowPresent(MTY_App *app, MTY_Window window, uint32_t numFrames);
 
+/// @brief Set the maximum number of frames the CPU may submit ahead of the GPU.
+/// @details After presenting, MTY_WindowPresent blocks until no more than `frames`
+///   frames are still being processed by the GPU. Fewer frames in flight lowers input
+///   latency, more frames allows CPU and GPU work to overlap for higher throughput.
+///   The default is 1.
+/// @param app The MTY_App.
+/// @param window An MTY_Window.
+/// @param frames Maximum frames in flight between 1 and 3.
+//- #support Linux
+MTY_EXPORT void
+MTY_WindowSetFramesInFlight(MTY_App *app, MTY_Window window, uint32_t frames);
+
+/// @brief Get presentation statistics for the window.
+/// @details Statistics are updated during MTY_WindowPresent, so `displayedID` typically
+///   trails `presentID` by the number of frames queued for display.
+/// @param app The MTY_App.
+/// @param window An MTY_Window.
+/// @param stats Set to the window's presentation statistics.
+/// @returns Returns true if the window's graphics context reports statistics,
+///   otherwise false.
+//- #support Linux
+MTY_EXPORT bool
+MTY_WindowGetPresentStats(MTY_App *app, MTY_Window window, MTY_PresentStats *stats);
+
 /// @brief Get the current graphics API in use by the window.
 /// @param app The MTY_App.
 /// @param window An MTY_Window.
@@ -1281,6 +1394,83 @@ MTY_SetAppID(const char *id);
 MTY_EXPORT void
 MTY_PrintEvent(const MTY_Event *evt);
 
+/// @brief Start recording raw controller input.
+/// @details Raw HID reports, and evdev events on Linux, are captured with timestamps
+///   as they arrive from any MTY_App in the process, along with what is needed to
+///   rebuild each device. The recording is held in memory so input handling never
+///   waits on disk, and is written to `path` by MTY_ControllerRecordStop. Only one
+///   recording can be active at a time.\n\n
+///   Recordings are fed back through the same parsers with MTY_ControllerReplayCreate.
+/// @param path Path to the recording file. An existing file is overwritten.
+/// @returns Returns true on success, false if a recording is already active.
+MTY_EXPORT bool
+MTY_ControllerRecordStart(const char *path);
+
+/// @brief Stop recording controller input and write the recording file.
+/// @returns Returns true if the recording was written, false if no recording was
+///   active or the write failed. Call MTY_GetLog for details.
+MTY_EXPORT bool
+MTY_ControllerRecordStop(void);
+
+/// @brief Create an MTY_ControllerReplay from a controller recording.
+/// @details The replay runs each recorded report through the same driver and axis
+///   mapping code that produced the original events. No real devices are needed.
+///   Output reports are discarded and feature requests fail as if the device did not
+///   support them. Some drivers may therefore take a different initialization path
+///   than they did during recording.\n\n
+///   Replays are deterministic for a given recording. The exception is drivers with
+///   wall-clock timeouts, such as the Nintendo Switch handshake.
+/// @param buf Recording data, typically loaded with MTY_ReadFile. The data is copied.
+/// @param size Size in bytes of `buf`.
+/// @returns On failure, NULL is returned. Call MTY_GetLog for details.\n\n
+///   The returned MTY_ControllerReplay must be destroyed with MTY_ControllerReplayDestroy.
+MTY_EXPORT MTY_ControllerReplay *
+MTY_ControllerReplayCreate(const void *buf, size_t size);
+
+/// @brief Destroy an MTY_ControllerReplay.
+/// @param replay Passed by reference and set to NULL after being destroyed.
+MTY_EXPORT void
+MTY_ControllerReplayDestroy(MTY_ControllerReplay **replay);
+
+/// @brief Get the next controller event from a replay.
+/// @details Events are MTY_EVENT_CONNECT, MTY_EVENT_DISCONNECT, or MTY_EVENT_CONTROLLER
+///   and match what an MTY_EventFunc would have received. Controller events are
+///   produced even if the recording app was in the background. Reports from HID devices
+///   without a dedicated driver are skipped.
+/// @param ctx An MTY_ControllerReplay.
+/// @param evt Set to the next event.
+/// @param timestamp Set to the time the source input arrived in microseconds since
+///   the recording started. May be NULL.
+/// @returns Returns true if an event was produced, false at the end of the recording
+///   or if the recording is malformed.
+MTY_EXPORT bool
+MTY_ControllerReplayNext(MTY_ControllerReplay *ctx, MTY_Event *evt, uint64_t *timestamp);
+
+/// @brief Run a replayed controller's rumble encoding and capture the output report.
+/// @details This is the replay equivalent of MTY_AppRumbleController. Instead of
+///   being sent to a device, the output report the driver builds is returned.
+/// @param ctx An MTY_ControllerReplay.
+/// @param id A controller `id` from a replayed MTY_EVENT_CONNECT that is still connected.
+/// @param low Strength of low frequency motor between 0 and UINT16_MAX.
+/// @param high Strength of the high frequency motor between 0 and UINT16_MAX.
+/// @param report Output buffer that receives the output report.
+/// @param size Size in bytes of `report`. Longer reports are truncated.
+/// @returns The full size of the output report, or 0 if the controller's driver
+///   does not support rumble.
+MTY_EXPORT size_t
+MTY_ControllerReplayRumble(MTY_ControllerReplay *ctx, uint32_t id, uint16_t low, uint16_t high,
+	void *report, size_t size);
+
+/// @brief Get the touchpad state of a replayed controller.
+/// @details This is the replay equivalent of MTY_AppGetControllerTouchpad, reflecting
+///   the most recent report returned by MTY_ControllerReplayNext.
+/// @param ctx An MTY_ControllerReplay.
+/// @param id A controller `id` from a replayed MTY_EVENT_CONNECT that is still connected.
+/// @param size Set to the size of the returned buffer.
+/// @returns The raw touchpad data, or NULL if the controller does not have a touchpad.
+MTY_EXPORT const void *
+MTY_ControllerReplayGetTouchpad(MTY_ControllerReplay *ctx, uint32_t id, size_t *size);
+
 /// @brief If using MTY_GFX_GL, retrieve a GL function by its name.
 /// @details A GL context (WGL, GLX, EGL) must be active on the current thread for
 ///   this function to work properly.
@@ -1293,11 +1483,90 @@ MTY_GLGetProcAddress(const char *name);
 
 
 //- #module Audio
-//- #mbrief Simple audio playback.
-//- #mdetails This is a very minimal interface that assumes 2-channel, 16-bit signed PCM
-//-   submitted by pushing to a queue.
+//- #mbrief Simple audio playback and capture.
+//- #mdetails Playback is a very minimal interface that assumes 2-channel, 16-bit signed
+//-   PCM submitted by pushing to a queue. Capture runs on its own thread and delivers
+//-   fixed size periods of audio either to a callback or through a queue.
 
 typedef struct MTY_Audio MTY_Audio;
+typedef struct MTY_AudioCapture MTY_AudioCapture;
+
+/// @brief Audio device events.
+typedef enum {
+	MTY_AUDIO_DEVICE_LOST            = 0, ///< The device was removed or stopped responding.
+	MTY_AUDIO_DEVICE_RESTORED        = 1, ///< The context was reopened after the device was lost.
+	MTY_AUDIO_DEVICE_DEFAULT_CHANGED = 2, ///< The set of devices changed and the context
+	                                      ///<   was reopened on the new default device.
+	MTY_AUDIO_DEVICE_MAKE_32         = INT32_MAX,
+} MTY_AudioDeviceEvent;
+
+/// @brief Description of an audio device.
+typedef struct {
+	char *id;    ///< Identifier passed to MTY_AudioCreateDevice.
+	char *name;  ///< Human readable name.
+	bool output; ///< The device supports playback.
+	bool input;  ///< The device supports capture.
+} MTY_AudioDevice;
+
+/// @brief A list of audio devices.
+typedef struct {
+	MTY_AudioDevice *devices; ///< List of audio devices.
+	uint32_t len;             ///< Number of elements in `devices`.
+} MTY_AudioDeviceList;
+
+/// @brief Hardware parameters negotiated with an audio device.
+typedef struct {
+	uint32_t sampleRate; ///< Sample rate in Hz.
+	uint32_t periodSize; ///< Number of frames the device processes at a time.
+	uint32_t bufferSize; ///< Number of frames in the device buffer.
+} MTY_AudioHardware;
+
+/// @brief Function called when the device backing an MTY_Audio context changes.
+/// @details This function is called on the thread calling MTY_AudioQueue.
+/// @param event The device event.
+/// @param device The id of the device that was lost or opened, or NULL for the
+///   system default.
+/// @param opaque Pointer set via MTY_AudioSetDeviceFunc.
+typedef void (*MTY_AudioDeviceFunc)(MTY_AudioDeviceEvent event, const char *device,
+	void *opaque);
+
+/// @brief Audio sample formats.
+typedef enum {
+	MTY_AUDIO_FORMAT_S16     = 0, ///< 16-bit signed integer samples.
+	MTY_AUDIO_FORMAT_S32     = 1, ///< 32-bit signed integer samples.
+	MTY_AUDIO_FORMAT_FLOAT   = 2, ///< 32-bit float samples.
+	MTY_AUDIO_FORMAT_MAKE_32 = INT32_MAX,
+} MTY_AudioFormat;
+
+/// @brief Description of an audio capture stream.
+typedef struct {
+	const char *device;     ///< Device name, or NULL for the system default. On Linux
+	                        ///<   this is an ALSA PCM name such as `hw:1,0` or `null`.
+	MTY_AudioFormat format; ///< Sample format of captured frames.
+	uint32_t sampleRate;    ///< Sample rate in Hz.
+	uint32_t channels;      ///< Number of interleaved channels per frame.
+	uint32_t periodSize;    ///< Number of frames delivered at a time. If 0, 10 ms worth
+	                        ///<   of frames is used.
+	uint32_t periods;       ///< Number of periods buffered by the device and by the
+	                        ///<   capture queue. If 0, 4 periods are used.
+} MTY_AudioCaptureDesc;
+
+/// @brief Audio capture statistics.
+typedef struct {
+	uint64_t frames;   ///< Total number of frames delivered.
+	uint32_t overruns; ///< Number of times the device buffer overran and audio was lost.
+	uint32_t dropped;  ///< Number of periods dropped because the capture queue was full.
+	float latency;     ///< Time in milliseconds from when the first frame of the most
+	                   ///<   recent period was captured to when it was delivered.
+} MTY_AudioCaptureStats;
+
+/// @brief Function called on the capture thread each time a period is captured.
+/// @param frames Interleaved audio frames in the format requested.
+/// @param count The number of frames in `frames`.
+/// @param timestamp MTY_Time at which the first frame in `frames` was captured.
+/// @param opaque Pointer set via MTY_AudioCaptureCreate.
+typedef void (*MTY_AudioCaptureFunc)(const void *frames, uint32_t count, int64_t timestamp,
+	void *opaque);
 
 /// @brief Create an MTY_Audio context for playback.
 /// @param sampleRate Audio sample rate in KHz.
@@ -1311,6 +1580,21 @@ typedef struct MTY_Audio MTY_Audio;
 MTY_EXPORT MTY_Audio *
 MTY_AudioCreate(uint32_t sampleRate, uint32_t minBuffer, uint32_t maxBuffer);
 
+/// @brief Create an MTY_Audio context for playback on a specific device.
+/// @details If the device is lost while playing, it is reopened automatically,
+///   falling back to the system default until the device returns.
+/// @param device An `id` returned by MTY_AudioGetDevices, or NULL for the system
+///   default. On Linux any ALSA PCM name may be used.
+/// @param sampleRate Audio sample rate in KHz.
+/// @param minBuffer See MTY_AudioCreate.
+/// @param maxBuffer See MTY_AudioCreate.
+/// @returns On failure, NULL is returned. Call MTY_GetLog for details.\n\n
+///   The returned MTY_Audio context must be destroyed with MTY_AudioDestroy.
+//- #support Linux
+MTY_EXPORT MTY_Audio *
+MTY_AudioCreateDevice(const char *device, uint32_t sampleRate, uint32_t minBuffer,
+	uint32_t maxBuffer);
+
 /// @brief Destroy an MTY_Audio context.
 /// @param audio Passed by reference and set to NULL after being destroyed.
 MTY_EXPORT void
@@ -1338,6 +1622,102 @@ MTY_AudioGetQueued(MTY_Audio *ctx);
 MTY_EXPORT void
 MTY_AudioQueue(MTY_Audio *ctx, const int16_t *frames, uint32_t count);
 
+/// @brief Get the hardware parameters negotiated with the current device.
+/// @param ctx An MTY_Audio context.
+/// @param hw Set to the negotiated hardware parameters.
+/// @returns Returns false if no device is currently open, otherwise true.
+//- #support Linux
+MTY_EXPORT bool
+MTY_AudioGetHardware(MTY_Audio *ctx, MTY_AudioHardware *hw);
+
+/// @brief Set a function to be notified of device changes.
+/// @param ctx An MTY_Audio context.
+/// @param func Function called when the device is lost, restored, or the default
+///   device changes. May be NULL.
+/// @param opaque Passed to `func`.
+//- #support Linux
+MTY_EXPORT void
+MTY_AudioSetDeviceFunc(MTY_Audio *ctx, MTY_AudioDeviceFunc func, void *opaque);
+
+/// @brief Get a list of available audio devices.
+/// @returns On failure, NULL is returned. Call MTY_GetLog for details.\n\n
+///   The returned MTY_AudioDeviceList must be destroyed with MTY_AudioFreeDevices.
+//- #support Linux
+MTY_EXPORT MTY_AudioDeviceList *
+MTY_AudioGetDevices(void);
+
+/// @brief Free a device list returned by MTY_AudioGetDevices.
+/// @param list Passed by reference and set to NULL after being destroyed.
+//- #support Linux
+MTY_EXPORT void
+MTY_AudioFreeDevices(MTY_AudioDeviceList **list);
+
+/// @brief Create an MTY_AudioCapture context.
+/// @details Capture does not begin until MTY_AudioCaptureStart is called.
+/// @param desc Description of the capture stream.
+/// @param func Function called on the capture thread with each period. If NULL,
+///   periods are queued and retrieved with MTY_AudioCaptureGetPeriod instead.
+/// @param opaque Passed to `func`.
+/// @returns On failure, NULL is returned. Call MTY_GetLog for details.\n\n
+///   The returned MTY_AudioCapture context must be destroyed with MTY_AudioCaptureDestroy.
+//- #support Linux
+MTY_EXPORT MTY_AudioCapture *
+MTY_AudioCaptureCreate(const MTY_AudioCaptureDesc *desc, MTY_AudioCaptureFunc func,
+	void *opaque);
+
+/// @brief Destroy an MTY_AudioCapture context.
+/// @details Capture is stopped if it is running.
+/// @param capture Passed by reference and set to NULL after being destroyed.
+//- #support Linux
+MTY_EXPORT void
+MTY_AudioCaptureDestroy(MTY_AudioCapture **capture);
+
+/// @brief Start capturing audio.
+/// @param ctx An MTY_AudioCapture context.
+/// @returns Returns true on success, false otherwise. Call MTY_GetLog for details.
+//- #support Linux
+MTY_EXPORT bool
+MTY_AudioCaptureStart(MTY_AudioCapture *ctx);
+
+/// @brief Stop capturing audio.
+/// @details The capture thread is joined before this function returns, so the
+///   capture function will not be called again. Periods already queued remain
+///   available until the next call to MTY_AudioCaptureStart.
+/// @param ctx An MTY_AudioCapture context.
+//- #support Linux
+MTY_EXPORT void
+MTY_AudioCaptureStop(MTY_AudioCapture *ctx);
+
+/// @brief Retrieve the oldest queued period of captured audio.
+/// @details Only available if `func` was NULL when the context was created. The
+///   period must be released with MTY_AudioCapturePop.
+/// @param ctx An MTY_AudioCapture context.
+/// @param timeout Time to wait in milliseconds for a period to become available.
+///   A negative value will not timeout.
+/// @param frames Set to the interleaved audio frames in the format requested.
+/// @param count Set to the number of frames in `frames`.
+/// @param timestamp Set to the MTY_Time at which the first frame was captured. May
+///   be NULL.
+/// @returns Returns true if a period was retrieved, false on timeout.
+//- #support Linux
+MTY_EXPORT bool
+MTY_AudioCaptureGetPeriod(MTY_AudioCapture *ctx, int32_t timeout, const void **frames,
+	uint32_t *count, int64_t *timestamp);
+
+/// @brief Release the period retrieved via MTY_AudioCaptureGetPeriod.
+/// @param ctx An MTY_AudioCapture context.
+//- #support Linux
+MTY_EXPORT void
+MTY_AudioCapturePop(MTY_AudioCapture *ctx);
+
+/// @brief Get statistics for an MTY_AudioCapture context.
+/// @details This function is thread safe and may be called while capture is running.
+/// @param ctx An MTY_AudioCapture context.
+/// @param stats Set to the current capture statistics.
+//- #support Linux
+MTY_EXPORT void
+MTY_AudioCaptureGetStats(MTY_AudioCapture *ctx, MTY_AudioCaptureStats *stats);
+
 
 //- #module Crypto
 //- #mbrief Common cryptography tasks.
@@ -1510,6 +1890,8 @@ MTY_ShowMessageBox(const char *title, const char *fmt, ...) MTY_FMT(2, 3);
 #define MTY_FILE_MAX 0x40000000 ///< Maximum size of a file that can be read by libmatoya.
 
 typedef struct MTY_LockFile MTY_LockFile;
+typedef struct MTY_RecordLog MTY_RecordLog;
+typedef struct MTY_RecordReader MTY_RecordReader;
 
 /// @brief Special directories on the filesystem.
 typedef enum {
@@ -1533,6 +1915,15 @@ typedef enum {
 	MTY_FILE_MODE_MAKE_32 = INT32_MAX,
 } MTY_FileMode;
 
+/// @brief Durability guarantees of an MTY_RecordLog.
+typedef enum {
+	MTY_DURABILITY_NONE     = 0, ///< Records are flushed to disk by the OS at its leisure.
+	MTY_DURABILITY_PERIODIC = 1, ///< Records are flushed when at least `interval` milliseconds
+	                             ///<   have passed since the last flush.
+	MTY_DURABILITY_RECORD   = 2, ///< Every record is flushed before MTY_RecordLogAppend returns.
+	MTY_DURABILITY_MAKE_32  = INT32_MAX,
+} MTY_Durability;
+
 /// @brief File properties.
 typedef struct {
 	char *path; ///< The base path to the file.
@@ -1599,6 +1990,13 @@ MTY_DeleteFile(const char *path);
 MTY_EXPORT bool
 MTY_FileExists(const char *path);
 
+/// @brief Get the size of a file without reading it.
+/// @param path Path to the file.
+/// @returns The size of the file in bytes, or 0 if it does not exist or can't be
+///   queried. Call MTY_GetLog for details.
+MTY_EXPORT size_t
+MTY_GetFileSize(const char *path);
+
 /// @brief Create a directory with subdirectories.
 /// @details This function behaves in a similar manner to the `mkdir -p` Unix utility.
 /// @param path Path to the directory.
@@ -1687,11 +2085,81 @@ MTY_GetFileList(const char *path, const char *filter);
 MTY_EXPORT void
 MTY_FreeFileList(MTY_FileList **fileList);
 
+/// @brief Create an MTY_RecordLog for appending binary records to disk.
+/// @details The log is a directory of memory mapped, pre-allocated segment files.
+///   Each record is length prefixed and protected by a CRC32. When the log is
+///   reopened after a crash, any partially written records at the tail of the most
+///   recent segment are discarded and appending resumes after the last valid record.
+///   Only one process may append to a log at a time.
+/// @param dir Directory containing the log. It will be created if it does not exist.
+/// @param segmentSize Size in bytes of each segment, or 0 for a reasonable default.
+///   A new segment is started when a record does not fit in the current one.
+/// @param durability When records are flushed to disk.
+/// @param interval Minimum milliseconds between flushes when `durability` is
+///   MTY_DURABILITY_PERIODIC. Flushing is driven by MTY_RecordLogAppend.
+/// @returns On failure, NULL is returned. Call MTY_GetLog for details.\n\n
+///   The returned MTY_RecordLog must be destroyed with MTY_RecordLogDestroy.
+//- #support macOS Android Linux
+MTY_EXPORT MTY_RecordLog *
+MTY_RecordLogCreate(const char *dir, size_t segmentSize, MTY_Durability durability,
+	uint32_t interval);
+
+/// @brief Destroy an MTY_RecordLog.
+/// @details Pending records are flushed unless the log uses MTY_DURABILITY_NONE.
+/// @param log Passed by reference and set to NULL after being destroyed.
+//- #support macOS Android Linux
+MTY_EXPORT void
+MTY_RecordLogDestroy(MTY_RecordLog **log);
+
+/// @brief Append a record to an MTY_RecordLog.
+/// @param ctx An MTY_RecordLog.
+/// @param buf Record data.
+/// @param size Size in bytes of `buf`. The record must fit in a single segment.
+/// @returns Returns true on success, false on failure. Call MTY_GetLog for details.
+//- #support macOS Android Linux
+MTY_EXPORT bool
+MTY_RecordLogAppend(MTY_RecordLog *ctx, const void *buf, size_t size);
+
+/// @brief Flush all appended records to disk regardless of durability mode.
+/// @param ctx An MTY_RecordLog.
+/// @returns Returns true on success, false on failure. Call MTY_GetLog for details.
+//- #support macOS Android Linux
+MTY_EXPORT bool
+MTY_RecordLogSync(MTY_RecordLog *ctx);
+
+/// @brief Create an MTY_RecordReader to sequentially read an MTY_RecordLog.
+/// @details The set of segments is captured when the reader is created. Records
+///   with an invalid CRC end the current segment.
+/// @param dir Directory containing the log.
+/// @returns The returned MTY_RecordReader must be destroyed with
+///   MTY_RecordReaderDestroy.
+//- #support macOS Android Linux
+MTY_EXPORT MTY_RecordReader *
+MTY_RecordReaderCreate(const char *dir);
+
+/// @brief Destroy an MTY_RecordReader.
+/// @param reader Passed by reference and set to NULL after being destroyed.
+//- #support macOS Android Linux
+MTY_EXPORT void
+MTY_RecordReaderDestroy(MTY_RecordReader **reader);
+
+/// @brief Read the next record from an MTY_RecordReader.
+/// @param ctx An MTY_RecordReader.
+/// @param size Set to the size in bytes of the returned record.
+/// @returns A pointer directly into the mapped segment, valid until the next call to
+///   this function or until the reader is destroyed. NULL is returned when there are
+///   no more records.
+//- #support macOS Android Linux
+MTY_EXPORT const void *
+MTY_RecordReaderNext(MTY_RecordReader *ctx, size_t *size);
+
 
 //- #module Image
-//- #mbrief Image compression and cropping. Program icons.
+//- #mbrief Image compression, cropping and resizing. Batch processing. Program icons.
 //- #mdetails Basic image processing with support for only PNG and JPEG.
 
+typedef struct MTY_ImageBatch MTY_ImageBatch;
+
 /// @brief Image compression methods.
 typedef enum {
 	MTY_IMAGE_COMPRESSION_PNG     = 0, ///< PNG encoded image.
@@ -1738,6 +2206,21 @@ MTY_EXPORT void *
 MTY_CropImage(const void *image, uint32_t cropWidth, uint32_t cropHeight,
 	uint32_t *width, uint32_t *height);
 
+/// @brief Resize an RGBA image.
+/// @details When shrinking, each output pixel is the average of the input pixels it
+///   covers. When enlarging, input pixels are repeated.
+/// @param image RGBA 8-bits per channel image to be resized.
+/// @param width The width of `image`.
+/// @param height The height of `image`.
+/// @param newWidth The width of the returned buffer.
+/// @param newHeight The height of the returned buffer.
+/// @returns The resized image, which is `newWidth * newHeight * 4` bytes.\n\n
+///   On failure, NULL is returned. Call MTY_GetLog for details.\n\n
+///   The returned buffer must be destroyed with MTY_Free.
+MTY_EXPORT void *
+MTY_ResizeImage(const void *image, uint32_t width, uint32_t height, uint32_t newWidth,
+	uint32_t newHeight);
+
 /// @brief Get an application's program icon as an RGBA image.
 /// @param path Path to the application binary.
 /// @param width Set to the width of the returned buffer.
@@ -1749,6 +2232,72 @@ MTY_CropImage(const void *image, uint32_t cropWidth, uint32_t cropHeight,
 MTY_EXPORT void *
 MTY_GetProgramIcon(const char *path, uint32_t *width, uint32_t *height);
 
+/// @brief Description of a single image processed by an MTY_ImageBatch.
+/// @details Images are decoded, center cropped, scaled down to fit, then optionally
+///   compressed, in that order.
+typedef struct {
+	const char *path;            ///< File containing the compressed image. Ignored if
+	                             ///<   `input` is set.
+	const void *input;           ///< Compressed image data. It must remain valid until
+	                             ///<   the image's MTY_ImageBatchFunc has been called.
+	size_t size;                 ///< Size in bytes of `input`.
+	uint32_t cropWidth;          ///< Center crop width, or 0 to not crop horizontally.
+	uint32_t cropHeight;         ///< Center crop height, or 0 to not crop vertically.
+	uint32_t maxWidth;           ///< Scale down to fit this width preserving the aspect
+	                             ///<   ratio, or 0 for no limit.
+	uint32_t maxHeight;          ///< Scale down to fit this height preserving the aspect
+	                             ///<   ratio, or 0 for no limit.
+	bool compress;               ///< Compress the result with `method`. If false, the
+	                             ///<   result is RGBA 8-bits per channel.
+	MTY_ImageCompression method; ///< Compression method used when `compress` is true.
+	void *opaque;                ///< Passed to the MTY_ImageBatchFunc.
+} MTY_ImageJob;
+
+/// @brief Function called when an image submitted to an MTY_ImageBatch is complete.
+/// @details This function is called on a worker thread, possibly concurrently with
+///   other images completing.
+/// @param job The job passed to MTY_ImageBatchSubmit. `path` is a copy owned by the
+///   batch.
+/// @param output The processed image, or NULL on failure. This buffer is only valid
+///   until the function returns.
+/// @param size The size in bytes of `output`.
+/// @param width The width of the processed image.
+/// @param height The height of the processed image.
+/// @param opaque Pointer set via MTY_ImageBatchCreate.
+typedef void (*MTY_ImageBatchFunc)(const MTY_ImageJob *job, const void *output, size_t size,
+	uint32_t width, uint32_t height, void *opaque);
+
+/// @brief Create an MTY_ImageBatch for processing images on worker threads.
+/// @param threads The number of worker threads, or 0 to use one per logical processor.
+/// @param maxMemory Approximate limit in bytes on the memory used by images in flight.
+///   A worker waits for memory to be released before starting an image that would
+///   exceed the limit, unless no other images are in flight. If 0, there is no limit.
+/// @param func Function called as each image completes.
+/// @param opaque Passed to `func`.
+/// @returns The returned MTY_ImageBatch must be destroyed with MTY_ImageBatchDestroy.
+MTY_EXPORT MTY_ImageBatch *
+MTY_ImageBatchCreate(uint32_t threads, size_t maxMemory, MTY_ImageBatchFunc func,
+	void *opaque);
+
+/// @brief Destroy an MTY_ImageBatch.
+/// @details All submitted images are completed before the workers are joined.
+/// @param batch Passed by reference and set to NULL after being destroyed.
+MTY_EXPORT void
+MTY_ImageBatchDestroy(MTY_ImageBatch **batch);
+
+/// @brief Submit an image for processing.
+/// @details If the number of images waiting for a worker is at its limit, this
+///   function blocks until one is started.
+/// @param ctx An MTY_ImageBatch.
+/// @param job Description of the image. It is copied, including `path`.
+MTY_EXPORT void
+MTY_ImageBatchSubmit(MTY_ImageBatch *ctx, const MTY_ImageJob *job);
+
+/// @brief Wait for all submitted images to complete.
+/// @param ctx An MTY_ImageBatch.
+MTY_EXPORT void
+MTY_ImageBatchWait(MTY_ImageBatch *ctx);
+
 
 //- #module JSON
 //- #mbrief JSON parsing and construction.
@@ -2159,6 +2708,8 @@ MTY_LogFatalParams(const char *func, const char *fmt, ...) MTY_FMT(2, 3);
 //-   functions that have platform differences. Additionally, functions like MTY_Alloc
 //-   wrap `calloc` but `abort()` on failure.
 
+typedef struct MTY_BufferPool MTY_BufferPool;
+
 #define MTY_MIN(a, b) \
 	((a) > (b) ? (b) : (a))
 
@@ -2178,6 +2729,17 @@ MTY_LogFatalParams(const char *func, const char *fmt, ...) MTY_FMT(2, 3);
 ///   before `e0`. Otherwise, the position is unchanged.
 typedef int32_t (*MTY_CompareFunc)(const void *e0, const void *e1);
 
+/// @brief MTY_BufferPool statistics.
+typedef struct {
+	uint64_t allocs;  ///< Total number of buffers handed out.
+	uint64_t reused;  ///< Number of buffers handed out from the pool's cache.
+	uint64_t mapped;  ///< Number of buffers newly mapped from the system.
+	uint64_t trimmed; ///< Number of cached buffers returned to the system.
+	size_t used;      ///< Bytes currently handed out.
+	size_t cached;    ///< Bytes cached for reuse.
+	size_t huge;      ///< Bytes currently backed by explicitly reserved huge pages.
+} MTY_BufferPoolStats;
+
 /// @brief Allocate zeroed memory.
 /// @details For more information, see `calloc` from the C standard library.
 /// @param len Number of elements requested.
@@ -2222,6 +2784,86 @@ MTY_FreeAligned(void *mem);
 MTY_EXPORT void *
 MTY_Realloc(void *mem, size_t len, size_t size);
 
+/// @brief Create an MTY_BufferPool for recycling large buffers.
+/// @details Buffers that are allocated and freed repeatedly, such as video frames
+///   passed to MTY_RendererDrawQuad or network payloads, pay for page faults and
+///   zeroing on every MTY_Alloc. An MTY_BufferPool maps buffers directly from the
+///   system in size classes no more than 25% larger than requested and keeps freed
+///   buffers for reuse, so a steady state workload stops touching the system
+///   allocator entirely.\n\n
+///   Cached buffers that go unused for several seconds are returned to the system,
+///   as are the least recently used buffers once `maxCached` is exceeded. Call
+///   MTY_BufferPoolTrim to release memory on demand, for instance when the
+///   application is notified of memory pressure.\n\n
+///   An MTY_BufferPool is thread safe.
+/// @param maxCached Maximum number of bytes kept for reuse, or 0 for 256 MB.
+/// @param hugePages Back buffers of 2 MB or larger with huge pages to reduce TLB
+///   pressure. Explicitly reserved huge pages (`MAP_HUGETLB`) are used if available,
+///   otherwise transparent huge pages are requested. Ignored on platforms other
+///   than Linux.
+/// @returns The returned MTY_BufferPool must be destroyed with MTY_BufferPoolDestroy.
+MTY_EXPORT MTY_BufferPool *
+MTY_BufferPoolCreate(size_t maxCached, bool hugePages);
+
+/// @brief Destroy an MTY_BufferPool.
+/// @details All buffers allocated by the pool, including those not yet freed, are
+///   returned to the system.
+/// @param pool Passed by reference and set to NULL after being destroyed.
+MTY_EXPORT void
+MTY_BufferPoolDestroy(MTY_BufferPool **pool);
+
+/// @brief Get a buffer from an MTY_BufferPool.
+/// @param ctx An MTY_BufferPool.
+/// @param size Size in bytes of the requested buffer. The pool is intended for
+///   buffers of at least several pages, smaller requests still occupy 64 KB.
+/// @param zero If true, the buffer is zeroed. If false, a recycled buffer keeps
+///   the contents it had when it was freed.
+/// @returns The page aligned buffer.\n\n
+///   This function can not return NULL. It will call `abort()` on failure.\n\n
+///   The returned buffer must be freed with MTY_BufferPoolFree on the same pool.
+MTY_EXPORT void *
+MTY_BufferPoolAlloc(MTY_BufferPool *ctx, size_t size, bool zero);
+
+/// @brief Return a buffer to an MTY_BufferPool.
+/// @param ctx An MTY_BufferPool.
+/// @param buffer A buffer returned by MTY_BufferPoolAlloc. May be NULL.
+MTY_EXPORT void
+MTY_BufferPoolFree(MTY_BufferPool *ctx, void *buffer);
+
+/// @brief Return cached buffers to the system.
+/// @details Buffers currently handed out are not affected.
+/// @param ctx An MTY_BufferPool.
+/// @param keep Number of cached bytes to retain. Pass 0 to release every cached
+///   buffer.
+MTY_EXPORT void
+MTY_BufferPoolTrim(MTY_BufferPool *ctx, size_t keep);
+
+/// @brief Get statistics about an MTY_BufferPool.
+/// @param ctx An MTY_BufferPool.
+/// @param stats Set to the current statistics.
+MTY_EXPORT void
+MTY_BufferPoolGetStats(MTY_BufferPool *ctx, MTY_BufferPoolStats *stats);
+
+/// @brief Allocate zeroed memory on a specific NUMA node.
+/// @details Pages are placed on `node` as they are first touched regardless of which
+///   thread touches them, falling back to other nodes if `node` is out of memory.
+///   This is intended for large per-thread data used by workers pinned to a node,
+///   see MTY_ThreadPoolCreateWithPolicy.\n\n
+///   On platforms without NUMA support `node` is ignored.
+/// @param size Size in bytes of the requested buffer.
+/// @param node NUMA node number as reported by MTY_GetCPUTopology.
+/// @returns The zeroed and page aligned buffer.\n\n
+///   This function can not return NULL. It will call `abort()` on failure.\n\n
+///   The returned buffer must be destroyed with MTY_FreeNode.
+MTY_EXPORT void *
+MTY_AllocNode(size_t size, uint32_t node);
+
+/// @brief Free memory allocated by MTY_AllocNode.
+/// @param mem Memory allocated by MTY_AllocNode. May be NULL.
+/// @param size The `size` passed to MTY_AllocNode.
+MTY_EXPORT void
+MTY_FreeNode(void *mem, size_t size);
+
 /// @brief Duplicate a buffer.
 /// @param mem Buffer to duplicate.
 /// @param size Size in bytes of `mem`.
@@ -2395,6 +3037,101 @@ MTY_EXPORT uint64_t
 MTY_SwapFromBE64(uint64_t value);
 
 
+//- #module Metrics
+//- #mbrief Lock-free counters, gauges, and histograms.
+//- #mdetails Metrics are registered by name in a global registry and live until the
+//-   process exits. Counter and histogram updates are sharded between threads and
+//-   never take a lock. When libmatoya is built with `MTY_METRICS` defined, its own
+//-   subsystems report metrics with the `mty_` prefix.
+
+typedef struct MTY_Metric MTY_Metric;
+
+/// @brief Metric types.
+typedef enum {
+	MTY_METRIC_COUNTER   = 0, ///< A monotonically increasing total.
+	MTY_METRIC_GAUGE     = 1, ///< A value that can be set or go up and down.
+	MTY_METRIC_HISTOGRAM = 2, ///< A distribution of observed values in fixed buckets.
+	MTY_METRIC_MAKE_32   = INT32_MAX,
+} MTY_MetricType;
+
+/// @brief A snapshot of a metric's value.
+typedef struct {
+	char *name;              ///< The full metric name, including any labels.
+	char *help;              ///< The description of the metric.
+	MTY_MetricType type;     ///< The metric type.
+	int64_t value;           ///< The value of a counter or gauge.
+	uint64_t count;          ///< The number of values observed by a histogram.
+	double sum;              ///< The sum of values observed by a histogram.
+	double *buckets;         ///< The inclusive upper bound of each histogram bucket.
+	uint64_t *bucketCounts;  ///< The cumulative number of observations in each bucket.
+	uint32_t numBuckets;     ///< Number of elements in `buckets` and `bucketCounts`.
+} MTY_MetricValue;
+
+/// @brief A snapshot of all registered metrics.
+typedef struct {
+	MTY_MetricValue *metrics; ///< Metrics in the order they were registered.
+	uint32_t len;             ///< Number of elements in `metrics`.
+} MTY_MetricList;
+
+/// @brief Get a metric by name, registering it if it does not exist.
+/// @details Registration takes a global lock, so the returned MTY_Metric should be
+///   kept rather than looked up on every update.
+/// @param name The metric name, i.e. `http_requests`, optionally followed by labels,
+///   i.e. `http_requests{code="200"}`. Metrics with the same name and different
+///   labels belong to the same family. Counter names should not end with `_total`,
+///   it is added when serialized.
+/// @param help A description of the metric. May be NULL.
+/// @param type The metric type. If the metric already exists with a different type,
+///   NULL is returned.
+/// @param buckets Increasing inclusive upper bounds for a histogram. May be NULL to
+///   use a default set suited to durations in seconds. Ignored for other types.
+/// @param numBuckets The number of elements in `buckets`.
+/// @returns On failure, NULL is returned. Call MTY_GetLog for details.\n\n
+///   The returned MTY_Metric is owned by the registry and must not be freed.
+MTY_EXPORT MTY_Metric *
+MTY_GetMetric(const char *name, const char *help, MTY_MetricType type,
+	const double *buckets, uint32_t numBuckets);
+
+/// @brief Add to a counter or gauge.
+/// @details Histograms treat this as MTY_MetricObserve.
+/// @param ctx An MTY_Metric. May be NULL, in which case this function does nothing.
+/// @param value The amount to add. Counters should only be increased.
+MTY_EXPORT void
+MTY_MetricAdd(MTY_Metric *ctx, int64_t value);
+
+/// @brief Set the value of a gauge.
+/// @param ctx An MTY_Metric. May be NULL, in which case this function does nothing.
+/// @param value The new value.
+MTY_EXPORT void
+MTY_MetricSet(MTY_Metric *ctx, int64_t value);
+
+/// @brief Record a value in a histogram.
+/// @param ctx An MTY_Metric. May be NULL, in which case this function does nothing.
+/// @param value The observed value.
+MTY_EXPORT void
+MTY_MetricObserve(MTY_Metric *ctx, double value);
+
+/// @brief Take a snapshot of all registered metrics.
+/// @details Updates made while the snapshot is taken may be partially included.
+/// @returns The returned MTY_MetricList must be destroyed with MTY_FreeMetricList.
+MTY_EXPORT MTY_MetricList *
+MTY_GetMetricList(void);
+
+/// @brief Free an MTY_MetricList.
+/// @param list Passed by reference and set to NULL after being destroyed.
+MTY_EXPORT void
+MTY_FreeMetricList(MTY_MetricList **list);
+
+/// @brief Serialize all registered metrics in the OpenMetrics text format.
+/// @details The output is also valid Prometheus text exposition format, and may be
+///   served as the body of an HTTP response with the content type
+///   `application/openmetrics-text; version=1.0.0; charset=utf-8`.
+/// @returns A null-terminated string ending with `# EOF`.\n\n
+///   The returned string must be destroyed with MTY_Free.
+MTY_EXPORT char *
+MTY_SerializeMetrics(void);
+
+
 //- #module Thread
 //- #mbrief Thread creation and synchronization, atomics.
 //- #mdetails You should have a solid understanding of multithreaded programming
@@ -2409,6 +3146,7 @@ typedef struct MTY_Cond MTY_Cond;
 typedef struct MTY_RWLock MTY_RWLock;
 typedef struct MTY_Waitable MTY_Waitable;
 typedef struct MTY_ThreadPool MTY_ThreadPool;
+typedef struct MTY_FiberScheduler MTY_FiberScheduler;
 
 /// @brief Function that takes a single opaque argument.
 /// @param opaque Pointer set via various MTY_ThreadPool related functions.
@@ -2429,6 +3167,27 @@ typedef enum {
 	MTY_ASYNC_MAKE_32  = INT32_MAX,
 } MTY_Async;
 
+/// @brief Placement of MTY_ThreadPool threads created via MTY_ThreadPoolCreateWithPolicy.
+typedef enum {
+	MTY_THREAD_POLICY_NONE    = 0, ///< Threads are not pinned and may run anywhere.
+	MTY_THREAD_POLICY_CORE    = 1, ///< One thread per physical core, pinned to the core's
+	                               ///<   SMT siblings.
+	MTY_THREAD_POLICY_LLC     = 2, ///< One thread per last level cache group, pinned to
+	                               ///<   the cores sharing the cache.
+	MTY_THREAD_POLICY_NODE    = 3, ///< One thread per NUMA node, pinned to the node's cores.
+	MTY_THREAD_POLICY_MAKE_32 = INT32_MAX,
+} MTY_ThreadPolicy;
+
+/// @brief Fiber scheduler statistics.
+typedef struct {
+	uint32_t fibers;   ///< Number of fibers that have not yet returned.
+	uint32_t waiting;  ///< Number of fibers blocked on I/O or sleeping.
+	uint64_t switches; ///< Total number of times a fiber has been resumed.
+	size_t stackSize;  ///< Usable stack size of each fiber in bytes.
+	size_t reserved;   ///< Address space reserved for stacks in bytes, including
+	                   ///<   guard pages and pooled stacks.
+} MTY_FiberStats;
+
 /// @brief 32-bit integer used for atomic operations.
 typedef struct {
 	volatile int32_t value; ///< 32-bit value wrapped in a struct for alignment.
@@ -2465,6 +3224,15 @@ MTY_ThreadDetach(MTY_ThreadFunc func, void *opaque);
 MTY_EXPORT int64_t
 MTY_ThreadGetID(MTY_Thread *ctx);
 
+/// @brief Restrict the calling thread to a set of logical processors.
+/// @param cpus Array of logical processor numbers as reported by MTY_GetCPUTopology.
+/// @param len Number of elements in `cpus`.
+/// @returns Returns true on success, false on failure or if the platform does not
+///   support thread affinity. Call MTY_GetLog for details.
+//- #support Windows Android Linux
+MTY_EXPORT bool
+MTY_ThreadSetAffinity(const uint32_t *cpus, uint32_t len);
+
 /// @brief Create an MTY_Mutex for synchronization.
 /// @details A mutex can be locked by only one thread at a time. Other threads trying
 ///   to take the same mutex will block until it becomes unlocked.
@@ -2598,6 +3366,28 @@ MTY_WaitableSignal(MTY_Waitable *ctx);
 MTY_EXPORT MTY_ThreadPool *
 MTY_ThreadPoolCreate(uint32_t maxThreads);
 
+/// @brief Create an MTY_ThreadPool whose threads are placed according to the CPU
+///   topology.
+/// @details Each index in the pool is assigned a core, cache group, or NUMA node in
+///   turn, and a thread dispatched at that index pins itself there before running.
+///   Per-thread data can be allocated on the thread's node with MTY_AllocNode and
+///   MTY_ThreadPoolGetNode.
+/// @param policy How threads are placed.
+/// @param maxThreads Maximum number of threads that can be simultaneously executing,
+///   or 0 for one thread per core, cache group, or node depending on `policy`. If
+///   there are more threads than placements, placements are reused in order.
+/// @returns This function can not return NULL. It will call `abort()` on failure.\n\n
+///   The returned MTY_ThreadPool object must be destroyed with MTY_ThreadPoolDestroy.
+MTY_EXPORT MTY_ThreadPool *
+MTY_ThreadPoolCreateWithPolicy(MTY_ThreadPolicy policy, uint32_t maxThreads);
+
+/// @brief Get the NUMA node a thread pool index is pinned to.
+/// @param ctx An MTY_ThreadPool.
+/// @param index Thread index returned by MTY_ThreadPoolDispatch.
+/// @returns The node number, or 0 if the index is not pinned.
+MTY_EXPORT uint32_t
+MTY_ThreadPoolGetNode(MTY_ThreadPool *ctx, uint32_t index);
+
 /// @brief Destroy an MTY_ThreadPool.
 /// @param pool Passed by reference and set to NULL after being destroyed.
 /// @param detach Function called to clean up `opaque` thread state set via
@@ -2714,6 +3504,204 @@ MTY_GlobalLock(MTY_Atomic32 *lock);
 MTY_EXPORT void
 MTY_GlobalUnlock(MTY_Atomic32 *lock);
 
+/// @brief Create an MTY_FiberScheduler.
+/// @details Fibers are cooperatively scheduled coroutines with their own stacks,
+///   all running on the thread that calls MTY_FiberSchedulerRun. When a fiber calls
+///   a blocking libmatoya networking function such as MTY_WebSocketRead or
+///   MTY_HttpRequest, the wait is handed to the scheduler's `epoll` loop and other
+///   fibers run in the meantime, so many thousands of connections can be served
+///   with straight line code and a single thread.\n\n
+///   DNS lookups still block the whole scheduler, as do any system calls made
+///   directly by the fiber.
+/// @param stackSize Size in bytes of each fiber's stack, or 0 for the default of
+///   64 KiB. Stack memory is committed as it is used, and an overflow faults on a
+///   guard page.
+/// @returns On failure, NULL is returned. Call MTY_GetLog for details.\n\n
+///   The returned MTY_FiberScheduler must be destroyed with MTY_FiberSchedulerDestroy.
+//- #support Linux
+MTY_EXPORT MTY_FiberScheduler *
+MTY_FiberSchedulerCreate(uint32_t stackSize);
+
+/// @brief Destroy an MTY_FiberScheduler.
+/// @details Fibers that have not returned are discarded without being unwound, so
+///   any resources they hold are leaked.
+/// @param sched Passed by reference and set to NULL after being destroyed.
+//- #support Linux
+MTY_EXPORT void
+MTY_FiberSchedulerDestroy(MTY_FiberScheduler **sched);
+
+/// @brief Queue a function to run on a new fiber.
+/// @details This function must be called from the thread that owns the scheduler,
+///   either before MTY_FiberSchedulerRun or from a running fiber.
+/// @param ctx An MTY_FiberScheduler.
+/// @param func Function that executes on the fiber.
+/// @param opaque Passed to `func` when it is called.
+/// @returns Returns true on success, false if a stack could not be allocated. Call
+///   MTY_GetLog for details.
+//- #support Linux
+MTY_EXPORT bool
+MTY_FiberSpawn(MTY_FiberScheduler *ctx, MTY_AnonFunc func, void *opaque);
+
+/// @brief Run fibers on the calling thread until all of them have returned.
+/// @param ctx An MTY_FiberScheduler.
+//- #support Linux
+MTY_EXPORT void
+MTY_FiberSchedulerRun(MTY_FiberScheduler *ctx);
+
+/// @brief Allow other ready fibers to run before continuing the current one.
+/// @details Does nothing if not called from a fiber.
+//- #support Linux
+MTY_EXPORT void
+MTY_FiberYield(void);
+
+/// @brief Suspend the current fiber for a number of milliseconds.
+/// @details If not called from a fiber, this function behaves like MTY_Sleep.
+/// @param timeout Time to sleep in milliseconds.
+//- #support Linux
+MTY_EXPORT void
+MTY_FiberSleep(uint32_t timeout);
+
+/// @brief Get statistics about an MTY_FiberScheduler.
+/// @param ctx An MTY_FiberScheduler.
+/// @param stats Set to the current statistics.
+//- #support Linux
+MTY_EXPORT void
+MTY_FiberSchedulerGetStats(MTY_FiberScheduler *ctx, MTY_FiberStats *stats);
+
+
+//- #module IPC
+//- #mbrief Cross-process shared memory ring buffer.
+//- #mdetails The MTY_SharedRing is a lock-free (SPSC) or lightly locked (MPSC)
+//-   ring of variable sized records living in POSIX shared memory. The process
+//-   that creates the ring is its only consumer, any number of processes up to 16
+//-   may open it as producers. Waits are implemented with futexes and peers are
+//-   periodically checked for liveness, so a producer or consumer that dies never
+//-   leaves the other side blocked indefinitely.\n\n
+//-   Large payloads such as video frames can be handed off without a copy via a
+//-   pool of fixed size blocks: the producer fills a block in place and only a small
+//-   descriptor travels through the ring.
+//- #msupport Linux
+
+typedef struct MTY_SharedRing MTY_SharedRing;
+
+/// @brief Shared ring producer models.
+typedef enum {
+	MTY_SHARED_RING_SPSC    = 0, ///< Single producer, single consumer. No locking.
+	MTY_SHARED_RING_MPSC    = 1, ///< Multiple producers serialized by a robust mutex.
+	MTY_SHARED_RING_MAKE_32 = INT32_MAX,
+} MTY_SharedRingType;
+
+/// @brief Create a shared ring and become its consumer.
+/// @param name Unique name used by producers to open the ring.
+/// @param type The producer model of the ring.
+/// @param size Size in bytes of the record ring. A single record may occupy at most
+///   half of this size.
+/// @param blockSize Size in bytes of each zero-copy block. May be 0.
+/// @param numBlocks Number of zero-copy blocks. May be 0.
+/// @returns On failure, NULL is returned. Call MTY_GetLog for details.\n\n
+///   The returned MTY_SharedRing must be destroyed with MTY_SharedRingDestroy.
+//- #support Linux
+MTY_EXPORT MTY_SharedRing *
+MTY_SharedRingCreate(const char *name, MTY_SharedRingType type, size_t size,
+	size_t blockSize, uint32_t numBlocks);
+
+/// @brief Open an existing shared ring as a producer.
+/// @param name The name passed to MTY_SharedRingCreate in the consumer process.
+/// @returns On failure, NULL is returned. Call MTY_GetLog for details.\n\n
+///   The returned MTY_SharedRing must be destroyed with MTY_SharedRingDestroy.
+//- #support Linux
+MTY_EXPORT MTY_SharedRing *
+MTY_SharedRingOpen(const char *name);
+
+/// @brief Destroy an MTY_SharedRing.
+/// @details If called by the consumer the shared memory object is unlinked and
+///   producers will fail their next wait. Blocks held by a producer are released.
+/// @param ring Passed by reference and set to NULL after being destroyed.
+//- #support Linux
+MTY_EXPORT void
+MTY_SharedRingDestroy(MTY_SharedRing **ring);
+
+/// @brief Reserve space for a record in the ring.
+/// @details The returned buffer is written in place then committed with
+///   MTY_SharedRingPush. Only one record may be reserved at a time per MTY_SharedRing.
+/// @param ctx A producer MTY_SharedRing.
+/// @param size Maximum size in bytes of the record.
+/// @param timeout Time to wait in milliseconds for space, or -1 to wait indefinitely.
+/// @returns A buffer at least `size` bytes long, or NULL on timeout, if the record is
+///   too large, or if the consumer is no longer running.
+//- #support Linux
+MTY_EXPORT void *
+MTY_SharedRingGetInputBuffer(MTY_SharedRing *ctx, size_t size, int32_t timeout);
+
+/// @brief Commit the record reserved by MTY_SharedRingGetInputBuffer.
+/// @param ctx A producer MTY_SharedRing.
+/// @param size The actual size of the record, which must not exceed the reserved size.
+//- #support Linux
+MTY_EXPORT void
+MTY_SharedRingPush(MTY_SharedRing *ctx, size_t size);
+
+/// @brief Acquire a free zero-copy block.
+/// @param ctx A producer MTY_SharedRing.
+/// @param timeout Time to wait in milliseconds for a block, or -1 to wait indefinitely.
+/// @param index Set to the index of the block, later passed to MTY_SharedRingPushBlock.
+/// @returns A buffer MTY_SharedRingGetBlockSize bytes long, or NULL on timeout or if
+///   the consumer is no longer running.
+//- #support Linux
+MTY_EXPORT void *
+MTY_SharedRingGetBlock(MTY_SharedRing *ctx, int32_t timeout, uint32_t *index);
+
+/// @brief Hand a filled block to the consumer.
+/// @details A small descriptor is pushed through the ring, the block contents are
+///   never copied. The block is released when the consumer pops the descriptor.
+/// @param ctx A producer MTY_SharedRing.
+/// @param index Block index acquired via MTY_SharedRingGetBlock.
+/// @param size Size in bytes of valid data in the block.
+/// @param timeout Time to wait in milliseconds for ring space, or -1 to wait
+///   indefinitely.
+/// @returns Returns true on success, false on timeout or invalid arguments.
+//- #support Linux
+MTY_EXPORT bool
+MTY_SharedRingPushBlock(MTY_SharedRing *ctx, uint32_t index, size_t size, int32_t timeout);
+
+/// @brief Wait for the next record in the ring.
+/// @details The buffer points directly into shared memory and remains valid until
+///   MTY_SharedRingPop is called. Records abandoned by dead producers are skipped.
+///   A producer that exits without calling MTY_SharedRingDestroy is detected once
+///   its process has been reaped.
+/// @param ctx The consumer MTY_SharedRing.
+/// @param timeout Time to wait in milliseconds for a record, or -1 to wait
+///   indefinitely.
+/// @param buffer Set to the record's data, either in the ring or a zero-copy block.
+/// @param size Set to the size of the record. May be NULL.
+/// @returns MTY_ASYNC_OK if a record is available.\n\n
+///   MTY_ASYNC_CONTINUE if the wait timed out.\n\n
+///   MTY_ASYNC_DONE if the ring is empty and all producers have exited.\n\n
+///   MTY_ASYNC_ERROR if the ring is corrupt.
+//- #support Linux
+MTY_EXPORT MTY_Async
+MTY_SharedRingGetOutputBuffer(MTY_SharedRing *ctx, int32_t timeout, void **buffer,
+	size_t *size);
+
+/// @brief Release the record returned by MTY_SharedRingGetOutputBuffer.
+/// @param ctx The consumer MTY_SharedRing.
+//- #support Linux
+MTY_EXPORT void
+MTY_SharedRingPop(MTY_SharedRing *ctx);
+
+/// @brief Check if the other side of the ring is still running.
+/// @param ctx An MTY_SharedRing.
+/// @returns For a producer, true if the consumer is alive. For the consumer, true if
+///   at least one producer is alive.
+//- #support Linux
+MTY_EXPORT bool
+MTY_SharedRingIsPeerAlive(MTY_SharedRing *ctx);
+
+/// @brief Get the size of each zero-copy block.
+/// @param ctx An MTY_SharedRing.
+//- #support Linux
+MTY_EXPORT size_t
+MTY_SharedRingGetBlockSize(MTY_SharedRing *ctx);
+
 
 //- #module Net
 //- #mbrief HTTP/HTTPS, WebSocket support.
@@ -2723,6 +3711,103 @@ MTY_GlobalUnlock(MTY_Atomic32 *lock);
 #define MTY_RES_MAX 0x40000000 ///< Maximum size of an HTTP response that can be read by libmatoya.
 
 typedef struct MTY_WebSocket MTY_WebSocket;
+typedef struct MTY_WebSocketServer MTY_WebSocketServer;
+
+/// @brief Description of a WebSocket server.
+typedef struct {
+	const char *ip;                ///< Local IP address to bind to.
+	uint16_t port;                 ///< Local port to bind to.
+	const char * const *origins;   ///< An array of strings determining the allowed client
+	                               ///<   origins to accept connections from.
+	uint32_t numOrigins;           ///< The number of elements in `origins`.
+	bool secureOrigin;             ///< Only accept origins that begin with `https://`.
+	uint32_t shards;               ///< Number of listener threads sharing the port, or 0
+	                               ///<   for 1. Only Linux supports more than one.
+	uint32_t handshakeTimeout;     ///< Time in milliseconds a client has to complete the
+	                               ///<   upgrade request before being dropped, or 0 for 5000.
+	uint32_t maxPending;           ///< Maximum number of handshakes in progress per shard,
+	                               ///<   and the number of ready connections that can be
+	                               ///<   queued, or 0 for 256.
+} MTY_WebSocketServerDesc;
+
+/// @brief WebSocket server statistics.
+typedef struct {
+	uint64_t accepted; ///< Connections that completed the handshake.
+	uint64_t rejected; ///< Connections that sent an invalid or disallowed upgrade request.
+	uint64_t timeouts; ///< Connections dropped for exceeding the handshake timeout.
+	uint64_t dropped;  ///< Handshaked connections dropped because the ready queue was full.
+} MTY_WebSocketServerStats;
+
+/// @brief Result of parsing an HTTP header.
+typedef enum {
+	MTY_HTTP_PARSE_OK        = 0, ///< The header is complete and valid.
+	MTY_HTTP_PARSE_PARTIAL   = 1, ///< The input is valid so far but the header is incomplete.
+	MTY_HTTP_PARSE_INVALID   = 2, ///< The input violates RFC 9112.
+	MTY_HTTP_PARSE_TOO_LARGE = 3, ///< The header has more fields than the caller allowed.
+	MTY_HTTP_PARSE_MAKE_32   = INT32_MAX,
+} MTY_HttpParseResult;
+
+/// @brief A header field parsed by MTY_HttpParseMessage.
+typedef struct {
+	const char *name;  ///< Field name pointing into the parsed buffer, not null terminated.
+	size_t nameLen;    ///< Length of `name`.
+	const char *value; ///< Field value without surrounding whitespace pointing into the
+	                   ///<   parsed buffer, not null terminated.
+	size_t valueLen;   ///< Length of `value`.
+} MTY_HttpField;
+
+/// @brief An HTTP/1.x request or response header parsed by MTY_HttpParseMessage.
+/// @details All strings point into the parsed buffer and are not null terminated.
+typedef struct {
+	const char *method;    ///< Request method, or NULL for a response.
+	size_t methodLen;      ///< Length of `method`.
+	const char *target;    ///< Request target, or NULL for a response.
+	size_t targetLen;      ///< Length of `target`.
+	const char *reason;    ///< Response reason phrase, or NULL for a request.
+	size_t reasonLen;      ///< Length of `reason`, which may be 0.
+	uint16_t status;       ///< Response status code, or 0 for a request.
+	uint8_t minorVersion;  ///< Minor HTTP version, i.e. 1 for `HTTP/1.1`.
+	MTY_HttpField *fields; ///< The `fields` array passed to MTY_HttpParseMessage.
+	uint32_t numFields;    ///< Number of fields parsed into `fields`.
+	size_t size;           ///< Size in bytes of the header including the empty line that
+	                       ///<   terminates it. A body begins at this offset.
+} MTY_HttpMessage;
+
+/// @brief Characters left as is by MTY_HttpPercentEncode.
+typedef enum {
+	MTY_URL_ENCODE_COMPONENT = 0, ///< RFC 3986 unreserved characters `A-Z a-z 0-9 -._~`,
+	                              ///<   for a single path segment or query value.
+	MTY_URL_ENCODE_PATH      = 1, ///< Unreserved characters, sub-delims, `:`, `@`, and `/`.
+	MTY_URL_ENCODE_FORM      = 2, ///< `application/x-www-form-urlencoded`, alphanumerics and
+	                              ///<   `*-._` with space encoded as `+`.
+	MTY_URL_ENCODE_MAKE_32   = INT32_MAX,
+} MTY_UrlEncoding;
+
+/// @brief Components of a URL split by MTY_HttpSplitUrl.
+/// @details All strings point into the split URL and are not null terminated. An
+///   absent component is NULL, while a present but empty component, such as the query
+///   of `http://a/?`, is non-NULL with a length of 0. Components are not
+///   percent-decoded.
+typedef struct {
+	const char *scheme;   ///< Scheme without the trailing `:`.
+	size_t schemeLen;     ///< Length of `scheme`.
+	const char *userinfo; ///< User information without the trailing `@`.
+	size_t userinfoLen;   ///< Length of `userinfo`.
+	const char *host;     ///< Host, without brackets if it is an IP literal. Non-NULL whenever
+	                      ///<   the URL has an authority, even if the host is empty.
+	size_t hostLen;       ///< Length of `host`.
+	const char *port;     ///< Port digits without the leading `:`.
+	size_t portLen;       ///< Length of `port`, which may be 0.
+	const char *path;     ///< Path, which is never NULL but may be empty.
+	size_t pathLen;       ///< Length of `path`.
+	const char *query;    ///< Query without the leading `?`.
+	size_t queryLen;      ///< Length of `query`.
+	const char *fragment; ///< Fragment without the leading `#`.
+	size_t fragmentLen;   ///< Length of `fragment`.
+	uint16_t portNum;     ///< Value of `port`, or the default port for `http`, `https`, `ws`,
+	                      ///<   and `wss` if `port` is empty or absent, otherwise 0.
+	bool ipLiteral;       ///< `host` is an IPv6 or IPvFuture literal.
+} MTY_HttpUrl;
 
 /// @brief Function that is executed on a thread after an HTTP response is received.
 /// @details If set, this callback allows you to intercept and modify an HTTP response
@@ -2735,6 +3820,7 @@ typedef struct MTY_WebSocket MTY_WebSocket;
 typedef void (*MTY_HttpAsyncFunc)(uint16_t code, void **body, size_t *size);
 
 /// @brief Parse a URL into its components.
+/// @details IPv6 literal hosts are rejected since HTTP connections are IPv4 only.
 /// @param url URL to parse.
 /// @param host Output hostname.
 /// @param hostSize Size in bytes of `host`.
@@ -2746,12 +3832,121 @@ MTY_HttpParseUrl(const char *url, char *host, size_t hostSize, char *path,
 	size_t pathSize);
 
 /// @brief Encode a string with URL percent-encoding.
+/// @details This is MTY_HttpPercentEncode with MTY_URL_ENCODE_FORM.
 /// @param src The source string to encode.
 /// @param dst The encoded output.
 /// @param size Size in bytes of `dst`.
 MTY_EXPORT void
 MTY_HttpEncodeUrl(const char *src, char *dst, size_t size);
 
+/// @brief Split a URL or relative reference into its RFC 3986 components.
+/// @details The scheme, user information, host, and port are validated strictly. IPv6
+///   and IPvFuture literals are accepted in brackets. The path, query, and fragment
+///   may contain any visible character including UTF-8, since they are commonly sent
+///   unescaped, but never whitespace or control characters.\n\n
+///   Nothing is allocated or copied.
+/// @param url URL to split, which does not need to be null terminated.
+/// @param len Length of `url`.
+/// @param parts Output components pointing into `url`.
+/// @returns Returns true if `url` is valid, otherwise false.
+MTY_EXPORT bool
+MTY_HttpSplitUrl(const char *url, size_t len, MTY_HttpUrl *parts);
+
+/// @brief Percent-encode a buffer.
+/// @details Runs of characters that do not need encoding are found with SIMD where
+///   available.
+/// @param src Data to encode.
+/// @param len Size in bytes of `src`.
+/// @param encoding Set of characters that are left as is.
+/// @param dst Null terminated output.
+/// @param size Size in bytes of `dst`.
+/// @returns Returns true on success, or false if `dst` is too small, in which case it
+///   holds as much of the output as fits without splitting an escape.
+MTY_EXPORT bool
+MTY_HttpPercentEncode(const void *src, size_t len, MTY_UrlEncoding encoding, char *dst,
+	size_t size);
+
+/// @brief Decode a percent-encoded string.
+/// @details Malformed escapes such as `%G0` are copied as is.
+/// @param src String to decode, which does not need to be null terminated.
+/// @param len Length of `src`.
+/// @param form Decode `+` to space as in `application/x-www-form-urlencoded`.
+/// @param dst Null terminated output.
+/// @param size Size in bytes of `dst`.
+/// @returns Returns true on success, or false if `dst` is too small, in which case it
+///   holds as much of the output as fits.
+MTY_EXPORT bool
+MTY_HttpPercentDecode(const char *src, size_t len, bool form, char *dst, size_t size);
+
+/// @brief Iterate over the `name=value` pairs of a query string.
+/// @details Pairs are separated by `&` and empty pairs are skipped. A pair without
+///   `=` has an empty value. Names and values are not decoded, see
+///   MTY_HttpPercentDecode.
+/// @param query Query string without the leading `?`, as in MTY_HttpUrl.
+/// @param len Length of `query`.
+/// @param iter Iterator that should be set to 0 for the first call.
+/// @param param The next pair, with `name` and `value` pointing into `query`.
+/// @returns Returns true if a pair was found, false if there are no more pairs.
+MTY_EXPORT bool
+MTY_HttpGetNextQueryParam(const char *query, size_t len, size_t *iter, MTY_HttpField *param);
+
+/// @brief Find and decode the value of a query string parameter.
+/// @param query Query string without the leading `?`.
+/// @param len Length of `query`.
+/// @param name Decoded name of the parameter. The first matching pair is used.
+/// @param value Decoded, null terminated value.
+/// @param size Size in bytes of `value`.
+/// @returns Returns true on success, or false if the parameter was not found or `value`
+///   is too small.
+MTY_EXPORT bool
+MTY_HttpGetQueryParam(const char *query, size_t len, const char *name, char *value,
+	size_t size);
+
+/// @brief Append a form encoded `name=value` pair to a query string.
+/// @param query Null terminated query string, which may be empty. A `&` is added before
+///   the pair if it is not.
+/// @param size Size in bytes of `query`.
+/// @param name Parameter name.
+/// @param value Parameter value, or NULL to append `name` alone.
+/// @returns Returns true on success, or false if `query` is too small, in which case it
+///   is left unchanged.
+MTY_EXPORT bool
+MTY_HttpAppendQueryParam(char *query, size_t size, const char *name, const char *value);
+
+/// @brief Parse an HTTP/1.x request or response header without allocating.
+/// @details The start line and fields are returned as slices of `buf`. Validation
+///   follows RFC 9112 strictly: lines must end with CRLF, field names must be tokens
+///   immediately followed by a colon, obsolete line folding is rejected, and control
+///   characters are not allowed anywhere but HTAB in values.\n\n
+///   Responses are parsed more leniently as the RFC permits: the SP and reason phrase
+///   following the status code may be omitted, and a folded field value spans the
+///   fold, whose CR and LF bytes should be treated as SP.\n\n
+///   Delimiters are scanned with SSE4.2, AVX2, or NEON when the CPU supports them.
+///   Input may be parsed incrementally as it arrives by calling this function again
+///   with the entire buffer received so far.
+/// @param buf Buffer containing the header, which need not be null terminated.
+/// @param size Size in bytes of `buf`.
+/// @param prevSize Size of `buf` when this function last returned MTY_HTTP_PARSE_PARTIAL
+///   for the same message, or 0. If nonzero, only the new bytes are scanned and a full
+///   parse is skipped until the header is complete.
+/// @param response Set true to parse a status line, false to parse a request line.
+/// @param fields Array to receive the header fields.
+/// @param maxFields Number of elements in `fields`.
+/// @param msg Set to the parsed header. Its contents are only meaningful when
+///   MTY_HTTP_PARSE_OK is returned, and remain valid as long as `buf` and `fields`.
+/// @returns An MTY_HttpParseResult. Bytes following the header in `buf` are not
+///   examined, i.e. the start of a body.
+MTY_EXPORT MTY_HttpParseResult
+MTY_HttpParseMessage(const void *buf, size_t size, size_t prevSize, bool response,
+	MTY_HttpField *fields, uint32_t maxFields, MTY_HttpMessage *msg);
+
+/// @brief Find a header field by name.
+/// @param msg An MTY_HttpMessage parsed by MTY_HttpParseMessage.
+/// @param name Case insensitive field name, i.e. `Content-Length`.
+/// @returns The first field with a matching name, or NULL if there is none.
+MTY_EXPORT const MTY_HttpField *
+MTY_HttpGetField(const MTY_HttpMessage *msg, const char *name);
+
 /// @brief Set a global proxy used by all HTTP and WebSocket requests.
 /// @param proxy The proxy URL including the port, i.e. `http://example.com:1337`.
 MTY_EXPORT void
@@ -2861,6 +4056,41 @@ MTY_EXPORT MTY_WebSocket *
 MTY_WebSocketAccept(MTY_WebSocket *ctx, const char * const *origins, uint32_t numOrigins,
 	bool secureOrigin, uint32_t timeout);
 
+/// @brief Create a WebSocket server that accepts connections in the background.
+/// @details Unlike MTY_WebSocketAccept, upgrade handshakes are performed concurrently
+///   on the server's threads, so a slow or idle client can not delay other clients.
+///   Each client must complete its upgrade request within the handshake timeout.\n\n
+///   Each shard has its own listening socket bound to the same port, and incoming
+///   connections are balanced between them by the system. WebSocket servers
+///   currently do not support secure connections.
+/// @param desc The server description.
+/// @returns On failure, NULL is returned. Call MTY_GetLog for details.\n\n
+///   The returned MTY_WebSocketServer must be destroyed with MTY_WebSocketServerDestroy.
+MTY_EXPORT MTY_WebSocketServer *
+MTY_WebSocketServerCreate(const MTY_WebSocketServerDesc *desc);
+
+/// @brief Destroy a WebSocket server.
+/// @details Connections still in the handshake or waiting to be accepted are closed.
+///   Connections already returned by MTY_WebSocketServerAccept are unaffected.
+/// @param server Passed by reference and set to NULL after being destroyed.
+MTY_EXPORT void
+MTY_WebSocketServerDestroy(MTY_WebSocketServer **server);
+
+/// @brief Get the next connection that has completed its handshake.
+/// @details Only a single thread may call this function at a time.
+/// @param ctx An MTY_WebSocketServer.
+/// @param timeout Time to wait in milliseconds for a connection before returning NULL.
+/// @returns On timeout, NULL is returned.\n\n
+///   The returned MTY_WebSocket must be destroyed with MTY_WebSocketDestroy.
+MTY_EXPORT MTY_WebSocket *
+MTY_WebSocketServerAccept(MTY_WebSocketServer *ctx, uint32_t timeout);
+
+/// @brief Get WebSocket server statistics.
+/// @param ctx An MTY_WebSocketServer.
+/// @param stats Set to the totals since the server was created.
+MTY_EXPORT void
+MTY_WebSocketServerGetStats(MTY_WebSocketServer *ctx, MTY_WebSocketServerStats *stats);
+
 /// @brief Connect to a WebSocket endpoint.
 /// @param host Hostname.
 /// @param port Port. May be set to 0 to use either port 80 or 443 depending on
@@ -3045,6 +4275,31 @@ MTY_QueueGetInputBuffer(MTY_Queue *ctx);
 MTY_EXPORT void
 MTY_QueuePush(MTY_Queue *ctx, size_t size);
 
+/// @brief Lock and retrieve up to `count` consecutive input buffers from the queue.
+/// @details This is the batched form of MTY_QueueGetInputBuffer. If any buffers
+///   are returned, the queue remains locked for input until MTY_QueuePushMany is
+///   called.
+/// @param ctx An MTY_Queue.
+/// @param buffers Array of at least `count` elements that receives the input buffers
+///   in queue order.
+/// @param count The maximum number of input buffers to retrieve.
+/// @returns The number of input buffers set in `buffers`, which may be less than
+///   `count`. If there are no input buffers available, 0 is returned.
+MTY_EXPORT uint32_t
+MTY_QueueGetInputBuffers(MTY_Queue *ctx, void **buffers, uint32_t count);
+
+/// @brief Push and unlock input buffers acquired via MTY_QueueGetInputBuffers.
+/// @details The consumer is signaled once for the entire batch.
+/// @param ctx An MTY_Queue.
+/// @param sizes Array of `count` elements containing the amount of data filled in
+///   each buffer, in the same order as returned by MTY_QueueGetInputBuffers. If a
+///   size is 0, that buffer and all buffers after it are released without being
+///   pushed.
+/// @param count The number of buffers to push. This may be less than the number
+///   acquired, in which case the remaining buffers are released.
+MTY_EXPORT void
+MTY_QueuePushMany(MTY_Queue *ctx, const size_t *sizes, uint32_t count);
+
 /// @brief Lock and retrieve the next available output buffer from the queue.
 /// @param ctx An MTY_Queue.
 /// @param timeout Time to wait in milliseconds for an output buffer to become available.
@@ -3072,6 +4327,29 @@ MTY_QueueGetLastOutputBuffer(MTY_Queue *ctx, int32_t timeout, void **buffer,
 MTY_EXPORT void
 MTY_QueuePop(MTY_Queue *ctx);
 
+/// @brief Lock and retrieve up to `count` consecutive output buffers from the queue.
+/// @details This is the batched form of MTY_QueueGetOutputBuffer. The buffers must
+///   be released with MTY_QueuePopMany.
+/// @param ctx An MTY_Queue.
+/// @param timeout Time to wait in milliseconds for at least one output buffer to
+///   become available. A negative value will not timeout.
+/// @param buffers Array of at least `count` elements that receives the output buffers
+///   in queue order.
+/// @param sizes Array of at least `count` elements that receives the size of the data
+///   available in each buffer. May be NULL.
+/// @param count The maximum number of output buffers to retrieve.
+/// @returns The number of output buffers set in `buffers`, or 0 on timeout.
+MTY_EXPORT uint32_t
+MTY_QueueGetOutputBuffers(MTY_Queue *ctx, int32_t timeout, void **buffers,
+	size_t *sizes, uint32_t count);
+
+/// @brief Unlock the `count` oldest acquired output buffers and mark them as empty.
+/// @param ctx An MTY_Queue.
+/// @param count Number of buffers to release, which must not exceed the number
+///   returned by MTY_QueueGetOutputBuffers.
+MTY_EXPORT void
+MTY_QueuePopMany(MTY_Queue *ctx, uint32_t count);
+
 /// @brief Push a pointer allocated by the caller to a queue.
 /// @param ctx An MTY_Queue.
 /// @param opaque Value you allocated and are responsible for freeing.
@@ -3155,6 +4433,58 @@ typedef enum {
 	MTY_OS_MAKE_32 = INT32_MAX,
 } MTY_OS;
 
+/// @brief CPU instruction set extensions.
+typedef enum {
+	MTY_CPU_SSE42   = 0x00000001, ///< x86 SSE4.2.
+	MTY_CPU_AVX2    = 0x00000002, ///< x86 AVX and AVX2 with OS support for YMM state.
+	MTY_CPU_AVX512  = 0x00000004, ///< x86 AVX-512 F, DQ, BW, and VL with OS support for ZMM state.
+	MTY_CPU_PCLMUL  = 0x00000008, ///< x86 PCLMULQDQ carry-less multiplication.
+	MTY_CPU_AES     = 0x00000010, ///< x86 AES-NI.
+	MTY_CPU_SHA     = 0x00000020, ///< x86 SHA extensions.
+	MTY_CPU_NEON    = 0x00010000, ///< ARM NEON (Advanced SIMD).
+	MTY_CPU_CRC32   = 0x00020000, ///< ARM CRC32 instructions.
+	MTY_CPU_ARM_AES = 0x00040000, ///< ARMv8 AES instructions.
+	MTY_CPU_PMULL   = 0x00080000, ///< ARMv8 64-bit polynomial multiplication.
+	MTY_CPU_ARM_SHA = 0x00100000, ///< ARMv8 SHA1 and SHA256 instructions.
+	MTY_CPU_MAKE_32 = INT32_MAX,
+} MTY_CPUFeature;
+
+/// @brief CPU features, caches, and topology.
+typedef struct {
+	uint32_t features;  ///< Bitwise OR of MTY_CPUFeature flags.
+	uint32_t cacheLine; ///< Size in bytes of an L1 data cache line.
+	uint32_t l1Size;    ///< Size in bytes of a single core's L1 data cache, or 0 if unknown.
+	uint32_t l2Size;    ///< Size in bytes of the L2 cache, or 0 if unknown.
+	uint32_t l3Size;    ///< Size in bytes of the L3 cache, or 0 if unknown.
+	uint32_t cores;     ///< Number of physical cores.
+	uint32_t threads;   ///< Number of logical processors, including SMT siblings.
+} MTY_CPUInfo;
+
+/// @brief A logical processor and its place in the CPU topology.
+typedef struct {
+	uint32_t id;   ///< Logical processor number used by the operating system.
+	uint32_t core; ///< Index of the physical core, shared with its SMT siblings.
+	uint32_t smt;  ///< Position among the core's SMT siblings, 0 for the first.
+	uint32_t llc;  ///< Index of the group of cores sharing a last level cache.
+	uint32_t node; ///< NUMA node number used by the operating system.
+} MTY_LogicalCPU;
+
+/// @brief Cores, caches, and NUMA nodes of the system.
+typedef struct {
+	MTY_LogicalCPU *cpus; ///< Online logical processors in ascending `id` order.
+	uint32_t numCPUs;     ///< Number of elements in `cpus`.
+	uint32_t numCores;    ///< Number of physical cores, `core` ranges from 0 to `numCores - 1`.
+	uint32_t numLLCs;     ///< Number of last level cache groups, `llc` ranges from 0 to
+	                      ///<   `numLLCs - 1`.
+	uint32_t numNodes;    ///< Number of distinct NUMA nodes.
+} MTY_CPUTopology;
+
+/// @brief An implementation candidate for MTY_SelectCPUImpl.
+typedef struct {
+	uint32_t features; ///< Bitwise OR of the MTY_CPUFeature flags the implementation requires.
+	void *func;        ///< Pointer to the implementation.
+} MTY_CPUImpl;
+
 /// @brief Dynamically load a shared object.
 /// @details This function wraps `dlopen` on Unix and `LoadLibrary` on Windows.
 /// @param path Path to the shared object. This can simply be the name of shared
@@ -3220,6 +4550,46 @@ MTY_GetPlatformNoWeb(void);
 MTY_EXPORT const char *
 MTY_GetPlatformString(uint32_t platform);
 
+/// @brief Get the instruction set extensions supported by the CPU.
+/// @details Detection happens once and the result is cached. Features may be masked
+///   out by setting the `MTY_CPU_DISABLE` environment variable to a comma separated
+///   list of `sse42`, `avx2`, `avx512`, `pclmul`, `aes`, `sha`, `neon`, `crc32`,
+///   `arm-aes`, `pmull`, `arm-sha`, or `all` before the first call. This allows each
+///   code path selected via MTY_SelectCPUImpl to be tested on a single machine.
+/// @returns Bitwise OR of MTY_CPUFeature flags.
+MTY_EXPORT uint32_t
+MTY_GetCPUFeatures(void);
+
+/// @brief Get CPU features along with cache and core topology information.
+/// @param info Set to the CPU's properties. The `features` member honors
+///   `MTY_CPU_DISABLE` in the same way as MTY_GetCPUFeatures.
+MTY_EXPORT void
+MTY_GetCPUInfo(MTY_CPUInfo *info);
+
+/// @brief Get the layout of logical processors across cores, caches, and NUMA nodes.
+/// @details On Linux the topology is read from `sysfs`. Other platforms report each
+///   logical processor as its own core on a single cache group and node.
+/// @returns This function can not return NULL.\n\n
+///   The returned MTY_CPUTopology must be destroyed with MTY_FreeCPUTopology.
+MTY_EXPORT MTY_CPUTopology *
+MTY_GetCPUTopology(void);
+
+/// @brief Free an MTY_CPUTopology.
+/// @param topology Passed by reference and set to NULL after being destroyed.
+MTY_EXPORT void
+MTY_FreeCPUTopology(MTY_CPUTopology **topology);
+
+/// @brief Select the best implementation of a function supported by the CPU.
+/// @details This is intended to be called once during initialization with the
+///   result stored in a function pointer.
+/// @param impls Array of candidates ordered from most to least preferred. The final
+///   candidate should usually require no features so it can act as a fallback.
+/// @param count Number of elements in `impls`.
+/// @returns The `func` member of the first candidate whose required features are all
+///   supported, or NULL if there is none.
+MTY_EXPORT void *
+MTY_SelectCPUImpl(const MTY_CPUImpl *impls, uint32_t count);
+
 /// @brief Execute the default protocol handler for a given URI.
 /// @param uri The resource to be handled, i.e. `C:\tmp.txt` or `http://google.com`.
 /// @param token An optional `HANDLE` to a user's security token. This can be used
@@ -3248,14 +4618,31 @@ MTY_EXPORT bool
 MTY_RestartProcess(char * const *argv);
 
 /// @brief Set a function to be called just before abnormal termination.
-/// @details This will attempt to hook `SIGKILL`, `SIGTERM`, and any Windows
-///   specific exception behavior that may trigger a crash.
+/// @details This will attempt to hook `SIGINT`, `SIGTERM`, `SIGSEGV`, `SIGBUS`,
+///   `SIGILL`, `SIGFPE`, `SIGABRT`, and any Windows specific exception behavior that
+///   may trigger a crash.\n\n
+///   On Unix platforms `func` is called from the signal handler, so it should
+///   only make async-signal-safe calls. The handler runs on an alternate stack,
+///   which is set for the calling thread and threads created via MTY_ThreadCreate.
 /// @param func Function called on termination.
 /// @param opaque Passed to `func` when it is called.
 //- #support Windows macOS Android Linux
 MTY_EXPORT void
 MTY_SetCrashFunc(MTY_CrashFunc func, void *opaque);
 
+/// @brief Write a crash report to a file descriptor if the process crashes.
+/// @details The report includes the signal, fault address, registers, a backtrace,
+///   the thread name, and the most recent messages passed to MTY_Log. It is written
+///   from the signal handler without allocating, before the MTY_CrashFunc is called.
+///   Forced termination via `SIGINT` or `SIGTERM` does not produce a report.\n\n
+///   This function installs the same handlers as MTY_SetCrashFunc.
+/// @param fd An open file descriptor, i.e. `STDERR_FILENO` or a file opened ahead of
+///   time. Set to -1 to disable the report.
+/// @param numLogs The number of recent log messages to include, up to 64.
+//- #support macOS Android Linux
+MTY_EXPORT void
+MTY_SetCrashReport(int32_t fd, uint32_t numLogs);
+
 /// @brief Open a console window that prints stdout and stderr.
 /// @param title The title of the console window.
 //- #support Windows
@@ -3425,6 +4812,13 @@ MTY_IsTLSApplicationData(const void *buf, size_t size);
 
 typedef int64_t MTY_Time;
 
+typedef struct MTY_TimerWheel MTY_TimerWheel;
+
+/// @brief Function called when a timer fires.
+/// @param id The `id` returned by MTY_TimerWheelSet.
+/// @param opaque Pointer set via MTY_TimerWheelSet.
+typedef void (*MTY_TimerFunc)(uint32_t id, void *opaque);
+
 /// @brief Get a high precision time stamp.
 /// @details This value has at least microsecond precision.
 MTY_EXPORT MTY_Time
@@ -3457,6 +4851,72 @@ MTY_SetTimerResolution(uint32_t res);
 MTY_EXPORT void
 MTY_RevertTimerResolution(uint32_t res);
 
+/// @brief Create an MTY_TimerWheel for scheduling large numbers of timers.
+/// @details The timer wheel is hierarchical, so arming and cancelling a timer
+///   are constant time operations regardless of how many timers are active. Timers
+///   are fired either by calling MTY_TimerWheelPoll from your own loop, or from a
+///   dedicated dispatch thread if `thread` is true.
+/// @param resolution The length of a single tick in milliseconds. Timers are rounded
+///   up to this resolution. Specifying 0 uses a resolution of 1 millisecond.
+/// @param thread If true, an internal thread fires timers as they expire and your
+///   MTY_TimerFunc is called from that thread.
+/// @returns The returned MTY_TimerWheel must be destroyed with MTY_TimerWheelDestroy.
+MTY_EXPORT MTY_TimerWheel *
+MTY_TimerWheelCreate(uint32_t resolution, bool thread);
+
+/// @brief Destroy an MTY_TimerWheel.
+/// @details Any timers still armed are discarded without being fired.
+/// @param wheel Passed by reference and set to NULL after being destroyed.
+MTY_EXPORT void
+MTY_TimerWheelDestroy(MTY_TimerWheel **wheel);
+
+/// @brief Arm a one-shot or periodic timer.
+/// @param ctx An MTY_TimerWheel.
+/// @param timeout Time in milliseconds until the timer first fires.
+/// @param interval If greater than 0, the timer is periodic and fires again every
+///   `interval` milliseconds until cancelled. Missed intervals are skipped rather
+///   than fired in a burst.
+/// @param func Function called when the timer fires.
+/// @param opaque Passed to `func` when it is called.
+/// @returns On success, the `id` of the timer which must be greater than 0. If the
+///   maximum number of timers has been reached, 0 is returned. Call MTY_GetLog for
+///   details.
+MTY_EXPORT uint32_t
+MTY_TimerWheelSet(MTY_TimerWheel *ctx, uint32_t timeout, uint32_t interval,
+	MTY_TimerFunc func, void *opaque);
+
+/// @brief Cancel a timer.
+/// @details It is safe to call this function from within an MTY_TimerFunc, including
+///   on the timer that is currently firing.
+/// @param ctx An MTY_TimerWheel.
+/// @param id An `id` returned by MTY_TimerWheelSet.
+/// @returns Returns true if the timer was found and cancelled, otherwise false if it
+///   has already fired or been cancelled.
+MTY_EXPORT bool
+MTY_TimerWheelCancel(MTY_TimerWheel *ctx, uint32_t id);
+
+/// @brief Advance the timer wheel to the current time and fire all expired timers.
+/// @details Each MTY_TimerFunc is called from the thread calling this function.
+/// @param ctx An MTY_TimerWheel.
+/// @returns The number of timers that fired.
+MTY_EXPORT uint32_t
+MTY_TimerWheelPoll(MTY_TimerWheel *ctx);
+
+/// @brief Get the time until the next timer may expire.
+/// @details This value is suitable as the timeout for MTY_AppSetTimeout,
+///   MTY_WaitableWait, or any other wait in your own event loop, after which
+///   MTY_TimerWheelPoll should be called. The value may be earlier than the actual
+///   next expiration, but never later.
+/// @param ctx An MTY_TimerWheel.
+/// @returns The number of milliseconds to wait, or -1 if no timers are armed.
+MTY_EXPORT int32_t
+MTY_TimerWheelGetTimeout(MTY_TimerWheel *ctx);
+
+/// @brief Get the number of timers currently armed.
+/// @param ctx An MTY_TimerWheel.
+MTY_EXPORT uint32_t
+MTY_TimerWheelGetLength(MTY_TimerWheel *ctx);
+
 
 //- #module Version
 //- #mbrief libmatoya version information.
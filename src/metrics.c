@@ -0,0 +1,471 @@
+// Copyright (c) Christopher D. Dickson <cdd@matoya.group>
+//
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+#include "matoya.h"
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "tlocal.h"
+
+#define METRICS_SHARDS 16
+#define METRICS_LINE   64
+
+// Shard layout for histograms, followed by one counter per bucket
+#define METRICS_COUNT 0
+#define METRICS_SUM   1
+#define METRICS_FIRST 2
+
+struct MTY_Metric {
+	char *name;
+	char *help;
+	MTY_MetricType type;
+
+	double *buckets;
+	uint32_t nbuckets;
+
+	// Counters and histograms are split into cache line sized shards, one per group of threads
+	uint8_t *shards;
+	size_t stride;
+
+	// Gauges have a single value since they can be set
+	MTY_Atomic64 gauge;
+};
+
+static MTY_Atomic32 METRICS_GLOCK;
+static MTY_Atomic32 METRICS_NEXT_SHARD;
+static TLOCAL uint32_t METRICS_SHARD;
+
+static MTY_Hash *METRICS_HASH;
+static MTY_Metric **METRICS;
+static uint32_t METRICS_LEN;
+
+static const double METRICS_DEFAULT_BUCKETS[] = {
+	0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1.0, 2.5, 5.0, 10.0,
+};
+
+
+// Helpers
+
+static uint32_t metrics_shard(void)
+{
+	// Threads are assigned a shard round robin on first use
+	if (METRICS_SHARD == 0)
+		METRICS_SHARD = (uint32_t) MTY_Atomic32Add(&METRICS_NEXT_SHARD, 1) % METRICS_SHARDS + 1;
+
+	return METRICS_SHARD - 1;
+}
+
+static MTY_Atomic64 *metrics_slot(MTY_Metric *ctx, uint32_t shard, uint32_t index)
+{
+	return (MTY_Atomic64 *) (ctx->shards + shard * ctx->stride) + index;
+}
+
+static int64_t metrics_sum_slot(MTY_Metric *ctx, uint32_t index)
+{
+	int64_t total = 0;
+
+	for (uint32_t x = 0; x < METRICS_SHARDS; x++)
+		total += MTY_Atomic64Get(metrics_slot(ctx, x, index));
+
+	return total;
+}
+
+static double metrics_to_double(int64_t bits)
+{
+	double d = 0;
+	memcpy(&d, &bits, sizeof(double));
+
+	return d;
+}
+
+static int64_t metrics_from_double(double d)
+{
+	int64_t bits = 0;
+	memcpy(&bits, &d, sizeof(double));
+
+	return bits;
+}
+
+static bool metrics_valid_name(const char *name)
+{
+	const char *brace = strchr(name, '{');
+	size_t len = brace ? (size_t) (brace - name) : strlen(name);
+
+	if (len == 0 || (name[0] >= '0' && name[0] <= '9'))
+		return false;
+
+	for (size_t x = 0; x < len; x++) {
+		char c = name[x];
+
+		if (!(c >= 'a' && c <= 'z') && !(c >= 'A' && c <= 'Z') && !(c >= '0' && c <= '9') &&
+			c != '_' && c != ':')
+			return false;
+	}
+
+	// Labels must be a closed brace at the end of the name
+	return !brace || (strlen(brace) > 2 && name[strlen(name) - 1] == '}');
+}
+
+static MTY_Metric *metrics_create(const char *name, const char *help, MTY_MetricType type,
+	const double *buckets, uint32_t numBuckets)
+{
+	MTY_Metric *ctx = MTY_Alloc(1, sizeof(MTY_Metric));
+	ctx->name = MTY_Strdup(name);
+	ctx->help = MTY_Strdup(help ? help : "");
+	ctx->type = type;
+
+	if (type == MTY_METRIC_HISTOGRAM) {
+		if (!buckets || numBuckets == 0) {
+			buckets = METRICS_DEFAULT_BUCKETS;
+			numBuckets = sizeof(METRICS_DEFAULT_BUCKETS) / sizeof(double);
+		}
+
+		ctx->nbuckets = numBuckets;
+		ctx->buckets = MTY_Dup(buckets, numBuckets * sizeof(double));
+	}
+
+	if (type != MTY_METRIC_GAUGE) {
+		size_t slots = type == MTY_METRIC_HISTOGRAM ? METRICS_FIRST + ctx->nbuckets : 1;
+
+		ctx->stride = (slots * sizeof(int64_t) + METRICS_LINE - 1) & ~((size_t) METRICS_LINE - 1);
+		ctx->shards = MTY_AllocAligned(ctx->stride * METRICS_SHARDS, METRICS_LINE);
+	}
+
+	return ctx;
+}
+
+
+// Registry
+
+MTY_Metric *MTY_GetMetric(const char *name, const char *help, MTY_MetricType type,
+	const double *buckets, uint32_t numBuckets)
+{
+	if (!metrics_valid_name(name)) {
+		MTY_Log("Metric name '%s' is invalid", name);
+		return NULL;
+	}
+
+	for (uint32_t x = 1; type == MTY_METRIC_HISTOGRAM && x < numBuckets; x++) {
+		if (buckets[x] <= buckets[x - 1]) {
+			MTY_Log("Metric '%s' buckets must be increasing", name);
+			return NULL;
+		}
+	}
+
+	MTY_GlobalLock(&METRICS_GLOCK);
+
+	if (!METRICS_HASH)
+		METRICS_HASH = MTY_HashCreate(0);
+
+	MTY_Metric *ctx = MTY_HashGet(METRICS_HASH, name);
+
+	if (!ctx) {
+		ctx = metrics_create(name, help, type, buckets, numBuckets);
+
+		METRICS = MTY_Realloc(METRICS, METRICS_LEN + 1, sizeof(MTY_Metric *));
+		METRICS[METRICS_LEN++] = ctx;
+
+		MTY_HashSet(METRICS_HASH, name, ctx);
+
+	} else if (ctx->type != type) {
+		MTY_Log("Metric '%s' already exists with a different type", name);
+		ctx = NULL;
+	}
+
+	MTY_GlobalUnlock(&METRICS_GLOCK);
+
+	return ctx;
+}
+
+
+// Updates
+
+void MTY_MetricAdd(MTY_Metric *ctx, int64_t value)
+{
+	if (!ctx)
+		return;
+
+	switch (ctx->type) {
+		case MTY_METRIC_COUNTER:
+			MTY_Atomic64Add(metrics_slot(ctx, metrics_shard(), 0), value);
+			break;
+		case MTY_METRIC_GAUGE:
+			MTY_Atomic64Add(&ctx->gauge, value);
+			break;
+		case MTY_METRIC_HISTOGRAM:
+			MTY_MetricObserve(ctx, (double) value);
+			break;
+	}
+}
+
+void MTY_MetricSet(MTY_Metric *ctx, int64_t value)
+{
+	if (!ctx || ctx->type != MTY_METRIC_GAUGE)
+		return;
+
+	MTY_Atomic64Set(&ctx->gauge, value);
+}
+
+void MTY_MetricObserve(MTY_Metric *ctx, double value)
+{
+	if (!ctx || ctx->type != MTY_METRIC_HISTOGRAM)
+		return;
+
+	uint32_t shard = metrics_shard();
+
+	// Buckets are stored non-cumulative, values past the last bound only count toward +Inf
+	uint32_t b = 0;
+	while (b < ctx->nbuckets && value > ctx->buckets[b])
+		b++;
+
+	if (b < ctx->nbuckets)
+		MTY_Atomic64Add(metrics_slot(ctx, shard, METRICS_FIRST + b), 1);
+
+	// The sum is only shared with the other threads on this shard, so the CAS rarely retries
+	MTY_Atomic64 *sum = metrics_slot(ctx, shard, METRICS_SUM);
+
+	for (int64_t old = MTY_Atomic64Get(sum);; old = MTY_Atomic64Get(sum))
+		if (MTY_Atomic64CAS(sum, old, metrics_from_double(metrics_to_double(old) + value)))
+			break;
+
+	MTY_Atomic64Add(metrics_slot(ctx, shard, METRICS_COUNT), 1);
+}
+
+
+// Snapshot
+
+static void metrics_snapshot(MTY_Metric *ctx, MTY_MetricValue *v)
+{
+	v->name = MTY_Strdup(ctx->name);
+	v->help = MTY_Strdup(ctx->help);
+	v->type = ctx->type;
+
+	switch (ctx->type) {
+		case MTY_METRIC_COUNTER:
+			v->value = metrics_sum_slot(ctx, 0);
+			break;
+		case MTY_METRIC_GAUGE:
+			v->value = MTY_Atomic64Get(&ctx->gauge);
+			break;
+		case MTY_METRIC_HISTOGRAM: {
+			v->numBuckets = ctx->nbuckets;
+			v->buckets = MTY_Dup(ctx->buckets, ctx->nbuckets * sizeof(double));
+			v->bucketCounts = MTY_Alloc(ctx->nbuckets, sizeof(uint64_t));
+
+			// Cumulative counts are computed here rather than on every update
+			uint64_t total = 0;
+
+			for (uint32_t x = 0; x < ctx->nbuckets; x++) {
+				total += metrics_sum_slot(ctx, METRICS_FIRST + x);
+				v->bucketCounts[x] = total;
+			}
+
+			double sum = 0;
+			for (uint32_t x = 0; x < METRICS_SHARDS; x++)
+				sum += metrics_to_double(MTY_Atomic64Get(metrics_slot(ctx, x, METRICS_SUM)));
+
+			v->sum = sum;
+
+			// Shards are read one at a time, keep the total consistent with the buckets
+			v->count = metrics_sum_slot(ctx, METRICS_COUNT);
+
+			if (v->numBuckets > 0 && v->count < v->bucketCounts[v->numBuckets - 1])
+				v->count = v->bucketCounts[v->numBuckets - 1];
+			break;
+		}
+	}
+}
+
+MTY_MetricList *MTY_GetMetricList(void)
+{
+	MTY_MetricList *list = MTY_Alloc(1, sizeof(MTY_MetricList));
+
+	MTY_GlobalLock(&METRICS_GLOCK);
+
+	list->len = METRICS_LEN;
+	list->metrics = MTY_Alloc(METRICS_LEN, sizeof(MTY_MetricValue));
+
+	for (uint32_t x = 0; x < METRICS_LEN; x++)
+		metrics_snapshot(METRICS[x], &list->metrics[x]);
+
+	MTY_GlobalUnlock(&METRICS_GLOCK);
+
+	return list;
+}
+
+void MTY_FreeMetricList(MTY_MetricList **list)
+{
+	if (!list || !*list)
+		return;
+
+	MTY_MetricList *ctx = *list;
+
+	for (uint32_t x = 0; x < ctx->len; x++) {
+		MTY_MetricValue *v = &ctx->metrics[x];
+
+		MTY_Free(v->name);
+		MTY_Free(v->help);
+		MTY_Free(v->buckets);
+		MTY_Free(v->bucketCounts);
+	}
+
+	MTY_Free(ctx->metrics);
+
+	MTY_Free(ctx);
+	*list = NULL;
+}
+
+
+// OpenMetrics
+
+struct metrics_text {
+	char *buf;
+	size_t len;
+	size_t size;
+};
+
+static void metrics_printf(struct metrics_text *t, const char *fmt, ...) MTY_FMT(2, 3);
+
+static void metrics_printf(struct metrics_text *t, const char *fmt, ...)
+{
+	va_list args;
+	va_start(args, fmt);
+	char *str = MTY_VsprintfD(fmt, args);
+	va_end(args);
+
+	size_t len = strlen(str);
+
+	if (t->len + len + 1 > t->size) {
+		t->size = (t->len + len + 1) * 2;
+		t->buf = MTY_Realloc(t->buf, t->size, 1);
+	}
+
+	memcpy(t->buf + t->len, str, len + 1);
+	t->len += len;
+
+	MTY_Free(str);
+}
+
+static void metrics_family(const char *name, char *family, size_t size, const char **labels)
+{
+	snprintf(family, size, "%s", name);
+
+	char *brace = strchr(family, '{');
+
+	if (brace) {
+		brace[0] = '\0';
+		*labels = name + (brace - family) + 1;
+
+	} else {
+		*labels = NULL;
+	}
+}
+
+static void metrics_sample(struct metrics_text *t, const char *family, const char *suffix,
+	const char *labels, size_t labels_len, const char *extra, const char *value)
+{
+	if (labels_len > 0 || extra) {
+		metrics_printf(t, "%s%s{%.*s%s%s} %s\n", family, suffix, (int) labels_len, labels ? labels : "",
+			labels_len > 0 && extra ? "," : "", extra ? extra : "", value);
+
+	} else {
+		metrics_printf(t, "%s%s %s\n", family, suffix, value);
+	}
+}
+
+static void metrics_write(struct metrics_text *t, const MTY_MetricValue *v)
+{
+	char family[MTY_URL_MAX];
+	const char *labels = NULL;
+	metrics_family(v->name, family, MTY_URL_MAX, &labels);
+
+	// Labels point into the name, excluding the closing brace
+	size_t labels_len = labels ? strlen(labels) - 1 : 0;
+
+	char value[64];
+
+	switch (v->type) {
+		case MTY_METRIC_COUNTER:
+			snprintf(value, 64, "%" PRId64, v->value);
+			metrics_sample(t, family, "_total", labels, labels_len, NULL, value);
+			break;
+		case MTY_METRIC_GAUGE:
+			snprintf(value, 64, "%" PRId64, v->value);
+			metrics_sample(t, family, "", labels, labels_len, NULL, value);
+			break;
+		case MTY_METRIC_HISTOGRAM: {
+			char le[64];
+
+			for (uint32_t x = 0; x < v->numBuckets; x++) {
+				snprintf(le, 64, "le=\"%.15g\"", v->buckets[x]);
+				snprintf(value, 64, "%" PRIu64, v->bucketCounts[x]);
+				metrics_sample(t, family, "_bucket", labels, labels_len, le, value);
+			}
+
+			snprintf(value, 64, "%" PRIu64, v->count);
+			metrics_sample(t, family, "_bucket", labels, labels_len, "le=\"+Inf\"", value);
+			metrics_sample(t, family, "_count", labels, labels_len, NULL, value);
+
+			snprintf(value, 64, "%.15g", v->sum);
+			metrics_sample(t, family, "_sum", labels, labels_len, NULL, value);
+			break;
+		}
+	}
+}
+
+static const char *metrics_type_str(MTY_MetricType type)
+{
+	switch (type) {
+		case MTY_METRIC_COUNTER:   return "counter";
+		case MTY_METRIC_GAUGE:     return "gauge";
+		case MTY_METRIC_HISTOGRAM: return "histogram";
+	}
+
+	return "unknown";
+}
+
+char *MTY_SerializeMetrics(void)
+{
+	struct metrics_text t = {0};
+
+	MTY_MetricList *list = MTY_GetMetricList();
+	bool *done = MTY_Alloc(list->len + 1, sizeof(bool));
+
+	// Samples are grouped by family, each family is described once
+	for (uint32_t x = 0; x < list->len; x++) {
+		if (done[x])
+			continue;
+
+		char family[MTY_URL_MAX];
+		const char *labels = NULL;
+		metrics_family(list->metrics[x].name, family, MTY_URL_MAX, &labels);
+
+		metrics_printf(&t, "# TYPE %s %s\n", family, metrics_type_str(list->metrics[x].type));
+
+		if (list->metrics[x].help[0])
+			metrics_printf(&t, "# HELP %s %s\n", family, list->metrics[x].help);
+
+		for (uint32_t y = x; y < list->len; y++) {
+			char other[MTY_URL_MAX];
+			metrics_family(list->metrics[y].name, other, MTY_URL_MAX, &labels);
+
+			if (!done[y] && !strcmp(family, other) && list->metrics[y].type == list->metrics[x].type) {
+				metrics_write(&t, &list->metrics[y]);
+				done[y] = true;
+			}
+		}
+	}
+
+	metrics_printf(&t, "# EOF\n");
+
+	MTY_Free(done);
+	MTY_FreeMetricList(&list);
+
+	return t.buf;
+}
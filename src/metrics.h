@@ -0,0 +1,46 @@
+// Copyright (c) Christopher D. Dickson <cdd@matoya.group>
+//
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+#pragma once
+
+#include "matoya.h"
+
+// Internal instrumentation, compiled out unless MTY_METRICS is defined. The metric is
+// looked up once per call site and cached, arguments are not evaluated when disabled.
+
+#if defined(MTY_METRICS)
+
+#define METRIC_COUNT(name, help, v) do { \
+	static MTY_Metric *m_; \
+	if (!m_) m_ = MTY_GetMetric(name, help, MTY_METRIC_COUNTER, NULL, 0); \
+	MTY_MetricAdd(m_, v); \
+} while (0)
+
+#define METRIC_GAUGE(name, help, v) do { \
+	static MTY_Metric *m_; \
+	if (!m_) m_ = MTY_GetMetric(name, help, MTY_METRIC_GAUGE, NULL, 0); \
+	MTY_MetricSet(m_, v); \
+} while (0)
+
+#define METRIC_OBSERVE(name, help, v, ...) do { \
+	static const double b_[] = {__VA_ARGS__}; \
+	static MTY_Metric *m_; \
+	if (!m_) m_ = MTY_GetMetric(name, help, MTY_METRIC_HISTOGRAM, b_, sizeof(b_) / sizeof(double)); \
+	MTY_MetricObserve(m_, v); \
+} while (0)
+
+// For names built at runtime, looked up on every call so only suited to infrequent events
+#define METRIC_COUNT_NAMED(name, help, v) \
+	MTY_MetricAdd(MTY_GetMetric(name, help, MTY_METRIC_COUNTER, NULL, 0), v)
+
+#else
+
+#define METRIC_COUNT(name, help, v)        do {} while (0)
+#define METRIC_GAUGE(name, help, v)        do {} while (0)
+#define METRIC_OBSERVE(name, help, v, ...) do {} while (0)
+#define METRIC_COUNT_NAMED(name, help, v)  do {} while (0)
+
+#endif
@@ -7,6 +7,9 @@
 #include "matoya.h"
 #include "gzip.h"
 
+// The byte-wise fallback compiles to the same loads on x86/ARM without the
+// misaligned pointer casts that UBSan reports on fuzzed input
+#define MINIZ_USE_UNALIGNED_LOADS_AND_STORES 0
 #include "miniz.h"
 
 #define GZIP_CHUNK_SIZE (256 * 1024)
@@ -85,9 +88,8 @@ void *mty_gzip_decompress(const void *in, size_t inSize, size_t *outSize)
 		MTY_Log("'inflate' failed with error %d", e);
 
 		MTY_Free(out);
+		out = NULL;
 		*outSize = 0;
-
-		return NULL;
 	}
 
 	e = inflateEnd(&strm);
@@ -13,6 +13,7 @@
 #include <ctype.h>
 
 #include "tlocal.h"
+#include "gzip.h"
 
 
 // Standard header generators
@@ -73,137 +74,665 @@ static char *http_response(const char *code, const char *msg, const char *fields
 }
 
 
-// Header parsing, construction
+// SIMD scanning
 
-struct http_pair {
-	char *key;
-	char *val;
-};
+// Each scanner returns the first byte at or after `p` that is not allowed in the
+// given element, or `end` if every byte is allowed. Field values (and reason
+// phrases) allow HTAB, SP, VCHAR and obs-text, request targets allow only VCHAR
 
-struct http_header {
-	char *first_line;
-	struct http_pair *pairs;
-	uint32_t npairs;
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+	#define HTTP_X86
+
+	#if defined(_MSC_VER)
+		#include <intrin.h>
+		#define HTTP_TARGET(t)
+	#else
+		#include <immintrin.h>
+		#define HTTP_TARGET(t) __attribute__((target(t)))
+	#endif
+
+#elif defined(__aarch64__) || defined(_M_ARM64)
+	#define HTTP_NEON
+	#include <arm_neon.h>
+#endif
+
+typedef const char *(*HTTP_SCAN_FUNC)(const char *p, const char *end);
+
+struct http_scan {
+	HTTP_SCAN_FUNC value;
+	HTTP_SCAN_FUNC target;
 };
 
-struct http_header *mty_http_parse_header(const char *header)
+static const char *http_scan_value_c(const char *p, const char *end)
 {
-	struct http_header *h = MTY_Alloc(1, sizeof(struct http_header));
-	char *dup = MTY_Strdup(header);
+	for (; p < end; p++) {
+		uint8_t c = *p;
 
-	// HTTP header lines are delimited by "\r\n"
-	char *ptr = NULL;
-	char *line = MTY_Strtok(dup, "\r\n", &ptr);
+		if ((c < 0x20 && c != '\t') || c == 0x7F)
+			break;
+	}
 
-	for (bool first = true; line; first = false) {
+	return p;
+}
 
-		// First line is special and is stored seperately
-		if (first) {
-			h->first_line = MTY_Strdup(line);
+static const char *http_scan_target_c(const char *p, const char *end)
+{
+	for (; p < end; p++) {
+		uint8_t c = *p;
 
-		// All lines following the first are in the "key: val" format
-		} else {
-			char *delim = strpbrk(line, ": ");
+		if (c <= 0x20 || c >= 0x7F)
+			break;
+	}
 
-			if (delim) {
-				h->pairs = MTY_Realloc(h->pairs, h->npairs + 1, sizeof(struct http_pair));
+	return p;
+}
 
-				// Place a null character to separate the line
-				char save = delim[0];
-				delim[0] = '\0';
+static const struct http_scan HTTP_SCAN_C = {
+	http_scan_value_c,
+	http_scan_target_c,
+};
 
-				// Save the key and remove the null character
-				h->pairs[h->npairs].key = MTY_Strdup(line);
-				delim[0] = save;
+#if defined(HTTP_X86)
 
-				// Advance the val past whitespace or the : character
-				while (*delim && (*delim == ':' || *delim == ' '))
-					delim++;
+static uint32_t http_ctz(uint32_t v)
+{
+	#if defined(_MSC_VER)
+		unsigned long i = 0;
+		_BitScanForward(&i, v);
+
+		return i;
+	#else
+		return __builtin_ctz(v);
+	#endif
+}
 
-				// Store the val and increment npairs
-				h->pairs[h->npairs].val = MTY_Strdup(delim);
-				h->npairs++;
-			}
-		}
+HTTP_TARGET("sse4.2")
+static const char *http_scan_sse42(const char *p, const char *end, const char *ranges, int32_t len)
+{
+	__m128i r = _mm_loadu_si128((const __m128i *) ranges);
+
+	for (; end - p >= 16; p += 16) {
+		__m128i v = _mm_loadu_si128((const __m128i *) p);
 
-		line = MTY_Strtok(NULL, "\r\n", &ptr);
+		int32_t i = _mm_cmpestri(r, len, v, 16, _SIDD_UBYTE_OPS | _SIDD_CMP_RANGES |
+			_SIDD_LEAST_SIGNIFICANT);
+
+		if (i < 16)
+			return p + i;
 	}
 
-	MTY_Free(dup);
+	return p;
+}
 
-	return h;
+static const char *http_scan_value_sse42(const char *p, const char *end)
+{
+	// Disallowed byte ranges: CTL except HTAB, DEL
+	static const char ranges[16] = "\x00\x08\x0A\x1F\x7F\x7F";
+
+	p = http_scan_sse42(p, end, ranges, 6);
+
+	return http_scan_value_c(p, end);
 }
 
-void mty_http_header_destroy(struct http_header **header)
+static const char *http_scan_target_sse42(const char *p, const char *end)
 {
-	if (!header || !*header)
-		return;
+	// Disallowed byte ranges: CTL and SP, DEL and obs-text
+	static const char ranges[16] = "\x00\x20\x7F\xFF";
 
-	struct http_header *h = *header;
+	p = http_scan_sse42(p, end, ranges, 4);
 
-	for (uint32_t x = 0; x < h->npairs; x++) {
-		MTY_Free(h->pairs[x].key);
-		MTY_Free(h->pairs[x].val);
+	return http_scan_target_c(p, end);
+}
+
+HTTP_TARGET("avx2")
+static const char *http_scan_value_avx2(const char *p, const char *end)
+{
+	const __m256i sp = _mm256_set1_epi8(0x20);
+	const __m256i tab = _mm256_set1_epi8('\t');
+	const __m256i del = _mm256_set1_epi8(0x7F);
+	const __m256i zero = _mm256_setzero_si256();
+
+	for (; end - p >= 32; p += 32) {
+		__m256i v = _mm256_loadu_si256((const __m256i *) p);
+
+		// Signed compares, obs-text is negative so it must be excluded from "below SP"
+		__m256i low = _mm256_cmpgt_epi8(sp, v);
+		__m256i ok = _mm256_or_si256(_mm256_cmpgt_epi8(zero, v), _mm256_cmpeq_epi8(v, tab));
+		__m256i bad = _mm256_or_si256(_mm256_andnot_si256(ok, low), _mm256_cmpeq_epi8(v, del));
+
+		uint32_t mask = (uint32_t) _mm256_movemask_epi8(bad);
+
+		if (mask)
+			return p + http_ctz(mask);
 	}
 
-	MTY_Free(h->first_line);
-	MTY_Free(h->pairs);
+	return http_scan_value_c(p, end);
+}
 
-	MTY_Free(h);
-	*header = NULL;
+HTTP_TARGET("avx2")
+static const char *http_scan_target_avx2(const char *p, const char *end)
+{
+	const __m256i sp = _mm256_set1_epi8(0x20);
+	const __m256i del = _mm256_set1_epi8(0x7F);
+
+	for (; end - p >= 32; p += 32) {
+		__m256i v = _mm256_loadu_si256((const __m256i *) p);
+
+		// Signed compare, anything above SP and not DEL is VCHAR
+		uint32_t mask = ~(uint32_t) _mm256_movemask_epi8(_mm256_cmpgt_epi8(v, sp)) |
+			(uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, del));
+
+		if (mask)
+			return p + http_ctz(mask);
+	}
+
+	return http_scan_target_c(p, end);
 }
 
-bool mty_http_get_status_code(struct http_header *h, uint16_t *status_code)
+static const struct http_scan HTTP_SCAN_SSE42 = {
+	http_scan_value_sse42,
+	http_scan_target_sse42,
+};
+
+static const struct http_scan HTTP_SCAN_AVX2 = {
+	http_scan_value_avx2,
+	http_scan_target_avx2,
+};
+
+#elif defined(HTTP_NEON)
+
+static const char *http_scan_neon_first(const char *p, uint8x16_t bad)
 {
-	bool r = true;
-	char *dup = MTY_Strdup(h->first_line);
+	// Narrow each byte of the mask to 4 bits so it fits in a 64-bit lane
+	uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(bad), 4)), 0);
 
-	char *ptr = NULL;
-	char *tok = MTY_Strtok(dup, " ", &ptr);
-	if (!tok) {
-		r = false;
-		goto except;
+	if (!mask)
+		return NULL;
+
+	#if defined(_MSC_VER)
+		unsigned long i = 0;
+		_BitScanForward64(&i, mask);
+
+		return p + (i >> 2);
+	#else
+		return p + (__builtin_ctzll(mask) >> 2);
+	#endif
+}
+
+static const char *http_scan_value_neon(const char *p, const char *end)
+{
+	const uint8x16_t sp = vdupq_n_u8(0x20);
+	const uint8x16_t tab = vdupq_n_u8('\t');
+	const uint8x16_t del = vdupq_n_u8(0x7F);
+
+	for (; end - p >= 16; p += 16) {
+		uint8x16_t v = vld1q_u8((const uint8_t *) p);
+		uint8x16_t bad = vorrq_u8(vbicq_u8(vcltq_u8(v, sp), vceqq_u8(v, tab)), vceqq_u8(v, del));
+
+		const char *r = http_scan_neon_first(p, bad);
+
+		if (r)
+			return r;
 	}
 
-	tok = MTY_Strtok(NULL, " ", &ptr);
-	if (!tok) {
-		r = false;
-		goto except;
+	return http_scan_value_c(p, end);
+}
+
+static const char *http_scan_target_neon(const char *p, const char *end)
+{
+	const uint8x16_t sp = vdupq_n_u8(0x20);
+	const uint8x16_t del = vdupq_n_u8(0x7F);
+
+	for (; end - p >= 16; p += 16) {
+		uint8x16_t v = vld1q_u8((const uint8_t *) p);
+		uint8x16_t bad = vorrq_u8(vcleq_u8(v, sp), vcgeq_u8(v, del));
+
+		const char *r = http_scan_neon_first(p, bad);
+
+		if (r)
+			return r;
 	}
 
-	*status_code = (uint16_t) strtol(tok, NULL, 10);
+	return http_scan_target_c(p, end);
+}
 
-	except:
+static const struct http_scan HTTP_SCAN_NEON = {
+	http_scan_value_neon,
+	http_scan_target_neon,
+};
 
-	MTY_Free(dup);
+#endif
 
-	return r;
+static const struct http_scan *http_get_scan(void)
+{
+	static const MTY_CPUImpl impls[] = {
+		#if defined(HTTP_X86)
+			{MTY_CPU_AVX2,  (void *) &HTTP_SCAN_AVX2},
+			{MTY_CPU_SSE42, (void *) &HTTP_SCAN_SSE42},
+		#elif defined(HTTP_NEON)
+			{MTY_CPU_NEON,  (void *) &HTTP_SCAN_NEON},
+		#endif
+		{0, (void *) &HTTP_SCAN_C},
+	};
+
+	return MTY_SelectCPUImpl(impls, sizeof(impls) / sizeof(impls[0]));
 }
 
-bool mty_http_get_header_int(struct http_header *h, const char *key, int32_t *val)
+
+// RFC 9112 message parsing
+
+static const uint8_t HTTP_TCHAR[256] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 1, 0, 1, 1, 1, 1, 1, 0, 0, 1, 1, 0, 1, 1, 0, //  !"#$%&'()*+,-./
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, // 0123456789:;<=>?
+	0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, // @ABCDEFGHIJKLMNO
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 1, 1, // PQRSTUVWXYZ[\]^_
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, // `abcdefghijklmno
+	1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 1, 0, 1, 0, // pqrstuvwxyz{|}~
+};
+
+static MTY_HttpParseResult http_expect(const char **p, const char *end, const char *lit, size_t len)
+{
+	size_t avail = end - *p;
+	size_t n = avail < len ? avail : len;
+
+	if (memcmp(*p, lit, n))
+		return MTY_HTTP_PARSE_INVALID;
+
+	if (n < len)
+		return MTY_HTTP_PARSE_PARTIAL;
+
+	*p += len;
+
+	return MTY_HTTP_PARSE_OK;
+}
+
+static MTY_HttpParseResult http_parse_token(const char **p, const char *end, char delim,
+	const char **tok, size_t *len)
+{
+	const char *s = *p;
+
+	while (s < end && HTTP_TCHAR[(uint8_t) *s])
+		s++;
+
+	if (s == end)
+		return MTY_HTTP_PARSE_PARTIAL;
+
+	if (s == *p || *s != delim)
+		return MTY_HTTP_PARSE_INVALID;
+
+	*tok = *p;
+	*len = s - *p;
+	*p = s + 1;
+
+	return MTY_HTTP_PARSE_OK;
+}
+
+static MTY_HttpParseResult http_parse_version(const char **p, const char *end, uint8_t *minor)
+{
+	// Only HTTP/1.x is handled by this parser
+	MTY_HttpParseResult r = http_expect(p, end, "HTTP/1.", 7);
+	if (r != MTY_HTTP_PARSE_OK)
+		return r;
+
+	if (*p == end)
+		return MTY_HTTP_PARSE_PARTIAL;
+
+	if (**p < '0' || **p > '9')
+		return MTY_HTTP_PARSE_INVALID;
+
+	*minor = (uint8_t) (**p - '0');
+	(*p)++;
+
+	return MTY_HTTP_PARSE_OK;
+}
+
+static MTY_HttpParseResult http_parse_request_line(const struct http_scan *scan, const char **p,
+	const char *end, MTY_HttpMessage *msg)
+{
+	MTY_HttpParseResult r = http_parse_token(p, end, ' ', &msg->method, &msg->methodLen);
+	if (r != MTY_HTTP_PARSE_OK)
+		return r;
+
+	const char *s = scan->target(*p, end);
+
+	if (s == end)
+		return MTY_HTTP_PARSE_PARTIAL;
+
+	if (s == *p || *s != ' ')
+		return MTY_HTTP_PARSE_INVALID;
+
+	msg->target = *p;
+	msg->targetLen = s - *p;
+	*p = s + 1;
+
+	r = http_parse_version(p, end, &msg->minorVersion);
+	if (r != MTY_HTTP_PARSE_OK)
+		return r;
+
+	return http_expect(p, end, "\r\n", 2);
+}
+
+static MTY_HttpParseResult http_parse_status_line(const struct http_scan *scan, const char **p,
+	const char *end, MTY_HttpMessage *msg)
+{
+	MTY_HttpParseResult r = http_parse_version(p, end, &msg->minorVersion);
+	if (r != MTY_HTTP_PARSE_OK)
+		return r;
+
+	r = http_expect(p, end, " ", 1);
+	if (r != MTY_HTTP_PARSE_OK)
+		return r;
+
+	for (uint8_t x = 0; x < 3; x++, (*p)++) {
+		if (*p == end)
+			return MTY_HTTP_PARSE_PARTIAL;
+
+		if (**p < '0' || **p > '9')
+			return MTY_HTTP_PARSE_INVALID;
+
+		msg->status = (uint16_t) (msg->status * 10 + (**p - '0'));
+	}
+
+	if (*p == end)
+		return MTY_HTTP_PARSE_PARTIAL;
+
+	// Some servers omit the SP along with an empty reason phrase
+	if (**p == '\r')
+		return http_expect(p, end, "\r\n", 2);
+
+	r = http_expect(p, end, " ", 1);
+	if (r != MTY_HTTP_PARSE_OK)
+		return r;
+
+	const char *s = scan->value(*p, end);
+
+	if (s == end)
+		return MTY_HTTP_PARSE_PARTIAL;
+
+	msg->reason = *p;
+	msg->reasonLen = s - *p;
+	*p = s;
+
+	return http_expect(p, end, "\r\n", 2);
+}
+
+static MTY_HttpParseResult http_parse_field(const struct http_scan *scan, const char **p,
+	const char *end, MTY_HttpField *field)
+{
+	// No whitespace is allowed between the name and the colon
+	MTY_HttpParseResult r = http_parse_token(p, end, ':', &field->name, &field->nameLen);
+	if (r != MTY_HTTP_PARSE_OK)
+		return r;
+
+	while (*p < end && (**p == ' ' || **p == '\t'))
+		(*p)++;
+
+	const char *s = scan->value(*p, end);
+
+	if (s == end)
+		return MTY_HTTP_PARSE_PARTIAL;
+
+	field->value = *p;
+	field->valueLen = s - *p;
+
+	// Trailing whitespace is not part of the value
+	while (field->valueLen > 0 && (field->value[field->valueLen - 1] == ' ' ||
+		field->value[field->valueLen - 1] == '\t'))
+		field->valueLen--;
+
+	*p = s;
+
+	return http_expect(p, end, "\r\n", 2);
+}
+
+static MTY_HttpParseResult http_parse_fold(const struct http_scan *scan, const char **p,
+	const char *end, MTY_HttpField *field)
 {
-	for (uint32_t x = 0; x < h->npairs; x++) {
-		if (!MTY_Strcasecmp(key, h->pairs[x].key)) {
-			char *endptr = h->pairs[x].val;
-			*val = strtol(h->pairs[x].val, &endptr, 10);
+	while (*p < end && (**p == ' ' || **p == '\t'))
+		(*p)++;
+
+	const char *s = scan->value(*p, end);
+
+	if (s == end)
+		return MTY_HTTP_PARSE_PARTIAL;
+
+	const char *v = s;
+
+	while (v > *p && (v[-1] == ' ' || v[-1] == '\t'))
+		v--;
+
+	// The value is extended across the fold, which recipients replace with SP
+	if (v > *p)
+		field->valueLen = v - field->value;
+
+	*p = s;
 
-			return endptr != h->pairs[x].val;
+	return http_expect(p, end, "\r\n", 2);
+}
+
+static MTY_HttpParseResult http_parse_message(const struct http_scan *scan, const char *buf,
+	size_t size, bool response, MTY_HttpField *fields, uint32_t maxFields, MTY_HttpMessage *msg)
+{
+	const char *p = buf;
+	const char *end = buf + size;
+
+	MTY_HttpParseResult r = response ? http_parse_status_line(scan, &p, end, msg) :
+		http_parse_request_line(scan, &p, end, msg);
+
+	while (r == MTY_HTTP_PARSE_OK) {
+		if (p == end)
+			return MTY_HTTP_PARSE_PARTIAL;
+
+		// The empty line terminates the header
+		if (*p == '\r') {
+			r = http_expect(&p, end, "\r\n", 2);
+
+			if (r == MTY_HTTP_PARSE_OK)
+				msg->size = p - buf;
+
+			break;
 		}
+
+		// Obsolete line folding is only tolerated in responses (RFC 9112 5.2),
+		// whitespace after the start line is always rejected
+		if (*p == ' ' || *p == '\t') {
+			if (!response || msg->numFields == 0)
+				return MTY_HTTP_PARSE_INVALID;
+
+			r = http_parse_fold(scan, &p, end, &fields[msg->numFields - 1]);
+			continue;
+		}
+
+		if (msg->numFields == maxFields)
+			return MTY_HTTP_PARSE_TOO_LARGE;
+
+		r = http_parse_field(scan, &p, end, &fields[msg->numFields]);
+
+		if (r == MTY_HTTP_PARSE_OK)
+			msg->numFields++;
 	}
 
-	return false;
+	return r;
 }
 
-bool mty_http_get_header_str(struct http_header *h, const char *key, const char **val)
+static MTY_HttpParseResult http_scan_complete(const struct http_scan *scan, const char *buf,
+	size_t size, size_t prevSize)
 {
-	for (uint32_t x = 0; x < h->npairs; x++) {
-		if (!MTY_Strcasecmp(key, h->pairs[x].key)) {
-			*val = h->pairs[x].val;
-			return true;
+	const char *end = buf + size;
+	const char *p = buf + (prevSize > 3 ? prevSize - 3 : 0);
+
+	// Every byte outside of a line ending must be allowed in a field value, so the
+	// value scanner stops on both line endings and invalid control characters
+	for (; p < end; p++) {
+		p = scan->value(p, end);
+
+		if (p == end)
+			break;
+
+		if (*p == '\r') {
+			if (p + 1 < end && p[1] != '\n')
+				return MTY_HTTP_PARSE_INVALID;
+
+		} else if (*p == '\n') {
+			if (p == buf || p[-1] != '\r')
+				return MTY_HTTP_PARSE_INVALID;
+
+			if (p - buf >= 3 && p[-2] == '\n' && p[-3] == '\r')
+				return MTY_HTTP_PARSE_OK;
+
+		} else {
+			return MTY_HTTP_PARSE_INVALID;
 		}
 	}
 
-	return false;
+	return MTY_HTTP_PARSE_PARTIAL;
+}
+
+MTY_HttpParseResult MTY_HttpParseMessage(const void *buf, size_t size, size_t prevSize,
+	bool response, MTY_HttpField *fields, uint32_t maxFields, MTY_HttpMessage *msg)
+{
+	const struct http_scan *scan = http_get_scan();
+
+	memset(msg, 0, sizeof(MTY_HttpMessage));
+	msg->fields = fields;
+
+	// Only the new bytes need to be checked for the end of the header
+	if (prevSize > 0 && prevSize <= size) {
+		MTY_HttpParseResult r = http_scan_complete(scan, buf, size, prevSize);
+		if (r != MTY_HTTP_PARSE_OK)
+			return r;
+	}
+
+	return http_parse_message(scan, buf, size, response, fields, maxFields, msg);
+}
+
+static bool http_name_equal(const char *a, size_t len, const char *b)
+{
+	for (size_t x = 0; x < len; x++, b++) {
+		if (!*b || tolower((uint8_t) a[x]) != tolower((uint8_t) *b))
+			return false;
+	}
+
+	return *b == '\0';
+}
+
+const MTY_HttpField *MTY_HttpGetField(const MTY_HttpMessage *msg, const char *name)
+{
+	for (uint32_t x = 0; x < msg->numFields; x++) {
+		const MTY_HttpField *f = &msg->fields[x];
+
+		if (http_name_equal(f->name, f->nameLen, name))
+			return f;
+	}
+
+	return NULL;
+}
+
+
+// Header parsing, construction
+
+struct http_header {
+	char *buf;
+	MTY_HttpMessage msg;
+	MTY_HttpField *fields;
+};
+
+static struct http_header *http_parse_header_buf(char *buf, size_t size)
+{
+	struct http_header *h = MTY_Alloc(1, sizeof(struct http_header));
+	h->buf = buf;
+
+	// The whole header is already buffered, every field ends with a line so the
+	// line count bounds the number of fields
+	uint32_t max_fields = 1;
+
+	for (size_t x = 0; x < size; x++)
+		if (buf[x] == '\n')
+			max_fields++;
+
+	h->fields = MTY_Alloc(max_fields, sizeof(MTY_HttpField));
+
+	// Status lines begin with the version, request lines with a method token
+	bool response = size >= 5 && !memcmp(buf, "HTTP/", 5);
+
+	MTY_HttpParseResult r = MTY_HttpParseMessage(buf, size, 0, response, h->fields,
+		max_fields, &h->msg);
+
+	if (r != MTY_HTTP_PARSE_OK) {
+		MTY_Log("'MTY_HttpParseMessage' failed with result %d", r);
+		mty_http_header_destroy(&h);
+		return NULL;
+	}
+
+	// The delimiter following each name and value can be replaced in place
+	// so they can be handed out as null terminated strings
+	for (uint32_t x = 0; x < h->msg.numFields; x++) {
+		MTY_HttpField *f = &h->fields[x];
+
+		// Folded response values still contain the line breaks
+		for (size_t y = f->value - buf; y < (size_t) (f->value - buf) + f->valueLen; y++)
+			if (buf[y] == '\r' || buf[y] == '\n')
+				buf[y] = ' ';
+
+		buf[f->name - buf + f->nameLen] = '\0';
+		buf[f->value - buf + f->valueLen] = '\0';
+	}
+
+	return h;
+}
+
+struct http_header *mty_http_parse_header(const char *header)
+{
+	return http_parse_header_buf(MTY_Strdup(header), strlen(header));
+}
+
+void mty_http_header_destroy(struct http_header **header)
+{
+	if (!header || !*header)
+		return;
+
+	struct http_header *h = *header;
+
+	MTY_Free(h->fields);
+	MTY_Free(h->buf);
+
+	MTY_Free(h);
+	*header = NULL;
+}
+
+bool mty_http_get_status_code(struct http_header *h, uint16_t *status_code)
+{
+	if (!h->msg.status)
+		return false;
+
+	*status_code = h->msg.status;
+
+	return true;
+}
+
+bool mty_http_get_header_int(struct http_header *h, const char *key, int32_t *val)
+{
+	const MTY_HttpField *f = MTY_HttpGetField(&h->msg, key);
+	if (!f)
+		return false;
+
+	char *endptr = NULL;
+	*val = strtol(f->value, &endptr, 10);
+
+	return endptr != f->value;
+}
+
+bool mty_http_get_header_str(struct http_header *h, const char *key, const char **val)
+{
+	const MTY_HttpField *f = MTY_HttpGetField(&h->msg, key);
+	if (!f)
+		return false;
+
+	*val = f->value;
+
+	return true;
 }
 
 void mty_http_set_header_int(char **header, const char *name, int32_t val)
@@ -287,10 +816,116 @@ struct http_header *mty_http_read_header(struct net *net, uint32_t timeout)
 	if (!header)
 		return NULL;
 
-	struct http_header *h = mty_http_parse_header(header);
-	MTY_Free(header);
+	return http_parse_header_buf(header, strlen(header));
+}
 
-	return h;
+static bool http_read_chunk_len(struct net *net, uint32_t timeout, size_t *len)
+{
+	*len = 0;
+	char len_buf[64] = {0};
+
+	for (uint32_t x = 0; x < 64 - 1; x++) {
+		if (!mty_net_read(net, len_buf + x, 1, timeout))
+			break;
+
+		if (x > 0 && len_buf[x - 1] == '\r' && len_buf[x] == '\n') {
+			len_buf[x - 1] = '\0';
+			*len = strtoul(len_buf, NULL, 16);
+
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static bool http_read_chunked(struct net *net, void **res, size_t *size, uint32_t timeout)
+{
+	size_t chunk_len = 0;
+
+	do {
+		// Read the chunk size one byte at a time
+		if (!http_read_chunk_len(net, timeout, &chunk_len))
+			return false;
+
+		// Overflow protection
+		if (chunk_len > MTY_RES_MAX || *size + chunk_len > MTY_RES_MAX)
+			return false;
+
+		// Make room for chunk and "\r\n" after chunk
+		*res = MTY_Realloc(*res, *size + chunk_len + 2, 1);
+
+		// Read chunk into buffer with extra 2 bytes for "\r\n"
+		if (!mty_net_read(net, (uint8_t *) *res + *size, chunk_len + 2, timeout))
+			return false;
+
+		*size += chunk_len;
+
+		// Keep null character at the end of the buffer for protection
+		memset((uint8_t *) *res + *size, 0, 1);
+
+	} while (chunk_len > 0);
+
+	return true;
+}
+
+bool mty_http_read_body(struct net *net, struct http_header *hdr, uint32_t timeout, void **res, size_t *size)
+{
+	*res = NULL;
+	*size = 0;
+
+	bool r = true;
+
+	// Either fixed content length or chunked
+	int32_t len = 0;
+	const char *val = NULL;
+
+	if (mty_http_get_header_int(hdr, "Content-Length", &len) && len > 0) {
+
+		// Overflow protection
+		if (len > MTY_RES_MAX) {
+			r = false;
+			goto except;
+		}
+
+		*size = len;
+		*res = MTY_Alloc(*size + 1, 1);
+
+		r = mty_net_read(net, *res, *size, timeout);
+		if (!r)
+			goto except;
+
+	} else if (mty_http_get_header_str(hdr, "Transfer-Encoding", &val) && !MTY_Strcasecmp(val, "chunked")) {
+		r = http_read_chunked(net, res, size, timeout);
+		if (!r)
+			goto except;
+	}
+
+	// Check for content-encoding header and attempt to uncompress
+	if (*res && *size > 0) {
+		if (mty_http_get_header_str(hdr, "Content-Encoding", &val) && !MTY_Strcasecmp(val, "gzip")) {
+			size_t zlen = 0;
+			void *z = mty_gzip_decompress(*res, *size, &zlen);
+			if (!z) {
+				r = false;
+				goto except;
+			}
+
+			MTY_Free(*res);
+			*res = z;
+			*size = zlen;
+		}
+	}
+
+	except:
+
+	if (!r) {
+		MTY_Free(*res);
+		*size = 0;
+		*res = NULL;
+	}
+
+	return r;
 }
 
 bool mty_http_write_response_header(struct net *net, const char *code, const char *reason, const char *headers)
@@ -319,74 +954,61 @@ bool mty_http_write_request_header(struct net *net, const char *method, const ch
 static bool mty_http_parse_url(const char *url, bool *secure, char *host, size_t hostSize,
 	uint16_t *port, char *path, size_t pathSize)
 {
-	bool r = true;
-	char *dup = MTY_Strdup(url);
-
 	*secure = false;
 	*port = 0;
 
-	// Scheme
-	char *tok = NULL;
-	char *ptr = NULL;
+	// Without a scheme the URL is taken as host:port/path
+	char *dup = strstr(url, "://") ? MTY_Strdup(url) : MTY_SprintfD("//%s", url);
 
-	if (strstr(dup, "http") || strstr(dup, "ws")) {
-		tok = MTY_Strtok(dup, ":", &ptr);
-		if (!tok) {
-			r = false;
-			goto except;
-		}
+	MTY_HttpUrl parts = {0};
+	bool r = MTY_HttpSplitUrl(dup, strlen(dup), &parts);
 
-		if (!MTY_Strcasecmp(tok, "https") || !MTY_Strcasecmp(tok, "wss")) {
-			*secure = true;
+	if (!r || !parts.host || parts.hostLen == 0) {
+		MTY_Log("Invalid URL '%s'", url);
+		r = false;
+		goto except;
+	}
 
-		} else if (!MTY_Strcasecmp(tok, "http") || !MTY_Strcasecmp(tok, "ws")) {
-			*secure = false;
+	// Scheme
+	if (parts.scheme) {
+		char scheme[8] = {0};
+		snprintf(scheme, sizeof(scheme), "%.*s", (int) parts.schemeLen, parts.scheme);
 
-		} else {
+		if (!MTY_Strcasecmp(scheme, "https") || !MTY_Strcasecmp(scheme, "wss")) {
+			*secure = true;
+
+		} else if (MTY_Strcasecmp(scheme, "http") && MTY_Strcasecmp(scheme, "ws")) {
+			MTY_Log("URL scheme '%s' is not supported", scheme);
 			r = false;
 			goto except;
 		}
-
-		// Leave tok at host:port/path
-		tok = MTY_Strtok(NULL, "/", &ptr);
-
-	// No scheme, assume host:port/path
-	} else {
-		*secure = false;
-		tok = MTY_Strtok(dup, "/", &ptr);
 	}
 
-	// Host
-	if (!tok) {
+	// Host, connections and name resolution are IPv4 only
+	if (parts.ipLiteral) {
+		MTY_Log("IP literal host '%.*s' is not supported", (int) parts.hostLen, parts.host);
 		r = false;
 		goto except;
 	}
 
-	// This buffer currently needs room for host:port, but strtok will null the ':' character
-	snprintf(host, hostSize, "%s", tok);
+	snprintf(host, hostSize, "%.*s", (int) parts.hostLen, parts.host);
 
-	// Try to find a port
-	char *ptr2 = NULL;
-	char *tok2 = MTY_Strtok(host, ":", &ptr2);
+	// Port
+	*port = parts.portLen > 0 ? parts.portNum : *secure ? HTTP_PORT_S : HTTP_PORT;
 
-	if (tok2)
-		tok2 = MTY_Strtok(NULL, ":", &ptr2);
+	// Path and query, the fragment is never sent
+	if (path) {
+		const char *slash = parts.pathLen > 0 && parts.path[0] == '/' ? "" : "/";
 
-	if (tok2) { // We have a port
-		*port = (uint16_t) atoi(tok2);
+		if (parts.query) {
+			snprintf(path, pathSize, "%s%.*s?%.*s", slash, (int) parts.pathLen, parts.path,
+				(int) parts.queryLen, parts.query);
 
-	} else {
-		*port = *secure ? HTTP_PORT_S : HTTP_PORT;
+		} else {
+			snprintf(path, pathSize, "%s%.*s", slash, (int) parts.pathLen, parts.path);
+		}
 	}
 
-	// Path
-	tok = MTY_Strtok(NULL, "", &ptr);
-	if (!tok)
-		tok = "";
-
-	if (path)
-		snprintf(path, pathSize, "/%s", tok);
-
 	except:
 
 	MTY_Free(dup);
@@ -404,32 +1026,7 @@ bool MTY_HttpParseUrl(const char *url, char *host, size_t hostSize, char *path,
 
 void MTY_HttpEncodeUrl(const char *src, char *dst, size_t size)
 {
-	memset(dst, 0, size);
-
-	char table[256];
-	for (int32_t c = 0; c < 256; c++)
-		table[c] = isalnum(c) || c == '*' || c == '-' || c == '.' || c == '_' ? (char) c : (c == ' ') ? '+' : '\0';
-
-	size_t src_len = strlen(src);
-
-	for (size_t x = 0; x < src_len && size > 0; x++) {
-		int32_t c = src[x];
-		size_t inc = 1;
-
-		if (table[c]) {
-			snprintf(dst, size, "%c", table[c]);
-
-		} else {
-			snprintf(dst, size, "%%%02X", c);
-			inc = 3;
-		}
-
-		if (inc > size)
-			break;
-
-		dst += inc;
-		size -= inc;
-	}
+	MTY_HttpPercentEncode(src, strlen(src), MTY_URL_ENCODE_FORM, dst, size);
 }
 
 
@@ -28,6 +28,7 @@ void mty_http_set_header_str(char **header, const char *name, const char *val);
 void mty_http_parse_headers(const char *all, HTTP_PARSE_FUNC func, void *opaque);
 
 struct http_header *mty_http_read_header(struct net *net, uint32_t timeout);
+bool mty_http_read_body(struct net *net, struct http_header *hdr, uint32_t timeout, void **res, size_t *size);
 bool mty_http_write_response_header(struct net *net, const char *code, const char *reason, const char *headers);
 bool mty_http_write_request_header(struct net *net, const char *method, const char *path, const char *headers);
 
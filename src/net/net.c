@@ -18,6 +18,10 @@ struct net {
 	char *host;
 	struct tcp *tcp;
 	struct secure *sec;
+
+	const uint8_t *mem;
+	size_t mem_size;
+	size_t mem_offset;
 };
 
 struct net *mty_net_connect(const char *host, uint16_t port, bool secure, uint32_t timeout)
@@ -74,30 +78,33 @@ struct net *mty_net_listen(const char *ip, uint16_t port)
 {
 	struct tcp *tcp = mty_tcp_listen(ip, port);
 
-	if (tcp) {
-		struct net *ctx = MTY_Alloc(1, sizeof(struct net));
-		ctx->host = MTY_Strdup(ip);
-		ctx->tcp = tcp;
-
-		return ctx;
-	}
-
-	return NULL;
+	return tcp ? mty_net_wrap(tcp, ip) : NULL;
 }
 
 struct net *mty_net_accept(struct net *ctx, uint32_t timeout)
 {
 	struct tcp *tcp = mty_tcp_accept(ctx->tcp, timeout);
 
-	if (tcp) {
-		struct net *child = MTY_Alloc(1, sizeof(struct net));
-		child->host = MTY_Strdup(ctx->host);
-		child->tcp = tcp;
+	return tcp ? mty_net_wrap(tcp, ctx->host) : NULL;
+}
 
-		return child;
-	}
+struct net *mty_net_wrap(struct tcp *tcp, const char *host)
+{
+	struct net *ctx = MTY_Alloc(1, sizeof(struct net));
+	ctx->host = MTY_Strdup(host);
+	ctx->tcp = tcp;
+
+	return ctx;
+}
+
+struct net *mty_net_wrap_buffer(const void *buf, size_t size)
+{
+	struct net *ctx = MTY_Alloc(1, sizeof(struct net));
+	ctx->host = MTY_Strdup("localhost");
+	ctx->mem = buf;
+	ctx->mem_size = size;
 
-	return NULL;
+	return ctx;
 }
 
 void mty_net_destroy(struct net **net)
@@ -118,17 +125,34 @@ void mty_net_destroy(struct net **net)
 
 MTY_Async mty_net_poll(struct net *ctx, uint32_t timeout)
 {
+	// An exhausted buffer behaves like a closed connection
+	if (ctx->mem)
+		return ctx->mem_offset < ctx->mem_size ? MTY_ASYNC_OK : MTY_ASYNC_ERROR;
+
 	return mty_tcp_poll(ctx->tcp, false, timeout);
 }
 
 bool mty_net_write(struct net *ctx, const void *buf, size_t size)
 {
+	if (ctx->mem)
+		return true;
+
 	return ctx->sec ? mty_secure_write(ctx->sec, ctx->tcp, buf, size) :
 		mty_tcp_write(ctx->tcp, buf, size);
 }
 
 bool mty_net_read(struct net *ctx, void *buf, size_t size, uint32_t timeout)
 {
+	if (ctx->mem) {
+		if (size > ctx->mem_size - ctx->mem_offset)
+			return false;
+
+		memcpy(buf, ctx->mem + ctx->mem_offset, size);
+		ctx->mem_offset += size;
+
+		return true;
+	}
+
 	return ctx->sec ? mty_secure_read(ctx->sec, ctx->tcp, buf, size, timeout) :
 		mty_tcp_read(ctx->tcp, buf, size, timeout);
 }
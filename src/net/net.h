@@ -9,10 +9,13 @@
 #include "matoya.h"
 
 struct net;
+struct tcp;
 
 struct net *mty_net_connect(const char *host, uint16_t port, bool secure, uint32_t timeout);
 struct net *mty_net_listen(const char *ip, uint16_t port);
 struct net *mty_net_accept(struct net *ctx, uint32_t timeout);
+struct net *mty_net_wrap(struct tcp *tcp, const char *host);
+struct net *mty_net_wrap_buffer(const void *buf, size_t size);
 void mty_net_destroy(struct net **net);
 
 MTY_Async mty_net_poll(struct net *ctx, uint32_t timeout);
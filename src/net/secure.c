@@ -10,6 +10,8 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "metrics.h"
+
 #define SECURE_PADDING (32 * 1024)
 
 struct secure {
@@ -102,8 +104,13 @@ struct secure *mty_secure_connect(struct tcp *tcp, const char *host, uint32_t ti
 
 	except:
 
-	if (!r)
+	if (r) {
+		METRIC_COUNT("mty_tls_handshakes{result=\"ok\"}", "Client TLS handshakes.", 1);
+
+	} else {
+		METRIC_COUNT("mty_tls_handshakes{result=\"error\"}", "Client TLS handshakes.", 1);
 		mty_secure_destroy(&ctx);
+	}
 
 	return ctx;
 }
@@ -4,17 +4,34 @@
 // If a copy of the MIT License was not distributed with this file,
 // You can obtain one at https://spdx.org/licenses/MIT.html.
 
+#if defined(__linux__)
+	#define _GNU_SOURCE // accept4
+#endif
+
 #include "tcp.h"
 
 #include <stdlib.h>
 #include <string.h>
 
 #include "net/sock.h"
+#include "metrics.h"
+
+#if defined(__linux__) && !defined(__ANDROID__)
+	#define TCP_FIBERS
+	#include "fiber.h"
+#endif
+
+#define TCP_WRITE_TIMEOUT 5000
 
 struct tcp {
 	SOCKET s;
 };
 
+struct tcp_set {
+	struct pollfd *fds;
+	uint32_t max;
+};
+
 
 // Connect, accept
 
@@ -117,7 +134,7 @@ struct tcp *mty_tcp_connect(const char *ip, uint16_t port, uint32_t timeout)
 	return ctx;
 }
 
-struct tcp *mty_tcp_listen(const char *ip, uint16_t port)
+static struct tcp *tcp_listen(const char *ip, uint16_t port, bool shared, uint32_t defer)
 {
 	struct sockaddr_in addr = {0};
 
@@ -127,6 +144,20 @@ struct tcp *mty_tcp_listen(const char *ip, uint16_t port)
 
 	bool r = true;
 
+	// Shared listeners on the same port have incoming connections balanced between them by the kernel
+	if (shared) {
+		#if defined(SO_REUSEPORT)
+			tcp_set_sockopt(ctx->s, SOL_SOCKET, SO_REUSEPORT, 1);
+		#endif
+	}
+
+	// Connections are not returned by accept until the client has sent data
+	if (defer > 0) {
+		#if defined(TCP_DEFER_ACCEPT)
+			tcp_set_sockopt(ctx->s, IPPROTO_TCP, TCP_DEFER_ACCEPT, defer);
+		#endif
+	}
+
 	if (bind(ctx->s, (struct sockaddr *) &addr, sizeof(struct sockaddr_in)) != 0) {
 		MTY_Log("'bind' failed with errno %d", SOCK_ERROR);
 		r = false;
@@ -147,6 +178,16 @@ struct tcp *mty_tcp_listen(const char *ip, uint16_t port)
 	return ctx;
 }
 
+struct tcp *mty_tcp_listen(const char *ip, uint16_t port)
+{
+	return tcp_listen(ip, port, false, 0);
+}
+
+struct tcp *mty_tcp_listen_shared(const char *ip, uint16_t port, uint32_t defer)
+{
+	return tcp_listen(ip, port, true, defer);
+}
+
 struct tcp *mty_tcp_accept(struct tcp *ctx, uint32_t timeout)
 {
 	if (mty_tcp_poll(ctx, false, timeout) != MTY_ASYNC_OK)
@@ -176,6 +217,36 @@ struct tcp *mty_tcp_accept(struct tcp *ctx, uint32_t timeout)
 	return child;
 }
 
+struct tcp *mty_tcp_accept_nowait(struct tcp *ctx)
+{
+	struct tcp *child = MTY_Alloc(1, sizeof(struct tcp));
+
+	#if defined(__linux__)
+		child->s = accept4(ctx->s, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+	#else
+		child->s = accept(ctx->s, NULL, NULL);
+	#endif
+
+	bool r = child->s != INVALID_SOCKET;
+	if (!r)
+		goto except;
+
+	#if !defined(__linux__)
+		r = sock_set_nonblocking(child->s);
+		if (!r)
+			goto except;
+	#endif
+
+	tcp_set_options(child->s);
+
+	except:
+
+	if (!r)
+		mty_tcp_destroy(&child);
+
+	return child;
+}
+
 void mty_tcp_destroy(struct tcp **tcp)
 {
 	if (!tcp || !*tcp)
@@ -197,6 +268,13 @@ void mty_tcp_destroy(struct tcp **tcp)
 
 MTY_Async mty_tcp_poll(struct tcp *ctx, bool out, uint32_t timeout)
 {
+	// On a fiber the wait is handed to the scheduler so other fibers may run
+	#if defined(TCP_FIBERS)
+		MTY_Async r = MTY_ASYNC_OK;
+		if (mty_fiber_poll(ctx->s, out, timeout, &r))
+			return r;
+	#endif
+
 	struct pollfd fd = {0};
 	fd.events = out ? POLLOUT : POLLIN;
 	fd.fd = ctx->s;
@@ -211,12 +289,19 @@ bool mty_tcp_write(struct tcp *ctx, const void *buf, size_t size)
 	for (size_t total = 0; total < size;) {
 		int32_t n = send(ctx->s, (const char *) buf + total, (int32_t) (size - total), 0);
 
-		if (n <= 0)
+		if (n <= 0) {
+			// The send buffer is full, wait for the peer to drain it
+			if (n < 0 && SOCK_ERROR == SOCK_WOULD_BLOCK && mty_tcp_poll(ctx, true, TCP_WRITE_TIMEOUT) == MTY_ASYNC_OK)
+				continue;
+
 			return false;
+		}
 
 		total += n;
 	}
 
+	METRIC_COUNT("mty_net_sent_bytes", "Bytes written to TCP sockets.", size);
+
 	return true;
 }
 
@@ -237,9 +322,77 @@ bool mty_tcp_read(struct tcp *ctx, void *buf, size_t size, uint32_t timeout)
 		}
 	}
 
+	METRIC_COUNT("mty_net_received_bytes", "Bytes read from TCP sockets.", size);
+
 	return true;
 }
 
+MTY_Async mty_tcp_read_nowait(struct tcp *ctx, void *buf, size_t size, size_t *read)
+{
+	*read = 0;
+
+	int32_t n = recv(ctx->s, (char *) buf, (int32_t) size, 0);
+
+	// A zero byte read means the peer has closed the connection
+	if (n == 0)
+		return MTY_ASYNC_ERROR;
+
+	if (n < 0)
+		return SOCK_ERROR == SOCK_WOULD_BLOCK ? MTY_ASYNC_CONTINUE : MTY_ASYNC_ERROR;
+
+	*read = n;
+
+	METRIC_COUNT("mty_net_received_bytes", "Bytes read from TCP sockets.", n);
+
+	return MTY_ASYNC_OK;
+}
+
+
+// Sets
+
+struct tcp_set *mty_tcp_set_create(uint32_t max)
+{
+	struct tcp_set *ctx = MTY_Alloc(1, sizeof(struct tcp_set));
+	ctx->fds = MTY_Alloc(max, sizeof(struct pollfd));
+	ctx->max = max;
+
+	return ctx;
+}
+
+void mty_tcp_set_destroy(struct tcp_set **set)
+{
+	if (!set || !*set)
+		return;
+
+	struct tcp_set *ctx = *set;
+
+	MTY_Free(ctx->fds);
+
+	MTY_Free(ctx);
+	*set = NULL;
+}
+
+MTY_Async mty_tcp_set_poll(struct tcp_set *ctx, struct tcp * const *tcp, uint32_t len, uint32_t timeout)
+{
+	if (len > ctx->max)
+		len = ctx->max;
+
+	for (uint32_t x = 0; x < len; x++) {
+		ctx->fds[x].fd = tcp[x]->s;
+		ctx->fds[x].events = POLLIN;
+		ctx->fds[x].revents = 0;
+	}
+
+	int32_t e = poll(ctx->fds, len, timeout);
+
+	return e == 0 ? MTY_ASYNC_CONTINUE : e < 0 ? MTY_ASYNC_ERROR : MTY_ASYNC_OK;
+}
+
+bool mty_tcp_set_ready(struct tcp_set *ctx, uint32_t index)
+{
+	return index < ctx->max && ctx->fds[index].revents != 0;
+}
+
 
 // DNS
 
@@ -9,14 +9,23 @@
 #include "matoya.h"
 
 struct tcp;
+struct tcp_set;
 
 struct tcp *mty_tcp_connect(const char *ip, uint16_t port, uint32_t timeout);
 struct tcp *mty_tcp_listen(const char *ip, uint16_t port);
+struct tcp *mty_tcp_listen_shared(const char *ip, uint16_t port, uint32_t defer);
 struct tcp *mty_tcp_accept(struct tcp *ctx, uint32_t timeout);
+struct tcp *mty_tcp_accept_nowait(struct tcp *ctx);
 void mty_tcp_destroy(struct tcp **tcp);
 
 MTY_Async mty_tcp_poll(struct tcp *ctx, bool out, uint32_t timeout);
 bool mty_tcp_write(struct tcp *ctx, const void *buf, size_t size);
 bool mty_tcp_read(struct tcp *ctx, void *buf, size_t size, uint32_t timeout);
+MTY_Async mty_tcp_read_nowait(struct tcp *ctx, void *buf, size_t size, size_t *read);
+
+struct tcp_set *mty_tcp_set_create(uint32_t max);
+void mty_tcp_set_destroy(struct tcp_set **set);
+MTY_Async mty_tcp_set_poll(struct tcp_set *ctx, struct tcp * const *tcp, uint32_t len, uint32_t timeout);
+bool mty_tcp_set_ready(struct tcp_set *ctx, uint32_t index);
 
 bool mty_dns_query(const char *host, char *ip, size_t size);
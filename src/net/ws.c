@@ -10,8 +10,10 @@
 #include <string.h>
 #include <stdio.h>
 
-#include "net.h"
+#include "ws.h"
 #include "http.h"
+#include "tcp.h"
+#include "metrics.h"
 
 enum {
 	WS_OPCODE_CONTINUE = 0x0,
@@ -40,6 +42,10 @@ struct MTY_WebSocket {
 #define WS_PONG_TO       (WS_PING_INTERVAL * 3.0f)
 #define WS_MAGIC         "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
 
+#define WS_HANDSHAKE_MAX    (8 * 1024)
+#define WS_HANDSHAKE_FIELDS 64
+#define WS_SHARD_POLL       100
+
 
 // Helpers
 
@@ -137,19 +143,11 @@ static bool ws_connect(MTY_WebSocket *ctx, const char *path, const char *headers
 	return r;
 }
 
-static bool ws_accept(MTY_WebSocket *ctx, const char * const *origins, uint32_t norigins,
-	bool secure_origin, uint32_t timeout)
+static bool ws_accept_header(MTY_WebSocket *ctx, struct http_header *hdr, const char * const *origins,
+	uint32_t norigins, bool secure_origin)
 {
 	bool r = true;
 	char *res = NULL;
-	struct http_header *hdr = NULL;
-
-	// Wait for the client's request header
-	hdr = mty_http_read_header(ctx->net, timeout);
-	if (!hdr) {
-		r = false;
-		goto except;
-	}
 
 	// Get origin header
 	const char *origin = NULL;
@@ -200,6 +198,20 @@ static bool ws_accept(MTY_WebSocket *ctx, const char * const *origins, uint32_t
 	except:
 
 	MTY_Free(res);
+
+	return r;
+}
+
+static bool ws_accept(MTY_WebSocket *ctx, const char * const *origins, uint32_t norigins,
+	bool secure_origin, uint32_t timeout)
+{
+	// Wait for the client's request header
+	struct http_header *hdr = mty_http_read_header(ctx->net, timeout);
+	if (!hdr)
+		return false;
+
+	bool r = ws_accept_header(ctx, hdr, origins, norigins, secure_origin);
+
 	mty_http_header_destroy(&hdr);
 
 	return r;
@@ -252,8 +264,10 @@ static bool ws_write(MTY_WebSocket *ctx, const void *buf, size_t size, uint8_t o
 		memcpy(ctx->buf + o, buf, size);
 	}
 
+	METRIC_COUNT("mty_ws_sent_frames", "WebSocket frames written.", 1);
+
 	// Write full network buffer
-	return mty_net_write(ctx->net, ctx->buf, size + o);;
+	return mty_net_write(ctx->net, ctx->buf, size + o);
 }
 
 static bool ws_read(MTY_WebSocket *ctx, void *buf, size_t size, uint8_t *opcode, uint32_t timeout, size_t *read)
@@ -279,10 +293,14 @@ static bool ws_read(MTY_WebSocket *ctx, void *buf, size_t size, uint8_t *opcode,
 
 	// Payload len of < 126 uses 1 bytes, == 126 uses 2 bytes, == 127 uses 8 bytes
 	if (*read == 126) {
-		*read = MTY_SwapFromBE16(*((uint16_t *) hbuf));
+		uint16_t len16 = 0;
+		memcpy(&len16, hbuf, 2);
+		*read = MTY_SwapFromBE16(len16);
 
 	} else if (*read == 127) {
-		*read = (size_t) MTY_SwapFromBE64(*((uint64_t *) hbuf));
+		uint64_t len64 = 0;
+		memcpy(&len64, hbuf, 8);
+		*read = (size_t) MTY_SwapFromBE64(len64);
 	}
 
 	// Check bounds
@@ -297,6 +315,8 @@ static bool ws_read(MTY_WebSocket *ctx, void *buf, size_t size, uint8_t *opcode,
 	if (mask)
 		ws_mask(buf, *read, masking_key, buf);
 
+	METRIC_COUNT("mty_ws_received_frames", "WebSocket frames read.", 1);
+
 	return true;
 }
 
@@ -366,6 +386,17 @@ MTY_WebSocket *MTY_WebSocketConnect(const char *host, uint16_t port, bool secure
 	return ctx;
 }
 
+MTY_WebSocket *mty_ws_wrap(struct net *net, bool mask)
+{
+	MTY_WebSocket *ctx = MTY_Alloc(1, sizeof(MTY_WebSocket));
+	ctx->net = net;
+	ctx->mask = mask;
+	ctx->connected = true;
+	ctx->last_ping = ctx->last_pong = MTY_GetTime();
+
+	return ctx;
+}
+
 void MTY_WebSocketDestroy(MTY_WebSocket **webSocket)
 {
 	if (!webSocket || !*webSocket)
@@ -449,3 +480,307 @@ uint16_t MTY_WebSocketGetCloseCode(MTY_WebSocket *ctx)
 {
 	return ctx->close_code;
 }
+
+
+// Server
+
+struct ws_pending {
+	struct tcp *tcp;
+	MTY_Time start;
+	char *buf;
+	size_t len;
+};
+
+struct ws_shard {
+	MTY_WebSocketServer *server;
+	MTY_Thread *thread;
+	struct tcp_set *set;
+
+	// Index 0 is the listener, followed by the pending connections
+	struct tcp **tcp;
+	struct ws_pending *pending;
+	uint32_t npending;
+};
+
+struct MTY_WebSocketServer {
+	char *ip;
+	char **origins;
+	uint32_t norigins;
+	bool secure_origin;
+	uint32_t timeout;
+	uint32_t max_pending;
+
+	MTY_Atomic32 running;
+	MTY_Queue *ready;
+
+	struct ws_shard *shards;
+	uint32_t nshards;
+
+	MTY_Atomic64 accepted;
+	MTY_Atomic64 rejected;
+	MTY_Atomic64 timeouts;
+	MTY_Atomic64 dropped;
+};
+
+static void ws_server_remove(struct ws_shard *shard, uint32_t index)
+{
+	struct ws_pending *p = &shard->pending[index];
+
+	mty_tcp_destroy(&p->tcp);
+	MTY_Free(p->buf);
+
+	// Swap the last pending connection into the free slot
+	shard->npending--;
+	shard->pending[index] = shard->pending[shard->npending];
+	shard->tcp[index + 1] = shard->tcp[shard->npending + 1];
+
+	memset(&shard->pending[shard->npending], 0, sizeof(struct ws_pending));
+}
+
+static void ws_server_upgrade(struct ws_shard *shard, struct ws_pending *p)
+{
+	MTY_WebSocketServer *ctx = shard->server;
+
+	MTY_WebSocket *ws = MTY_Alloc(1, sizeof(MTY_WebSocket));
+	ws->net = mty_net_wrap(p->tcp, ctx->ip);
+	p->tcp = NULL;
+
+	struct http_header *hdr = mty_http_parse_header(p->buf);
+
+	if (!hdr || !ws_accept_header(ws, hdr, (const char * const *) ctx->origins, ctx->norigins, ctx->secure_origin)) {
+		MTY_Atomic64Add(&ctx->rejected, 1);
+		MTY_WebSocketDestroy(&ws);
+
+	} else {
+		ws->connected = true;
+		ws->last_ping = ws->last_pong = MTY_GetTime();
+
+		if (MTY_QueuePushPtr(ctx->ready, ws, sizeof(MTY_WebSocket))) {
+			MTY_Atomic64Add(&ctx->accepted, 1);
+
+		} else {
+			MTY_Atomic64Add(&ctx->dropped, 1);
+			MTY_WebSocketDestroy(&ws);
+		}
+	}
+
+	mty_http_header_destroy(&hdr);
+}
+
+static bool ws_server_read(struct ws_shard *shard, struct ws_pending *p)
+{
+	size_t n = 0;
+	MTY_Async r = mty_tcp_read_nowait(p->tcp, p->buf + p->len, WS_HANDSHAKE_MAX - 1 - p->len, &n);
+
+	if (r == MTY_ASYNC_CONTINUE)
+		return true;
+
+	if (r != MTY_ASYNC_OK)
+		return false;
+
+	size_t prev = p->len;
+	p->len += n;
+	p->buf[p->len] = '\0';
+
+	// Malformed requests are rejected as soon as the offending bytes arrive
+	MTY_HttpField fields[WS_HANDSHAKE_FIELDS];
+	MTY_HttpMessage msg;
+
+	MTY_HttpParseResult pr = MTY_HttpParseMessage(p->buf, p->len, prev, false, fields,
+		WS_HANDSHAKE_FIELDS, &msg);
+
+	if (pr == MTY_HTTP_PARSE_PARTIAL) {
+		if (p->len < WS_HANDSHAKE_MAX - 1)
+			return true;
+
+	// The client must wait for the 101 response, so nothing may follow the request
+	} else if (pr == MTY_HTTP_PARSE_OK && msg.size == p->len) {
+		ws_server_upgrade(shard, p);
+		return false;
+	}
+
+	MTY_Atomic64Add(&shard->server->rejected, 1);
+
+	return false;
+}
+
+static void ws_server_accept(struct ws_shard *shard)
+{
+	MTY_WebSocketServer *ctx = shard->server;
+
+	while (shard->npending < ctx->max_pending) {
+		struct tcp *tcp = mty_tcp_accept_nowait(shard->tcp[0]);
+		if (!tcp)
+			break;
+
+		struct ws_pending *p = &shard->pending[shard->npending];
+		p->tcp = tcp;
+		p->start = MTY_GetTime();
+		p->buf = MTY_Alloc(WS_HANDSHAKE_MAX, 1);
+		p->len = 0;
+
+		shard->tcp[++shard->npending] = tcp;
+	}
+}
+
+static void *ws_server_thread(void *opaque)
+{
+	struct ws_shard *shard = opaque;
+	MTY_WebSocketServer *ctx = shard->server;
+
+	while (MTY_Atomic32Get(&ctx->running) == 1) {
+		// The listener is left out of the poll while the pending list is full
+		bool full = shard->npending == ctx->max_pending;
+		struct tcp **tcp = full ? shard->tcp + 1 : shard->tcp;
+		uint32_t len = full ? shard->npending : shard->npending + 1;
+
+		if (mty_tcp_set_poll(shard->set, tcp, len, WS_SHARD_POLL) == MTY_ASYNC_ERROR) {
+			MTY_Sleep(WS_SHARD_POLL);
+			continue;
+		}
+
+		// Ready flags must be consumed before the pending list is modified
+		uint32_t o = full ? 0 : 1;
+		bool accept = !full && mty_tcp_set_ready(shard->set, 0);
+
+		MTY_Time now = MTY_GetTime();
+
+		for (uint32_t x = shard->npending; x > 0; x--) {
+			uint32_t i = x - 1;
+			struct ws_pending *p = &shard->pending[i];
+
+			bool keep = true;
+
+			if (mty_tcp_set_ready(shard->set, i + o))
+				keep = ws_server_read(shard, p);
+
+			if (keep && MTY_TimeDiff(p->start, now) > ctx->timeout) {
+				MTY_Atomic64Add(&ctx->timeouts, 1);
+				keep = false;
+			}
+
+			if (!keep)
+				ws_server_remove(shard, i);
+		}
+
+		if (accept)
+			ws_server_accept(shard);
+	}
+
+	return NULL;
+}
+
+MTY_WebSocketServer *MTY_WebSocketServerCreate(const MTY_WebSocketServerDesc *desc)
+{
+	bool r = true;
+
+	MTY_WebSocketServer *ctx = MTY_Alloc(1, sizeof(MTY_WebSocketServer));
+	ctx->ip = MTY_Strdup(desc->ip);
+	ctx->secure_origin = desc->secureOrigin;
+	ctx->timeout = desc->handshakeTimeout > 0 ? desc->handshakeTimeout : 5000;
+	ctx->max_pending = desc->maxPending > 0 ? desc->maxPending : 256;
+	ctx->nshards = desc->shards > 0 ? desc->shards : 1;
+
+	// Other platforms either lack SO_REUSEPORT or do not balance connections with it
+	#if !defined(__linux__)
+		ctx->nshards = 1;
+	#endif
+
+	ctx->norigins = desc->numOrigins;
+	ctx->origins = MTY_Alloc(ctx->norigins, sizeof(char *));
+
+	for (uint32_t x = 0; x < ctx->norigins; x++)
+		ctx->origins[x] = MTY_Strdup(desc->origins[x]);
+
+	ctx->ready = MTY_QueueCreate(ctx->max_pending, 0);
+	ctx->shards = MTY_Alloc(ctx->nshards, sizeof(struct ws_shard));
+
+	// The kernel holds connections until the request arrives, rounded up to seconds
+	uint32_t defer = (ctx->timeout + 999) / 1000;
+
+	for (uint32_t x = 0; x < ctx->nshards; x++) {
+		struct ws_shard *shard = &ctx->shards[x];
+		shard->server = ctx;
+		shard->set = mty_tcp_set_create(ctx->max_pending + 1);
+		shard->tcp = MTY_Alloc(ctx->max_pending + 1, sizeof(struct tcp *));
+		shard->pending = MTY_Alloc(ctx->max_pending, sizeof(struct ws_pending));
+
+		shard->tcp[0] = mty_tcp_listen_shared(desc->ip, desc->port, defer);
+		if (!shard->tcp[0]) {
+			r = false;
+			goto except;
+		}
+	}
+
+	MTY_Atomic32Set(&ctx->running, 1);
+
+	for (uint32_t x = 0; x < ctx->nshards; x++)
+		ctx->shards[x].thread = MTY_ThreadCreate(ws_server_thread, &ctx->shards[x]);
+
+	except:
+
+	if (!r)
+		MTY_WebSocketServerDestroy(&ctx);
+
+	return ctx;
+}
+
+void MTY_WebSocketServerDestroy(MTY_WebSocketServer **server)
+{
+	if (!server || !*server)
+		return;
+
+	MTY_WebSocketServer *ctx = *server;
+
+	MTY_Atomic32Set(&ctx->running, 0);
+
+	for (uint32_t x = 0; x < ctx->nshards; x++) {
+		struct ws_shard *shard = &ctx->shards[x];
+
+		MTY_ThreadDestroy(&shard->thread);
+
+		while (shard->npending > 0)
+			ws_server_remove(shard, 0);
+
+		if (shard->tcp)
+			mty_tcp_destroy(&shard->tcp[0]);
+
+		mty_tcp_set_destroy(&shard->set);
+		MTY_Free(shard->tcp);
+		MTY_Free(shard->pending);
+	}
+
+	if (ctx->ready) {
+		for (void *ptr = NULL; MTY_QueuePopPtr(ctx->ready, 0, &ptr, NULL);) {
+			MTY_WebSocket *ws = ptr;
+			MTY_WebSocketDestroy(&ws);
+		}
+
+		MTY_QueueDestroy(&ctx->ready);
+	}
+
+	for (uint32_t x = 0; x < ctx->norigins; x++)
+		MTY_Free(ctx->origins[x]);
+
+	MTY_Free(ctx->origins);
+	MTY_Free(ctx->shards);
+	MTY_Free(ctx->ip);
+
+	MTY_Free(ctx);
+	*server = NULL;
+}
+
+MTY_WebSocket *MTY_WebSocketServerAccept(MTY_WebSocketServer *ctx, uint32_t timeout)
+{
+	void *ws = NULL;
+
+	return MTY_QueuePopPtr(ctx->ready, timeout, &ws, NULL) ? ws : NULL;
+}
+
+void MTY_WebSocketServerGetStats(MTY_WebSocketServer *ctx, MTY_WebSocketServerStats *stats)
+{
+	stats->accepted = MTY_Atomic64Get(&ctx->accepted);
+	stats->rejected = MTY_Atomic64Get(&ctx->rejected);
+	stats->timeouts = MTY_Atomic64Get(&ctx->timeouts);
+	stats->dropped = MTY_Atomic64Get(&ctx->dropped);
+}
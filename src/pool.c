@@ -0,0 +1,305 @@
+// Copyright (c) Christopher D. Dickson <cdd@matoya.group>
+//
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+#include "matoya.h"
+#include "pool.h"
+
+#include <string.h>
+
+#define POOL_MIN_SHIFT  16
+#define POOL_MAX_SHIFT  40
+#define POOL_STEPS      4
+#define POOL_CLASSES    ((POOL_MAX_SHIFT - POOL_MIN_SHIFT) * POOL_STEPS + 1)
+#define POOL_UNCACHED   POOL_CLASSES
+#define POOL_IDLE       5000
+#define POOL_SCAN       1000
+#define POOL_CACHED     (256 * 1024 * 1024)
+
+struct pool_buf {
+	void *mem;
+	size_t size;
+	uint32_t cls;
+	bool hugetlb;
+	MTY_Time freed;
+
+	struct pool_buf *prev;
+	struct pool_buf *next;
+};
+
+struct pool_class {
+	struct pool_buf *head;
+	struct pool_buf *tail;
+};
+
+struct MTY_BufferPool {
+	MTY_Mutex *mutex;
+	MTY_Hash *used;
+	size_t max_cached;
+	bool huge;
+	bool hugetlb;
+	MTY_Time last_scan;
+
+	struct pool_class classes[POOL_CLASSES];
+	MTY_BufferPoolStats stats;
+};
+
+
+// Size classes
+
+// Sizes are rounded up to one of four steps per power of two, so no more than
+// 25% of a buffer is ever wasted. Above the huge page size every class is a
+// multiple of 512 KiB.
+
+static uint32_t pool_class(size_t size, size_t *class_size)
+{
+	size_t min = (size_t) 1 << POOL_MIN_SHIFT;
+
+	if (size <= min) {
+		*class_size = min;
+		return 0;
+	}
+
+	uint32_t p = POOL_MIN_SHIFT;
+	while (p < 63 && ((size_t) 1 << (p + 1)) < size)
+		p++;
+
+	size_t base = (size_t) 1 << p;
+	size_t step = base / POOL_STEPS;
+	size_t k = (size - base + step - 1) / step;
+
+	*class_size = base + k * step;
+
+	return p < POOL_MAX_SHIFT ? (p - POOL_MIN_SHIFT) * POOL_STEPS + (uint32_t) k : POOL_UNCACHED;
+}
+
+
+// Cache lists
+
+static void pool_class_push(struct pool_class *cls, struct pool_buf *buf)
+{
+	buf->prev = NULL;
+	buf->next = cls->head;
+
+	if (cls->head) {
+		cls->head->prev = buf;
+
+	} else {
+		cls->tail = buf;
+	}
+
+	cls->head = buf;
+}
+
+static void pool_class_remove(struct pool_class *cls, struct pool_buf *buf)
+{
+	if (buf->prev) {
+		buf->prev->next = buf->next;
+
+	} else {
+		cls->head = buf->next;
+	}
+
+	if (buf->next) {
+		buf->next->prev = buf->prev;
+
+	} else {
+		cls->tail = buf->prev;
+	}
+
+	buf->prev = buf->next = NULL;
+}
+
+static void pool_release(MTY_BufferPool *ctx, struct pool_buf *buf)
+{
+	if (buf->hugetlb)
+		ctx->stats.huge -= buf->size;
+
+	mty_pages_free(buf->mem, buf->size);
+	MTY_Free(buf);
+}
+
+static void pool_trim(MTY_BufferPool *ctx, size_t keep)
+{
+	// Largest classes first, least recently used first within a class
+	for (int32_t x = POOL_CLASSES - 1; x >= 0 && ctx->stats.cached > keep; x--) {
+		struct pool_class *cls = &ctx->classes[x];
+
+		while (cls->tail && ctx->stats.cached > keep) {
+			struct pool_buf *buf = cls->tail;
+			pool_class_remove(cls, buf);
+
+			ctx->stats.cached -= buf->size;
+			ctx->stats.trimmed++;
+			pool_release(ctx, buf);
+		}
+	}
+}
+
+static void pool_trim_idle(MTY_BufferPool *ctx, MTY_Time now)
+{
+	if (MTY_TimeDiff(ctx->last_scan, now) < POOL_SCAN)
+		return;
+
+	ctx->last_scan = now;
+
+	// Buffers that have not been reused recently are no longer part of a steady
+	// state workload, return them so they don't hold memory indefinitely
+	for (uint32_t x = 0; x < POOL_CLASSES; x++) {
+		struct pool_class *cls = &ctx->classes[x];
+
+		while (cls->tail && MTY_TimeDiff(cls->tail->freed, now) > POOL_IDLE) {
+			struct pool_buf *buf = cls->tail;
+			pool_class_remove(cls, buf);
+
+			ctx->stats.cached -= buf->size;
+			ctx->stats.trimmed++;
+			pool_release(ctx, buf);
+		}
+	}
+}
+
+
+// Public
+
+MTY_BufferPool *MTY_BufferPoolCreate(size_t maxCached, bool hugePages)
+{
+	MTY_BufferPool *ctx = MTY_Alloc(1, sizeof(MTY_BufferPool));
+	ctx->mutex = MTY_MutexCreate();
+	ctx->used = MTY_HashCreate(0);
+	ctx->max_cached = maxCached > 0 ? maxCached : POOL_CACHED;
+	ctx->huge = hugePages;
+	ctx->hugetlb = hugePages;
+	ctx->last_scan = MTY_GetTime();
+
+	return ctx;
+}
+
+void MTY_BufferPoolDestroy(MTY_BufferPool **pool)
+{
+	if (!pool || !*pool)
+		return;
+
+	MTY_BufferPool *ctx = *pool;
+
+	pool_trim(ctx, 0);
+
+	// Outstanding buffers are released along with the pool
+	uint64_t iter = 0;
+	int64_t key = 0;
+
+	while (MTY_HashGetNextKeyInt(ctx->used, &iter, &key))
+		pool_release(ctx, MTY_HashGetInt(ctx->used, key));
+
+	MTY_HashDestroy(&ctx->used, NULL);
+	MTY_MutexDestroy(&ctx->mutex);
+
+	MTY_Free(ctx);
+	*pool = NULL;
+}
+
+void *MTY_BufferPoolAlloc(MTY_BufferPool *ctx, size_t size, bool zero)
+{
+	size_t class_size = 0;
+	uint32_t cls = pool_class(size, &class_size);
+
+	MTY_MutexLock(ctx->mutex);
+
+	struct pool_buf *buf = cls < POOL_CLASSES ? ctx->classes[cls].head : NULL;
+
+	if (buf) {
+		pool_class_remove(&ctx->classes[cls], buf);
+		ctx->stats.cached -= buf->size;
+		ctx->stats.reused++;
+
+	} else {
+		buf = MTY_Alloc(1, sizeof(struct pool_buf));
+		buf->cls = cls;
+
+		// Explicit huge pages need a reservation, after the first failure only
+		// transparent huge pages are attempted. The mapped size may be rounded up.
+		bool hugetlb = ctx->hugetlb && class_size >= MTY_HUGE_PAGE_SIZE;
+		buf->size = class_size;
+		buf->mem = mty_pages_alloc(&buf->size, ctx->huge, &hugetlb);
+		buf->hugetlb = hugetlb;
+
+		if (buf->hugetlb) {
+			ctx->stats.huge += buf->size;
+
+		} else if (ctx->hugetlb && class_size >= MTY_HUGE_PAGE_SIZE) {
+			ctx->hugetlb = false;
+		}
+
+		// Fresh pages are already zeroed by the system
+		zero = false;
+
+		ctx->stats.mapped++;
+	}
+
+	MTY_HashSetInt(ctx->used, (int64_t) (uintptr_t) buf->mem, buf);
+
+	ctx->stats.allocs++;
+	ctx->stats.used += buf->size;
+
+	MTY_MutexUnlock(ctx->mutex);
+
+	if (zero)
+		memset(buf->mem, 0, size);
+
+	return buf->mem;
+}
+
+void MTY_BufferPoolFree(MTY_BufferPool *ctx, void *buffer)
+{
+	if (!buffer)
+		return;
+
+	MTY_MutexLock(ctx->mutex);
+
+	struct pool_buf *buf = MTY_HashPopInt(ctx->used, (int64_t) (uintptr_t) buffer);
+
+	if (buf) {
+		ctx->stats.used -= buf->size;
+
+		if (buf->cls < POOL_CLASSES) {
+			MTY_Time now = MTY_GetTime();
+			buf->freed = now;
+
+			pool_class_push(&ctx->classes[buf->cls], buf);
+			ctx->stats.cached += buf->size;
+
+			if (ctx->stats.cached > ctx->max_cached)
+				pool_trim(ctx, ctx->max_cached);
+
+			pool_trim_idle(ctx, now);
+
+		} else {
+			pool_release(ctx, buf);
+		}
+
+	} else {
+		MTY_Log("Buffer %p was not allocated by this MTY_BufferPool", buffer);
+	}
+
+	MTY_MutexUnlock(ctx->mutex);
+}
+
+void MTY_BufferPoolTrim(MTY_BufferPool *ctx, size_t keep)
+{
+	MTY_MutexLock(ctx->mutex);
+
+	pool_trim(ctx, keep);
+
+	MTY_MutexUnlock(ctx->mutex);
+}
+
+void MTY_BufferPoolGetStats(MTY_BufferPool *ctx, MTY_BufferPoolStats *stats)
+{
+	MTY_MutexLock(ctx->mutex);
+
+	*stats = ctx->stats;
+
+	MTY_MutexUnlock(ctx->mutex);
+}
@@ -0,0 +1,14 @@
+// Copyright (c) Christopher D. Dickson <cdd@matoya.group>
+//
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+#pragma once
+
+#include "matoya.h"
+
+#define MTY_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+void *mty_pages_alloc(size_t *size, bool huge, bool *hugetlb);
+void mty_pages_free(void *mem, size_t size);
@@ -8,6 +8,8 @@
 
 #include <string.h>
 
+#include "metrics.h"
+
 enum {
 	QUEUE_EMPTY = 0,
 	QUEUE_FULL  = 1,
@@ -116,6 +118,9 @@ static void queue_push(MTY_Queue *ctx, size_t size, bool ptr)
 		ctx->slots[lock_pos].ptr = ptr;
 		MTY_Atomic32Set(&ctx->slots[lock_pos].state, QUEUE_FULL);
 
+		METRIC_OBSERVE("mty_queue_depth", "MTY_Queue length after each push.",
+			MTY_QueueGetLength(ctx), 0, 1, 2, 4, 8, 16, 32, 64, 128, 256, 512, 1024);
+
 		MTY_WaitableSignal(ctx->pop_sync);
 	}
 
@@ -127,6 +132,52 @@ void MTY_QueuePush(MTY_Queue *ctx, size_t size)
 	queue_push(ctx, size, false);
 }
 
+uint32_t MTY_QueueGetInputBuffers(MTY_Queue *ctx, void **buffers, uint32_t count)
+{
+	MTY_MutexLock(ctx->push_mutex);
+
+	uint32_t n = 0;
+	uint32_t pos = ctx->push_pos;
+
+	while (n < count && n < ctx->len) {
+		if (MTY_Atomic32Get(&ctx->slots[pos].state) != QUEUE_EMPTY)
+			break;
+
+		buffers[n++] = ctx->slots[pos].data;
+		pos = queue_next_pos(ctx, pos);
+	}
+
+	if (n == 0)
+		MTY_MutexUnlock(ctx->push_mutex);
+
+	return n;
+}
+
+void MTY_QueuePushMany(MTY_Queue *ctx, const size_t *sizes, uint32_t count)
+{
+	uint32_t n = 0;
+
+	for (; n < count && sizes[n] > 0; n++) {
+		struct queue_slot *slot = &ctx->slots[ctx->push_pos];
+		slot->size = sizes[n];
+		slot->ptr = false;
+
+		ctx->push_pos = queue_next_pos(ctx, ctx->push_pos);
+
+		MTY_Atomic32Set(&slot->state, QUEUE_FULL);
+	}
+
+	// A single observation and wakeup cover the entire batch
+	if (n > 0) {
+		METRIC_OBSERVE("mty_queue_depth", "MTY_Queue length after each push.",
+			MTY_QueueGetLength(ctx), 0, 1, 2, 4, 8, 16, 32, 64, 128, 256, 512, 1024);
+
+		MTY_WaitableSignal(ctx->pop_sync);
+	}
+
+	MTY_MutexUnlock(ctx->push_mutex);
+}
+
 static bool queue_pop(MTY_Queue *ctx, int32_t timeout, bool last, void **buffer, size_t *size)
 {
 	begin:
@@ -177,6 +228,38 @@ void MTY_QueuePop(MTY_Queue *ctx)
 	MTY_Atomic32Set(&ctx->slots[lock_pos].state, QUEUE_EMPTY);
 }
 
+uint32_t MTY_QueueGetOutputBuffers(MTY_Queue *ctx, int32_t timeout, void **buffers,
+	size_t *sizes, uint32_t count)
+{
+	if (count == 0 || !queue_pop(ctx, timeout, false, &buffers[0], sizes ? &sizes[0] : NULL))
+		return 0;
+
+	uint32_t n = 1;
+	uint32_t pos = ctx->pop_pos;
+
+	while (n < count && n < ctx->len) {
+		pos = queue_next_pos(ctx, pos);
+
+		if (MTY_Atomic32Get(&ctx->slots[pos].state) != QUEUE_FULL)
+			break;
+
+		buffers[n] = ctx->slots[pos].data;
+
+		if (sizes)
+			sizes[n] = ctx->slots[pos].size;
+
+		n++;
+	}
+
+	return n;
+}
+
+void MTY_QueuePopMany(MTY_Queue *ctx, uint32_t count)
+{
+	for (uint32_t x = 0; x < count; x++)
+		MTY_QueuePop(ctx);
+}
+
 bool MTY_QueuePushPtr(MTY_Queue *ctx, void *opaque, size_t size)
 {
 	void *buffer = MTY_QueueGetInputBuffer(ctx);
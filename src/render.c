@@ -6,6 +6,9 @@
 
 #include "matoya.h"
 
+#include <string.h>
+
+#include "render.h"
 #include "gfx/mod.h"
 #include "gfx/mod-ui.h"
 
@@ -21,13 +24,59 @@ GFX_UI_PROTOTYPES(_d3d11_)
 GFX_UI_PROTOTYPES(_metal_)
 GFX_UI_DECLARE_TABLE()
 
+#define RENDER_ATLAS_ID    0xFFFFFF00
+#define RENDER_ATLAS_PAGES 8
+#define RENDER_ATLAS_PAD   1
+
+struct render_atlas_page {
+	uint8_t *rgba;
+	uint16_t *skyline;
+	uint32_t size;
+	uint32_t live;
+	uint64_t live_area;
+
+	// Bounds of the texels written since the last upload
+	bool dirty;
+	uint32_t dirty_x0;
+	uint32_t dirty_y0;
+	uint32_t dirty_x1;
+	uint32_t dirty_y1;
+};
+
+struct render_atlas_entry {
+	uint32_t page;
+	uint32_t x;
+	uint32_t y;
+	uint32_t w;
+	uint32_t h;
+};
+
+struct render_atlas_list {
+	MTY_Vtx *vtx;
+	MTY_Cmd *cmd;
+	uint8_t *mark;
+	uint32_t vtx_max;
+	uint32_t cmd_max;
+};
+
 struct MTY_Renderer {
 	MTY_GFX api;
 	MTY_Device *device;
 	MTY_Hash *textures;
+	MTY_Renderer *parent;
 
 	struct gfx *gfx;
 	struct gfx_ui *gfx_ui;
+
+	uint32_t atlas_size;
+	uint32_t atlas_count;
+	MTY_Hash *atlas;
+	struct render_atlas_page pages[RENDER_ATLAS_PAGES];
+
+	MTY_DrawData dd;
+	MTY_CmdList *lists;
+	struct render_atlas_list *scratch;
+	uint32_t lists_max;
 };
 
 struct MTY_RenderState {
@@ -39,10 +88,429 @@ MTY_Renderer *MTY_RendererCreate(void)
 {
 	MTY_Renderer *ctx = MTY_Alloc(1, sizeof(MTY_Renderer));
 	ctx->textures = MTY_HashCreate(0);
+	ctx->atlas = MTY_HashCreate(0);
+
+	return ctx;
+}
+
+MTY_Renderer *mty_renderer_create_shared(MTY_Renderer *parent)
+{
+	MTY_Renderer *ctx = MTY_RendererCreate();
+	ctx->parent = parent;
 
 	return ctx;
 }
 
+
+// UI atlas
+
+// Small UI textures are packed into shared pages with a skyline packer so that
+// consecutive commands referencing different images can be drawn with a single
+// bind. Each image is surrounded by a replicated border so linear filtering at
+// its edges does not sample its neighbors.
+
+static void render_atlas_reset_page(struct render_atlas_page *page)
+{
+	memset(page->skyline, 0, page->size * sizeof(uint16_t));
+	page->live = 0;
+	page->live_area = 0;
+}
+
+static void render_atlas_free_page(struct render_atlas_page *page)
+{
+	MTY_Free(page->rgba);
+	MTY_Free(page->skyline);
+
+	memset(page, 0, sizeof(struct render_atlas_page));
+}
+
+static bool render_atlas_find(struct render_atlas_page *page, uint32_t w, uint32_t h, uint32_t *x, uint32_t *y)
+{
+	uint32_t best_x = 0;
+	uint32_t best_y = UINT32_MAX;
+
+	// Bottom-left: choose the position where the image's top edge lands lowest
+	for (uint32_t cx = 0; cx + w <= page->size; cx++) {
+		uint32_t cy = 0;
+
+		for (uint32_t i = cx; i < cx + w && cy < best_y; i++)
+			if (page->skyline[i] > cy)
+				cy = page->skyline[i];
+
+		if (cy < best_y && cy + h <= page->size) {
+			best_x = cx;
+			best_y = cy;
+		}
+	}
+
+	*x = best_x;
+	*y = best_y;
+
+	return best_y != UINT32_MAX;
+}
+
+static void render_atlas_copy(struct render_atlas_page *page, const struct render_atlas_entry *e,
+	const uint8_t *rgba)
+{
+	uint32_t pad = RENDER_ATLAS_PAD;
+
+	// Destination rows include the border, clamping the source replicates edge texels
+	for (uint32_t y = 0; y < e->h + pad * 2; y++) {
+		uint32_t sy = y < pad ? 0 : y - pad >= e->h ? e->h - 1 : y - pad;
+		uint8_t *dst = page->rgba + ((size_t) (e->y + y) * page->size + e->x) * 4;
+		const uint8_t *src = rgba + (size_t) sy * e->w * 4;
+
+		memcpy(dst + 4 * pad, src, (size_t) e->w * 4);
+
+		for (uint32_t x = 0; x < pad; x++) {
+			memcpy(dst + 4 * x, src, 4);
+			memcpy(dst + 4 * (pad + e->w + x), src + (size_t) (e->w - 1) * 4, 4);
+		}
+	}
+
+	uint32_t x1 = e->x + e->w + pad * 2;
+	uint32_t y1 = e->y + e->h + pad * 2;
+
+	if (!page->dirty) {
+		page->dirty_x0 = e->x;
+		page->dirty_y0 = e->y;
+		page->dirty_x1 = x1;
+		page->dirty_y1 = y1;
+		page->dirty = true;
+
+	} else {
+		page->dirty_x0 = e->x < page->dirty_x0 ? e->x : page->dirty_x0;
+		page->dirty_y0 = e->y < page->dirty_y0 ? e->y : page->dirty_y0;
+		page->dirty_x1 = x1 > page->dirty_x1 ? x1 : page->dirty_x1;
+		page->dirty_y1 = y1 > page->dirty_y1 ? y1 : page->dirty_y1;
+	}
+}
+
+static bool render_atlas_place(MTY_Renderer *ctx, struct render_atlas_entry *e, const uint8_t *rgba)
+{
+	uint32_t w = e->w + RENDER_ATLAS_PAD * 2;
+	uint32_t h = e->h + RENDER_ATLAS_PAD * 2;
+
+	for (uint32_t x = 0; x < RENDER_ATLAS_PAGES; x++) {
+		struct render_atlas_page *page = &ctx->pages[x];
+
+		if (!page->rgba) {
+			if (ctx->atlas_size == 0)
+				continue;
+
+			page->size = ctx->atlas_size;
+			page->rgba = MTY_Alloc((size_t) page->size * page->size, 4);
+			page->skyline = MTY_Alloc(page->size, sizeof(uint16_t));
+		}
+
+		uint32_t px = 0;
+		uint32_t py = 0;
+
+		if (render_atlas_find(page, w, h, &px, &py)) {
+			for (uint32_t i = px; i < px + w; i++)
+				page->skyline[i] = (uint16_t) (py + h);
+
+			e->page = x;
+			e->x = px;
+			e->y = py;
+
+			page->live++;
+			page->live_area += (uint64_t) w * h;
+
+			render_atlas_copy(page, e, rgba);
+
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static uint8_t *render_atlas_extract(MTY_Renderer *ctx, const struct render_atlas_entry *e)
+{
+	struct render_atlas_page *page = &ctx->pages[e->page];
+	uint8_t *rgba = MTY_Alloc((size_t) e->w * e->h, 4);
+
+	for (uint32_t y = 0; y < e->h; y++) {
+		size_t offset = ((size_t) (e->y + RENDER_ATLAS_PAD + y) * page->size + e->x + RENDER_ATLAS_PAD) * 4;
+		memcpy(rgba + (size_t) y * e->w * 4, page->rgba + offset, (size_t) e->w * 4);
+	}
+
+	return rgba;
+}
+
+static uint64_t render_atlas_wasted(MTY_Renderer *ctx)
+{
+	uint64_t wasted = 0;
+
+	for (uint32_t x = 0; x < RENDER_ATLAS_PAGES; x++) {
+		struct render_atlas_page *page = &ctx->pages[x];
+
+		for (uint32_t i = 0; i < page->size; i++)
+			wasted += page->skyline[i];
+
+		wasted -= page->live_area;
+	}
+
+	return wasted;
+}
+
+static void render_atlas_defrag(MTY_Renderer *ctx, MTY_GFX api, MTY_Device *device)
+{
+	uint32_t n = 0;
+	int64_t *ids = MTY_Alloc(ctx->atlas_count, sizeof(int64_t));
+	uint8_t **images = MTY_Alloc(ctx->atlas_count, sizeof(uint8_t *));
+
+	uint64_t i = 0;
+	int64_t id = 0;
+
+	while (MTY_HashGetNextKeyInt(ctx->atlas, &i, &id) && n < ctx->atlas_count) {
+		images[n] = render_atlas_extract(ctx, MTY_HashGetInt(ctx->atlas, id));
+		ids[n++] = id;
+	}
+
+	// Tallest first packs a skyline with the least waste
+	for (uint32_t x = 1; x < n; x++) {
+		for (uint32_t y = x; y > 0; y--) {
+			struct render_atlas_entry *a = MTY_HashGetInt(ctx->atlas, ids[y - 1]);
+			struct render_atlas_entry *b = MTY_HashGetInt(ctx->atlas, ids[y]);
+
+			if (a->h >= b->h)
+				break;
+
+			int64_t tid = ids[y]; ids[y] = ids[y - 1]; ids[y - 1] = tid;
+			uint8_t *timg = images[y]; images[y] = images[y - 1]; images[y - 1] = timg;
+		}
+	}
+
+	for (uint32_t x = 0; x < RENDER_ATLAS_PAGES; x++)
+		if (ctx->pages[x].rgba)
+			render_atlas_reset_page(&ctx->pages[x]);
+
+	for (uint32_t x = 0; x < n; x++) {
+		struct render_atlas_entry *e = MTY_HashGetInt(ctx->atlas, ids[x]);
+
+		// Repacking is not guaranteed to fit everything the incremental packing did,
+		// anything left over is given its own texture
+		if (!render_atlas_place(ctx, e, images[x])) {
+			void *texture = GFX_UI_API[api].create_texture(device, images[x], e->w, e->h);
+
+			if (texture) {
+				MTY_HashSetInt(ctx->textures, ids[x], texture);
+
+			} else {
+				MTY_Log("UI atlas entry %u was lost while defragmenting", (uint32_t) ids[x]);
+			}
+
+			MTY_Free(MTY_HashPopInt(ctx->atlas, ids[x]));
+			ctx->atlas_count--;
+		}
+
+		MTY_Free(images[x]);
+	}
+
+	MTY_Free(images);
+	MTY_Free(ids);
+}
+
+static void render_atlas_remove(MTY_Renderer *ctx, uint32_t id)
+{
+	struct render_atlas_entry *e = MTY_HashPopInt(ctx->atlas, id);
+	if (!e)
+		return;
+
+	struct render_atlas_page *page = &ctx->pages[e->page];
+
+	// Space is only reclaimed when a page empties or during defragmentation
+	page->live--;
+	page->live_area -= (uint64_t) (e->w + RENDER_ATLAS_PAD * 2) * (e->h + RENDER_ATLAS_PAD * 2);
+
+	if (page->live == 0)
+		render_atlas_reset_page(page);
+
+	ctx->atlas_count--;
+	MTY_Free(e);
+}
+
+static bool render_atlas_insert(MTY_Renderer *ctx, MTY_GFX api, MTY_Device *device, uint32_t id,
+	const void *rgba, uint32_t width, uint32_t height)
+{
+	// Only small images benefit, large ones keep their own texture
+	uint32_t max = ctx->atlas_size / 4;
+
+	if (width == 0 || height == 0 || width + RENDER_ATLAS_PAD * 2 > max || height + RENDER_ATLAS_PAD * 2 > max)
+		return false;
+
+	struct render_atlas_entry *e = MTY_Alloc(1, sizeof(struct render_atlas_entry));
+	e->w = width;
+	e->h = height;
+
+	bool r = render_atlas_place(ctx, e, rgba);
+
+	if (!r && render_atlas_wasted(ctx) >= (uint64_t) (width + RENDER_ATLAS_PAD * 2) * (height + RENDER_ATLAS_PAD * 2)) {
+		render_atlas_defrag(ctx, api, device);
+		r = render_atlas_place(ctx, e, rgba);
+	}
+
+	if (!r) {
+		MTY_Free(e);
+		return false;
+	}
+
+	MTY_HashSetInt(ctx->atlas, id, e);
+	ctx->atlas_count++;
+
+	return true;
+}
+
+static void render_atlas_clear(MTY_Renderer *ctx)
+{
+	MTY_HashDestroy(&ctx->atlas, MTY_Free);
+	ctx->atlas = MTY_HashCreate(0);
+	ctx->atlas_count = 0;
+
+	for (uint32_t x = 0; x < RENDER_ATLAS_PAGES; x++)
+		render_atlas_free_page(&ctx->pages[x]);
+}
+
+static void render_atlas_upload(MTY_Renderer *ctx, MTY_GFX api, MTY_Device *device, MTY_Context *context)
+{
+	for (uint32_t x = 0; x < RENDER_ATLAS_PAGES; x++) {
+		struct render_atlas_page *page = &ctx->pages[x];
+
+		if (!page->dirty)
+			continue;
+
+		// Once a page exists only the region written since the last upload is sent
+		void *texture = MTY_HashGetInt(ctx->textures, RENDER_ATLAS_ID + x);
+		const uint8_t *rgba = page->rgba + ((size_t) page->dirty_y0 * page->size + page->dirty_x0) * 4;
+
+		if (!texture || !GFX_UI_API[api].update_texture(device, context, texture, rgba, page->size,
+			page->dirty_x0, page->dirty_y0, page->dirty_x1 - page->dirty_x0, page->dirty_y1 - page->dirty_y0))
+		{
+			texture = MTY_HashPopInt(ctx->textures, RENDER_ATLAS_ID + x);
+			if (texture)
+				GFX_UI_API[api].destroy_texture(&texture);
+
+			texture = GFX_UI_API[api].create_texture(device, page->rgba, page->size, page->size);
+			if (texture)
+				MTY_HashSetInt(ctx->textures, RENDER_ATLAS_ID + x, texture);
+		}
+
+		page->dirty = false;
+	}
+}
+
+static void render_atlas_remap_cmd(MTY_Renderer *ctx, const MTY_CmdList *src, struct render_atlas_list *list,
+	MTY_Cmd *cmd)
+{
+	struct render_atlas_entry *e = MTY_HashGetInt(ctx->atlas, cmd->texture);
+	if (!e)
+		return;
+
+	float size = (float) ctx->pages[e->page].size;
+	float x = (float) (e->x + RENDER_ATLAS_PAD);
+	float y = (float) (e->y + RENDER_ATLAS_PAD);
+
+	for (uint32_t i = cmd->idxOffset; i < cmd->idxOffset + cmd->elemCount && i < src->idxLength; i++) {
+		uint32_t v = cmd->vtxOffset + src->idx[i];
+
+		if (v >= src->vtxLength || list->mark[v])
+			continue;
+
+		MTY_Point *uv = &list->vtx[v].uv;
+		uv->x = (x + uv->x * e->w) / size;
+		uv->y = (y + uv->y * e->h) / size;
+
+		list->mark[v] = 1;
+	}
+
+	cmd->texture = RENDER_ATLAS_ID + e->page;
+}
+
+static const MTY_DrawData *render_atlas_remap(MTY_Renderer *ctx, const MTY_DrawData *dd)
+{
+	if (dd->cmdListLength > ctx->lists_max) {
+		ctx->lists = MTY_Realloc(ctx->lists, dd->cmdListLength, sizeof(MTY_CmdList));
+		ctx->scratch = MTY_Realloc(ctx->scratch, dd->cmdListLength, sizeof(struct render_atlas_list));
+		memset(ctx->scratch + ctx->lists_max, 0, (dd->cmdListLength - ctx->lists_max) * sizeof(struct render_atlas_list));
+
+		ctx->lists_max = dd->cmdListLength;
+	}
+
+	ctx->dd = *dd;
+	ctx->dd.cmdList = ctx->lists;
+	ctx->dd.cmdListMax = ctx->lists_max;
+
+	for (uint32_t n = 0; n < dd->cmdListLength; n++) {
+		const MTY_CmdList *src = &dd->cmdList[n];
+		struct render_atlas_list *list = &ctx->scratch[n];
+
+		if (src->vtxLength > list->vtx_max) {
+			list->vtx = MTY_Realloc(list->vtx, src->vtxLength, sizeof(MTY_Vtx));
+			list->mark = MTY_Realloc(list->mark, src->vtxLength, 1);
+			list->vtx_max = src->vtxLength;
+		}
+
+		if (src->cmdLength > list->cmd_max) {
+			list->cmd = MTY_Realloc(list->cmd, src->cmdLength, sizeof(MTY_Cmd));
+			list->cmd_max = src->cmdLength;
+		}
+
+		memcpy(list->vtx, src->vtx, src->vtxLength * sizeof(MTY_Vtx));
+		memset(list->mark, 0, src->vtxLength);
+
+		uint32_t len = 0;
+
+		for (uint32_t i = 0; i < src->cmdLength; i++) {
+			MTY_Cmd cmd = src->cmd[i];
+
+			if (cmd.texture)
+				render_atlas_remap_cmd(ctx, src, list, &cmd);
+
+			// Commands that now share a texture and clip with contiguous indices merge into one draw
+			MTY_Cmd *prev = len > 0 ? &list->cmd[len - 1] : NULL;
+
+			if (prev && prev->texture == cmd.texture && prev->vtxOffset == cmd.vtxOffset &&
+				prev->idxOffset + prev->elemCount == cmd.idxOffset && !memcmp(&prev->clip, &cmd.clip, sizeof(MTY_Rect)))
+			{
+				prev->elemCount += cmd.elemCount;
+
+			} else {
+				list->cmd[len++] = cmd;
+			}
+		}
+
+		MTY_CmdList *dst = &ctx->lists[n];
+		*dst = *src;
+		dst->vtx = list->vtx;
+		dst->cmd = list->cmd;
+		dst->cmdLength = len;
+		dst->cmdMax = list->cmd_max;
+		dst->vtxMax = list->vtx_max;
+	}
+
+	return &ctx->dd;
+}
+
+static void render_atlas_destroy(MTY_Renderer *ctx)
+{
+	render_atlas_clear(ctx);
+	MTY_HashDestroy(&ctx->atlas, MTY_Free);
+
+	for (uint32_t x = 0; x < ctx->lists_max; x++) {
+		MTY_Free(ctx->scratch[x].vtx);
+		MTY_Free(ctx->scratch[x].cmd);
+		MTY_Free(ctx->scratch[x].mark);
+	}
+
+	MTY_Free(ctx->scratch);
+	MTY_Free(ctx->lists);
+}
+
+
+// Renderer
+
 static void render_destroy_api(MTY_Renderer *ctx)
 {
 	if (ctx->api == MTY_GFX_NONE)
@@ -58,6 +526,9 @@ static void render_destroy_api(MTY_Renderer *ctx)
 		GFX_UI_API[ctx->api].destroy_texture(&texture);
 	}
 
+	// Atlas pages were destroyed above along with the standalone textures
+	render_atlas_clear(ctx);
+
 	ctx->api = MTY_GFX_NONE;
 	ctx->device = NULL;
 }
@@ -70,6 +541,7 @@ void MTY_RendererDestroy(MTY_Renderer **renderer)
 	MTY_Renderer *ctx = *renderer;
 
 	render_destroy_api(ctx);
+	render_atlas_destroy(ctx);
 	MTY_HashDestroy(&ctx->textures, NULL);
 
 	MTY_Free(ctx);
@@ -89,8 +561,15 @@ static bool render_create_api(MTY_Renderer *ctx, MTY_GFX api, MTY_Device *device
 	ctx->api = api;
 	ctx->device = device;
 
-	ctx->gfx = GFX_API[api].create(device);
-	ctx->gfx_ui = GFX_UI_API[api].create(device);
+	// Children compile nothing and reference the parent's programs
+	if (ctx->parent && api == MTY_GFX_GL) {
+		ctx->gfx = mty_gl_create_shared(ctx->parent->gfx);
+		ctx->gfx_ui = mty_gl_ui_create_shared(ctx->parent->gfx_ui);
+
+	} else {
+		ctx->gfx = GFX_API[api].create(device);
+		ctx->gfx_ui = GFX_UI_API[api].create(device);
+	}
 
 	if (!ctx->gfx || !ctx->gfx_ui) {
 		render_destroy_api(ctx);
@@ -102,6 +581,9 @@ static bool render_create_api(MTY_Renderer *ctx, MTY_GFX api, MTY_Device *device
 
 static bool renderer_begin(MTY_Renderer *ctx, MTY_GFX api, MTY_Context *context, MTY_Device *device)
 {
+	if (ctx->parent && !renderer_begin(ctx->parent, api, context, device))
+		return false;
+
 	if (ctx->api != api || ctx->device != device)
 		render_destroy_api(ctx);
 
@@ -111,9 +593,20 @@ static bool renderer_begin(MTY_Renderer *ctx, MTY_GFX api, MTY_Context *context,
 	return true;
 }
 
+bool mty_renderer_init(MTY_Renderer *ctx, MTY_GFX api, MTY_Device *device, MTY_Context *context)
+{
+	return renderer_begin(ctx, api, context, device);
+}
+
 bool MTY_RendererDrawQuad(MTY_Renderer *ctx, MTY_GFX api, MTY_Device *device, MTY_Context *context,
 	const void *image, const MTY_RenderDesc *desc, MTY_Surface *dst)
 {
+	// High bit depth and HDR formats are only implemented by the GL shader
+	if (api != MTY_GFX_GL && desc->format >= MTY_COLOR_FORMAT_P010) {
+		MTY_Log("MTY_ColorFormat %d is only supported by MTY_GFX_GL", desc->format);
+		return false;
+	}
+
 	if (!renderer_begin(ctx, api, context, device))
 		return false;
 
@@ -126,12 +619,23 @@ bool MTY_RendererDrawUI(MTY_Renderer *ctx, MTY_GFX api, MTY_Device *device,
 	if (!renderer_begin(ctx, api, context, device))
 		return false;
 
-	return GFX_UI_API[api].render(ctx->gfx_ui, device, context, dd, ctx->textures, dst);
+	// UI textures and the atlas are owned by the parent
+	MTY_Renderer *owner = ctx->parent ? ctx->parent : ctx;
+
+	if (owner->atlas_count > 0) {
+		render_atlas_upload(owner, api, device, context);
+		dd = render_atlas_remap(owner, dd);
+	}
+
+	return GFX_UI_API[api].render(ctx->gfx_ui, device, context, dd, owner->textures, dst);
 }
 
 bool MTY_RendererSetUITexture(MTY_Renderer *ctx, MTY_GFX api, MTY_Device *device,
 	MTY_Context *context, uint32_t id, const void *rgba, uint32_t width, uint32_t height)
 {
+	if (ctx->parent)
+		return MTY_RendererSetUITexture(ctx->parent, api, device, context, id, rgba, width, height);
+
 	if (!renderer_begin(ctx, api, context, device))
 		return false;
 
@@ -139,7 +643,12 @@ bool MTY_RendererSetUITexture(MTY_Renderer *ctx, MTY_GFX api, MTY_Device *device
 	if (texture)
 		GFX_UI_API[api].destroy_texture(&texture);
 
+	render_atlas_remove(ctx, id);
+
 	if (rgba) {
+		if (ctx->atlas_size > 0 && render_atlas_insert(ctx, api, device, id, rgba, width, height))
+			return true;
+
 		texture = GFX_UI_API[api].create_texture(device, rgba, width, height);
 		MTY_HashSetInt(ctx->textures, id, texture);
 	}
@@ -149,7 +658,27 @@ bool MTY_RendererSetUITexture(MTY_Renderer *ctx, MTY_GFX api, MTY_Device *device
 
 bool MTY_RendererHasUITexture(MTY_Renderer *ctx, uint32_t id)
 {
-	return MTY_HashGetInt(ctx->textures, id) ? true : false;
+	if (ctx->parent)
+		return MTY_RendererHasUITexture(ctx->parent, id);
+
+	return MTY_HashGetInt(ctx->textures, id) || MTY_HashGetInt(ctx->atlas, id);
+}
+
+void MTY_RendererSetUIAtlas(MTY_Renderer *ctx, uint32_t pageSize)
+{
+	if (ctx->parent) {
+		MTY_RendererSetUIAtlas(ctx->parent, pageSize);
+		return;
+	}
+
+	// Skyline heights are stored as 16-bit values
+	if (pageSize > UINT16_MAX)
+		pageSize = UINT16_MAX;
+
+	if (pageSize > 0 && pageSize < 64)
+		pageSize = 64;
+
+	ctx->atlas_size = pageSize;
 }
 
 uint32_t MTY_GetAvailableGFX(MTY_GFX *apis)
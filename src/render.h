@@ -0,0 +1,17 @@
+// Copyright (c) Christopher D. Dickson <cdd@matoya.group>
+//
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+#pragma once
+
+#include "matoya.h"
+
+// A child renderer draws with its own per-frame resources but uses the compiled
+// programs and UI textures of `parent`. The parent must outlive its children and
+// callers must serialize access to it. Sharing only takes effect with MTY_GFX_GL.
+MTY_Renderer *mty_renderer_create_shared(MTY_Renderer *parent);
+
+// Create the API objects ahead of the first draw
+bool mty_renderer_init(MTY_Renderer *ctx, MTY_GFX api, MTY_Device *device, MTY_Context *context);
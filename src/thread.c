@@ -209,6 +209,10 @@ struct thread_info {
 	void *opaque;
 	MTY_Thread *t;
 	MTY_Mutex *m;
+
+	uint32_t *cpus;
+	uint32_t num_cpus;
+	uint32_t node;
 };
 
 struct MTY_ThreadPool {
@@ -231,6 +235,65 @@ MTY_ThreadPool *MTY_ThreadPoolCreate(uint32_t maxThreads)
 	return ctx;
 }
 
+static uint32_t thread_pool_unit(const MTY_LogicalCPU *cpu, MTY_ThreadPolicy policy)
+{
+	switch (policy) {
+		case MTY_THREAD_POLICY_CORE: return cpu->core;
+		case MTY_THREAD_POLICY_LLC:  return cpu->llc;
+		case MTY_THREAD_POLICY_NODE: return cpu->node;
+		default:
+			break;
+	}
+
+	return 0;
+}
+
+MTY_ThreadPool *MTY_ThreadPoolCreateWithPolicy(MTY_ThreadPolicy policy, uint32_t maxThreads)
+{
+	MTY_CPUTopology *topo = MTY_GetCPUTopology();
+
+	// Units are the distinct cores, caches, or nodes in order of first appearance
+	uint32_t *units = MTY_Alloc(topo->numCPUs, sizeof(uint32_t));
+	uint32_t num_units = 0;
+
+	for (uint32_t x = 0; x < topo->numCPUs; x++) {
+		uint32_t unit = thread_pool_unit(&topo->cpus[x], policy);
+		uint32_t y = 0;
+
+		while (y < num_units && units[y] != unit)
+			y++;
+
+		if (y == num_units)
+			units[num_units++] = unit;
+	}
+
+	if (maxThreads == 0)
+		maxThreads = policy == MTY_THREAD_POLICY_NONE ? topo->numCPUs : num_units;
+
+	MTY_ThreadPool *ctx = MTY_ThreadPoolCreate(maxThreads);
+
+	for (uint32_t x = 1; x < ctx->num && policy != MTY_THREAD_POLICY_NONE; x++) {
+		struct thread_info *ti = &ctx->ti[x];
+		uint32_t unit = units[(x - 1) % num_units];
+
+		ti->cpus = MTY_Alloc(topo->numCPUs, sizeof(uint32_t));
+
+		for (uint32_t y = 0; y < topo->numCPUs; y++) {
+			if (thread_pool_unit(&topo->cpus[y], policy) == unit) {
+				if (ti->num_cpus == 0)
+					ti->node = topo->cpus[y].node;
+
+				ti->cpus[ti->num_cpus++] = topo->cpus[y].id;
+			}
+		}
+	}
+
+	MTY_Free(units);
+	MTY_FreeCPUTopology(&topo);
+
+	return ctx;
+}
+
 void MTY_ThreadPoolDestroy(MTY_ThreadPool **pool, MTY_AnonFunc detach)
 {
 	if (!pool || !*pool)
@@ -245,6 +308,7 @@ void MTY_ThreadPoolDestroy(MTY_ThreadPool **pool, MTY_AnonFunc detach)
 			MTY_ThreadDestroy(&ctx->ti[x].t);
 
 		MTY_MutexDestroy(&ctx->ti[x].m);
+		MTY_Free(ctx->ti[x].cpus);
 	}
 
 	MTY_Free(ctx->ti);
@@ -256,6 +320,10 @@ static void *thread_pool_func(void *opaque)
 {
 	struct thread_info *ti = (struct thread_info *) opaque;
 
+	// Threads are created per dispatch, so placement is applied every time
+	if (ti->num_cpus > 0)
+		MTY_ThreadSetAffinity(ti->cpus, ti->num_cpus);
+
 	ti->func(ti->opaque);
 
 	MTY_MutexLock(ti->m);
@@ -335,6 +403,11 @@ MTY_Async MTY_ThreadPoolPoll(MTY_ThreadPool *ctx, uint32_t index, void **opaque)
 	return status;
 }
 
+uint32_t MTY_ThreadPoolGetNode(MTY_ThreadPool *ctx, uint32_t index)
+{
+	return index < ctx->num ? ctx->ti[index].node : 0;
+}
+
 
 // Global locks
 
@@ -0,0 +1,547 @@
+// Copyright (c) Christopher D. Dickson <cdd@matoya.group>
+//
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+#include "matoya.h"
+
+#include <string.h>
+
+// Hierarchical timing wheel: a 256 slot base wheel followed by three 64 slot
+// wheels, covering 2^26 ticks. Timers further out than that are parked in the
+// last slot of the outermost wheel and re-cascaded until they are in range.
+
+#define TIMER_LEVELS     4
+#define TIMER_BASE_BITS  8
+#define TIMER_BASE_SIZE  (1 << TIMER_BASE_BITS)
+#define TIMER_BASE_MASK  (TIMER_BASE_SIZE - 1)
+#define TIMER_LEVEL_BITS 6
+#define TIMER_LEVEL_SIZE (1 << TIMER_LEVEL_BITS)
+#define TIMER_LEVEL_MASK (TIMER_LEVEL_SIZE - 1)
+#define TIMER_RANGE      ((uint64_t) 1 << (TIMER_BASE_BITS + TIMER_LEVEL_BITS * (TIMER_LEVELS - 1)))
+
+#define TIMER_INDEX_BITS 24
+#define TIMER_INDEX_MASK ((1 << TIMER_INDEX_BITS) - 1)
+#define TIMER_GEN_MASK   0xFF
+
+#define TIMER_SHIFT(level) \
+	((level) == 0 ? 0 : TIMER_BASE_BITS + TIMER_LEVEL_BITS * ((level) - 1))
+
+enum timer_state {
+	TIMER_FREE   = 0,
+	TIMER_ARMED  = 1,
+	TIMER_DUE    = 2,
+	TIMER_FIRING = 3,
+};
+
+struct timer_node {
+	uint32_t prev;
+	uint32_t next;
+	uint32_t *head;
+
+	uint64_t expires;
+	uint64_t interval;
+	MTY_TimerFunc func;
+	void *opaque;
+
+	uint8_t gen;
+	uint8_t state;
+	bool cancel;
+};
+
+struct MTY_TimerWheel {
+	float resolution;
+	MTY_Time last;
+	double elapsed;
+	uint64_t tick;
+	uint32_t count;
+
+	// Links are node index + 1, 0 terminates a list
+	uint32_t slots[TIMER_LEVELS][TIMER_BASE_SIZE];
+	uint32_t due;
+	uint32_t due_tail;
+
+	struct timer_node *nodes;
+	uint32_t nodes_len;
+	uint32_t free;
+
+	MTY_Mutex *mutex;
+	MTY_Waitable *sync;
+	MTY_Thread *thread;
+	MTY_Atomic32 running;
+};
+
+
+// Node lists
+
+#define timer_node(ctx, link) \
+	(&(ctx)->nodes[(link) - 1])
+
+static void timer_link(MTY_TimerWheel *ctx, uint32_t *head, uint32_t link)
+{
+	struct timer_node *node = timer_node(ctx, link);
+
+	node->head = head;
+	node->prev = 0;
+	node->next = *head;
+
+	if (*head)
+		timer_node(ctx, *head)->prev = link;
+
+	*head = link;
+}
+
+static void timer_unlink(MTY_TimerWheel *ctx, uint32_t link)
+{
+	struct timer_node *node = timer_node(ctx, link);
+
+	if (node->prev) {
+		timer_node(ctx, node->prev)->next = node->next;
+
+	} else {
+		*node->head = node->next;
+	}
+
+	if (node->next)
+		timer_node(ctx, node->next)->prev = node->prev;
+
+	if (node->head == &ctx->due && ctx->due_tail == link)
+		ctx->due_tail = node->prev;
+
+	node->head = NULL;
+	node->prev = node->next = 0;
+}
+
+static void timer_append_due(MTY_TimerWheel *ctx, uint32_t link)
+{
+	struct timer_node *node = timer_node(ctx, link);
+
+	node->head = &ctx->due;
+	node->prev = ctx->due_tail;
+	node->next = 0;
+	node->state = TIMER_DUE;
+
+	if (ctx->due_tail) {
+		timer_node(ctx, ctx->due_tail)->next = link;
+
+	} else {
+		ctx->due = link;
+	}
+
+	ctx->due_tail = link;
+}
+
+static uint32_t timer_alloc(MTY_TimerWheel *ctx)
+{
+	if (!ctx->free) {
+		uint32_t len = ctx->nodes_len == 0 ? 64 : ctx->nodes_len * 2;
+		if (len > TIMER_INDEX_MASK)
+			len = TIMER_INDEX_MASK;
+
+		if (len == ctx->nodes_len)
+			return 0;
+
+		ctx->nodes = MTY_Realloc(ctx->nodes, len, sizeof(struct timer_node));
+
+		for (uint32_t x = len; x > ctx->nodes_len; x--) {
+			struct timer_node *node = timer_node(ctx, x);
+			memset(node, 0, sizeof(struct timer_node));
+
+			node->next = ctx->free;
+			ctx->free = x;
+		}
+
+		ctx->nodes_len = len;
+	}
+
+	uint32_t link = ctx->free;
+	ctx->free = timer_node(ctx, link)->next;
+
+	ctx->count++;
+
+	return link;
+}
+
+static void timer_release(MTY_TimerWheel *ctx, uint32_t link)
+{
+	struct timer_node *node = timer_node(ctx, link);
+
+	node->state = TIMER_FREE;
+	node->gen++;
+	node->func = NULL;
+	node->opaque = NULL;
+	node->head = NULL;
+	node->prev = 0;
+	node->next = ctx->free;
+
+	ctx->free = link;
+	ctx->count--;
+}
+
+static uint32_t timer_id(MTY_TimerWheel *ctx, uint32_t link)
+{
+	return ((uint32_t) timer_node(ctx, link)->gen << TIMER_INDEX_BITS) | link;
+}
+
+static uint32_t timer_lookup(MTY_TimerWheel *ctx, uint32_t id)
+{
+	uint32_t link = id & TIMER_INDEX_MASK;
+
+	if (link == 0 || link > ctx->nodes_len)
+		return 0;
+
+	struct timer_node *node = timer_node(ctx, link);
+
+	if (node->state == TIMER_FREE || node->gen != ((id >> TIMER_INDEX_BITS) & TIMER_GEN_MASK))
+		return 0;
+
+	return link;
+}
+
+
+// Wheel
+
+static double timer_elapsed(MTY_TimerWheel *ctx)
+{
+	// Accumulate short differences so float precision does not degrade over time
+	MTY_Time now = MTY_GetTime();
+	float diff = MTY_TimeDiff(ctx->last, now);
+
+	if (diff > 0.0f) {
+		ctx->elapsed += diff;
+		ctx->last = now;
+	}
+
+	return ctx->elapsed;
+}
+
+static uint64_t timer_now(MTY_TimerWheel *ctx)
+{
+	return (uint64_t) (timer_elapsed(ctx) / ctx->resolution);
+}
+
+static void timer_insert(MTY_TimerWheel *ctx, uint32_t link)
+{
+	struct timer_node *node = timer_node(ctx, link);
+
+	// Anything already expired fires on the very next tick
+	if (node->expires <= ctx->tick)
+		node->expires = ctx->tick + 1;
+
+	uint64_t expires = node->expires;
+	uint64_t delta = expires - ctx->tick;
+
+	if (delta >= TIMER_RANGE) {
+		expires = ctx->tick + TIMER_RANGE - 1;
+		delta = TIMER_RANGE - 1;
+	}
+
+	uint8_t level = 0;
+	for (; level < TIMER_LEVELS - 1; level++)
+		if (delta < (uint64_t) 1 << TIMER_SHIFT(level + 1))
+			break;
+
+	uint32_t mask = level == 0 ? TIMER_BASE_MASK : TIMER_LEVEL_MASK;
+	uint32_t index = (uint32_t) (expires >> TIMER_SHIFT(level)) & mask;
+
+	node->state = TIMER_ARMED;
+	timer_link(ctx, &ctx->slots[level][index], link);
+}
+
+static uint32_t timer_cascade(MTY_TimerWheel *ctx, uint8_t level)
+{
+	uint32_t index = (uint32_t) (ctx->tick >> TIMER_SHIFT(level)) & TIMER_LEVEL_MASK;
+
+	uint32_t link = ctx->slots[level][index];
+	ctx->slots[level][index] = 0;
+
+	while (link) {
+		uint32_t next = timer_node(ctx, link)->next;
+
+		// Timers due on this tick go in the base slot that is about to be processed
+		if (timer_node(ctx, link)->expires <= ctx->tick) {
+			timer_link(ctx, &ctx->slots[0][ctx->tick & TIMER_BASE_MASK], link);
+
+		} else {
+			timer_insert(ctx, link);
+		}
+
+		link = next;
+	}
+
+	return index;
+}
+
+static void timer_advance(MTY_TimerWheel *ctx)
+{
+	ctx->tick++;
+
+	uint32_t index = (uint32_t) ctx->tick & TIMER_BASE_MASK;
+
+	if (index == 0)
+		for (uint8_t x = 1; x < TIMER_LEVELS && timer_cascade(ctx, x) == 0; x++);
+
+	uint32_t link = ctx->slots[0][index];
+	ctx->slots[0][index] = 0;
+
+	while (link) {
+		uint32_t next = timer_node(ctx, link)->next;
+		timer_append_due(ctx, link);
+		link = next;
+	}
+}
+
+static int32_t timer_timeout(MTY_TimerWheel *ctx)
+{
+	if (ctx->due)
+		return 0;
+
+	if (ctx->count == 0)
+		return -1;
+
+	// Scan the base wheel up to the next cascade, which may pull in earlier timers
+	uint64_t tick = ctx->tick + 1;
+
+	for (; (tick & TIMER_BASE_MASK) != 0; tick++)
+		if (ctx->slots[0][tick & TIMER_BASE_MASK])
+			break;
+
+	double ms = (double) tick * ctx->resolution - timer_elapsed(ctx);
+
+	return ms > 0.0 ? (int32_t) (ms + 0.999) : 0;
+}
+
+static uint32_t timer_fire(MTY_TimerWheel *ctx)
+{
+	uint32_t fired = 0;
+
+	for (; ctx->due; fired++) {
+		uint32_t link = ctx->due;
+		struct timer_node *node = timer_node(ctx, link);
+
+		timer_unlink(ctx, link);
+		node->state = TIMER_FIRING;
+
+		MTY_TimerFunc func = node->func;
+		void *opaque = node->opaque;
+		uint32_t id = timer_id(ctx, link);
+
+		MTY_MutexUnlock(ctx->mutex);
+		func(id, opaque);
+		MTY_MutexLock(ctx->mutex);
+
+		// The node array may have moved while unlocked
+		node = timer_node(ctx, link);
+
+		if (node->cancel || node->interval == 0) {
+			timer_release(ctx, link);
+
+		} else {
+			// Periodic timers keep their phase, skipping any intervals that were missed
+			node->expires += node->interval;
+
+			if (node->expires <= ctx->tick)
+				node->expires = ctx->tick + node->interval;
+
+			timer_insert(ctx, link);
+		}
+	}
+
+	return fired;
+}
+
+static uint32_t timer_poll(MTY_TimerWheel *ctx)
+{
+	uint64_t now = timer_now(ctx);
+
+	while (ctx->tick < now) {
+		if (ctx->count == 0) {
+			ctx->tick = now;
+			break;
+		}
+
+		timer_advance(ctx);
+	}
+
+	return timer_fire(ctx);
+}
+
+
+// Dispatch thread
+
+static void *timer_thread(void *opaque)
+{
+	MTY_TimerWheel *ctx = opaque;
+
+	while (MTY_Atomic32Get(&ctx->running)) {
+		MTY_MutexLock(ctx->mutex);
+		int32_t timeout = timer_timeout(ctx);
+		MTY_MutexUnlock(ctx->mutex);
+
+		if (timeout != 0)
+			MTY_WaitableWait(ctx->sync, timeout);
+
+		if (!MTY_Atomic32Get(&ctx->running))
+			break;
+
+		MTY_MutexLock(ctx->mutex);
+		timer_poll(ctx);
+		MTY_MutexUnlock(ctx->mutex);
+	}
+
+	return NULL;
+}
+
+
+// Public
+
+MTY_TimerWheel *MTY_TimerWheelCreate(uint32_t resolution, bool thread)
+{
+	MTY_TimerWheel *ctx = MTY_Alloc(1, sizeof(MTY_TimerWheel));
+
+	ctx->resolution = (float) (resolution > 0 ? resolution : 1);
+	ctx->last = MTY_GetTime();
+	ctx->mutex = MTY_MutexCreate();
+
+	if (thread) {
+		ctx->sync = MTY_WaitableCreate();
+
+		MTY_Atomic32Set(&ctx->running, 1);
+		ctx->thread = MTY_ThreadCreate(timer_thread, ctx);
+	}
+
+	return ctx;
+}
+
+void MTY_TimerWheelDestroy(MTY_TimerWheel **wheel)
+{
+	if (!wheel || !*wheel)
+		return;
+
+	MTY_TimerWheel *ctx = *wheel;
+
+	if (ctx->thread) {
+		MTY_Atomic32Set(&ctx->running, 0);
+		MTY_WaitableSignal(ctx->sync);
+		MTY_ThreadDestroy(&ctx->thread);
+	}
+
+	MTY_WaitableDestroy(&ctx->sync);
+	MTY_MutexDestroy(&ctx->mutex);
+
+	MTY_Free(ctx->nodes);
+
+	MTY_Free(ctx);
+	*wheel = NULL;
+}
+
+uint32_t MTY_TimerWheelSet(MTY_TimerWheel *ctx, uint32_t timeout, uint32_t interval,
+	MTY_TimerFunc func, void *opaque)
+{
+	MTY_MutexLock(ctx->mutex);
+
+	// An empty wheel is not advanced by polling, so catch it up before arming
+	if (ctx->count == 0)
+		ctx->tick = timer_now(ctx);
+
+	uint32_t id = 0;
+	uint32_t link = timer_alloc(ctx);
+
+	if (link) {
+		struct timer_node *node = timer_node(ctx, link);
+		node->func = func;
+		node->opaque = opaque;
+		node->cancel = false;
+
+		// Round up so a timer never fires before its timeout has elapsed
+		uint64_t ticks = (uint64_t) (((float) timeout + ctx->resolution - 1.0f) / ctx->resolution);
+		node->expires = timer_now(ctx) + (ticks > 0 ? ticks : 1);
+
+		if (interval > 0) {
+			node->interval = (uint64_t) (((float) interval + ctx->resolution - 1.0f) / ctx->resolution);
+
+			if (node->interval == 0)
+				node->interval = 1;
+
+		} else {
+			node->interval = 0;
+		}
+
+		timer_insert(ctx, link);
+		id = timer_id(ctx, link);
+
+	} else {
+		MTY_Log("Maximum number of timers (%u) exceeded", TIMER_INDEX_MASK);
+	}
+
+	MTY_MutexUnlock(ctx->mutex);
+
+	if (id && ctx->sync)
+		MTY_WaitableSignal(ctx->sync);
+
+	return id;
+}
+
+bool MTY_TimerWheelCancel(MTY_TimerWheel *ctx, uint32_t id)
+{
+	MTY_MutexLock(ctx->mutex);
+
+	bool r = false;
+	uint32_t link = timer_lookup(ctx, id);
+
+	if (link) {
+		struct timer_node *node = timer_node(ctx, link);
+
+		switch (node->state) {
+			case TIMER_ARMED:
+			case TIMER_DUE:
+				timer_unlink(ctx, link);
+				timer_release(ctx, link);
+				r = true;
+				break;
+			case TIMER_FIRING:
+				// A one-shot timer in its callback has already fired
+				r = node->interval > 0 && !node->cancel;
+				node->cancel = true;
+				break;
+		}
+	}
+
+	MTY_MutexUnlock(ctx->mutex);
+
+	return r;
+}
+
+uint32_t MTY_TimerWheelPoll(MTY_TimerWheel *ctx)
+{
+	MTY_MutexLock(ctx->mutex);
+
+	uint32_t fired = timer_poll(ctx);
+
+	MTY_MutexUnlock(ctx->mutex);
+
+	return fired;
+}
+
+int32_t MTY_TimerWheelGetTimeout(MTY_TimerWheel *ctx)
+{
+	MTY_MutexLock(ctx->mutex);
+
+	int32_t timeout = timer_timeout(ctx);
+
+	MTY_MutexUnlock(ctx->mutex);
+
+	return timeout;
+}
+
+uint32_t MTY_TimerWheelGetLength(MTY_TimerWheel *ctx)
+{
+	MTY_MutexLock(ctx->mutex);
+
+	uint32_t count = ctx->count;
+
+	MTY_MutexUnlock(ctx->mutex);
+
+	return count;
+}
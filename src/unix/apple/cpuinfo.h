@@ -0,0 +1,56 @@
+// Copyright (c) Christopher D. Dickson <cdd@matoya.group>
+//
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+#pragma once
+
+#include <sys/types.h>
+#include <sys/sysctl.h>
+
+static uint32_t cpuinfo_sysctl(const char *name)
+{
+	uint64_t val = 0;
+	size_t size = sizeof(val);
+
+	// Values are either 32 or 64 bit depending on the key, both little endian
+	if (sysctlbyname(name, &val, &size, NULL, 0) != 0)
+		return 0;
+
+	return (uint32_t) val;
+}
+
+static void mty_cpu_get_os_info(MTY_CPUInfo *info)
+{
+	info->cacheLine = cpuinfo_sysctl("hw.cachelinesize");
+	info->l1Size = cpuinfo_sysctl("hw.l1dcachesize");
+	info->l2Size = cpuinfo_sysctl("hw.l2cachesize");
+	info->l3Size = cpuinfo_sysctl("hw.l3cachesize");
+	info->cores = cpuinfo_sysctl("hw.physicalcpu");
+	info->threads = cpuinfo_sysctl("hw.logicalcpu");
+
+	#if defined(__aarch64__)
+		if (cpuinfo_sysctl("hw.optional.neon"))
+			info->features |= MTY_CPU_NEON;
+
+		if (cpuinfo_sysctl("hw.optional.armv8_crc32"))
+			info->features |= MTY_CPU_CRC32;
+
+		if (cpuinfo_sysctl("hw.optional.arm.FEAT_AES"))
+			info->features |= MTY_CPU_ARM_AES;
+
+		if (cpuinfo_sysctl("hw.optional.arm.FEAT_PMULL"))
+			info->features |= MTY_CPU_PMULL;
+
+		if (cpuinfo_sysctl("hw.optional.arm.FEAT_SHA256"))
+			info->features |= MTY_CPU_ARM_SHA;
+	#endif
+}
+
+static bool mty_cpu_get_os_topology(MTY_CPUTopology *topo)
+{
+	// Core and cache layout is not exposed per logical processor, a flat
+	// topology is used
+	return false;
+}
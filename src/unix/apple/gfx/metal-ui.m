@@ -213,6 +213,16 @@ void *mty_metal_ui_create_texture(MTY_Device *device, const void *rgba, uint32_t
 	return (void *) CFBridgingRetain(texture);
 }
 
+bool mty_metal_ui_update_texture(MTY_Device *device, MTY_Context *context, void *texture,
+	const void *rgba, uint32_t stride, uint32_t x, uint32_t y, uint32_t width, uint32_t height)
+{
+	id<MTLTexture> mtexture = (__bridge id<MTLTexture>) texture;
+
+	[mtexture replaceRegion:MTLRegionMake2D(x, y, width, height) mipmapLevel:0 withBytes:rgba bytesPerRow:stride * 4];
+
+	return true;
+}
+
 void mty_metal_ui_destroy_texture(void **texture)
 {
 	if (!texture || !*texture)
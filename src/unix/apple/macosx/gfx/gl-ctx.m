@@ -176,6 +176,13 @@ bool mty_gl_ctx_has_ui_texture(struct gfx_ctx *gfx_ctx, uint32_t id)
 	return MTY_RendererHasUITexture(ctx->renderer, id);
 }
 
+void mty_gl_ctx_set_ui_atlas(struct gfx_ctx *gfx_ctx, uint32_t page_size)
+{
+	struct gl_ctx *ctx = (struct gl_ctx *) gfx_ctx;
+
+	MTY_RendererSetUIAtlas(ctx->renderer, page_size);
+}
+
 bool mty_gl_ctx_make_current(struct gfx_ctx *gfx_ctx, bool current)
 {
 	struct gl_ctx *ctx = (struct gl_ctx *) gfx_ctx;
@@ -190,3 +197,12 @@ bool mty_gl_ctx_make_current(struct gfx_ctx *gfx_ctx, bool current)
 
 	return true;
 }
+
+void mty_gl_ctx_set_frames_in_flight(struct gfx_ctx *gfx_ctx, uint32_t frames)
+{
+}
+
+bool mty_gl_ctx_get_present_stats(struct gfx_ctx *gfx_ctx, MTY_PresentStats *stats)
+{
+	return false;
+}
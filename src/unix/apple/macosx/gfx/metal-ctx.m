@@ -179,7 +179,23 @@ bool mty_metal_ctx_has_ui_texture(struct gfx_ctx *gfx_ctx, uint32_t id)
 	return MTY_RendererHasUITexture(ctx->renderer, id);
 }
 
+void mty_metal_ctx_set_ui_atlas(struct gfx_ctx *gfx_ctx, uint32_t page_size)
+{
+	struct metal_ctx *ctx = (struct metal_ctx *) gfx_ctx;
+
+	MTY_RendererSetUIAtlas(ctx->renderer, page_size);
+}
+
 bool mty_metal_ctx_make_current(struct gfx_ctx *gfx_ctx, bool current)
 {
 	return false;
 }
+
+void mty_metal_ctx_set_frames_in_flight(struct gfx_ctx *gfx_ctx, uint32_t frames)
+{
+}
+
+bool mty_metal_ctx_get_present_stats(struct gfx_ctx *gfx_ctx, MTY_PresentStats *stats)
+{
+	return false;
+}
@@ -5,6 +5,7 @@
 // You can obtain one at https://spdx.org/licenses/MIT.html.
 
 #include "hid/hid.h"
+#include "hid/replay.h"
 
 #include <IOKit/hid/IOHIDManager.h>
 #include <IOKit/hid/IOHIDKeys.h>
@@ -89,6 +90,7 @@ static void hid_disconnect(void *context, IOReturn result, void *sender, IOHIDDe
 
 	struct hid_dev *dev = MTY_HashPopInt(ctx->devices, (intptr_t) device);
 	if (dev) {
+		mty_hid_record_disconnect(dev->id);
 		ctx->disconnect(dev, ctx->opaque);
 
 		MTY_HashPopInt(ctx->devices_rev, dev->id);
@@ -0,0 +1,11 @@
+// Copyright (c) Christopher D. Dickson <cdd@matoya.group>
+//
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+#pragma once
+
+// Give threads created by libmatoya an alternate signal stack once crash handling is set
+void mty_crash_thread_start(void);
+void mty_crash_thread_end(void);
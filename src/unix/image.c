@@ -34,17 +34,23 @@
 #include "stb_image_write.h"
 
 struct image_write {
-	void *output;
+	uint8_t *output;
 	size_t size;
+	size_t cap;
 };
 
 static void image_compress_write_func(void *context, void *data, int size)
 {
 	struct image_write *ctx = (struct image_write *) context;
-	ctx->size = size;
 
-	ctx->output = MTY_Alloc(ctx->size, 1);
-	memcpy(ctx->output, data, ctx->size);
+	// The JPEG writer emits many small writes
+	if (ctx->size + size > ctx->cap) {
+		ctx->cap = (ctx->size + size) * 2;
+		ctx->output = MTY_Realloc(ctx->output, ctx->cap, 1);
+	}
+
+	memcpy(ctx->output + ctx->size, data, size);
+	ctx->size += size;
 }
 
 void *MTY_CompressImage(MTY_ImageCompression method, const void *input, uint32_t width,
@@ -54,11 +60,18 @@ void *MTY_CompressImage(MTY_ImageCompression method, const void *input, uint32_t
 	int32_t e = 0;
 
 	switch (method) {
-		case MTY_IMAGE_COMPRESSION_PNG:
-			e = stbi_write_png_to_func(image_compress_write_func, &ctx, width, height, 4, input, width * 4);
+		case MTY_IMAGE_COMPRESSION_PNG: {
+			// The PNG writer produces a single buffer, return it directly
+			int32_t len = 0;
+			ctx.output = stbi_write_png_to_mem(input, width * 4, width, height, 4, &len);
+			ctx.size = len;
+			e = ctx.output != NULL;
 			break;
+		}
 		case MTY_IMAGE_COMPRESSION_JPEG:
 			// Quality defaults to 90
+			ctx.cap = width * height / 4 + 1024;
+			ctx.output = MTY_Alloc(ctx.cap, 1);
 			e = stbi_write_jpg_to_func(image_compress_write_func, &ctx, width, height, 4, input, 0);
 			break;
 		default:
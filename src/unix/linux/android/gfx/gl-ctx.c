@@ -326,6 +326,15 @@ bool mty_gl_ctx_has_ui_texture(struct gfx_ctx *gfx_ctx, uint32_t id)
 	return r;
 }
 
+void mty_gl_ctx_set_ui_atlas(struct gfx_ctx *gfx_ctx, uint32_t page_size)
+{
+	struct gl_ctx *ctx = (struct gl_ctx *) gfx_ctx;
+
+	MTY_MutexLock(ctx->mutex);
+	MTY_RendererSetUIAtlas(ctx->renderer, page_size);
+	MTY_MutexUnlock(ctx->mutex);
+}
+
 bool mty_gl_ctx_make_current(struct gfx_ctx *gfx_ctx, bool current)
 {
 	struct gl_ctx *ctx = (struct gl_ctx *) gfx_ctx;
@@ -347,3 +356,12 @@ bool mty_gl_ctx_make_current(struct gfx_ctx *gfx_ctx, bool current)
 
 	return r;
 }
+
+void mty_gl_ctx_set_frames_in_flight(struct gfx_ctx *gfx_ctx, uint32_t frames)
+{
+}
+
+bool mty_gl_ctx_get_present_stats(struct gfx_ctx *gfx_ctx, MTY_PresentStats *stats)
+{
+	return false;
+}
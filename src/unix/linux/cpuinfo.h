@@ -0,0 +1,294 @@
+// Copyright (c) Christopher D. Dickson <cdd@matoya.group>
+//
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+#pragma once
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/auxv.h>
+
+#define CPUINFO_SYSFS "/sys/devices/system/cpu"
+#define CPUINFO_NODE  "/sys/devices/system/node"
+#define CPUINFO_LIST  4096
+#define CPUINFO_MAX   8192
+
+static bool cpuinfo_read(const char *path, char *buf, size_t size)
+{
+	int32_t fd = open(path, O_RDONLY);
+	if (fd == -1)
+		return false;
+
+	ssize_t n = read(fd, buf, size - 1);
+	close(fd);
+
+	if (n <= 0)
+		return false;
+
+	buf[n] = '\0';
+
+	return true;
+}
+
+static uint32_t cpuinfo_read_uint(const char *path)
+{
+	char buf[32];
+	if (!cpuinfo_read(path, buf, sizeof(buf)))
+		return 0;
+
+	char *end = NULL;
+	uint32_t val = strtoul(buf, &end, 10);
+
+	// Cache sizes are reported as i.e. "48K"
+	if (*end == 'K')
+		val *= 1024;
+
+	if (*end == 'M')
+		val *= 1024 * 1024;
+
+	return val;
+}
+
+static uint32_t cpuinfo_parse_list(const char *list, uint32_t *ids, uint32_t max)
+{
+	// Lists are formatted as i.e. "0-3,8,10-11"
+	uint32_t n = 0;
+
+	while (*list >= '0' && *list <= '9') {
+		char *end = NULL;
+		uint32_t lo = strtoul(list, &end, 10);
+		uint32_t hi = lo;
+
+		if (*end == '-')
+			hi = strtoul(end + 1, &end, 10);
+
+		for (uint32_t x = lo; x <= hi && n < max; x++)
+			ids[n++] = x;
+
+		list = *end == ',' ? end + 1 : end;
+	}
+
+	return n;
+}
+
+static void cpuinfo_get_caches(MTY_CPUInfo *info)
+{
+	char path[128];
+	char type[32];
+
+	for (uint32_t x = 0; x < 16; x++) {
+		snprintf(path, sizeof(path), CPUINFO_SYSFS "/cpu0/cache/index%u/type", x);
+		if (!cpuinfo_read(path, type, sizeof(type)))
+			break;
+
+		if (type[0] == 'I')
+			continue;
+
+		snprintf(path, sizeof(path), CPUINFO_SYSFS "/cpu0/cache/index%u/level", x);
+		uint32_t level = cpuinfo_read_uint(path);
+
+		snprintf(path, sizeof(path), CPUINFO_SYSFS "/cpu0/cache/index%u/size", x);
+		uint32_t size = cpuinfo_read_uint(path);
+
+		if (level == 1) {
+			info->l1Size = size;
+
+			snprintf(path, sizeof(path), CPUINFO_SYSFS "/cpu0/cache/index%u/coherency_line_size", x);
+			info->cacheLine = cpuinfo_read_uint(path);
+
+		} else if (level == 2) {
+			info->l2Size = size;
+
+		} else if (level == 3) {
+			info->l3Size = size;
+		}
+	}
+}
+
+static void cpuinfo_get_topology(MTY_CPUInfo *info)
+{
+	char *buf = MTY_Alloc(CPUINFO_LIST, 1);
+	uint32_t *ids = MTY_Alloc(CPUINFO_MAX, sizeof(uint32_t));
+
+	// Online CPUs need not be numbered contiguously from 0
+	if (cpuinfo_read(CPUINFO_SYSFS "/online", buf, CPUINFO_LIST))
+		info->threads = cpuinfo_parse_list(buf, ids, CPUINFO_MAX);
+
+	if (info->threads == 0) {
+		long n = sysconf(_SC_NPROCESSORS_ONLN);
+		info->threads = n > 0 ? n : 1;
+
+		for (uint32_t x = 0; x < info->threads && x < CPUINFO_MAX; x++)
+			ids[x] = x;
+	}
+
+	// A physical core is counted once via the first logical CPU of its siblings
+	char path[128];
+
+	for (uint32_t x = 0; x < info->threads && x < CPUINFO_MAX; x++) {
+		snprintf(path, sizeof(path), CPUINFO_SYSFS "/cpu%u/topology/thread_siblings_list", ids[x]);
+
+		if (cpuinfo_read(path, buf, CPUINFO_LIST) && strtoul(buf, NULL, 10) == ids[x])
+			info->cores++;
+	}
+
+	MTY_Free(ids);
+	MTY_Free(buf);
+}
+
+static void cpuinfo_get_hwcaps(MTY_CPUInfo *info)
+{
+	#if defined(__aarch64__)
+		unsigned long hwcap = getauxval(AT_HWCAP);
+
+		if (hwcap & (1 << 1)) // HWCAP_ASIMD
+			info->features |= MTY_CPU_NEON;
+
+		if (hwcap & (1 << 3)) // HWCAP_AES
+			info->features |= MTY_CPU_ARM_AES;
+
+		if (hwcap & (1 << 4)) // HWCAP_PMULL
+			info->features |= MTY_CPU_PMULL;
+
+		if ((hwcap & (1 << 5)) && (hwcap & (1 << 6))) // HWCAP_SHA1, HWCAP_SHA2
+			info->features |= MTY_CPU_ARM_SHA;
+
+		if (hwcap & (1 << 7)) // HWCAP_CRC32
+			info->features |= MTY_CPU_CRC32;
+
+	#elif defined(__arm__)
+		unsigned long hwcap = getauxval(AT_HWCAP);
+		unsigned long hwcap2 = getauxval(AT_HWCAP2);
+
+		if (hwcap & (1 << 12)) // HWCAP_NEON
+			info->features |= MTY_CPU_NEON;
+
+		if (hwcap2 & (1 << 0)) // HWCAP2_AES
+			info->features |= MTY_CPU_ARM_AES;
+
+		if (hwcap2 & (1 << 1)) // HWCAP2_PMULL
+			info->features |= MTY_CPU_PMULL;
+
+		if ((hwcap2 & (1 << 2)) && (hwcap2 & (1 << 3))) // HWCAP2_SHA1, HWCAP2_SHA2
+			info->features |= MTY_CPU_ARM_SHA;
+
+		if (hwcap2 & (1 << 4)) // HWCAP2_CRC32
+			info->features |= MTY_CPU_CRC32;
+	#endif
+}
+
+static uint32_t cpuinfo_read_first(const char *path, uint32_t fallback)
+{
+	char buf[32];
+	if (!cpuinfo_read(path, buf, sizeof(buf)) || buf[0] < '0' || buf[0] > '9')
+		return fallback;
+
+	return strtoul(buf, NULL, 10);
+}
+
+static int32_t cpuinfo_get_llc_index(void)
+{
+	char path[128];
+	char type[32];
+
+	int32_t index = -1;
+	uint32_t max = 0;
+
+	for (uint32_t x = 0; x < 16; x++) {
+		snprintf(path, sizeof(path), CPUINFO_SYSFS "/cpu0/cache/index%u/type", x);
+		if (!cpuinfo_read(path, type, sizeof(type)))
+			break;
+
+		if (type[0] == 'I')
+			continue;
+
+		snprintf(path, sizeof(path), CPUINFO_SYSFS "/cpu0/cache/index%u/level", x);
+		uint32_t level = cpuinfo_read_uint(path);
+
+		if (level > max) {
+			max = level;
+			index = x;
+		}
+	}
+
+	return index;
+}
+
+static bool mty_cpu_get_os_topology(MTY_CPUTopology *topo)
+{
+	char *buf = MTY_Alloc(CPUINFO_LIST, 1);
+	uint32_t *ids = MTY_Alloc(CPUINFO_MAX, sizeof(uint32_t));
+
+	bool r = cpuinfo_read(CPUINFO_SYSFS "/online", buf, CPUINFO_LIST);
+	if (!r)
+		goto except;
+
+	topo->numCPUs = cpuinfo_parse_list(buf, ids, CPUINFO_MAX);
+	topo->cpus = MTY_Alloc(topo->numCPUs, sizeof(MTY_LogicalCPU));
+
+	int32_t llc = cpuinfo_get_llc_index();
+	char path[128];
+
+	// Cores and cache groups are keyed by the first logical CPU sharing them,
+	// keys are made dense by the caller
+	for (uint32_t x = 0; x < topo->numCPUs; x++) {
+		MTY_LogicalCPU *cpu = &topo->cpus[x];
+		cpu->id = ids[x];
+
+		snprintf(path, sizeof(path), CPUINFO_SYSFS "/cpu%u/topology/thread_siblings_list", cpu->id);
+		if (cpuinfo_read(path, buf, CPUINFO_LIST)) {
+			uint32_t n = cpuinfo_parse_list(buf, ids + topo->numCPUs, CPUINFO_MAX - topo->numCPUs);
+			cpu->core = n > 0 ? ids[topo->numCPUs] : cpu->id;
+
+			for (uint32_t y = 0; y < n; y++)
+				if (ids[topo->numCPUs + y] == cpu->id)
+					cpu->smt = y;
+
+		} else {
+			cpu->core = cpu->id;
+		}
+
+		if (llc >= 0) {
+			snprintf(path, sizeof(path), CPUINFO_SYSFS "/cpu%u/cache/index%d/shared_cpu_list", cpu->id, llc);
+			cpu->llc = cpuinfo_read_first(path, 0);
+		}
+	}
+
+	// Kernels without NUMA support have no node directory, everything is node 0
+	if (cpuinfo_read(CPUINFO_NODE "/online", buf, CPUINFO_LIST)) {
+		uint32_t num_nodes = cpuinfo_parse_list(buf, ids, CPUINFO_MAX);
+		uint32_t *cpus = ids + num_nodes;
+
+		for (uint32_t x = 0; x < num_nodes; x++) {
+			snprintf(path, sizeof(path), CPUINFO_NODE "/node%u/cpulist", ids[x]);
+			if (!cpuinfo_read(path, buf, CPUINFO_LIST))
+				continue;
+
+			uint32_t n = cpuinfo_parse_list(buf, cpus, CPUINFO_MAX - num_nodes);
+
+			for (uint32_t y = 0; y < n; y++)
+				for (uint32_t z = 0; z < topo->numCPUs; z++)
+					if (topo->cpus[z].id == cpus[y])
+						topo->cpus[z].node = ids[x];
+		}
+	}
+
+	except:
+
+	MTY_Free(ids);
+	MTY_Free(buf);
+
+	return r && topo->numCPUs > 0;
+}
+
+static void mty_cpu_get_os_info(MTY_CPUInfo *info)
+{
+	cpuinfo_get_caches(info);
+	cpuinfo_get_topology(info);
+	cpuinfo_get_hwcaps(info);
+}
@@ -15,6 +15,7 @@
 #include <unistd.h>
 
 #include "dl/libX11.h"
+#include "hid/hid.h"
 #include "hid/utils.h"
 #include "wsize.h"
 #include "evdev.h"
@@ -49,6 +50,8 @@ struct MTY_App {
 	MTY_Hash *hotkey;
 	MTY_Mutex *mutex;
 	struct evdev *evdev;
+	struct hid *hid;
+	MTY_Hash *evdev_shown;
 	struct window *windows[MTY_WINDOW_MAX];
 	uint32_t timeout;
 	MTY_Time suspend_ts;
@@ -479,6 +482,74 @@ static void app_event(MTY_App *ctx, XEvent *event)
 
 // App
 
+static void app_evdev_hide(MTY_App *ctx, uint16_t vid, uint16_t pid)
+{
+	uint64_t iter = 0;
+
+	for (int64_t id = 0; MTY_HashGetNextKeyInt(ctx->evdev_shown, &iter, &id);) {
+		MTY_ControllerEvent *c = MTY_HashGetInt(ctx->evdev_shown, id);
+
+		if (c->vid == vid && c->pid == pid) {
+			MTY_Event evt = {0};
+			evt.type = MTY_EVENT_DISCONNECT;
+			evt.controller = *c;
+
+			ctx->event_func(&evt, ctx->opaque);
+
+			MTY_Free(MTY_HashPopInt(ctx->evdev_shown, id));
+			iter = 0;
+		}
+	}
+}
+
+static void app_hid_connect(struct hid_dev *device, void *opaque)
+{
+	MTY_App *ctx = opaque;
+
+	mty_hid_driver_init(device);
+
+	uint16_t vid = mty_hid_device_get_vid(device);
+	uint16_t pid = mty_hid_device_get_pid(device);
+
+	// hidraw takes over from evdev, which may have seen the device first on hotplug
+	app_evdev_hide(ctx, vid, pid);
+
+	MTY_Event evt = {0};
+	evt.type = MTY_EVENT_CONNECT;
+	evt.controller.vid = vid;
+	evt.controller.pid = pid;
+	evt.controller.id = mty_hid_device_get_id(device);
+
+	ctx->event_func(&evt, ctx->opaque);
+}
+
+static void app_hid_disconnect(struct hid_dev *device, void *opaque)
+{
+	MTY_App *ctx = opaque;
+
+	MTY_Event evt = {0};
+	evt.type = MTY_EVENT_DISCONNECT;
+	evt.controller.vid = mty_hid_device_get_vid(device);
+	evt.controller.pid = mty_hid_device_get_pid(device);
+	evt.controller.id = mty_hid_device_get_id(device);
+
+	ctx->event_func(&evt, ctx->opaque);
+}
+
+static void app_hid_report(struct hid_dev *device, const void *buf, size_t size, void *opaque)
+{
+	MTY_App *ctx = opaque;
+
+	MTY_Event evt = {0};
+	evt.type = MTY_EVENT_CONTROLLER;
+
+	if (mty_hid_driver_state(device, buf, size, &evt.controller)) {
+		// Prevent gamepad input while in the background
+		if (evt.type != MTY_EVENT_NONE && MTY_AppIsActive(ctx))
+			ctx->event_func(&evt, ctx->opaque);
+	}
+}
+
 static void app_evdev_connect(struct evdev_dev *device, void *opaque)
 {
 	MTY_App *ctx = opaque;
@@ -488,6 +559,12 @@ static void app_evdev_connect(struct evdev_dev *device, void *opaque)
 	evt.controller = mty_evdev_state(device);
 	mty_hid_map_axes(&evt.controller);
 
+	// evdev is the fallback for devices hidraw could not open
+	if (ctx->hid && mty_hid_linux_has_device(ctx->hid, evt.controller.vid, evt.controller.pid))
+		return;
+
+	MTY_HashSetInt(ctx->evdev_shown, evt.controller.id, MTY_Dup(&evt.controller, sizeof(MTY_ControllerEvent)));
+
 	ctx->event_func(&evt, ctx->opaque);
 }
 
@@ -500,6 +577,12 @@ static void app_evdev_disconnect(struct evdev_dev *device, void *opaque)
 	evt.controller = mty_evdev_state(device);
 	mty_hid_map_axes(&evt.controller);
 
+	MTY_ControllerEvent *c = MTY_HashPopInt(ctx->evdev_shown, evt.controller.id);
+	if (!c)
+		return;
+
+	MTY_Free(c);
+
 	ctx->event_func(&evt, ctx->opaque);
 }
 
@@ -507,10 +590,11 @@ static void app_evdev_report(struct evdev_dev *device, void *opaque)
 {
 	MTY_App *ctx = opaque;
 
-	if (MTY_AppIsActive(ctx)) {
-		MTY_Event evt = {0};
+	MTY_Event evt = {0};
+	evt.controller = mty_evdev_state(device);
+
+	if (MTY_AppIsActive(ctx) && MTY_HashGetInt(ctx->evdev_shown, evt.controller.id)) {
 		evt.type = MTY_EVENT_CONTROLLER;
-		evt.controller = mty_evdev_state(device);
 		mty_hid_map_axes(&evt.controller);
 
 		ctx->event_func(&evt, ctx->opaque);
@@ -550,7 +634,9 @@ MTY_App *MTY_AppCreate(MTY_AppFunc appFunc, MTY_EventFunc eventFunc, void *opaqu
 	ctx->opaque = opaque;
 	ctx->class_name = MTY_Strdup(MTY_GetFileName(MTY_GetProcessPath(), false));
 
-	// This may return NULL
+	// These may return NULL
+	ctx->evdev_shown = MTY_HashCreate(0);
+	ctx->hid = mty_hid_create(app_hid_connect, app_hid_disconnect, app_hid_report, ctx);
 	ctx->evdev = mty_evdev_create(app_evdev_connect, app_evdev_disconnect, ctx);
 
 	ctx->display = XOpenDisplay(NULL);
@@ -621,7 +707,9 @@ void MTY_AppDestroy(MTY_App **app)
 		XCloseDisplay(ctx->display);
 
 	mty_evdev_destroy(&ctx->evdev);
+	mty_hid_destroy(&ctx->hid);
 
+	MTY_HashDestroy(&ctx->evdev_shown, MTY_Free);
 	MTY_HashDestroy(&ctx->hotkey, NULL);
 	MTY_MutexDestroy(&ctx->mutex);
 	MTY_Free(ctx->clip);
@@ -666,6 +754,10 @@ void MTY_AppRun(MTY_App *ctx)
 			app_event(ctx, &event);
 		}
 
+		// hidraw reports, polled first so known controllers are claimed before evdev sees them
+		if (ctx->hid)
+			mty_hid_linux_poll(ctx->hid);
+
 		// evdev events
 		if (ctx->evdev)
 			mty_evdev_poll(ctx->evdev, app_evdev_report);
@@ -923,13 +1015,20 @@ void MTY_AppSetOrientation(MTY_App *ctx, MTY_Orientation orientation)
 
 void MTY_AppRumbleController(MTY_App *ctx, uint32_t id, uint16_t low, uint16_t high)
 {
-	if (ctx->evdev)
+	if (ctx->hid && mty_hid_get_device_by_id(ctx->hid, id)) {
+		mty_hid_driver_rumble(ctx->hid, id, low, high);
+
+	} else if (ctx->evdev) {
 		mty_evdev_rumble(ctx->evdev, id, low, high);
+	}
 }
 
 const void *MTY_AppGetControllerTouchpad(MTY_App *ctx, uint32_t id, size_t *size)
 {
-	return NULL;
+	if (!ctx->hid)
+		return NULL;
+
+	return mty_hid_device_get_touchpad(ctx->hid, id, size);
 }
 
 bool MTY_AppIsPenEnabled(MTY_App *ctx)
@@ -6,17 +6,29 @@
 
 #include "matoya.h"
 
+#include <stdlib.h>
 #include <string.h>
 #include <math.h>
 
 #include "dl/libasound.h"
+#include "metrics.h"
 
 #define AUDIO_CHANNELS    2
 #define AUDIO_SAMPLE_SIZE sizeof(int16_t)
 #define AUDIO_BUF_SIZE    (48000 * AUDIO_CHANNELS * AUDIO_SAMPLE_SIZE)
+#define AUDIO_CHECK_MS    1000.0f
 
 struct MTY_Audio {
 	snd_pcm_t *pcm;
+	char *device;
+	MTY_AudioHardware hw;
+
+	MTY_AudioDeviceFunc func;
+	void *opaque;
+
+	bool fallback;
+	uint64_t cards;
+	MTY_Time check_ts;
 
 	bool playing;
 	uint32_t sample_rate;
@@ -26,25 +38,37 @@ struct MTY_Audio {
 	size_t pos;
 };
 
-MTY_Audio *MTY_AudioCreate(uint32_t sampleRate, uint32_t minBuffer, uint32_t maxBuffer)
+
+// Devices
+
+static uint64_t audio_get_cards(void)
 {
-	if (!libasound_global_init())
-		return NULL;
+	uint64_t cards = 0;
 
-	MTY_Audio *ctx = MTY_Alloc(1, sizeof(MTY_Audio));
-	ctx->sample_rate = sampleRate;
+	for (int32_t card = -1; snd_card_next(&card) == 0 && card >= 0;)
+		cards |= 1ull << (card & 63);
 
-	uint32_t frames_per_ms = lrint((float) sampleRate / 1000.0f);
-	ctx->min_buffer = minBuffer * frames_per_ms;
-	ctx->max_buffer = maxBuffer * frames_per_ms;
+	return cards;
+}
 
-	bool r = true;
+static void audio_close(MTY_Audio *ctx)
+{
+	if (ctx->pcm) {
+		snd_pcm_close(ctx->pcm);
+		ctx->pcm = NULL;
+	}
+
+	memset(&ctx->hw, 0, sizeof(MTY_AudioHardware));
+	ctx->playing = false;
+}
 
-	int32_t e = snd_pcm_open(&ctx->pcm, "default", SND_PCM_STREAM_PLAYBACK, 0);
+static bool audio_open(MTY_Audio *ctx, const char *device)
+{
+	int32_t e = snd_pcm_open(&ctx->pcm, device ? device : "default", SND_PCM_STREAM_PLAYBACK, 0);
 	if (e != 0) {
 		MTY_Log("'snd_pcm_open' failed with error %d", e);
-		r = false;
-		goto except;
+		ctx->pcm = NULL;
+		return false;
 	}
 
 	snd_pcm_hw_params_t *params = NULL;
@@ -54,11 +78,194 @@ MTY_Audio *MTY_AudioCreate(uint32_t sampleRate, uint32_t minBuffer, uint32_t max
 	snd_pcm_hw_params_set_access(ctx->pcm, params, SND_PCM_ACCESS_RW_INTERLEAVED);
 	snd_pcm_hw_params_set_format(ctx->pcm, params, SND_PCM_FORMAT_S16);
 	snd_pcm_hw_params_set_channels(ctx->pcm, params, AUDIO_CHANNELS);
-	snd_pcm_hw_params_set_rate(ctx->pcm, params, sampleRate, 0);
-	snd_pcm_hw_params(ctx->pcm, params);
+	snd_pcm_hw_params_set_rate(ctx->pcm, params, ctx->sample_rate, 0);
+
+	e = snd_pcm_hw_params(ctx->pcm, params);
+	if (e != 0) {
+		MTY_Log("'snd_pcm_hw_params' failed with error %d", e);
+		audio_close(ctx);
+		return false;
+	}
+
+	unsigned int rate = 0;
+	snd_pcm_uframes_t period = 0;
+	snd_pcm_uframes_t buffer = 0;
+	snd_pcm_hw_params_get_rate(params, &rate, NULL);
+	snd_pcm_hw_params_get_period_size(params, &period, NULL);
+	snd_pcm_hw_params_get_buffer_size(params, &buffer);
+
+	ctx->hw.sampleRate = rate;
+	ctx->hw.periodSize = period;
+	ctx->hw.bufferSize = buffer;
+
 	snd_pcm_nonblock(ctx->pcm, 1);
 
+	return true;
+}
+
+static void audio_notify(MTY_Audio *ctx, MTY_AudioDeviceEvent event, const char *device)
+{
+	if (ctx->func)
+		ctx->func(event, device, ctx->opaque);
+}
+
+static void audio_lost(MTY_Audio *ctx)
+{
+	audio_close(ctx);
+	audio_notify(ctx, MTY_AUDIO_DEVICE_LOST, ctx->fallback ? NULL : ctx->device);
+
+	// Retry on the next call to MTY_AudioQueue
+	ctx->check_ts = 0;
+}
+
+static void audio_check_devices(MTY_Audio *ctx)
+{
+	MTY_Time now = MTY_GetTime();
+
+	if (MTY_TimeDiff(ctx->check_ts, now) < AUDIO_CHECK_MS)
+		return;
+
+	ctx->check_ts = now;
+
+	uint64_t cards = audio_get_cards();
+	bool changed = cards != ctx->cards;
+	ctx->cards = cards;
+
+	// An explicit device that's open needs no attention, errors are caught on write
+	if (ctx->pcm && !ctx->fallback && (ctx->device || !changed))
+		return;
+
+	// Following the default device, reopen it so it picks up the new routing
+	if (ctx->pcm && !ctx->device) {
+		audio_close(ctx);
+
+		if (audio_open(ctx, NULL)) {
+			audio_notify(ctx, MTY_AUDIO_DEVICE_DEFAULT_CHANGED, NULL);
+
+		} else {
+			audio_notify(ctx, MTY_AUDIO_DEVICE_LOST, NULL);
+		}
+
+		return;
+	}
+
+	// Playing on the default device in place of a lost one, check if it has returned
+	if (ctx->pcm && ctx->fallback && !changed)
+		return;
+
+	// A failed open may clear the state that belongs to the fallback
+	snd_pcm_t *fallback = ctx->pcm;
+	MTY_AudioHardware fallback_hw = ctx->hw;
+	bool fallback_playing = ctx->playing;
+	ctx->pcm = NULL;
+
+	if (audio_open(ctx, ctx->device)) {
+		if (fallback)
+			snd_pcm_close(fallback);
+
+		ctx->fallback = false;
+		audio_notify(ctx, MTY_AUDIO_DEVICE_RESTORED, ctx->device);
+
+	} else if (fallback) {
+		ctx->pcm = fallback;
+		ctx->hw = fallback_hw;
+		ctx->playing = fallback_playing;
+
+	} else if (ctx->device && audio_open(ctx, NULL)) {
+		ctx->fallback = true;
+		audio_notify(ctx, MTY_AUDIO_DEVICE_RESTORED, NULL);
+	}
+}
+
+MTY_AudioDeviceList *MTY_AudioGetDevices(void)
+{
+	if (!libasound_global_init())
+		return NULL;
+
+	void **hints = NULL;
+	int32_t e = snd_device_name_hint(-1, "pcm", &hints);
+	if (e != 0) {
+		MTY_Log("'snd_device_name_hint' failed with error %d", e);
+		return NULL;
+	}
+
+	MTY_AudioDeviceList *list = MTY_Alloc(1, sizeof(MTY_AudioDeviceList));
+
+	uint32_t len = 0;
+	for (; hints[len]; len++);
+
+	list->devices = MTY_Alloc(len, sizeof(MTY_AudioDevice));
+
+	for (uint32_t x = 0; x < len; x++) {
+		char *name = snd_device_name_get_hint(hints[x], "NAME");
+		char *desc = snd_device_name_get_hint(hints[x], "DESC");
+		char *ioid = snd_device_name_get_hint(hints[x], "IOID");
+
+		if (name) {
+			MTY_AudioDevice *dev = &list->devices[list->len++];
+			dev->id = MTY_Strdup(name);
+			dev->name = MTY_Strdup(desc ? desc : name);
+
+			// A missing IOID means the device supports both directions
+			dev->output = !ioid || !strcmp(ioid, "Output");
+			dev->input = !ioid || !strcmp(ioid, "Input");
+
+			// Multi-line descriptions are "card\ndevice", keep it on one line
+			for (char *c = dev->name; *c; c++)
+				if (*c == '\n')
+					*c = ' ';
+		}
+
+		free(name);
+		free(desc);
+		free(ioid);
+	}
+
+	snd_device_name_free_hint(hints);
+
+	return list;
+}
+
+void MTY_AudioFreeDevices(MTY_AudioDeviceList **list)
+{
+	if (!list || !*list)
+		return;
+
+	for (uint32_t x = 0; x < (*list)->len; x++) {
+		MTY_Free((*list)->devices[x].id);
+		MTY_Free((*list)->devices[x].name);
+	}
+
+	MTY_Free((*list)->devices);
+
+	MTY_Free(*list);
+	*list = NULL;
+}
+
+
+// Playback
+
+MTY_Audio *MTY_AudioCreateDevice(const char *device, uint32_t sampleRate, uint32_t minBuffer,
+	uint32_t maxBuffer)
+{
+	if (!libasound_global_init())
+		return NULL;
+
+	MTY_Audio *ctx = MTY_Alloc(1, sizeof(MTY_Audio));
+	ctx->sample_rate = sampleRate;
+	ctx->device = device ? MTY_Strdup(device) : NULL;
+
+	uint32_t frames_per_ms = lrint((float) sampleRate / 1000.0f);
+	ctx->min_buffer = minBuffer * frames_per_ms;
+	ctx->max_buffer = maxBuffer * frames_per_ms;
+
+	bool r = audio_open(ctx, device);
+	if (!r)
+		goto except;
+
 	ctx->buf = MTY_Alloc(AUDIO_BUF_SIZE, 1);
+	ctx->cards = audio_get_cards();
+	ctx->check_ts = MTY_GetTime();
 
 	except:
 
@@ -68,6 +275,11 @@ MTY_Audio *MTY_AudioCreate(uint32_t sampleRate, uint32_t minBuffer, uint32_t max
 	return ctx;
 }
 
+MTY_Audio *MTY_AudioCreate(uint32_t sampleRate, uint32_t minBuffer, uint32_t maxBuffer)
+{
+	return MTY_AudioCreateDevice(NULL, sampleRate, minBuffer, maxBuffer);
+}
+
 void MTY_AudioDestroy(MTY_Audio **audio)
 {
 	if (!audio || !*audio)
@@ -75,9 +287,9 @@ void MTY_AudioDestroy(MTY_Audio **audio)
 
 	MTY_Audio *ctx = *audio;
 
-	if (ctx->pcm)
-		snd_pcm_close(ctx->pcm);
+	audio_close(ctx);
 
+	MTY_Free(ctx->device);
 	MTY_Free(ctx->buf);
 	MTY_Free(ctx);
 	*audio = NULL;
@@ -105,7 +317,7 @@ static uint32_t audio_get_queued_frames(MTY_Audio *ctx)
 
 static void audio_play(MTY_Audio *ctx)
 {
-	if (!ctx->playing) {
+	if (!ctx->playing && ctx->pcm) {
 		snd_pcm_prepare(ctx->pcm);
 		ctx->playing = true;
 	}
@@ -124,13 +336,19 @@ uint32_t MTY_AudioGetQueued(MTY_Audio *ctx)
 
 void MTY_AudioQueue(MTY_Audio *ctx, const int16_t *frames, uint32_t count)
 {
+	audio_check_devices(ctx);
+
 	size_t size = count * 4;
 
 	uint32_t queued = audio_get_queued_frames(ctx);
 
 	// Stop playing and flush if we've exceeded the maximum buffer or underrun
-	if (ctx->playing && (queued > ctx->max_buffer || queued == 0))
+	if (ctx->playing && (queued > ctx->max_buffer || queued == 0)) {
+		if (queued == 0)
+			METRIC_COUNT("mty_audio_underruns", "Audio playback buffer underruns.", 1);
+
 		MTY_AudioReset(ctx);
+	}
 
 	if (ctx->pos + size <= AUDIO_BUF_SIZE) {
 		memcpy(ctx->buf + ctx->pos, frames, count * 4);
@@ -148,7 +366,366 @@ void MTY_AudioQueue(MTY_Audio *ctx, const int16_t *frames, uint32_t count)
 			ctx->pos = 0;
 
 		} else if (e == -EPIPE) {
+			METRIC_COUNT("mty_audio_underruns", "Audio playback buffer underruns.", 1);
 			MTY_AudioReset(ctx);
+
+		// Unplugged, or the sound server went away. Queued audio is kept for the reopen
+		} else if (e == -ENODEV || e == -EIO) {
+			audio_lost(ctx);
+		}
+	}
+}
+
+bool MTY_AudioGetHardware(MTY_Audio *ctx, MTY_AudioHardware *hw)
+{
+	*hw = ctx->hw;
+
+	return ctx->pcm != NULL;
+}
+
+void MTY_AudioSetDeviceFunc(MTY_Audio *ctx, MTY_AudioDeviceFunc func, void *opaque)
+{
+	ctx->func = func;
+	ctx->opaque = opaque;
+}
+
+// Capture
+
+#define AUDIO_CAPTURE_PERIOD_MS 10
+#define AUDIO_CAPTURE_PERIODS   4
+#define AUDIO_CAPTURE_WAIT      100
+
+struct audio_period {
+	int64_t timestamp;
+	uint32_t frames;
+	uint32_t reserved;
+};
+
+struct MTY_AudioCapture {
+	snd_pcm_t *pcm;
+	MTY_AudioCaptureFunc func;
+	void *opaque;
+
+	uint32_t sample_rate;
+	uint32_t frame_size;
+	uint32_t period_size;
+
+	MTY_Thread *thread;
+	MTY_Queue *q;
+	uint8_t *buf;
+	MTY_Atomic32 running;
+
+	MTY_Atomic64 frames;
+	MTY_Atomic32 overruns;
+	MTY_Atomic32 dropped;
+	MTY_Atomic32 latency;
+};
+
+static snd_pcm_format_t audio_capture_format(MTY_AudioFormat format, uint32_t *sample_size)
+{
+	switch (format) {
+		case MTY_AUDIO_FORMAT_S16:
+			*sample_size = 2;
+			return SND_PCM_FORMAT_S16;
+		case MTY_AUDIO_FORMAT_S32:
+			*sample_size = 4;
+			return SND_PCM_FORMAT_S32;
+		case MTY_AUDIO_FORMAT_FLOAT:
+			*sample_size = 4;
+			return SND_PCM_FORMAT_FLOAT;
+		default:
+			break;
+	}
+
+	*sample_size = 0;
+
+	return SND_PCM_FORMAT_UNKNOWN;
+}
+
+static void audio_capture_set_latency(MTY_AudioCapture *ctx, int64_t timestamp)
+{
+	// MTY_Time is in microseconds on Linux
+	MTY_Atomic32Set(&ctx->latency, (int32_t) (MTY_GetTime() - timestamp));
+}
+
+static bool audio_capture_recover(MTY_AudioCapture *ctx, int32_t e)
+{
+	// Overrun or system suspend, audio between now and the restart is lost
+	if (e == -EPIPE || e == -ESTRPIPE) {
+		MTY_Atomic32Add(&ctx->overruns, 1);
+		METRIC_COUNT("mty_audio_capture_overruns", "Audio capture buffer overruns.", 1);
+
+		e = snd_pcm_prepare(ctx->pcm);
+		if (e == 0)
+			e = snd_pcm_start(ctx->pcm);
+	}
+
+	if (e < 0 && e != -EAGAIN) {
+		MTY_Log("Audio capture failed with error %d", e);
+		return false;
+	}
+
+	return true;
+}
+
+static void *audio_capture_thread(void *opaque)
+{
+	MTY_AudioCapture *ctx = opaque;
+
+	while (MTY_Atomic32Get(&ctx->running) == 1) {
+		int32_t e = snd_pcm_wait(ctx->pcm, AUDIO_CAPTURE_WAIT);
+
+		if (e == 0)
+			continue;
+
+		if (e < 0) {
+			if (!audio_capture_recover(ctx, e))
+				break;
+
+			continue;
 		}
+
+		// Read directly into the queue, falling back to the scratch buffer if it's full
+		uint8_t *buf = ctx->q ? MTY_QueueGetInputBuffer(ctx->q) : NULL;
+		bool queued = buf != NULL;
+
+		if (!buf)
+			buf = ctx->buf;
+
+		// The header is only valid once a read succeeds, an empty period is never
+		// handed to the consumer
+		struct audio_period *period = (struct audio_period *) buf;
+		period->timestamp = 0;
+		period->frames = 0;
+
+		snd_pcm_sframes_t n = snd_pcm_readi(ctx->pcm, period + 1, ctx->period_size);
+
+		if (n <= 0) {
+			if (queued)
+				MTY_QueuePush(ctx->q, 0);
+
+			if (!audio_capture_recover(ctx, (int32_t) n))
+				break;
+
+			continue;
+		}
+
+		// Frames still in the device buffer were captured after this period
+		snd_pcm_sframes_t delay = 0;
+		if (snd_pcm_delay(ctx->pcm, &delay) != 0 || delay < 0)
+			delay = 0;
+
+		int64_t age = ((int64_t) delay + n) * 1000000 / ctx->sample_rate;
+
+		period->timestamp = MTY_GetTime() - age;
+		period->frames = (uint32_t) n;
+
+		MTY_Atomic64Add(&ctx->frames, n);
+
+		if (ctx->func) {
+			audio_capture_set_latency(ctx, period->timestamp);
+			ctx->func(period + 1, period->frames, period->timestamp, ctx->opaque);
+
+		} else if (queued) {
+			MTY_QueuePush(ctx->q, sizeof(struct audio_period) + n * ctx->frame_size);
+
+		} else {
+			MTY_Atomic32Add(&ctx->dropped, 1);
+		}
+	}
+
+	return NULL;
+}
+
+MTY_AudioCapture *MTY_AudioCaptureCreate(const MTY_AudioCaptureDesc *desc, MTY_AudioCaptureFunc func,
+	void *opaque)
+{
+	if (!libasound_global_init())
+		return NULL;
+
+	uint32_t sample_size = 0;
+	snd_pcm_format_t format = audio_capture_format(desc->format, &sample_size);
+
+	if (format == SND_PCM_FORMAT_UNKNOWN || desc->sampleRate == 0 || desc->channels == 0) {
+		MTY_Log("Invalid audio capture description");
+		return NULL;
+	}
+
+	MTY_AudioCapture *ctx = MTY_Alloc(1, sizeof(MTY_AudioCapture));
+	ctx->func = func;
+	ctx->opaque = opaque;
+	ctx->sample_rate = desc->sampleRate;
+	ctx->frame_size = sample_size * desc->channels;
+
+	uint32_t periods = desc->periods > 0 ? desc->periods : AUDIO_CAPTURE_PERIODS;
+
+	snd_pcm_uframes_t period_size = desc->periodSize > 0 ? desc->periodSize :
+		desc->sampleRate * AUDIO_CAPTURE_PERIOD_MS / 1000;
+	snd_pcm_uframes_t buffer_size = period_size * periods;
+
+	bool r = true;
+
+	int32_t e = snd_pcm_open(&ctx->pcm, desc->device ? desc->device : "default", SND_PCM_STREAM_CAPTURE, 0);
+	if (e != 0) {
+		MTY_Log("'snd_pcm_open' failed with error %d", e);
+		r = false;
+		goto except;
+	}
+
+	snd_pcm_hw_params_t *params = NULL;
+	snd_pcm_hw_params_alloca(&params);
+	snd_pcm_hw_params_any(ctx->pcm, params);
+
+	snd_pcm_hw_params_set_access(ctx->pcm, params, SND_PCM_ACCESS_RW_INTERLEAVED);
+
+	e = snd_pcm_hw_params_set_format(ctx->pcm, params, format);
+	if (e != 0) {
+		MTY_Log("'snd_pcm_hw_params_set_format' failed with error %d", e);
+		r = false;
+		goto except;
 	}
+
+	e = snd_pcm_hw_params_set_channels(ctx->pcm, params, desc->channels);
+	if (e != 0) {
+		MTY_Log("'snd_pcm_hw_params_set_channels' failed with error %d", e);
+		r = false;
+		goto except;
+	}
+
+	e = snd_pcm_hw_params_set_rate(ctx->pcm, params, desc->sampleRate, 0);
+	if (e != 0) {
+		MTY_Log("'snd_pcm_hw_params_set_rate' failed with error %d", e);
+		r = false;
+		goto except;
+	}
+
+	// The device may round these, the actual period size is what gets delivered
+	snd_pcm_hw_params_set_period_size_near(ctx->pcm, params, &period_size, NULL);
+	snd_pcm_hw_params_set_buffer_size_near(ctx->pcm, params, &buffer_size);
+
+	e = snd_pcm_hw_params(ctx->pcm, params);
+	if (e != 0) {
+		MTY_Log("'snd_pcm_hw_params' failed with error %d", e);
+		r = false;
+		goto except;
+	}
+
+	snd_pcm_nonblock(ctx->pcm, 1);
+
+	ctx->period_size = period_size;
+
+	size_t buf_size = sizeof(struct audio_period) + period_size * ctx->frame_size;
+	ctx->buf = MTY_Alloc(buf_size, 1);
+
+	if (!func)
+		ctx->q = MTY_QueueCreate(periods, buf_size);
+
+	except:
+
+	if (!r)
+		MTY_AudioCaptureDestroy(&ctx);
+
+	return ctx;
+}
+
+void MTY_AudioCaptureDestroy(MTY_AudioCapture **capture)
+{
+	if (!capture || !*capture)
+		return;
+
+	MTY_AudioCapture *ctx = *capture;
+
+	MTY_AudioCaptureStop(ctx);
+
+	if (ctx->pcm)
+		snd_pcm_close(ctx->pcm);
+
+	MTY_QueueDestroy(&ctx->q);
+
+	MTY_Free(ctx->buf);
+	MTY_Free(ctx);
+	*capture = NULL;
+}
+
+bool MTY_AudioCaptureStart(MTY_AudioCapture *ctx)
+{
+	if (ctx->thread)
+		return true;
+
+	if (ctx->q)
+		MTY_QueueFlush(ctx->q, NULL);
+
+	int32_t e = snd_pcm_prepare(ctx->pcm);
+	if (e != 0) {
+		MTY_Log("'snd_pcm_prepare' failed with error %d", e);
+		return false;
+	}
+
+	e = snd_pcm_start(ctx->pcm);
+	if (e != 0) {
+		MTY_Log("'snd_pcm_start' failed with error %d", e);
+		return false;
+	}
+
+	MTY_Atomic32Set(&ctx->running, 1);
+	ctx->thread = MTY_ThreadCreate(audio_capture_thread, ctx);
+
+	return true;
+}
+
+void MTY_AudioCaptureStop(MTY_AudioCapture *ctx)
+{
+	if (!ctx->thread)
+		return;
+
+	MTY_Atomic32Set(&ctx->running, 0);
+	MTY_ThreadDestroy(&ctx->thread);
+
+	snd_pcm_drop(ctx->pcm);
+}
+
+bool MTY_AudioCaptureGetPeriod(MTY_AudioCapture *ctx, int32_t timeout, const void **frames,
+	uint32_t *count, int64_t *timestamp)
+{
+	if (!ctx->q)
+		return false;
+
+	struct audio_period *period = NULL;
+
+	while (true) {
+		void *buf = NULL;
+		if (!MTY_QueueGetOutputBuffer(ctx->q, timeout, &buf, NULL))
+			return false;
+
+		period = buf;
+
+		if (period->frames > 0)
+			break;
+
+		MTY_QueuePop(ctx->q);
+	}
+
+	audio_capture_set_latency(ctx, period->timestamp);
+
+	*frames = period + 1;
+	*count = period->frames;
+
+	if (timestamp)
+		*timestamp = period->timestamp;
+
+	return true;
+}
+
+void MTY_AudioCapturePop(MTY_AudioCapture *ctx)
+{
+	if (ctx->q)
+		MTY_QueuePop(ctx->q);
+}
+
+void MTY_AudioCaptureGetStats(MTY_AudioCapture *ctx, MTY_AudioCaptureStats *stats)
+{
+	stats->frames = MTY_Atomic64Get(&ctx->frames);
+	stats->overruns = MTY_Atomic32Get(&ctx->overruns);
+	stats->dropped = MTY_Atomic32Get(&ctx->dropped);
+	stats->latency = MTY_Atomic32Get(&ctx->latency) / 1000.0f;
 }
@@ -453,6 +453,7 @@ static int (*XCloseDisplay)(Display *display);
 static Window (*XDefaultRootWindow)(Display *display);
 static Window (*XRootWindowOfScreen)(Screen *screen);
 static Colormap (*XCreateColormap)(Display *display, Window w, Visual *visual, int alloc);
+static int (*XFreeColormap)(Display *display, Colormap colormap);
 static Window (*XCreateWindow)(Display *display, Window parent, int x, int y, unsigned int width,
 	unsigned int height, unsigned int border_width, int depth, unsigned int class, Visual *visual,
 	unsigned long valuemask, XSetWindowAttributes *attributes);
@@ -622,6 +623,7 @@ static GLXContext (*glXCreateContext)(Display *dpy, XVisualInfo *vis, GLXContext
 static Bool (*glXMakeCurrent)(Display *dpy, GLXDrawable drawable, GLXContext ctx);
 static void (*glXDestroyContext)(Display *dpy, GLXContext ctx);
 static GLXContext (*glXGetCurrentContext)(void);
+static const char *(*glXQueryExtensionsString)(Display *dpy, int screen);
 
 
 // Helper window struct
@@ -677,6 +679,7 @@ static bool libX11_global_init(void)
 		LOAD_SYM(LIBX11_SO, XDefaultRootWindow);
 		LOAD_SYM(LIBX11_SO, XRootWindowOfScreen);
 		LOAD_SYM(LIBX11_SO, XCreateColormap);
+		LOAD_SYM(LIBX11_SO, XFreeColormap);
 		LOAD_SYM(LIBX11_SO, XCreateWindow);
 		LOAD_SYM(LIBX11_SO, XWithdrawWindow);
 		LOAD_SYM(LIBX11_SO, XMapRaised);
@@ -743,11 +746,16 @@ static bool libX11_global_init(void)
 		LOAD_SYM(LIBGL_SO, glXMakeCurrent);
 		LOAD_SYM(LIBGL_SO, glXDestroyContext);
 		LOAD_SYM(LIBGL_SO, glXGetCurrentContext);
+		LOAD_SYM(LIBGL_SO, glXQueryExtensionsString);
 
 		except:
 
-		if (!r)
-			libX11_global_destroy();
+		if (!r) {
+			MTY_SOUnload(&LIBGL_SO);
+			MTY_SOUnload(&LIBXI_SO);
+			MTY_SOUnload(&LIBXCURSOR_SO);
+			MTY_SOUnload(&LIBX11_SO);
+		}
 
 		LIBX11_INIT = r;
 	}
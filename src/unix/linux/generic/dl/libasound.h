@@ -150,6 +150,20 @@ static size_t (*snd_pcm_status_sizeof)(void);
 static size_t (*snd_pcm_hw_params_sizeof)(void);
 static snd_pcm_uframes_t (*snd_pcm_status_get_avail)(const snd_pcm_status_t *obj);
 static snd_pcm_uframes_t (*snd_pcm_status_get_avail_max)(const snd_pcm_status_t *obj);
+static int (*snd_pcm_hw_params_set_period_size_near)(snd_pcm_t *pcm, snd_pcm_hw_params_t *params, snd_pcm_uframes_t *val, int *dir);
+static int (*snd_pcm_hw_params_set_buffer_size_near)(snd_pcm_t *pcm, snd_pcm_hw_params_t *params, snd_pcm_uframes_t *val);
+static snd_pcm_sframes_t (*snd_pcm_readi)(snd_pcm_t *pcm, void *buffer, snd_pcm_uframes_t size);
+static int (*snd_pcm_wait)(snd_pcm_t *pcm, int timeout);
+static int (*snd_pcm_delay)(snd_pcm_t *pcm, snd_pcm_sframes_t *delayp);
+static int (*snd_pcm_start)(snd_pcm_t *pcm);
+static int (*snd_pcm_drop)(snd_pcm_t *pcm);
+static int (*snd_pcm_hw_params_get_rate)(const snd_pcm_hw_params_t *params, unsigned int *val, int *dir);
+static int (*snd_pcm_hw_params_get_period_size)(const snd_pcm_hw_params_t *params, snd_pcm_uframes_t *frames, int *dir);
+static int (*snd_pcm_hw_params_get_buffer_size)(const snd_pcm_hw_params_t *params, snd_pcm_uframes_t *val);
+static int (*snd_device_name_hint)(int card, const char *iface, void ***hints);
+static char *(*snd_device_name_get_hint)(const void *hint, const char *id);
+static int (*snd_device_name_free_hint)(void **hints);
+static int (*snd_card_next)(int *card);
 
 
 // Runtime open
@@ -158,12 +172,17 @@ static MTY_Atomic32 LIBASOUND_LOCK;
 static MTY_SO *LIBASOUND_SO;
 static bool LIBASOUND_INIT;
 
+static void libasound_global_destroy_lockfree(void)
+{
+	MTY_SOUnload(&LIBASOUND_SO);
+	LIBASOUND_INIT = false;
+}
+
 static void __attribute__((destructor)) libasound_global_destroy(void)
 {
 	MTY_GlobalLock(&LIBASOUND_LOCK);
 
-	MTY_SOUnload(&LIBASOUND_SO);
-	LIBASOUND_INIT = false;
+	libasound_global_destroy_lockfree();
 
 	MTY_GlobalUnlock(&LIBASOUND_LOCK);
 }
@@ -198,11 +217,26 @@ static bool libasound_global_init(void)
 		LOAD_SYM(LIBASOUND_SO, snd_pcm_hw_params_sizeof);
 		LOAD_SYM(LIBASOUND_SO, snd_pcm_status_get_avail);
 		LOAD_SYM(LIBASOUND_SO, snd_pcm_status_get_avail_max);
+		LOAD_SYM(LIBASOUND_SO, snd_pcm_hw_params_set_period_size_near);
+		LOAD_SYM(LIBASOUND_SO, snd_pcm_hw_params_set_buffer_size_near);
+		LOAD_SYM(LIBASOUND_SO, snd_pcm_readi);
+		LOAD_SYM(LIBASOUND_SO, snd_pcm_wait);
+		LOAD_SYM(LIBASOUND_SO, snd_pcm_delay);
+		LOAD_SYM(LIBASOUND_SO, snd_pcm_start);
+		LOAD_SYM(LIBASOUND_SO, snd_pcm_drop);
+		LOAD_SYM(LIBASOUND_SO, snd_pcm_hw_params_get_rate);
+		LOAD_SYM(LIBASOUND_SO, snd_pcm_hw_params_get_period_size);
+		LOAD_SYM(LIBASOUND_SO, snd_pcm_hw_params_get_buffer_size);
+		LOAD_SYM(LIBASOUND_SO, snd_device_name_hint);
+		LOAD_SYM(LIBASOUND_SO, snd_device_name_get_hint);
+		LOAD_SYM(LIBASOUND_SO, snd_device_name_free_hint);
+		LOAD_SYM(LIBASOUND_SO, snd_card_next);
 
 		except:
 
+		// The global lock is not recursive
 		if (!r)
-			libasound_global_destroy();
+			libasound_global_destroy_lockfree();
 
 		LIBASOUND_INIT = r;
 	}
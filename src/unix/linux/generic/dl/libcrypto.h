@@ -98,7 +98,7 @@ static bool libcrypto_global_init(void)
 		except:
 
 		if (!r)
-			libcrypto_global_destroy();
+			MTY_SOUnload(&LIBCRYPTO_SO);
 
 		LIBCRYPTO_INIT = r;
 	}
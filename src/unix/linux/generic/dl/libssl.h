@@ -229,7 +229,7 @@ static bool libssl_global_init(void)
 		except:
 
 		if (!r)
-			libssl_global_destroy();
+			MTY_SOUnload(&LIBSSL_SO);
 
 		LIBSSL_INIT = r;
 	}
@@ -93,7 +93,7 @@ static bool libudev_global_init(void)
 		except:
 
 		if (!r)
-			libudev_global_destroy();
+			MTY_SOUnload(&LIBUDEV_SO);
 
 		LIBUDEV_INIT = r;
 	}
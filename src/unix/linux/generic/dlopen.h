@@ -8,4 +8,15 @@
 
 #include <dlfcn.h>
 
-#define DLOPEN_FLAGS (RTLD_NOW | RTLD_LOCAL | RTLD_DEEPBIND)
+// ASan refuses RTLD_DEEPBIND, sanitized builds are only used for testing
+#if defined(__SANITIZE_ADDRESS__)
+	#define DLOPEN_FLAGS (RTLD_NOW | RTLD_LOCAL)
+#elif defined(__has_feature)
+	#if __has_feature(address_sanitizer)
+		#define DLOPEN_FLAGS (RTLD_NOW | RTLD_LOCAL)
+	#endif
+#endif
+
+#if !defined(DLOPEN_FLAGS)
+	#define DLOPEN_FLAGS (RTLD_NOW | RTLD_LOCAL | RTLD_DEEPBIND)
+#endif
@@ -18,6 +18,7 @@
 #include <linux/input.h>
 
 #include "dl/libudev.h"
+#include "hid/replay.h"
 
 // https://github.com/torvalds/linux/blob/master/include/uapi/linux/input.h
 // https://github.com/torvalds/linux/blob/master/include/uapi/linux/input-event-codes.h
@@ -78,6 +79,35 @@ static uint8_t evdev_find_slot(struct evdev *ctx)
 	return 0;
 }
 
+static struct evdev_dev *evdev_device_create(uint32_t id, uint16_t vid, uint16_t pid, const int32_t (*abs)[2])
+{
+	struct evdev_dev *edev = MTY_Alloc(1, sizeof(struct evdev_dev));
+	edev->id = id;
+
+	edev->state.type = MTY_CTYPE_DEFAULT;
+	edev->state.numAxes = 1; // There's always a dummy 'hat' DPAD
+	edev->state.numButtons = 15; // There's no good way to know how many buttons the device has
+	edev->state.id = edev->id;
+	edev->state.vid = vid;
+	edev->state.pid = pid;
+
+	// Set up rumble
+	edev->ff.type = FF_RUMBLE;
+	edev->ff.replay.length = 1000;
+	edev->ff.id = -1;
+
+	// Assign axis slots
+	for (uint8_t x = 0x00; x < ABS_CNT; x++) {
+		if (x != ABS_HAT0X && x != ABS_HAT0Y && (abs[x][0] != 0 || abs[x][1] != 0)) {
+			edev->ainfo[x].slot = edev->state.numAxes++;
+			edev->ainfo[x].min = abs[x][0];
+			edev->ainfo[x].max = abs[x][1];
+		}
+	}
+
+	return edev;
+}
+
 static void evdev_device_add(struct evdev *ctx, const char *devnode, const char *syspath)
 {
 	struct evdev_dev *edev = MTY_HashGet(ctx->devices, devnode);
@@ -97,48 +127,33 @@ static void evdev_device_add(struct evdev *ctx, const char *devnode, const char
 		// There is no great way to tell what kind of device this is. Filter by
 		// devices that have EV_KEY (keys and buttons) and EV_ABS (absolute axis)
 		if ((evs & (1 << EV_KEY)) && (evs & (1 << EV_ABS))) {
-			edev = MTY_Alloc(1, sizeof(struct evdev_dev));
-			edev->id = fd;
-			edev->slot = slot;
-
-			edev->state.type = MTY_CTYPE_DEFAULT;
-			edev->state.numAxes = 1; // There's always a dummy 'hat' DPAD
-			edev->state.numButtons = 15; // There's no good way to know how many buttons the device has
-			edev->state.id = edev->id;
-
 			// VID/PID
 			struct input_id ids = {0};
 			ioctl(fd, EVIOCGID, &ids);
-			edev->state.vid = ids.vendor;
-			edev->state.pid = ids.product;
 
-			// Set up rumble
-			edev->ff.type = FF_RUMBLE;
-			edev->ff.replay.length = 1000;
-			edev->ff.id = -1;
+			// Discover axis
+			int32_t abs[ABS_CNT][2] = {0};
+
+			for (uint8_t x = 0x00; x < ABS_CNT; x++) {
+				struct input_absinfo info = {0};
+				ioctl(fd, EVIOCGABS(x), &info);
+
+				abs[x][0] = info.minimum;
+				abs[x][1] = info.maximum;
+			}
+
+			edev = evdev_device_create(fd, ids.vendor, ids.product, abs);
+			edev->slot = slot;
 
 			uint64_t features[2] = {0};
 			if (ioctl(fd, EVIOCGBIT(EV_FF, 2 * sizeof(uint64_t)), features) != -1)
 				edev->rumble = features[1] & (1 << (FF_RUMBLE - 64));
 
-			// Discover axis
-			for (uint8_t x = 0x00; x < ABS_CNT; x++) {
-				if (x != ABS_HAT0X && x != ABS_HAT0Y) {
-					struct input_absinfo info = {0};
-					ioctl(fd, EVIOCGABS(x), &info);
-
-					if (info.minimum != 0 || info.maximum != 0) {
-						edev->ainfo[x].slot = edev->state.numAxes++;
-						edev->ainfo[x].min = info.minimum;
-						edev->ainfo[x].max = info.maximum;
-					}
-				}
-			}
-
 			ctx->fds[slot].fd = fd;
 			MTY_HashSet(ctx->devices, devnode, edev);
 			MTY_HashSetInt(ctx->devices_rev, edev->id, edev);
 
+			mty_hid_record_evdev_connect(edev->id, ids.vendor, ids.product, abs, ABS_CNT);
 			ctx->connect(edev, ctx->opaque);
 
 		} else {
@@ -159,6 +174,7 @@ static void evdev_device_remove(struct evdev *ctx, const char *devnode)
 	if (!edev)
 		return;
 
+	mty_hid_record_disconnect(edev->id);
 	ctx->disconnect(edev, ctx->opaque);
 	int32_t *fd = &ctx->fds[edev->slot].fd;
 
@@ -289,54 +305,64 @@ static uint16_t evdev_joystick_usage(struct evdev_dev *ctx, uint16_t type, const
 	return 0;
 }
 
-static void evdev_joystick_event(struct evdev *ctx, int32_t fd, EVDEV_REPORT report)
+static bool evdev_device_event(struct evdev_dev *edev, const struct input_event *event)
 {
-	struct evdev_dev *edev = MTY_HashGetInt(ctx->devices_rev, fd);
-	if (!edev)
-		return;
-
 	MTY_ControllerEvent *c = &edev->state;
-	struct input_event event = {0};
 
-	if (read(fd, &event, sizeof(struct input_event)) != sizeof(struct input_event))
-		return;
-
-	if (event.type == EV_KEY) {
-		if (event.code >= 0x130 && event.code < 0x140)
+	if (event->type == EV_KEY) {
+		if (event->code >= 0x130 && event->code < 0x140)
 			edev->gamepad = true;
 
-		MTY_CButton cb = evdev_button(event.code);
+		MTY_CButton cb = evdev_button(event->code);
 
 		if (cb >= 0) {
 			if (cb >= MTY_CBUTTON_MAX)
-				return;
+				return false;
 
-			c->buttons[cb] = event.value ? true : false;
-			report(edev, ctx->opaque);
+			c->buttons[cb] = event->value ? true : false;
 		}
 
-	} else if (event.type == EV_ABS) {
-		evdev_set_hat(edev, event.code, &event);
+	} else if (event->type == EV_ABS) {
+		if (event->code >= ABS_CNT)
+			return false;
+
+		evdev_set_hat(edev, event->code, event);
 
-		uint16_t usage = edev->gamepad ? evdev_gamepad_usage(edev, event.code, &event) :
-			evdev_joystick_usage(edev, event.code, &event);
+		uint16_t usage = edev->gamepad ? evdev_gamepad_usage(edev, event->code, event) :
+			evdev_joystick_usage(edev, event->code, event);
 
 		if (usage > 0) {
-			uint8_t slot = edev->ainfo[event.code].slot;
+			uint8_t slot = edev->ainfo[event->code].slot;
 
 			// Slots will always begin at 1 since the DPAD is in a fixed position of 0
 			if (slot == 0 || slot >= MTY_CAXIS_MAX)
-				return;
+				return false;
 
-			c->axes[slot].value  = event.value;
+			c->axes[slot].value  = event->value;
 			c->axes[slot].usage  = usage;
-			c->axes[slot].min = edev->ainfo[event.code].min;
-			c->axes[slot].max = edev->ainfo[event.code].max;
+			c->axes[slot].min = edev->ainfo[event->code].min;
+			c->axes[slot].max = edev->ainfo[event->code].max;
 
 		}
 	}
 
-	if (event.type != EV_SYN)
+	return event->type != EV_SYN;
+}
+
+static void evdev_joystick_event(struct evdev *ctx, int32_t fd, EVDEV_REPORT report)
+{
+	struct evdev_dev *edev = MTY_HashGetInt(ctx->devices_rev, fd);
+	if (!edev)
+		return;
+
+	struct input_event event = {0};
+
+	if (read(fd, &event, sizeof(struct input_event)) != sizeof(struct input_event))
+		return;
+
+	mty_hid_record_evdev_event(edev->id, event.type, event.code, event.value);
+
+	if (evdev_device_event(edev, &event))
 		report(edev, ctx->opaque);
 }
 
@@ -512,3 +538,33 @@ void mty_evdev_rumble(struct evdev *ctx, uint32_t id, uint16_t low, uint16_t hig
 			MTY_Log("'write' failed with errno %d", errno);
 	}
 }
+
+
+// Replay
+
+struct evdev_dev *mty_evdev_replay_create(uint32_t id, uint16_t vid, uint16_t pid, const int32_t (*abs)[2], uint32_t len)
+{
+	int32_t full[ABS_CNT][2] = {0};
+	memcpy(full, abs, (len < ABS_CNT ? len : ABS_CNT) * sizeof(full[0]));
+
+	return evdev_device_create(id, vid, pid, full);
+}
+
+bool mty_evdev_replay_event(struct evdev_dev *ctx, uint16_t type, uint16_t code, int32_t value)
+{
+	struct input_event event = {0};
+	event.type = type;
+	event.code = code;
+	event.value = value;
+
+	return evdev_device_event(ctx, &event);
+}
+
+void mty_evdev_replay_destroy(struct evdev_dev **edev)
+{
+	if (!edev || !*edev)
+		return;
+
+	evdev_device_destroy(*edev);
+	*edev = NULL;
+}
@@ -18,3 +18,8 @@ void mty_evdev_poll(struct evdev *ctx, EVDEV_REPORT report);
 void mty_evdev_destroy(struct evdev **evdev);
 MTY_ControllerEvent mty_evdev_state(struct evdev_dev *ctx);
 void mty_evdev_rumble(struct evdev *ctx, uint32_t id, uint16_t low, uint16_t high);
+
+// Devices rebuilt from a controller recording, not backed by a device node
+struct evdev_dev *mty_evdev_replay_create(uint32_t id, uint16_t vid, uint16_t pid, const int32_t (*abs)[2], uint32_t len);
+bool mty_evdev_replay_event(struct evdev_dev *ctx, uint16_t type, uint16_t code, int32_t value);
+void mty_evdev_replay_destroy(struct evdev_dev **edev);
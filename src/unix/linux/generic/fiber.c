@@ -0,0 +1,706 @@
+// Copyright (c) Christopher D. Dickson <cdd@matoya.group>
+//
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+#define _GNU_SOURCE // MAP_ANONYMOUS, MAP_STACK
+
+#include "matoya.h"
+#include "fiber.h"
+
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/epoll.h>
+
+#include "tlocal.h"
+
+#if defined(__x86_64__)
+	#define FIBER_ASM_X64
+#elif defined(__aarch64__)
+	#define FIBER_ASM_A64
+#else
+	#define FIBER_UCONTEXT
+	#include <ucontext.h>
+#endif
+
+#define FIBER_STACK_DEFAULT (64 * 1024)
+#define FIBER_STACK_MIN     (16 * 1024)
+#define FIBER_POOL_MAX      1024
+#define FIBER_EVENTS        256
+
+struct fiber {
+	MTY_AnonFunc func;
+	void *opaque;
+
+	#if defined(FIBER_UCONTEXT)
+		ucontext_t uc;
+	#else
+		void *sp;
+	#endif
+
+	uint8_t *stack;
+	struct fiber *next;
+	struct fiber *prev_all;
+	struct fiber *next_all;
+
+	int32_t fd;
+	int64_t deadline;
+	uint32_t timer;
+	MTY_Async result;
+	bool done;
+};
+
+struct MTY_FiberScheduler {
+	int32_t epoll;
+	size_t page;
+	size_t map_size;
+
+	#if defined(FIBER_UCONTEXT)
+		ucontext_t uc;
+	#else
+		void *sp;
+	#endif
+
+	struct fiber *current;
+	struct fiber *all;
+	struct fiber *ready_head;
+	struct fiber *ready_tail;
+	struct fiber *pool;
+	uint32_t pool_len;
+
+	struct fiber **timers;
+	uint32_t timers_len;
+	uint32_t timers_size;
+
+	struct fiber **waiters;
+	uint32_t waiters_size;
+
+	uint32_t fibers;
+	uint32_t waiting;
+	uint64_t switches;
+	size_t reserved;
+};
+
+static TLOCAL MTY_FiberScheduler *FIBER_SCHED;
+
+
+// Context switch
+
+// Fibers only ever switch to and from the scheduler. The switch saves the
+// callee-saved registers on the current stack, stores the stack pointer in
+// `from`, then loads `to` and unwinds the same frame off of the other stack.
+// New stacks are seeded with a frame that returns into the trampoline, which
+// calls the entry function held in a callee-saved register.
+
+#if defined(FIBER_ASM_X64)
+
+void fiber_switch(void **from, void *to);
+void fiber_trampoline(void);
+
+__asm__(
+	".pushsection .text\n"
+	".globl fiber_switch\n"
+	".hidden fiber_switch\n"
+	".type fiber_switch, @function\n"
+	"fiber_switch:\n"
+	"	pushq %rbp\n"
+	"	pushq %rbx\n"
+	"	pushq %r12\n"
+	"	pushq %r13\n"
+	"	pushq %r14\n"
+	"	pushq %r15\n"
+	"	subq $8, %rsp\n"
+	"	stmxcsr (%rsp)\n"
+	"	fnstcw 4(%rsp)\n"
+	"	movq %rsp, (%rdi)\n"
+	"	movq %rsi, %rsp\n"
+	"	ldmxcsr (%rsp)\n"
+	"	fldcw 4(%rsp)\n"
+	"	addq $8, %rsp\n"
+	"	popq %r15\n"
+	"	popq %r14\n"
+	"	popq %r13\n"
+	"	popq %r12\n"
+	"	popq %rbx\n"
+	"	popq %rbp\n"
+	"	ret\n"
+	".size fiber_switch, .-fiber_switch\n"
+	".globl fiber_trampoline\n"
+	".hidden fiber_trampoline\n"
+	".type fiber_trampoline, @function\n"
+	"fiber_trampoline:\n"
+	"	movq %r12, %rdi\n"
+	"	callq *%r13\n"
+	"	ud2\n"
+	".size fiber_trampoline, .-fiber_trampoline\n"
+	".popsection\n"
+);
+
+static void *fiber_init_stack(uint8_t *top, struct fiber *f, void (*entry)(struct fiber *))
+{
+	uint64_t *sp = (uint64_t *) top;
+
+	*--sp = (uint64_t) fiber_trampoline; // ret
+	*--sp = 0;                           // rbp
+	*--sp = 0;                           // rbx
+	*--sp = (uint64_t) f;                // r12
+	*--sp = (uint64_t) entry;            // r13
+	*--sp = 0;                           // r14
+	*--sp = 0;                           // r15
+	*--sp = 0x1F80 | (0x037Full << 32);  // mxcsr, x87 control word
+
+	return sp;
+}
+
+#elif defined(FIBER_ASM_A64)
+
+void fiber_switch(void **from, void *to);
+void fiber_trampoline(void);
+
+__asm__(
+	".pushsection .text\n"
+	".globl fiber_switch\n"
+	".hidden fiber_switch\n"
+	".type fiber_switch, %function\n"
+	"fiber_switch:\n"
+	"	sub sp, sp, #160\n"
+	"	stp x19, x20, [sp, #0]\n"
+	"	stp x21, x22, [sp, #16]\n"
+	"	stp x23, x24, [sp, #32]\n"
+	"	stp x25, x26, [sp, #48]\n"
+	"	stp x27, x28, [sp, #64]\n"
+	"	stp x29, x30, [sp, #80]\n"
+	"	stp d8, d9, [sp, #96]\n"
+	"	stp d10, d11, [sp, #112]\n"
+	"	stp d12, d13, [sp, #128]\n"
+	"	stp d14, d15, [sp, #144]\n"
+	"	mov x9, sp\n"
+	"	str x9, [x0]\n"
+	"	mov sp, x1\n"
+	"	ldp x19, x20, [sp, #0]\n"
+	"	ldp x21, x22, [sp, #16]\n"
+	"	ldp x23, x24, [sp, #32]\n"
+	"	ldp x25, x26, [sp, #48]\n"
+	"	ldp x27, x28, [sp, #64]\n"
+	"	ldp x29, x30, [sp, #80]\n"
+	"	ldp d8, d9, [sp, #96]\n"
+	"	ldp d10, d11, [sp, #112]\n"
+	"	ldp d12, d13, [sp, #128]\n"
+	"	ldp d14, d15, [sp, #144]\n"
+	"	add sp, sp, #160\n"
+	"	ret\n"
+	".size fiber_switch, .-fiber_switch\n"
+	".globl fiber_trampoline\n"
+	".hidden fiber_trampoline\n"
+	".type fiber_trampoline, %function\n"
+	"fiber_trampoline:\n"
+	"	mov x0, x19\n"
+	"	blr x20\n"
+	"	brk #0\n"
+	".size fiber_trampoline, .-fiber_trampoline\n"
+	".popsection\n"
+);
+
+static void *fiber_init_stack(uint8_t *top, struct fiber *f, void (*entry)(struct fiber *))
+{
+	uint64_t *sp = (uint64_t *) (top - 160);
+	memset(sp, 0, 160);
+
+	sp[0] = (uint64_t) f;                 // x19
+	sp[1] = (uint64_t) entry;             // x20
+	sp[11] = (uint64_t) fiber_trampoline; // x30
+
+	return sp;
+}
+
+#endif
+
+static void fiber_resume(MTY_FiberScheduler *ctx, struct fiber *f)
+{
+	ctx->current = f;
+	ctx->switches++;
+
+	#if defined(FIBER_UCONTEXT)
+		swapcontext(&ctx->uc, &f->uc);
+	#else
+		fiber_switch(&ctx->sp, f->sp);
+	#endif
+
+	ctx->current = NULL;
+}
+
+static void fiber_suspend(MTY_FiberScheduler *ctx, struct fiber *f)
+{
+	#if defined(FIBER_UCONTEXT)
+		swapcontext(&f->uc, &ctx->uc);
+	#else
+		fiber_switch(&f->sp, ctx->sp);
+	#endif
+}
+
+static void fiber_main(struct fiber *f)
+{
+	f->func(f->opaque);
+	f->done = true;
+
+	fiber_suspend(FIBER_SCHED, f);
+}
+
+#if defined(FIBER_UCONTEXT)
+
+static void fiber_uc_main(void)
+{
+	fiber_main(FIBER_SCHED->current);
+}
+
+#endif
+
+
+// Timers
+
+static int64_t fiber_now(void)
+{
+	struct timespec ts = {0};
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (int64_t) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void fiber_timer_set(MTY_FiberScheduler *ctx, uint32_t i, struct fiber *f)
+{
+	ctx->timers[i] = f;
+	f->timer = i + 1;
+}
+
+static void fiber_timer_up(MTY_FiberScheduler *ctx, uint32_t i)
+{
+	struct fiber *f = ctx->timers[i];
+
+	while (i > 0) {
+		uint32_t parent = (i - 1) / 2;
+		if (ctx->timers[parent]->deadline <= f->deadline)
+			break;
+
+		fiber_timer_set(ctx, i, ctx->timers[parent]);
+		i = parent;
+	}
+
+	fiber_timer_set(ctx, i, f);
+}
+
+static void fiber_timer_down(MTY_FiberScheduler *ctx, uint32_t i)
+{
+	struct fiber *f = ctx->timers[i];
+
+	while (true) {
+		uint32_t child = i * 2 + 1;
+		if (child >= ctx->timers_len)
+			break;
+
+		if (child + 1 < ctx->timers_len && ctx->timers[child + 1]->deadline < ctx->timers[child]->deadline)
+			child++;
+
+		if (f->deadline <= ctx->timers[child]->deadline)
+			break;
+
+		fiber_timer_set(ctx, i, ctx->timers[child]);
+		i = child;
+	}
+
+	fiber_timer_set(ctx, i, f);
+}
+
+static void fiber_timer_push(MTY_FiberScheduler *ctx, struct fiber *f, uint32_t timeout)
+{
+	if (ctx->timers_len == ctx->timers_size) {
+		ctx->timers_size = ctx->timers_size == 0 ? 64 : ctx->timers_size * 2;
+		ctx->timers = MTY_Realloc(ctx->timers, ctx->timers_size, sizeof(struct fiber *));
+	}
+
+	f->deadline = fiber_now() + timeout;
+	ctx->timers[ctx->timers_len++] = f;
+
+	fiber_timer_up(ctx, ctx->timers_len - 1);
+}
+
+static void fiber_timer_remove(MTY_FiberScheduler *ctx, struct fiber *f)
+{
+	if (f->timer == 0)
+		return;
+
+	uint32_t i = f->timer - 1;
+	f->timer = 0;
+
+	struct fiber *last = ctx->timers[--ctx->timers_len];
+	if (i == ctx->timers_len)
+		return;
+
+	fiber_timer_set(ctx, i, last);
+	fiber_timer_up(ctx, i);
+	fiber_timer_down(ctx, last->timer - 1);
+}
+
+static int32_t fiber_timer_next(MTY_FiberScheduler *ctx)
+{
+	if (ctx->timers_len == 0)
+		return -1;
+
+	int64_t diff = ctx->timers[0]->deadline - fiber_now();
+
+	return diff < 0 ? 0 : diff > INT32_MAX ? INT32_MAX : (int32_t) diff;
+}
+
+
+// Ready queue, waits
+
+static void fiber_ready(MTY_FiberScheduler *ctx, struct fiber *f)
+{
+	f->next = NULL;
+
+	if (ctx->ready_tail) {
+		ctx->ready_tail->next = f;
+
+	} else {
+		ctx->ready_head = f;
+	}
+
+	ctx->ready_tail = f;
+}
+
+static void fiber_wake(MTY_FiberScheduler *ctx, struct fiber *f, MTY_Async result)
+{
+	if (f->fd >= 0) {
+		ctx->waiters[f->fd] = NULL;
+		f->fd = -1;
+	}
+
+	fiber_timer_remove(ctx, f);
+
+	f->result = result;
+	ctx->waiting--;
+
+	fiber_ready(ctx, f);
+}
+
+static void fiber_wait(MTY_FiberScheduler *ctx, struct fiber *f, uint32_t timeout)
+{
+	// Timeouts follow poll semantics, anything negative waits indefinitely
+	if ((int32_t) timeout >= 0)
+		fiber_timer_push(ctx, f, timeout);
+
+	ctx->waiting++;
+
+	fiber_suspend(ctx, f);
+}
+
+static void fiber_dispatch(MTY_FiberScheduler *ctx, int32_t timeout)
+{
+	struct epoll_event evs[FIBER_EVENTS];
+
+	int32_t n = epoll_wait(ctx->epoll, evs, FIBER_EVENTS, timeout);
+
+	if (n < 0 && errno != EINTR)
+		MTY_Log("'epoll_wait' failed with errno %d", errno);
+
+	// Registrations are oneshot and may outlive the wait that armed them, so events
+	// are matched against the fiber currently waiting on the descriptor
+	for (int32_t x = 0; x < n; x++) {
+		int32_t fd = evs[x].data.fd;
+
+		if ((uint32_t) fd < ctx->waiters_size && ctx->waiters[fd])
+			fiber_wake(ctx, ctx->waiters[fd], MTY_ASYNC_OK);
+	}
+
+	int64_t now = fiber_now();
+
+	while (ctx->timers_len > 0 && ctx->timers[0]->deadline <= now) {
+		struct fiber *f = ctx->timers[0];
+		fiber_wake(ctx, f, f->fd >= 0 ? MTY_ASYNC_CONTINUE : MTY_ASYNC_OK);
+	}
+}
+
+bool mty_fiber_poll(int32_t fd, bool out, uint32_t timeout, MTY_Async *r)
+{
+	MTY_FiberScheduler *ctx = FIBER_SCHED;
+
+	// Zero timeouts never block, so there is nothing to gain by yielding
+	if (!ctx || !ctx->current || timeout == 0 || fd < 0)
+		return false;
+
+	struct fiber *f = ctx->current;
+
+	struct epoll_event ev = {0};
+	ev.events = (out ? EPOLLOUT : EPOLLIN) | EPOLLONESHOT;
+	ev.data.fd = fd;
+
+	if (epoll_ctl(ctx->epoll, EPOLL_CTL_MOD, fd, &ev) != 0) {
+		if (errno != ENOENT || epoll_ctl(ctx->epoll, EPOLL_CTL_ADD, fd, &ev) != 0) {
+			MTY_Log("'epoll_ctl' failed with errno %d", errno);
+			*r = MTY_ASYNC_ERROR;
+			return true;
+		}
+	}
+
+	if ((uint32_t) fd >= ctx->waiters_size) {
+		uint32_t size = ctx->waiters_size == 0 ? 1024 : ctx->waiters_size;
+		while (size <= (uint32_t) fd)
+			size *= 2;
+
+		ctx->waiters = MTY_Realloc(ctx->waiters, size, sizeof(struct fiber *));
+		memset(ctx->waiters + ctx->waiters_size, 0, (size - ctx->waiters_size) * sizeof(struct fiber *));
+		ctx->waiters_size = size;
+	}
+
+	ctx->waiters[fd] = f;
+	f->fd = fd;
+
+	fiber_wait(ctx, f, timeout);
+
+	*r = f->result;
+
+	return true;
+}
+
+
+// Stacks
+
+static struct fiber *fiber_alloc(MTY_FiberScheduler *ctx)
+{
+	struct fiber *f = ctx->pool;
+
+	if (f) {
+		ctx->pool = f->next;
+		ctx->pool_len--;
+
+		return f;
+	}
+
+	f = MTY_Alloc(1, sizeof(struct fiber));
+
+	// Stacks are reserved up front but only committed as they are touched, the
+	// lowest page is left inaccessible so an overflow faults instead of corrupting
+	// the neighboring stack
+	f->stack = mmap(NULL, ctx->map_size, PROT_READ | PROT_WRITE,
+		MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_STACK, -1, 0);
+
+	if (f->stack == MAP_FAILED) {
+		MTY_Log("'mmap' failed with errno %d", errno);
+		MTY_Free(f);
+		return NULL;
+	}
+
+	if (mprotect(f->stack, ctx->page, PROT_NONE) != 0) {
+		MTY_Log("'mprotect' failed with errno %d", errno);
+		munmap(f->stack, ctx->map_size);
+		MTY_Free(f);
+		return NULL;
+	}
+
+	ctx->reserved += ctx->map_size;
+
+	return f;
+}
+
+static void fiber_release(MTY_FiberScheduler *ctx, struct fiber *f)
+{
+	munmap(f->stack, ctx->map_size);
+	ctx->reserved -= ctx->map_size;
+
+	MTY_Free(f);
+}
+
+static void fiber_free(MTY_FiberScheduler *ctx, struct fiber *f)
+{
+	if (f->prev_all) {
+		f->prev_all->next_all = f->next_all;
+
+	} else {
+		ctx->all = f->next_all;
+	}
+
+	if (f->next_all)
+		f->next_all->prev_all = f->prev_all;
+
+	ctx->fibers--;
+
+	if (ctx->pool_len < FIBER_POOL_MAX) {
+		f->next = ctx->pool;
+		ctx->pool = f;
+		ctx->pool_len++;
+
+	} else {
+		fiber_release(ctx, f);
+	}
+}
+
+
+// Public
+
+MTY_FiberScheduler *MTY_FiberSchedulerCreate(uint32_t stackSize)
+{
+	MTY_FiberScheduler *ctx = MTY_Alloc(1, sizeof(MTY_FiberScheduler));
+
+	ctx->epoll = epoll_create1(EPOLL_CLOEXEC);
+	if (ctx->epoll == -1) {
+		MTY_Log("'epoll_create1' failed with errno %d", errno);
+		MTY_Free(ctx);
+		return NULL;
+	}
+
+	if (stackSize == 0)
+		stackSize = FIBER_STACK_DEFAULT;
+
+	if (stackSize < FIBER_STACK_MIN)
+		stackSize = FIBER_STACK_MIN;
+
+	ctx->page = sysconf(_SC_PAGESIZE);
+	ctx->map_size = (stackSize + ctx->page - 1) / ctx->page * ctx->page + ctx->page;
+
+	return ctx;
+}
+
+void MTY_FiberSchedulerDestroy(MTY_FiberScheduler **sched)
+{
+	if (!sched || !*sched)
+		return;
+
+	MTY_FiberScheduler *ctx = *sched;
+
+	// Fibers that have not finished are discarded without being unwound
+	for (struct fiber *f = ctx->all; f;) {
+		struct fiber *next = f->next_all;
+		fiber_release(ctx, f);
+		f = next;
+	}
+
+	for (struct fiber *f = ctx->pool; f;) {
+		struct fiber *next = f->next;
+		fiber_release(ctx, f);
+		f = next;
+	}
+
+	if (ctx->epoll != -1)
+		close(ctx->epoll);
+
+	MTY_Free(ctx->timers);
+	MTY_Free(ctx->waiters);
+
+	MTY_Free(ctx);
+	*sched = NULL;
+}
+
+bool MTY_FiberSpawn(MTY_FiberScheduler *ctx, MTY_AnonFunc func, void *opaque)
+{
+	struct fiber *f = fiber_alloc(ctx);
+	if (!f)
+		return false;
+
+	f->func = func;
+	f->opaque = opaque;
+	f->fd = -1;
+	f->timer = 0;
+	f->result = MTY_ASYNC_OK;
+	f->done = false;
+
+	uint8_t *top = f->stack + ctx->map_size;
+
+	#if defined(FIBER_UCONTEXT)
+		getcontext(&f->uc);
+		f->uc.uc_stack.ss_sp = f->stack + ctx->page;
+		f->uc.uc_stack.ss_size = ctx->map_size - ctx->page;
+		f->uc.uc_link = NULL;
+		makecontext(&f->uc, fiber_uc_main, 0);
+		(void) top;
+	#else
+		f->sp = fiber_init_stack(top, f, fiber_main);
+	#endif
+
+	f->prev_all = NULL;
+	f->next_all = ctx->all;
+
+	if (ctx->all)
+		ctx->all->prev_all = f;
+
+	ctx->all = f;
+	ctx->fibers++;
+
+	fiber_ready(ctx, f);
+
+	return true;
+}
+
+void MTY_FiberSchedulerRun(MTY_FiberScheduler *ctx)
+{
+	MTY_FiberScheduler *prev = FIBER_SCHED;
+	if (prev && prev->current) {
+		MTY_Log("MTY_FiberSchedulerRun can not be called from a fiber");
+		return;
+	}
+
+	FIBER_SCHED = ctx;
+
+	while (ctx->fibers > 0) {
+		// Fibers that become ready during this pass run on the next one so that
+		// I/O and timers are serviced between passes
+		struct fiber *f = ctx->ready_head;
+		ctx->ready_head = ctx->ready_tail = NULL;
+
+		while (f) {
+			struct fiber *next = f->next;
+			f->next = NULL;
+
+			fiber_resume(ctx, f);
+
+			if (f->done)
+				fiber_free(ctx, f);
+
+			f = next;
+		}
+
+		if (ctx->fibers > 0)
+			fiber_dispatch(ctx, ctx->ready_head ? 0 : fiber_timer_next(ctx));
+	}
+
+	FIBER_SCHED = prev;
+}
+
+void MTY_FiberYield(void)
+{
+	MTY_FiberScheduler *ctx = FIBER_SCHED;
+	if (!ctx || !ctx->current)
+		return;
+
+	struct fiber *f = ctx->current;
+
+	fiber_ready(ctx, f);
+	fiber_suspend(ctx, f);
+}
+
+void MTY_FiberSleep(uint32_t timeout)
+{
+	MTY_FiberScheduler *ctx = FIBER_SCHED;
+	if (!ctx || !ctx->current) {
+		MTY_Sleep(timeout);
+		return;
+	}
+
+	struct fiber *f = ctx->current;
+
+	fiber_wait(ctx, f, timeout);
+}
+
+void MTY_FiberSchedulerGetStats(MTY_FiberScheduler *ctx, MTY_FiberStats *stats)
+{
+	memset(stats, 0, sizeof(MTY_FiberStats));
+
+	stats->fibers = ctx->fibers;
+	stats->waiting = ctx->waiting;
+	stats->switches = ctx->switches;
+	stats->stackSize = ctx->map_size - ctx->page;
+	stats->reserved = ctx->reserved;
+}
@@ -7,18 +7,160 @@
 #include "gfx/mod-ctx.h"
 GFX_CTX_PROTOTYPES(_gl_)
 
+#include <string.h>
+#include <math.h>
+
+#include "render.h"
 #include "gfx/glproc.h"
 #include "dl/libX11.h"
 
+#define GL_CTX_MAX_FRAMES 3
+#define GL_CTX_WAIT_NS    1000000000ull
+#define GL_CTX_REFRESH_EMA 0.1f
+
+
+// ARB_sync (core in GL 3.2) is loaded optionally, glFinish is used without it
+
+typedef struct __GLsync *GLsync;
+
+#define GL_SYNC_GPU_COMMANDS_COMPLETE 0x9117
+#define GL_SYNC_FLUSH_COMMANDS_BIT    0x00000001
+#define GL_TIMEOUT_EXPIRED            0x911B
+#define GL_WAIT_FAILED                0x911D
+#define GL_TIMEOUT_IGNORED            0xFFFFFFFFFFFFFFFFull
+
+
+// Share group, every window context shares objects with a hidden root context so
+// programs and UI textures are created once and drawn by all windows. Each window
+// keeps its own renderer for the per-frame staging textures and vertex buffers.
+
+struct gl_group {
+	Display *display;
+	Window window;
+	Colormap colormap;
+	GLXContext root;
+	MTY_Renderer *renderer;
+	MTY_Mutex *mutex;
+	GLsync sync;
+	uint32_t refs;
+};
+
+static MTY_Atomic32 GL_GROUP_GLOCK;
+static struct gl_group GL_GROUP;
+
+static GLXContext gl_group_ref(Display *display, XVisualInfo *vis)
+{
+	MTY_GlobalLock(&GL_GROUP_GLOCK);
+
+	struct gl_group *group = &GL_GROUP;
+
+	if (group->refs == 0) {
+		Window root = XDefaultRootWindow(display);
+
+		// The root context needs a drawable so the shared renderer can be
+		// destroyed after all of the app's windows have gone away
+		XSetWindowAttributes swa = {0};
+		swa.colormap = XCreateColormap(display, root, vis->visual, AllocNone);
+
+		group->colormap = swa.colormap;
+		group->window = XCreateWindow(display, root, 0, 0, 1, 1, 0, vis->depth,
+			InputOutput, vis->visual, CWColormap, &swa);
+
+		group->root = glXCreateContext(display, vis, NULL, GL_TRUE);
+
+		if (!group->root) {
+			MTY_Log("'glXCreateContext' failed");
+			XDestroyWindow(display, group->window);
+			XFreeColormap(display, group->colormap);
+			group->window = 0;
+			group->colormap = 0;
+
+		} else {
+			group->display = display;
+			group->renderer = MTY_RendererCreate();
+			group->mutex = MTY_MutexCreate();
+		}
+	}
+
+	GLXContext share = NULL;
+
+	if (group->root && group->display == display) {
+		share = group->root;
+		group->refs++;
+	}
+
+	MTY_GlobalUnlock(&GL_GROUP_GLOCK);
+
+	return share;
+}
+
+static void gl_group_unref(void)
+{
+	MTY_GlobalLock(&GL_GROUP_GLOCK);
+
+	struct gl_group *group = &GL_GROUP;
+
+	if (group->refs > 0 && --group->refs == 0) {
+		// Shared objects must be deleted with a context from the group current. The
+		// caller's context may have just been destroyed, so nothing is left current.
+		glXMakeCurrent(group->display, group->window, group->root);
+		MTY_RendererDestroy(&group->renderer);
+
+		if (group->sync) {
+			void (*delete_sync)(GLsync sync) = glXGetProcAddress((const unsigned char *) "glDeleteSync");
+			delete_sync(group->sync);
+		}
+
+		glXMakeCurrent(group->display, None, NULL);
+
+		glXDestroyContext(group->display, group->root);
+		XDestroyWindow(group->display, group->window);
+		XFreeColormap(group->display, group->colormap);
+		MTY_MutexDestroy(&group->mutex);
+
+		memset(group, 0, sizeof(struct gl_group));
+	}
+
+	MTY_GlobalUnlock(&GL_GROUP_GLOCK);
+}
+
 struct gl_ctx {
 	Display *display;
 	XVisualInfo *vis;
 	Window window;
 	GLXContext gl;
 	MTY_Renderer *renderer;
+	MTY_Mutex *mutex;
+	bool shared;
 	uint32_t fb0;
 	uint32_t interval;
 	void (*glXSwapIntervalEXT)(Display *dpy, GLXDrawable drawable, int interval);
+
+	GLsync (*glFenceSync)(GLenum condition, GLbitfield flags);
+	GLenum (*glClientWaitSync)(GLsync sync, GLbitfield flags, uint64_t timeout);
+	void (*glWaitSync)(GLsync sync, GLbitfield flags, uint64_t timeout);
+	void (*glDeleteSync)(GLsync sync);
+
+	// GLX_OML_sync_control, UST is CLOCK_MONOTONIC microseconds like MTY_Time
+	Bool (*glXGetSyncValuesOML)(Display *dpy, GLXDrawable drawable, int64_t *ust,
+		int64_t *msc, int64_t *sbc);
+	Bool (*glXWaitForSbcOML)(Display *dpy, GLXDrawable drawable, int64_t target_sbc,
+		int64_t *ust, int64_t *msc, int64_t *sbc);
+	Bool (*glXGetMscRateOML)(Display *dpy, GLXDrawable drawable, int32_t *numerator,
+		int32_t *denominator);
+
+	// Ring of fences, one per presented frame not yet known to be complete
+	GLsync fences[GL_CTX_MAX_FRAMES + 1];
+	uint32_t fence_pos;
+	uint32_t fence_count;
+	uint32_t max_frames;
+
+	MTY_PresentStats stats;
+	int64_t sbc_base;
+	int64_t last_sbc;
+	int64_t last_msc;
+	int64_t last_ust;
+	MTY_Time last_present;
 };
 
 static void gl_ctx_get_size(struct gl_ctx *ctx, uint32_t *width, uint32_t *height)
@@ -30,6 +172,178 @@ static void gl_ctx_get_size(struct gl_ctx *ctx, uint32_t *width, uint32_t *heigh
 	*height = attr.height;
 }
 
+
+// Present timing
+
+static bool gl_ctx_has_extension(struct gl_ctx *ctx, const char *name)
+{
+	const char *exts = glXQueryExtensionsString(ctx->display, ctx->vis->screen);
+	size_t len = strlen(name);
+
+	for (const char *ext = exts ? strstr(exts, name) : NULL; ext; ext = strstr(ext + len, name))
+		if ((ext == exts || ext[-1] == ' ') && (ext[len] == ' ' || ext[len] == '\0'))
+			return true;
+
+	return false;
+}
+
+static void gl_ctx_init_timing(struct gl_ctx *ctx)
+{
+	ctx->stats.estimated = true;
+
+	// glXGetProcAddress returns non-NULL for unknown functions, so check the extension string
+	if (!gl_ctx_has_extension(ctx, "GLX_OML_sync_control"))
+		return;
+
+	ctx->glXGetSyncValuesOML = glXGetProcAddress((const unsigned char *) "glXGetSyncValuesOML");
+	ctx->glXWaitForSbcOML = glXGetProcAddress((const unsigned char *) "glXWaitForSbcOML");
+	ctx->glXGetMscRateOML = glXGetProcAddress((const unsigned char *) "glXGetMscRateOML");
+
+	int64_t ust = 0, msc = 0;
+
+	// Swap counts are per drawable and may not start at zero if the window is reused
+	if (!ctx->glXGetSyncValuesOML || !ctx->glXWaitForSbcOML ||
+		!ctx->glXGetSyncValuesOML(ctx->display, ctx->window, &ust, &msc, &ctx->sbc_base))
+	{
+		ctx->glXGetSyncValuesOML = NULL;
+		ctx->glXWaitForSbcOML = NULL;
+		return;
+	}
+
+	ctx->last_sbc = ctx->sbc_base;
+	ctx->stats.estimated = false;
+
+	int32_t num = 0, den = 0;
+
+	if (ctx->glXGetMscRateOML && ctx->glXGetMscRateOML(ctx->display, ctx->window, &num, &den) && num > 0)
+		ctx->stats.refreshInterval = 1000.0f * den / num;
+}
+
+static void gl_ctx_update_refresh(struct gl_ctx *ctx, float sample)
+{
+	float *refresh = &ctx->stats.refreshInterval;
+
+	*refresh = *refresh == 0.0f ? sample : *refresh + (sample - *refresh) * GL_CTX_REFRESH_EMA;
+}
+
+static bool gl_ctx_update_oml(struct gl_ctx *ctx, uint32_t interval)
+{
+	int64_t ust = 0, msc = 0, sbc = 0;
+
+	if (!ctx->glXGetSyncValuesOML(ctx->display, ctx->window, &ust, &msc, &sbc))
+		return false;
+
+	if (sbc <= ctx->last_sbc)
+		return true;
+
+	// The target has already completed so this returns immediately with the
+	// UST and MSC at which that swap reached the screen
+	if (!ctx->glXWaitForSbcOML(ctx->display, ctx->window, sbc, &ust, &msc, &sbc))
+		return false;
+
+	if (ctx->last_msc > 0 && msc > ctx->last_msc) {
+		int64_t dmsc = msc - ctx->last_msc;
+		int64_t expected = (sbc - ctx->last_sbc) * interval;
+
+		gl_ctx_update_refresh(ctx, (float) (ust - ctx->last_ust) / (float) dmsc / 1000.0f);
+
+		// Without vsync swaps aren't tied to refreshes and can't be late
+		if (interval > 0 && dmsc > expected)
+			ctx->stats.missedFrames += dmsc - expected;
+	}
+
+	ctx->stats.displayedID = sbc - ctx->sbc_base;
+	ctx->stats.displayTime = ust;
+	ctx->last_sbc = sbc;
+	ctx->last_msc = msc;
+	ctx->last_ust = ust;
+
+	return true;
+}
+
+static void gl_ctx_update_estimate(struct gl_ctx *ctx, uint32_t interval, MTY_Time now)
+{
+	// Every frame older than those still in flight has been processed by the GPU,
+	// the time the present returned is the best available guess at when it was shown
+	uint64_t displayed = ctx->stats.presentID - ctx->fence_count;
+
+	if (displayed > ctx->stats.displayedID) {
+		ctx->stats.displayedID = displayed;
+		ctx->stats.displayTime = now;
+	}
+
+	if (ctx->last_present != 0 && interval > 0) {
+		float refresh = ctx->stats.refreshInterval;
+		float delta = MTY_TimeDiff(ctx->last_present, now) / interval;
+
+		// Samples well above the current estimate are most likely missed frames
+		if (refresh == 0.0f || delta < refresh * 1.5f) {
+			gl_ctx_update_refresh(ctx, delta);
+
+		} else {
+			ctx->stats.missedFrames += lrintf(delta / refresh) - 1;
+		}
+	}
+
+	ctx->last_present = now;
+}
+
+static void gl_ctx_update_timing(struct gl_ctx *ctx, uint32_t interval, MTY_Time now)
+{
+	ctx->stats.presentID++;
+
+	if (ctx->glXGetSyncValuesOML) {
+		if (gl_ctx_update_oml(ctx, interval))
+			return;
+
+		MTY_Log("GLX_OML_sync_control query failed, falling back to estimates");
+		ctx->glXGetSyncValuesOML = NULL;
+		ctx->stats.estimated = true;
+	}
+
+	gl_ctx_update_estimate(ctx, interval, now);
+}
+
+
+// Shared object handoff
+
+static void gl_ctx_lock(struct gl_ctx *ctx, bool gl)
+{
+	if (!ctx->mutex)
+		return;
+
+	MTY_MutexLock(ctx->mutex);
+
+	// The GPU must finish the previous context's use of shared objects before this
+	// context's commands touch them, the wait is queued rather than blocking
+	if (gl && GL_GROUP.sync && ctx->glWaitSync)
+		ctx->glWaitSync(GL_GROUP.sync, 0, GL_TIMEOUT_IGNORED);
+}
+
+static void gl_ctx_unlock(struct gl_ctx *ctx, bool gl)
+{
+	if (!ctx->mutex)
+		return;
+
+	// Changes to shared objects only become visible to other contexts once the
+	// commands are flushed, the fence lets the next context order itself after them
+	if (gl) {
+		if (ctx->glFenceSync && ctx->glDeleteSync) {
+			if (GL_GROUP.sync)
+				ctx->glDeleteSync(GL_GROUP.sync);
+
+			GL_GROUP.sync = ctx->glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		}
+
+		glFlush();
+	}
+
+	MTY_MutexUnlock(ctx->mutex);
+}
+
+
+// Context
+
 struct gfx_ctx *mty_gl_ctx_create(void *native_window, bool vsync)
 {
 	if (!libX11_global_init())
@@ -45,9 +359,21 @@ struct gfx_ctx *mty_gl_ctx_create(void *native_window, bool vsync)
 	ctx->display = info->display;
 	ctx->vis = info->vis;
 	ctx->window = info->window;
-	ctx->renderer = MTY_RendererCreate();
 
-	ctx->gl = glXCreateContext(ctx->display, ctx->vis, NULL, GL_TRUE);
+	GLXContext share = gl_group_ref(ctx->display, ctx->vis);
+
+	if (share) {
+		ctx->gl = glXCreateContext(ctx->display, ctx->vis, share, GL_TRUE);
+		ctx->shared = ctx->gl != NULL;
+
+		if (!ctx->shared)
+			gl_group_unref();
+	}
+
+	// Windows on another display, or if sharing fails, get private resources
+	if (!ctx->gl)
+		ctx->gl = glXCreateContext(ctx->display, ctx->vis, NULL, GL_TRUE);
+
 	if (!ctx->gl) {
 		r = false;
 		MTY_Log("'glXCreateContext' failed");
@@ -57,9 +383,33 @@ struct gfx_ctx *mty_gl_ctx_create(void *native_window, bool vsync)
 	glXMakeCurrent(ctx->display, ctx->window, ctx->gl);
 
 	ctx->glXSwapIntervalEXT = glXGetProcAddress((const unsigned char *) "glXSwapIntervalEXT");
+	ctx->glFenceSync = glXGetProcAddress((const unsigned char *) "glFenceSync");
+	ctx->glClientWaitSync = glXGetProcAddress((const unsigned char *) "glClientWaitSync");
+	ctx->glWaitSync = glXGetProcAddress((const unsigned char *) "glWaitSync");
+	ctx->glDeleteSync = glXGetProcAddress((const unsigned char *) "glDeleteSync");
+	ctx->max_frames = 1;
+
+	if (ctx->shared) {
+		ctx->mutex = GL_GROUP.mutex;
+		ctx->renderer = mty_renderer_create_shared(GL_GROUP.renderer);
+
+		// The group's programs are compiled by the first window, later windows only
+		// create their own staging textures and buffers, so quad draws need no lock
+		gl_ctx_lock(ctx, true);
+		r = mty_renderer_init(ctx->renderer, MTY_GFX_GL, NULL, (MTY_Context *) ctx->gl);
+		gl_ctx_unlock(ctx, true);
+
+	} else {
+		ctx->renderer = MTY_RendererCreate();
+	}
+
+	gl_ctx_init_timing(ctx);
 
 	glXMakeCurrent(ctx->display, None, NULL);
 
+	if (!r)
+		MTY_Log("Failed to create the shared renderer");
+
 	except:
 
 	if (!r)
@@ -75,10 +425,26 @@ void mty_gl_ctx_destroy(struct gfx_ctx **gfx_ctx)
 
 	struct gl_ctx *ctx = (struct gl_ctx *) *gfx_ctx;
 
-	MTY_RendererDestroy(&ctx->renderer);
+	if (ctx->gl) {
+		glXMakeCurrent(ctx->display, ctx->window, ctx->gl);
 
-	if (ctx->gl)
+		// Fences are shared objects, destroying this context does not free them
+		for (uint32_t x = 0; x < GL_CTX_MAX_FRAMES + 1; x++) {
+			if (ctx->fences[x]) {
+				ctx->glDeleteSync(ctx->fences[x]);
+				ctx->fences[x] = NULL;
+			}
+		}
+
+		// Per-window objects only, the group's are left for gl_group_unref
+		MTY_RendererDestroy(&ctx->renderer);
+
+		glXMakeCurrent(ctx->display, None, NULL);
 		glXDestroyContext(ctx->display, ctx->gl);
+	}
+
+	if (ctx->shared)
+		gl_group_unref();
 
 	MTY_Free(ctx);
 	*gfx_ctx = NULL;
@@ -103,6 +469,48 @@ MTY_Surface *mty_gl_ctx_get_surface(struct gfx_ctx *gfx_ctx)
 	return (MTY_Surface *) &ctx->fb0;
 }
 
+static void gl_ctx_wait_oldest(struct gl_ctx *ctx)
+{
+	uint32_t oldest = (ctx->fence_pos + GL_CTX_MAX_FRAMES + 1 - ctx->fence_count) % (GL_CTX_MAX_FRAMES + 1);
+	GLsync fence = ctx->fences[oldest];
+
+	GLenum e = GL_TIMEOUT_EXPIRED;
+
+	while (e == GL_TIMEOUT_EXPIRED)
+		e = ctx->glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_CTX_WAIT_NS);
+
+	if (e == GL_WAIT_FAILED)
+		MTY_Log("'glClientWaitSync' failed");
+
+	ctx->glDeleteSync(fence);
+	ctx->fences[oldest] = NULL;
+	ctx->fence_count--;
+}
+
+static void gl_ctx_throttle(struct gl_ctx *ctx)
+{
+	if (!ctx->glFenceSync || !ctx->glClientWaitSync || !ctx->glDeleteSync) {
+		glFinish();
+		return;
+	}
+
+	// Rather than draining the GPU with glFinish, only block once more than
+	// max_frames frames are queued, letting the CPU build the next frame meanwhile
+	GLsync fence = ctx->glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+	if (!fence) {
+		glFinish();
+		return;
+	}
+
+	ctx->fences[ctx->fence_pos] = fence;
+	ctx->fence_pos = (ctx->fence_pos + 1) % (GL_CTX_MAX_FRAMES + 1);
+	ctx->fence_count++;
+
+	while (ctx->fence_count > ctx->max_frames)
+		gl_ctx_wait_oldest(ctx);
+}
+
 void mty_gl_ctx_present(struct gfx_ctx *gfx_ctx, uint32_t interval)
 {
 	struct gl_ctx *ctx = (struct gl_ctx *) gfx_ctx;
@@ -112,8 +520,17 @@ void mty_gl_ctx_present(struct gfx_ctx *gfx_ctx, uint32_t interval)
 		ctx->interval = interval;
 	}
 
+	MTY_Time ts = MTY_GetTime();
+
 	glXSwapBuffers(ctx->display, ctx->window);
-	glFinish();
+	gl_ctx_throttle(ctx);
+
+	MTY_Time now = MTY_GetTime();
+
+	ctx->stats.cpuWait = MTY_TimeDiff(ts, now);
+	ctx->stats.framesInFlight = ctx->fence_count;
+
+	gl_ctx_update_timing(ctx, interval, now);
 }
 
 void mty_gl_ctx_draw_quad(struct gfx_ctx *gfx_ctx, const void *image, const MTY_RenderDesc *desc)
@@ -123,6 +540,7 @@ void mty_gl_ctx_draw_quad(struct gfx_ctx *gfx_ctx, const void *image, const MTY_
 	MTY_RenderDesc mutated = *desc;
 	gl_ctx_get_size(ctx, &mutated.viewWidth, &mutated.viewHeight);
 
+	// Only this window's staging textures are written, shared programs and buffers are read
 	MTY_RendererDrawQuad(ctx->renderer, MTY_GFX_GL, NULL, NULL, image, &mutated, (MTY_Surface *) &ctx->fb0);
 }
 
@@ -130,7 +548,10 @@ void mty_gl_ctx_draw_ui(struct gfx_ctx *gfx_ctx, const MTY_DrawData *dd)
 {
 	struct gl_ctx *ctx = (struct gl_ctx *) gfx_ctx;
 
+	// Atlas pages may be uploaded and shared textures are read
+	gl_ctx_lock(ctx, true);
 	MTY_RendererDrawUI(ctx->renderer, MTY_GFX_GL, NULL, NULL, dd, (MTY_Surface *) &ctx->fb0);
+	gl_ctx_unlock(ctx, true);
 }
 
 bool mty_gl_ctx_set_ui_texture(struct gfx_ctx *gfx_ctx, uint32_t id, const void *rgba,
@@ -138,14 +559,33 @@ bool mty_gl_ctx_set_ui_texture(struct gfx_ctx *gfx_ctx, uint32_t id, const void
 {
 	struct gl_ctx *ctx = (struct gl_ctx *) gfx_ctx;
 
-	return MTY_RendererSetUITexture(ctx->renderer, MTY_GFX_GL, NULL, NULL, id, rgba, width, height);
+	// With a share group the texture is uploaded once and visible to every window
+	gl_ctx_lock(ctx, true);
+	bool r = MTY_RendererSetUITexture(ctx->renderer, MTY_GFX_GL, NULL, NULL, id, rgba, width, height);
+	gl_ctx_unlock(ctx, true);
+
+	return r;
 }
 
 bool mty_gl_ctx_has_ui_texture(struct gfx_ctx *gfx_ctx, uint32_t id)
 {
 	struct gl_ctx *ctx = (struct gl_ctx *) gfx_ctx;
 
-	return MTY_RendererHasUITexture(ctx->renderer, id);
+	gl_ctx_lock(ctx, false);
+	bool r = MTY_RendererHasUITexture(ctx->renderer, id);
+	gl_ctx_unlock(ctx, false);
+
+	return r;
+}
+
+void mty_gl_ctx_set_ui_atlas(struct gfx_ctx *gfx_ctx, uint32_t page_size)
+{
+	struct gl_ctx *ctx = (struct gl_ctx *) gfx_ctx;
+
+	// Applies to every window in the share group
+	gl_ctx_lock(ctx, false);
+	MTY_RendererSetUIAtlas(ctx->renderer, page_size);
+	gl_ctx_unlock(ctx, false);
 }
 
 bool mty_gl_ctx_make_current(struct gfx_ctx *gfx_ctx, bool current)
@@ -163,3 +603,26 @@ bool mty_gl_ctx_make_current(struct gfx_ctx *gfx_ctx, bool current)
 
 	return r;
 }
+
+void mty_gl_ctx_set_frames_in_flight(struct gfx_ctx *gfx_ctx, uint32_t frames)
+{
+	struct gl_ctx *ctx = (struct gl_ctx *) gfx_ctx;
+
+	if (frames < 1)
+		frames = 1;
+
+	if (frames > GL_CTX_MAX_FRAMES)
+		frames = GL_CTX_MAX_FRAMES;
+
+	// Excess fences are waited on during the next present
+	ctx->max_frames = frames;
+}
+
+bool mty_gl_ctx_get_present_stats(struct gfx_ctx *gfx_ctx, MTY_PresentStats *stats)
+{
+	struct gl_ctx *ctx = (struct gl_ctx *) gfx_ctx;
+
+	*stats = ctx->stats;
+
+	return true;
+}
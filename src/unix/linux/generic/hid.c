@@ -0,0 +1,488 @@
+// Copyright (c) Christopher D. Dickson <cdd@matoya.group>
+//
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+#include "hid/hid.h"
+#include "hid/replay.h"
+
+#include <string.h>
+
+#include <poll.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/hidraw.h>
+
+#include "dl/libudev.h"
+
+// https://github.com/torvalds/linux/blob/master/include/uapi/linux/hidraw.h
+
+#define HID_FD_MAX     33
+#define HID_REPORT_MAX 4096
+
+struct hid {
+	bool init_scan;
+	struct udev *udev;
+	struct udev_monitor *udev_monitor;
+	MTY_Hash *devices;
+	MTY_Hash *devices_rev;
+	HID_CONNECT connect;
+	HID_DISCONNECT disconnect;
+	HID_REPORT report;
+	struct pollfd fds[HID_FD_MAX];
+	uint8_t buf[HID_REPORT_MAX];
+	void *opaque;
+};
+
+struct hid_dev {
+	char *devnode;
+	void *state;
+	int32_t fd;
+	uint8_t slot;
+	uint32_t id;
+	uint32_t input_size;
+	uint16_t vid;
+	uint16_t pid;
+};
+
+
+// Report descriptor
+
+static uint32_t hid_input_report_size(int32_t fd)
+{
+	int32_t size = 0;
+	if (ioctl(fd, HIDIOCGRDESCSIZE, &size) == -1 || size <= 0)
+		return 0;
+
+	struct hidraw_report_descriptor desc = {0};
+	desc.size = size;
+
+	if (ioctl(fd, HIDIOCGRDESC, &desc) == -1)
+		return 0;
+
+	// Sum the bits of each Input main item per report ID, global state is tracked
+	// only as far as Report Size, Report Count, and Report ID
+	uint32_t bits[256] = {0};
+	uint32_t report_size = 0;
+	uint32_t report_count = 0;
+	uint8_t report_id = 0;
+	bool numbered = false;
+
+	for (uint32_t x = 0; x < desc.size;) {
+		uint8_t prefix = desc.value[x++];
+
+		// Long item
+		if (prefix == 0xFE) {
+			if (x + 1 >= desc.size)
+				break;
+
+			x += 2 + desc.value[x];
+			continue;
+		}
+
+		uint8_t len = prefix & 0x03;
+		if (len == 3)
+			len = 4;
+
+		if (x + len > desc.size)
+			break;
+
+		uint32_t data = 0;
+		for (uint8_t y = 0; y < len; y++)
+			data |= (uint32_t) desc.value[x + y] << (y * 8);
+
+		x += len;
+
+		switch (prefix & 0xFC) {
+			case 0x80: // Input
+				bits[report_id] += report_size * report_count;
+				break;
+			case 0x74: // Report Size
+				report_size = data;
+				break;
+			case 0x94: // Report Count
+				report_count = data;
+				break;
+			case 0x84: // Report ID
+				report_id = data & 0xFF;
+				numbered = true;
+				break;
+		}
+	}
+
+	uint32_t max = 0;
+	for (uint32_t x = 0; x < 256; x++)
+		if (bits[x] > max)
+			max = bits[x];
+
+	// Sizes include the report ID byte, matching the other platforms
+	return (max + 7) / 8 + (numbered ? 1 : 0);
+}
+
+
+// Devices
+
+static void hid_device_destroy(void *hdevice)
+{
+	if (!hdevice)
+		return;
+
+	struct hid_dev *ctx = hdevice;
+
+	if (ctx->fd >= 0)
+		close(ctx->fd);
+
+	MTY_Free(ctx->devnode);
+	MTY_Free(ctx->state);
+	MTY_Free(ctx);
+}
+
+static uint8_t hid_find_slot(struct hid *ctx)
+{
+	for (uint8_t x = 1; x < HID_FD_MAX; x++)
+		if (ctx->fds[x].fd == -1)
+			return x;
+
+	return 0;
+}
+
+static void hid_device_add(struct hid *ctx, const char *devnode)
+{
+	if (MTY_HashGet(ctx->devices, devnode))
+		return;
+
+	uint8_t slot = hid_find_slot(ctx);
+	if (slot == 0)
+		return;
+
+	int32_t fd = open(devnode, O_RDWR | O_NONBLOCK);
+
+	if (fd == -1) {
+		// hidraw nodes are root only unless a udev rule grants access, evdev will
+		// pick up the device in that case
+		if (errno != EACCES && errno != ENOENT)
+			MTY_Log("'open' failed with errno %d", errno);
+
+		return;
+	}
+
+	struct hidraw_devinfo info = {0};
+	if (ioctl(fd, HIDIOCGRAWINFO, &info) == -1) {
+		MTY_Log("'ioctl' failed with errno %d", errno);
+		close(fd);
+		return;
+	}
+
+	// Only devices with a dedicated driver are handled here, generic joysticks
+	// are better served by evdev which has already parsed the descriptor
+	if (!mty_hid_driver_is_supported(info.vendor, info.product)) {
+		close(fd);
+		return;
+	}
+
+	struct hid_dev *dev = MTY_Alloc(1, sizeof(struct hid_dev));
+	dev->devnode = MTY_Strdup(devnode);
+	dev->fd = fd;
+	dev->slot = slot;
+	dev->id = fd;
+	dev->vid = info.vendor;
+	dev->pid = info.product;
+	dev->state = MTY_Alloc(HID_STATE_MAX, 1);
+	dev->input_size = hid_input_report_size(fd);
+
+	ctx->fds[slot].fd = fd;
+	MTY_HashSet(ctx->devices, devnode, dev);
+	MTY_HashSetInt(ctx->devices_rev, dev->id, dev);
+
+	ctx->connect(dev, ctx->opaque);
+}
+
+static void hid_device_remove(struct hid *ctx, const char *devnode)
+{
+	struct hid_dev *dev = MTY_HashPop(ctx->devices, devnode);
+	if (!dev)
+		return;
+
+	mty_hid_record_disconnect(dev->id);
+	ctx->disconnect(dev, ctx->opaque);
+
+	ctx->fds[dev->slot].fd = -1;
+	MTY_HashPopInt(ctx->devices_rev, dev->id);
+	hid_device_destroy(dev);
+}
+
+static void hid_device_read(struct hid *ctx, struct hid_dev *dev)
+{
+	// Each read returns exactly one report, drain everything queued since the last poll
+	while (true) {
+		ssize_t n = read(dev->fd, ctx->buf, HID_REPORT_MAX);
+
+		if (n > 0) {
+			ctx->report(dev, ctx->buf, n, ctx->opaque);
+
+		} else {
+			if (n == 0 || (errno != EAGAIN && errno != EINTR)) {
+				// The node goes away before udev reports the removal
+				if (n == 0 || errno == ENODEV) {
+					hid_device_remove(ctx, dev->devnode);
+
+				} else {
+					MTY_Log("'read' failed with errno %d", errno);
+				}
+			}
+
+			break;
+		}
+	}
+}
+
+
+// Enumeration
+
+static void hid_monitor_event(struct hid *ctx)
+{
+	struct udev_device *dev = udev_monitor_receive_device(ctx->udev_monitor);
+	if (!dev)
+		return;
+
+	const char *action = udev_device_get_action(dev);
+	const char *devnode = udev_device_get_devnode(dev);
+
+	if (action && devnode) {
+		if (!strcmp(action, "add")) {
+			hid_device_add(ctx, devnode);
+
+		} else if (!strcmp(action, "remove")) {
+			hid_device_remove(ctx, devnode);
+		}
+	}
+
+	udev_device_unref(dev);
+}
+
+static void hid_initial_scan(struct hid *ctx)
+{
+	struct udev_enumerate *enumerate = udev_enumerate_new(ctx->udev);
+	if (!enumerate)
+		return;
+
+	udev_enumerate_add_match_subsystem(enumerate, "hidraw");
+	udev_enumerate_scan_devices(enumerate);
+
+	struct udev_list_entry *devs = udev_enumerate_get_list_entry(enumerate);
+	for (struct udev_list_entry *item = devs; item; item = udev_list_entry_get_next(item)) {
+		const char *syspath = udev_list_entry_get_name(item);
+		struct udev_device *dev = udev_device_new_from_syspath(ctx->udev, syspath);
+
+		if (dev) {
+			const char *devnode = udev_device_get_devnode(dev);
+			if (devnode)
+				hid_device_add(ctx, devnode);
+
+			udev_device_unref(dev);
+		}
+	}
+
+	udev_enumerate_unref(enumerate);
+}
+
+
+// Public
+
+struct hid *mty_hid_create(HID_CONNECT connect, HID_DISCONNECT disconnect, HID_REPORT report, void *opaque)
+{
+	if (!libudev_global_init())
+		return NULL;
+
+	bool r = true;
+
+	struct hid *ctx = MTY_Alloc(1, sizeof(struct hid));
+	ctx->connect = connect;
+	ctx->disconnect = disconnect;
+	ctx->report = report;
+	ctx->opaque = opaque;
+	ctx->devices = MTY_HashCreate(0);
+	ctx->devices_rev = MTY_HashCreate(0);
+
+	for (uint8_t x = 0; x < HID_FD_MAX; x++) {
+		ctx->fds[x].fd = -1;
+		ctx->fds[x].events = POLLIN;
+	}
+
+	ctx->udev = udev_new();
+	if (!ctx->udev) {
+		r = false;
+		MTY_Log("'udev_new' failed");
+		goto except;
+	}
+
+	ctx->udev_monitor = udev_monitor_new_from_netlink(ctx->udev, "udev");
+	if (!ctx->udev_monitor) {
+		r = false;
+		MTY_Log("'udev_monitor_new_from_netlink' failed");
+		goto except;
+	}
+
+	int32_t e = udev_monitor_filter_add_match_subsystem_devtype(ctx->udev_monitor, "hidraw", NULL);
+	if (e < 0) {
+		r = false;
+		MTY_Log("'udev_monitor_filter_add_match_subsystem_devtype' failed with error %d", e);
+		goto except;
+	}
+
+	e = udev_monitor_enable_receiving(ctx->udev_monitor);
+	if (e < 0) {
+		r = false;
+		MTY_Log("'udev_monitor_enable_receiving' failed with error %d", e);
+		goto except;
+	}
+
+	ctx->fds[0].fd = udev_monitor_get_fd(ctx->udev_monitor);
+	if (ctx->fds[0].fd < 0) {
+		r = false;
+		MTY_Log("'udev_monitor_get_fd' failed with error %d", ctx->fds[0].fd);
+		goto except;
+	}
+
+	except:
+
+	if (!r)
+		mty_hid_destroy(&ctx);
+
+	return ctx;
+}
+
+struct hid_dev *mty_hid_get_device_by_id(struct hid *ctx, uint32_t id)
+{
+	return MTY_HashGetInt(ctx->devices_rev, id);
+}
+
+void mty_hid_destroy(struct hid **hid)
+{
+	if (!hid || !*hid)
+		return;
+
+	struct hid *ctx = *hid;
+
+	if (ctx->udev_monitor)
+		udev_monitor_unref(ctx->udev_monitor);
+
+	if (ctx->udev)
+		udev_unref(ctx->udev);
+
+	MTY_HashDestroy(&ctx->devices, hid_device_destroy);
+	MTY_HashDestroy(&ctx->devices_rev, NULL);
+
+	MTY_Free(ctx);
+	*hid = NULL;
+}
+
+void mty_hid_device_write(struct hid_dev *ctx, const void *buf, size_t size)
+{
+	// hidraw expects the report ID in the first byte, 0 for unnumbered reports
+	if (write(ctx->fd, buf, size) == -1)
+		MTY_Log("'write' failed with errno %d", errno);
+}
+
+bool mty_hid_device_feature(struct hid_dev *ctx, void *buf, size_t size, size_t *size_out)
+{
+	int32_t n = ioctl(ctx->fd, HIDIOCGFEATURE(size), buf);
+
+	if (n == -1) {
+		MTY_Log("'ioctl' failed with errno %d", errno);
+		return false;
+	}
+
+	*size_out = n;
+
+	return true;
+}
+
+void mty_hid_default_state(struct hid_dev *ctx, const void *buf, size_t size, MTY_ControllerEvent *c)
+{
+	// Devices without a driver are left to evdev
+	c->type = MTY_CTYPE_DEFAULT;
+	c->vid = ctx->vid;
+	c->pid = ctx->pid;
+	c->id = ctx->id;
+}
+
+void mty_hid_default_rumble(struct hid *ctx, uint32_t id, uint16_t low, uint16_t high)
+{
+}
+
+void *mty_hid_device_get_state(struct hid_dev *ctx)
+{
+	return ctx->state;
+}
+
+uint16_t mty_hid_device_get_vid(struct hid_dev *ctx)
+{
+	return ctx->vid;
+}
+
+uint16_t mty_hid_device_get_pid(struct hid_dev *ctx)
+{
+	return ctx->pid;
+}
+
+uint32_t mty_hid_device_get_id(struct hid_dev *ctx)
+{
+	return ctx->id;
+}
+
+uint32_t mty_hid_device_get_input_report_size(struct hid_dev *ctx)
+{
+	return ctx->input_size;
+}
+
+
+// Linux specific
+
+void mty_hid_linux_poll(struct hid *ctx)
+{
+	// Fire off an initial enumerate to populate already connected devices
+	if (!ctx->init_scan) {
+		hid_initial_scan(ctx);
+		ctx->init_scan = true;
+	}
+
+	int32_t e = poll(ctx->fds, HID_FD_MAX, 0);
+	if (e <= 0)
+		return;
+
+	for (uint8_t x = 0; x < HID_FD_MAX; x++) {
+		if (ctx->fds[x].fd == -1)
+			continue;
+
+		if (ctx->fds[x].revents & (POLLIN | POLLHUP | POLLERR)) {
+			// udev_monitor fd
+			if (x == 0) {
+				hid_monitor_event(ctx);
+
+			// hidraw reports
+			} else {
+				struct hid_dev *dev = MTY_HashGetInt(ctx->devices_rev, ctx->fds[x].fd);
+				if (dev)
+					hid_device_read(ctx, dev);
+			}
+		}
+	}
+}
+
+bool mty_hid_linux_has_device(struct hid *ctx, uint16_t vid, uint16_t pid)
+{
+	uint64_t iter = 0;
+
+	for (int64_t id = 0; MTY_HashGetNextKeyInt(ctx->devices_rev, &iter, &id);) {
+		struct hid_dev *dev = MTY_HashGetInt(ctx->devices_rev, id);
+
+		if (dev && dev->vid == vid && dev->pid == pid)
+			return true;
+	}
+
+	return false;
+}
@@ -0,0 +1,723 @@
+// Copyright (c) Christopher D. Dickson <cdd@matoya.group>
+//
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+#define _GNU_SOURCE // syscall, pthread_mutexattr_setrobust
+
+#include "matoya.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <signal.h>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#define RING_MAGIC         0x474E5249
+#define RING_ALIGN         16
+#define RING_MAX_PRODUCERS 16
+#define RING_POLL_INTERVAL 100
+#define RING_BLOCK_QUEUED  -1
+
+#define RING_ALIGN_UP(v, a) \
+	(((v) + ((a) - 1)) & ~((uint64_t) (a) - 1))
+
+enum {
+	RING_COMMITTED = 0x1,
+	RING_WRAP      = 0x2,
+	RING_BLOCK     = 0x4,
+};
+
+// Each record is prefixed by this header and padded to RING_ALIGN. `pid` is the
+// producer that reserved the record and is never written by the commit, `aux` holds
+// the block index of committed RING_BLOCK records. An uncommitted RING_BLOCK record
+// keeps the block index in `size` so the consumer can return the block if the
+// producer dies before committing.
+
+struct ring_record {
+	MTY_Atomic32 flags;
+	uint32_t span;
+	uint32_t size;
+	int32_t aux;
+	int32_t pid;
+	uint32_t padding[3];
+};
+
+struct ring_header {
+	uint32_t magic;
+	MTY_SharedRingType type;
+	uint64_t ring_size;
+	uint64_t block_size;
+	uint32_t num_blocks;
+	uint64_t ring_offset;
+	uint64_t states_offset;
+	uint64_t blocks_offset;
+	uint64_t total_size;
+
+	MTY_Atomic64 head;
+	MTY_Atomic64 tail;
+
+	// Futex words, incremented whenever data is committed or space is freed
+	MTY_Atomic32 data_seq;
+	MTY_Atomic32 space_seq;
+	MTY_Atomic32 consumer_waiting;
+	MTY_Atomic32 producers_waiting;
+
+	MTY_Atomic32 consumer;
+	MTY_Atomic32 attached;
+	MTY_Atomic32 producers[RING_MAX_PRODUCERS];
+
+	pthread_mutex_t lock;
+};
+
+struct MTY_SharedRing {
+	int32_t fd;
+	char *name;
+	bool consumer;
+	int32_t pid;
+	int32_t slot;
+	size_t size;
+
+	struct ring_header *hdr;
+	uint8_t *ring;
+	uint8_t *blocks;
+	MTY_Atomic32 *states;
+
+	uint64_t reserved;
+	bool has_reserved;
+};
+
+
+// Process helpers
+
+static bool ring_pid_alive(int32_t pid)
+{
+	if (pid <= 0)
+		return false;
+
+	return kill(pid, 0) == 0 || errno == EPERM;
+}
+
+static void ring_futex_wait(MTY_Atomic32 *word, int32_t val, int32_t timeout)
+{
+	struct timespec ts = {0};
+	ts.tv_sec = timeout / 1000;
+	ts.tv_nsec = (timeout % 1000) * 1000 * 1000;
+
+	// The word lives in shared memory, so FUTEX_PRIVATE_FLAG must not be used
+	if (syscall(SYS_futex, &word->value, FUTEX_WAIT, val, &ts, NULL, 0) == -1)
+		if (errno != EAGAIN && errno != ETIMEDOUT && errno != EINTR)
+			MTY_Log("'futex' failed with errno %d", errno);
+}
+
+static void ring_futex_wake(MTY_Atomic32 *word, MTY_Atomic32 *waiting, int32_t n)
+{
+	MTY_Atomic32Add(word, 1);
+
+	if (MTY_Atomic32CAS(waiting, 1, 0))
+		syscall(SYS_futex, &word->value, FUTEX_WAKE, n, NULL, NULL, 0);
+}
+
+static bool ring_wait(MTY_Atomic32 *word, MTY_Atomic32 *waiting, int32_t seq, MTY_Time start,
+	int32_t timeout)
+{
+	int32_t remaining = RING_POLL_INTERVAL;
+
+	if (timeout >= 0) {
+		remaining = timeout - (int32_t) MTY_TimeDiff(start, MTY_GetTime());
+
+		if (remaining <= 0)
+			return false;
+
+		if (remaining > RING_POLL_INTERVAL)
+			remaining = RING_POLL_INTERVAL;
+	}
+
+	MTY_Atomic32Set(waiting, 1);
+
+	// Waking is bounded by RING_POLL_INTERVAL so a dead peer is noticed
+	if (MTY_Atomic32Get(word) == seq)
+		ring_futex_wait(word, seq, remaining);
+
+	return true;
+}
+
+static void ring_lock(MTY_SharedRing *ctx)
+{
+	if (ctx->hdr->type != MTY_SHARED_RING_MPSC)
+		return;
+
+	int32_t e = pthread_mutex_lock(&ctx->hdr->lock);
+
+	// A producer died while holding the lock, shared state is only modified
+	// after all record headers are written, so it is already consistent
+	if (e == EOWNERDEAD) {
+		e = pthread_mutex_consistent(&ctx->hdr->lock);
+		if (e != 0)
+			MTY_LogFatal("'pthread_mutex_consistent' failed with error %d", e);
+
+	} else if (e != 0) {
+		MTY_LogFatal("'pthread_mutex_lock' failed with error %d", e);
+	}
+}
+
+static void ring_unlock(MTY_SharedRing *ctx)
+{
+	if (ctx->hdr->type != MTY_SHARED_RING_MPSC)
+		return;
+
+	int32_t e = pthread_mutex_unlock(&ctx->hdr->lock);
+	if (e != 0)
+		MTY_LogFatal("'pthread_mutex_unlock' failed with error %d", e);
+}
+
+static struct ring_record *ring_record(MTY_SharedRing *ctx, uint64_t offset)
+{
+	return (struct ring_record *) (ctx->ring + offset % ctx->hdr->ring_size);
+}
+
+static bool ring_consumer_alive(MTY_SharedRing *ctx)
+{
+	return ring_pid_alive(MTY_Atomic32Get(&ctx->hdr->consumer));
+}
+
+static bool ring_reclaim(MTY_SharedRing *ctx, uint32_t slot, int32_t pid)
+{
+	// Releases the producer slot and any blocks the dead producer was filling
+	if (!MTY_Atomic32CAS(&ctx->hdr->producers[slot], pid, 0))
+		return false;
+
+	for (uint32_t x = 0; x < ctx->hdr->num_blocks; x++)
+		MTY_Atomic32CAS(&ctx->states[x], pid, 0);
+
+	ring_futex_wake(&ctx->hdr->space_seq, &ctx->hdr->producers_waiting, INT_MAX);
+
+	return true;
+}
+
+static bool ring_producers_alive(MTY_SharedRing *ctx)
+{
+	bool alive = false;
+
+	for (uint32_t x = 0; x < RING_MAX_PRODUCERS; x++) {
+		int32_t pid = MTY_Atomic32Get(&ctx->hdr->producers[x]);
+
+		if (pid == 0)
+			continue;
+
+		if (ring_pid_alive(pid)) {
+			alive = true;
+			continue;
+		}
+
+		ring_reclaim(ctx, x, pid);
+	}
+
+	return alive;
+}
+
+
+// Mapping
+
+static MTY_SharedRing *ring_map(const char *name, int32_t fd, size_t size, bool consumer)
+{
+	MTY_SharedRing *ctx = MTY_Alloc(1, sizeof(MTY_SharedRing));
+	ctx->fd = fd;
+	ctx->name = MTY_Strdup(name);
+	ctx->consumer = consumer;
+	ctx->pid = getpid();
+	ctx->slot = -1;
+	ctx->size = size;
+
+	void *mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (mem == MAP_FAILED) {
+		MTY_Log("'mmap' failed with errno %d", errno);
+		MTY_SharedRingDestroy(&ctx);
+		return NULL;
+	}
+
+	ctx->hdr = mem;
+
+	return ctx;
+}
+
+static void ring_set_pointers(MTY_SharedRing *ctx)
+{
+	uint8_t *base = (uint8_t *) ctx->hdr;
+
+	ctx->ring = base + ctx->hdr->ring_offset;
+	ctx->states = (MTY_Atomic32 *) (base + ctx->hdr->states_offset);
+	ctx->blocks = base + ctx->hdr->blocks_offset;
+}
+
+static char *ring_shm_name(const char *name)
+{
+	return MTY_SprintfD("/mty-ring-%s", name);
+}
+
+static bool ring_unlink_stale(const char *shm_name)
+{
+	int32_t fd = shm_open(shm_name, O_RDWR, 0);
+	if (fd == -1)
+		return errno == ENOENT;
+
+	// A ring is stale if its creator crashed before initializing it or if the
+	// consumer that owns it is no longer running
+	bool stale = false;
+	struct stat st = {0};
+
+	if (fstat(fd, &st) == 0) {
+		if ((size_t) st.st_size < sizeof(struct ring_header)) {
+			stale = true;
+
+		} else {
+			struct ring_header *hdr = mmap(NULL, sizeof(struct ring_header), PROT_READ | PROT_WRITE,
+				MAP_SHARED, fd, 0);
+
+			if (hdr != MAP_FAILED) {
+				stale = __atomic_load_n(&hdr->magic, __ATOMIC_SEQ_CST) != RING_MAGIC ||
+					!ring_pid_alive(MTY_Atomic32Get(&hdr->consumer));
+
+				munmap(hdr, sizeof(struct ring_header));
+			}
+		}
+	}
+
+	close(fd);
+
+	if (stale && shm_unlink(shm_name) == -1 && errno != ENOENT) {
+		MTY_Log("'shm_unlink' failed with errno %d", errno);
+		return false;
+	}
+
+	return stale;
+}
+
+
+// Producer
+
+static struct ring_record *ring_reserve(MTY_SharedRing *ctx, size_t size, int32_t timeout)
+{
+	struct ring_header *hdr = ctx->hdr;
+	uint64_t span = RING_ALIGN_UP(sizeof(struct ring_record) + size, RING_ALIGN);
+
+	if (span > hdr->ring_size / 2) {
+		MTY_Log("Record of %zu bytes is too large for the ring, use a block instead", size);
+		return NULL;
+	}
+
+	if (ctx->has_reserved) {
+		MTY_Log("A buffer is already reserved and must be pushed first");
+		return NULL;
+	}
+
+	MTY_Time start = MTY_GetTime();
+
+	while (true) {
+		int32_t seq = MTY_Atomic32Get(&hdr->space_seq);
+
+		ring_lock(ctx);
+
+		uint64_t head = (uint64_t) MTY_Atomic64Get(&hdr->head);
+		uint64_t tail = (uint64_t) MTY_Atomic64Get(&hdr->tail);
+		uint64_t pos = head % hdr->ring_size;
+		uint64_t pad = pos + span > hdr->ring_size ? hdr->ring_size - pos : 0;
+
+		if (head + pad + span - tail <= hdr->ring_size) {
+			// Records never straddle the end of the ring, a padding record is
+			// committed in the remaining space instead
+			if (pad > 0) {
+				struct ring_record *rec = ring_record(ctx, head);
+				rec->span = (uint32_t) pad;
+				rec->size = 0;
+				rec->aux = 0;
+				rec->pid = ctx->pid;
+				MTY_Atomic32Set(&rec->flags, RING_WRAP | RING_COMMITTED);
+			}
+
+			// The header may land on stale payload bytes from a previous lap, so the
+			// flags must be cleared before the record becomes visible via head
+			struct ring_record *rec = ring_record(ctx, head + pad);
+			MTY_Atomic32Set(&rec->flags, 0);
+			rec->span = (uint32_t) span;
+			rec->size = 0;
+			rec->aux = 0;
+			rec->pid = ctx->pid;
+
+			MTY_Atomic64Set(&hdr->head, head + pad + span);
+
+			ring_unlock(ctx);
+
+			ctx->reserved = head + pad;
+			ctx->has_reserved = true;
+
+			return rec;
+		}
+
+		ring_unlock(ctx);
+
+		if (!ring_consumer_alive(ctx)) {
+			MTY_Log("Consumer process is no longer running");
+			return NULL;
+		}
+
+		if (!ring_wait(&hdr->space_seq, &hdr->producers_waiting, seq, start, timeout))
+			return NULL;
+	}
+}
+
+static void ring_commit(MTY_SharedRing *ctx, size_t size, int32_t aux, uint32_t flags)
+{
+	struct ring_record *rec = ring_record(ctx, ctx->reserved);
+	rec->size = (uint32_t) size;
+	rec->aux = aux;
+
+	MTY_Atomic32Set(&rec->flags, flags | RING_COMMITTED);
+	ctx->has_reserved = false;
+
+	ring_futex_wake(&ctx->hdr->data_seq, &ctx->hdr->consumer_waiting, 1);
+}
+
+
+// Public
+
+MTY_SharedRing *MTY_SharedRingCreate(const char *name, MTY_SharedRingType type, size_t size,
+	size_t blockSize, uint32_t numBlocks)
+{
+	size_t page = sysconf(_SC_PAGESIZE);
+
+	uint64_t ring_size = RING_ALIGN_UP(size, RING_ALIGN);
+	uint64_t block_size = RING_ALIGN_UP(blockSize, 64);
+
+	if (ring_size < 2 * RING_ALIGN_UP(sizeof(struct ring_record) + sizeof(uint32_t), RING_ALIGN)) {
+		MTY_Log("Ring size of %zu bytes is too small", size);
+		return NULL;
+	}
+
+	uint64_t ring_offset = RING_ALIGN_UP(sizeof(struct ring_header), page);
+	uint64_t states_offset = ring_offset + ring_size;
+	uint64_t blocks_offset = RING_ALIGN_UP(states_offset + numBlocks * sizeof(MTY_Atomic32), page);
+	uint64_t total_size = RING_ALIGN_UP(blocks_offset + block_size * numBlocks, page);
+
+	char *shm_name = ring_shm_name(name);
+	int32_t fd = shm_open(shm_name, O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+
+	// A consumer that crashed never unlinked its ring, so the name is taken over
+	if (fd == -1 && errno == EEXIST && ring_unlink_stale(shm_name))
+		fd = shm_open(shm_name, O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+
+	if (fd == -1) {
+		MTY_Log("'shm_open' failed with errno %d", errno);
+		MTY_Free(shm_name);
+		return NULL;
+	}
+
+	if (ftruncate(fd, total_size) == -1) {
+		MTY_Log("'ftruncate' failed with errno %d", errno);
+		shm_unlink(shm_name);
+		MTY_Free(shm_name);
+		close(fd);
+		return NULL;
+	}
+
+	MTY_Free(shm_name);
+
+	MTY_SharedRing *ctx = ring_map(name, fd, total_size, true);
+	if (!ctx)
+		return NULL;
+
+	struct ring_header *hdr = ctx->hdr;
+	hdr->type = type;
+	hdr->ring_size = ring_size;
+	hdr->block_size = block_size;
+	hdr->num_blocks = numBlocks;
+	hdr->ring_offset = ring_offset;
+	hdr->states_offset = states_offset;
+	hdr->blocks_offset = blocks_offset;
+	hdr->total_size = total_size;
+
+	pthread_mutexattr_t attr;
+	pthread_mutexattr_init(&attr);
+	pthread_mutexattr_setpshared(&attr, PTHREAD_PROCESS_SHARED);
+	pthread_mutexattr_setrobust(&attr, PTHREAD_MUTEX_ROBUST);
+
+	int32_t e = pthread_mutex_init(&hdr->lock, &attr);
+	pthread_mutexattr_destroy(&attr);
+
+	if (e != 0) {
+		MTY_Log("'pthread_mutex_init' failed with error %d", e);
+		MTY_SharedRingDestroy(&ctx);
+		return NULL;
+	}
+
+	ring_set_pointers(ctx);
+
+	MTY_Atomic32Set(&hdr->consumer, ctx->pid);
+
+	// Publishing the magic value makes the ring visible to MTY_SharedRingOpen
+	__atomic_store_n(&hdr->magic, RING_MAGIC, __ATOMIC_SEQ_CST);
+
+	return ctx;
+}
+
+MTY_SharedRing *MTY_SharedRingOpen(const char *name)
+{
+	char *shm_name = ring_shm_name(name);
+	int32_t fd = shm_open(shm_name, O_RDWR, 0);
+	MTY_Free(shm_name);
+
+	if (fd == -1) {
+		MTY_Log("'shm_open' failed with errno %d", errno);
+		return NULL;
+	}
+
+	struct stat st = {0};
+	if (fstat(fd, &st) == -1 || (size_t) st.st_size < sizeof(struct ring_header)) {
+		MTY_Log("Shared ring '%s' is not initialized", name);
+		close(fd);
+		return NULL;
+	}
+
+	MTY_SharedRing *ctx = ring_map(name, fd, st.st_size, false);
+	if (!ctx)
+		return NULL;
+
+	struct ring_header *hdr = ctx->hdr;
+
+	if (__atomic_load_n(&hdr->magic, __ATOMIC_SEQ_CST) != RING_MAGIC || hdr->total_size != (uint64_t) st.st_size) {
+		MTY_Log("Shared ring '%s' is not initialized", name);
+		MTY_SharedRingDestroy(&ctx);
+		return NULL;
+	}
+
+	ring_set_pointers(ctx);
+
+	// Register as a producer so the consumer can detect if this process dies
+	uint32_t max = hdr->type == MTY_SHARED_RING_SPSC ? 1 : RING_MAX_PRODUCERS;
+
+	for (uint32_t x = 0; x < max && ctx->slot < 0; x++) {
+		int32_t pid = MTY_Atomic32Get(&hdr->producers[x]);
+
+		if (pid != 0 && ring_pid_alive(pid))
+			continue;
+
+		// A dead producer's blocks are returned before its slot is taken over
+		if (pid != 0 && !ring_reclaim(ctx, x, pid))
+			continue;
+
+		if (MTY_Atomic32CAS(&hdr->producers[x], 0, ctx->pid))
+			ctx->slot = x;
+	}
+
+	if (ctx->slot < 0) {
+		MTY_Log("Shared ring '%s' has no producer slots available", name);
+		MTY_SharedRingDestroy(&ctx);
+		return NULL;
+	}
+
+	MTY_Atomic32Add(&hdr->attached, 1);
+
+	return ctx;
+}
+
+void MTY_SharedRingDestroy(MTY_SharedRing **ring)
+{
+	if (!ring || !*ring)
+		return;
+
+	MTY_SharedRing *ctx = *ring;
+
+	if (ctx->hdr) {
+		if (ctx->consumer) {
+			MTY_Atomic32Set(&ctx->hdr->consumer, 0);
+			ring_futex_wake(&ctx->hdr->space_seq, &ctx->hdr->producers_waiting, INT_MAX);
+
+		} else if (ctx->slot >= 0) {
+			for (uint32_t x = 0; x < ctx->hdr->num_blocks; x++)
+				MTY_Atomic32CAS(&ctx->states[x], ctx->pid, 0);
+
+			MTY_Atomic32CAS(&ctx->hdr->producers[ctx->slot], ctx->pid, 0);
+			ring_futex_wake(&ctx->hdr->data_seq, &ctx->hdr->consumer_waiting, 1);
+		}
+
+		if (munmap(ctx->hdr, ctx->size) == -1)
+			MTY_Log("'munmap' failed with errno %d", errno);
+	}
+
+	if (ctx->consumer) {
+		char *shm_name = ring_shm_name(ctx->name);
+		shm_unlink(shm_name);
+		MTY_Free(shm_name);
+	}
+
+	if (ctx->fd >= 0)
+		close(ctx->fd);
+
+	MTY_Free(ctx->name);
+
+	MTY_Free(ctx);
+	*ring = NULL;
+}
+
+void *MTY_SharedRingGetInputBuffer(MTY_SharedRing *ctx, size_t size, int32_t timeout)
+{
+	struct ring_record *rec = ring_reserve(ctx, size, timeout);
+
+	return rec ? rec + 1 : NULL;
+}
+
+void MTY_SharedRingPush(MTY_SharedRing *ctx, size_t size)
+{
+	if (!ctx->has_reserved)
+		return;
+
+	ring_commit(ctx, size, 0, 0);
+}
+
+void *MTY_SharedRingGetBlock(MTY_SharedRing *ctx, int32_t timeout, uint32_t *index)
+{
+	struct ring_header *hdr = ctx->hdr;
+	MTY_Time start = MTY_GetTime();
+
+	while (true) {
+		int32_t seq = MTY_Atomic32Get(&hdr->space_seq);
+
+		for (uint32_t x = 0; x < hdr->num_blocks; x++) {
+			if (MTY_Atomic32CAS(&ctx->states[x], 0, ctx->pid)) {
+				*index = x;
+				return ctx->blocks + x * hdr->block_size;
+			}
+		}
+
+		if (!ring_consumer_alive(ctx)) {
+			MTY_Log("Consumer process is no longer running");
+			return NULL;
+		}
+
+		if (!ring_wait(&hdr->space_seq, &hdr->producers_waiting, seq, start, timeout))
+			return NULL;
+	}
+}
+
+bool MTY_SharedRingPushBlock(MTY_SharedRing *ctx, uint32_t index, size_t size, int32_t timeout)
+{
+	if (index >= ctx->hdr->num_blocks || size > ctx->hdr->block_size)
+		return false;
+
+	struct ring_record *rec = ring_reserve(ctx, 0, timeout);
+	if (!rec)
+		return false;
+
+	// Ownership of the block passes to the ring until the consumer pops it. The
+	// record is tagged first so the block is not lost if this process dies here.
+	rec->size = index;
+	MTY_Atomic32Set(&rec->flags, RING_BLOCK);
+	MTY_Atomic32Set(&ctx->states[index], RING_BLOCK_QUEUED);
+	ring_commit(ctx, size, index, RING_BLOCK);
+
+	return true;
+}
+
+MTY_Async MTY_SharedRingGetOutputBuffer(MTY_SharedRing *ctx, int32_t timeout, void **buffer,
+	size_t *size)
+{
+	struct ring_header *hdr = ctx->hdr;
+	MTY_Time start = MTY_GetTime();
+
+	while (true) {
+		int32_t seq = MTY_Atomic32Get(&hdr->data_seq);
+
+		uint64_t tail = (uint64_t) MTY_Atomic64Get(&hdr->tail);
+		uint64_t head = (uint64_t) MTY_Atomic64Get(&hdr->head);
+
+		if (tail != head) {
+			struct ring_record *rec = ring_record(ctx, tail);
+			uint32_t flags = MTY_Atomic32Get(&rec->flags);
+
+			if (flags & RING_COMMITTED) {
+				if (flags & RING_WRAP) {
+					MTY_SharedRingPop(ctx);
+					continue;
+				}
+
+				if (rec->span < sizeof(struct ring_record) || rec->span > hdr->ring_size) {
+					MTY_Log("Shared ring '%s' is corrupt", ctx->name);
+					return MTY_ASYNC_ERROR;
+				}
+
+				if (flags & RING_BLOCK) {
+					if ((uint32_t) rec->aux >= hdr->num_blocks)
+						return MTY_ASYNC_ERROR;
+
+					*buffer = ctx->blocks + (uint64_t) rec->aux * hdr->block_size;
+
+				} else {
+					*buffer = rec + 1;
+				}
+
+				if (size)
+					*size = rec->size;
+
+				return MTY_ASYNC_OK;
+			}
+
+			// The producer that reserved this record died before committing it. It may
+			// have committed just before dying, so the flags are checked again.
+			if (!ring_pid_alive(rec->pid) && !(MTY_Atomic32Get(&rec->flags) & RING_COMMITTED)) {
+				MTY_SharedRingPop(ctx);
+				continue;
+			}
+
+		} else if (!ring_producers_alive(ctx) && MTY_Atomic32Get(&hdr->attached) > 0) {
+			return MTY_ASYNC_DONE;
+		}
+
+		if (!ring_wait(&hdr->data_seq, &hdr->consumer_waiting, seq, start, timeout))
+			return MTY_ASYNC_CONTINUE;
+	}
+}
+
+void MTY_SharedRingPop(MTY_SharedRing *ctx)
+{
+	struct ring_header *hdr = ctx->hdr;
+
+	uint64_t tail = (uint64_t) MTY_Atomic64Get(&hdr->tail);
+	if (tail == (uint64_t) MTY_Atomic64Get(&hdr->head))
+		return;
+
+	struct ring_record *rec = ring_record(ctx, tail);
+	uint32_t flags = MTY_Atomic32Get(&rec->flags);
+	uint32_t span = rec->span;
+
+	if (flags & RING_BLOCK) {
+		uint32_t index = (flags & RING_COMMITTED) ? (uint32_t) rec->aux : rec->size;
+
+		if (index < hdr->num_blocks)
+			MTY_Atomic32CAS(&ctx->states[index], RING_BLOCK_QUEUED, 0);
+	}
+
+	// Stale flags must not be mistaken for a commit on the next lap
+	MTY_Atomic32Set(&rec->flags, 0);
+	MTY_Atomic64Set(&hdr->tail, tail + span);
+
+	ring_futex_wake(&hdr->space_seq, &hdr->producers_waiting, INT_MAX);
+}
+
+bool MTY_SharedRingIsPeerAlive(MTY_SharedRing *ctx)
+{
+	return ctx->consumer ? ring_producers_alive(ctx) : ring_consumer_alive(ctx);
+}
+
+size_t MTY_SharedRingGetBlockSize(MTY_SharedRing *ctx)
+{
+	return (size_t) ctx->hdr->block_size;
+}
@@ -13,7 +13,21 @@
 #include <errno.h>
 #include <wchar.h>
 
+#if !defined(__wasi__)
+	#include <sys/mman.h>
+#endif
+
+#if defined(__linux__)
+	#include <unistd.h>
+	#include <sys/syscall.h>
+#endif
+
 #include "matoya.h"
+#include "pool.h"
+
+#define MEMORY_NODES          1024
+#define MEMORY_MPOL_PREFERRED 1
+#define MEMORY_PAGE           4096
 
 void *MTY_AllocAligned(size_t size, size_t align)
 {
@@ -33,6 +47,120 @@ void MTY_FreeAligned(void *mem)
 	free(mem);
 }
 
+#if defined(__wasi__)
+
+void *mty_pages_alloc(size_t *size, bool huge, bool *hugetlb)
+{
+	// No virtual memory, pages come from the heap already zeroed
+	*hugetlb = false;
+
+	return MTY_AllocAligned(*size, MEMORY_PAGE);
+}
+
+void mty_pages_free(void *mem, size_t size)
+{
+	MTY_FreeAligned(mem);
+}
+
+#else
+
+void *mty_pages_alloc(size_t *size, bool huge, bool *hugetlb)
+{
+	#if defined(MAP_HUGETLB)
+		// Explicit huge page mappings must be a multiple of the huge page size, the
+		// fallback below maps only the requested size
+		if (*hugetlb) {
+			size_t rounded = (*size + MTY_HUGE_PAGE_SIZE - 1) / MTY_HUGE_PAGE_SIZE * MTY_HUGE_PAGE_SIZE;
+			void *mem = mmap(NULL, rounded, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+
+			if (mem != MAP_FAILED) {
+				*size = rounded;
+				return mem;
+			}
+		}
+	#endif
+
+	*hugetlb = false;
+
+	uint8_t *mem = NULL;
+
+	#if defined(MADV_HUGEPAGE)
+		// Transparent huge pages only back 2 MB aligned ranges, so large mappings are
+		// over-allocated then trimmed to an aligned start
+		if (huge && *size >= MTY_HUGE_PAGE_SIZE) {
+			mem = mmap(NULL, *size + MTY_HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+			if (mem == MAP_FAILED)
+				MTY_LogFatal("'mmap' failed with errno %d", errno);
+
+			size_t head = (MTY_HUGE_PAGE_SIZE - (uintptr_t) mem % MTY_HUGE_PAGE_SIZE) % MTY_HUGE_PAGE_SIZE;
+
+			if (head > 0)
+				munmap(mem, head);
+
+			munmap(mem + head + *size, MTY_HUGE_PAGE_SIZE - head);
+
+			mem += head;
+			madvise(mem, *size, MADV_HUGEPAGE);
+
+			return mem;
+		}
+	#endif
+
+	mem = mmap(NULL, *size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+	if (mem == MAP_FAILED)
+		MTY_LogFatal("'mmap' failed with errno %d", errno);
+
+	return mem;
+}
+
+void mty_pages_free(void *mem, size_t size)
+{
+	munmap(mem, size);
+}
+
+#endif
+
+void *MTY_AllocNode(size_t size, uint32_t node)
+{
+	#if defined(__wasi__)
+		// A single node and no virtual memory, so there is nothing to bind
+		return MTY_AllocAligned(size, MEMORY_PAGE);
+
+	#else
+		bool hugetlb = false;
+		void *mem = mty_pages_alloc(&size, false, &hugetlb);
+
+		#if defined(__linux__) && defined(SYS_mbind)
+			// Binding before first touch places every page on the node no matter which
+			// thread faults it in, MPOL_PREFERRED falls back to other nodes when full
+			unsigned long mask[MEMORY_NODES / (sizeof(unsigned long) * 8)] = {0};
+
+			if (node < MEMORY_NODES - 1) {
+				mask[node / (sizeof(unsigned long) * 8)] |= 1UL << (node % (sizeof(unsigned long) * 8));
+
+				if (syscall(SYS_mbind, mem, size, MEMORY_MPOL_PREFERRED, mask, MEMORY_NODES, 0) != 0 && errno != ENOSYS)
+					MTY_Log("'mbind' failed with errno %d", errno);
+			}
+		#endif
+
+		return mem;
+	#endif
+}
+
+void MTY_FreeNode(void *mem, size_t size)
+{
+	if (!mem)
+		return;
+
+	#if defined(__wasi__)
+		MTY_FreeAligned(mem);
+	#else
+		mty_pages_free(mem, size);
+	#endif
+}
+
 int32_t MTY_Strcasecmp(const char *s0, const char *s1)
 {
 	return strcasecmp(s0, s1);
@@ -7,11 +7,12 @@
 #include "matoya.h"
 
 #include <stdlib.h>
+#include <stdio.h>
 #include <string.h>
 
 #include "net/net.h"
 #include "net/http.h"
-#include "net/gzip.h"
+#include "metrics.h"
 
 #define MTY_USER_AGENT "libmatoya/v" MTY_VERSION_STRING
 
@@ -20,56 +21,6 @@ struct request_parse_args {
 	bool ua_found;
 };
 
-static bool http_read_chunk_len(struct net *net, uint32_t timeout, size_t *len)
-{
-	*len = 0;
-	char len_buf[64] = {0};
-
-	for (uint32_t x = 0; x < 64 - 1; x++) {
-		if (!mty_net_read(net, len_buf + x, 1, timeout))
-			break;
-
-		if (x > 0 && len_buf[x - 1] == '\r' && len_buf[x] == '\n') {
-			len_buf[x - 1] = '\0';
-			*len = strtoul(len_buf, NULL, 16);
-
-			return true;
-		}
-	}
-
-	return false;
-}
-
-static bool http_read_chunked(struct net *net, void **res, size_t *size, uint32_t timeout)
-{
-	size_t chunk_len = 0;
-
-	do {
-		// Read the chunk size one byte at a time
-		if (!http_read_chunk_len(net, timeout, &chunk_len))
-			return false;
-
-		// Overflow protection
-		if (chunk_len > MTY_RES_MAX || *size + chunk_len > MTY_RES_MAX)
-			return false;
-
-		// Make room for chunk and "\r\n" after chunk
-		*res = MTY_Realloc(*res, *size + chunk_len + 2, 1);
-
-		// Read chunk into buffer with extra 2 bytes for "\r\n"
-		if (!mty_net_read(net, (uint8_t *) *res + *size, chunk_len + 2, timeout))
-			return false;
-
-		*size += chunk_len;
-
-		// Keep null character at the end of the buffer for protection
-		memset((uint8_t *) *res + *size, 0, 1);
-
-	} while (chunk_len > 0);
-
-	return true;
-}
-
 static void request_parse_headers(const char *key, const char *val, void *opaque)
 {
 	struct request_parse_args *pargs = opaque;
@@ -137,43 +88,14 @@ bool MTY_HttpRequest(const char *host, uint16_t port, bool secure, const char *m
 	if (!r)
 		goto except;
 
-	// Read response body -- either fixed content length or chunked
-	const char *val = NULL;
-	if (mty_http_get_header_int(hdr, "Content-Length", (int32_t *) responseSize) && *responseSize > 0) {
+	#if defined(MTY_METRICS)
+		char name[64];
+		snprintf(name, 64, "mty_http_requests{code=\"%u\"}", *status);
+		METRIC_COUNT_NAMED(name, "HTTP requests by response status.", 1);
+	#endif
 
-		// Overflow protection
-		if (*responseSize > MTY_RES_MAX) {
-			r = false;
-			goto except;
-		}
-
-		*response = MTY_Alloc(*responseSize + 1, 1);
-
-		r = mty_net_read(net, *response, *responseSize, timeout);
-		if (!r)
-			goto except;
-
-	} else if (mty_http_get_header_str(hdr, "Transfer-Encoding", &val) && !MTY_Strcasecmp(val, "chunked")) {
-		r = http_read_chunked(net, response, responseSize, timeout);
-		if (!r)
-			goto except;
-	}
-
-	// Check for content-encoding header and attempt to uncompress
-	if (*response && *responseSize > 0) {
-		if (mty_http_get_header_str(hdr, "Content-Encoding", &val) && !MTY_Strcasecmp(val, "gzip")) {
-			size_t zlen = 0;
-			void *z = mty_gzip_decompress(*response, *responseSize, &zlen);
-			if (!z) {
-				r = false;
-				goto except;
-			}
-
-			MTY_Free(*response);
-			*response = z;
-			*responseSize = zlen;
-		}
-	}
+	// Read the response body
+	r = mty_http_read_body(net, hdr, timeout, response, responseSize);
 
 	except:
 
@@ -0,0 +1,537 @@
+// Copyright (c) Christopher D. Dickson <cdd@matoya.group>
+//
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+#define _DEFAULT_SOURCE  // flock
+#define _DARWIN_C_SOURCE // flock
+
+#include "matoya.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <errno.h>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/file.h>
+
+#define RECORD_MAGIC    0x4C59544D // 'MTYL'
+#define RECORD_VERSION  1
+#define RECORD_ALIGN    8
+#define RECORD_EXT      ".log"
+#define RECORD_MIN_SEG  (64 * 1024)
+#define RECORD_DEF_SEG  (64 * 1024 * 1024)
+
+#define RECORD_PAD(size) \
+	(((size) + (RECORD_ALIGN - 1)) & ~((size_t) RECORD_ALIGN - 1))
+
+// Segments are pre-allocated and zero filled, so a record header of all zeroes
+// marks the end of written data
+
+struct record_segment {
+	uint32_t magic;
+	uint32_t version;
+	uint64_t index;
+};
+
+struct record_header {
+	uint32_t size;
+	uint32_t crc;
+};
+
+struct segment {
+	int32_t fd;
+	uint64_t index;
+	uint8_t *map;
+	size_t size;
+	size_t pos;
+};
+
+struct MTY_RecordLog {
+	char *dir;
+	size_t seg_size;
+	MTY_Durability durability;
+	uint32_t interval;
+
+	struct segment seg;
+	size_t synced;
+	MTY_Time last_sync;
+};
+
+struct MTY_RecordReader {
+	MTY_FileList *list;
+	uint32_t next;
+
+	struct segment seg;
+};
+
+
+// Segments
+
+static uint32_t record_crc(const void *buf, uint32_t size)
+{
+	uint32_t crc = MTY_CRC32(0xFFFFFFFF, &size, sizeof(uint32_t));
+
+	// The CRC of an empty record is zero, mix in the magic so zero filled space
+	// can never pass as a record
+	return ~MTY_CRC32(crc, buf, size) ^ RECORD_MAGIC;
+}
+
+static const char *record_seg_path(const char *dir, uint64_t index)
+{
+	char name[32];
+	snprintf(name, 32, "%016" PRIx64 RECORD_EXT, index);
+
+	return MTY_JoinPath(dir, name);
+}
+
+static bool record_seg_valid(const struct segment *seg)
+{
+	const struct record_segment *hdr = (const struct record_segment *) seg->map;
+
+	return seg->size >= sizeof(struct record_segment) && hdr->magic == RECORD_MAGIC &&
+		hdr->version == RECORD_VERSION && hdr->index == seg->index;
+}
+
+static void record_seg_close(struct segment *seg)
+{
+	if (seg->map && munmap(seg->map, seg->size) != 0)
+		MTY_Log("'munmap' failed with errno %d", errno);
+
+	if (seg->fd != -1 && close(seg->fd) != 0)
+		MTY_Log("'close' failed with errno %d", errno);
+
+	memset(seg, 0, sizeof(struct segment));
+	seg->fd = -1;
+}
+
+static bool record_seg_map(struct segment *seg, bool writable)
+{
+	int32_t prot = writable ? PROT_READ | PROT_WRITE : PROT_READ;
+
+	seg->map = mmap(NULL, seg->size, prot, MAP_SHARED, seg->fd, 0);
+
+	if (seg->map == MAP_FAILED) {
+		MTY_Log("'mmap' failed with errno %d", errno);
+		seg->map = NULL;
+		return false;
+	}
+
+	return true;
+}
+
+static size_t record_seg_scan(const struct segment *seg, size_t pos, const void **buf, size_t *size)
+{
+	if (pos + sizeof(struct record_header) > seg->size)
+		return 0;
+
+	const struct record_header *hdr = (const struct record_header *) (seg->map + pos);
+	size_t span = sizeof(struct record_header) + RECORD_PAD((size_t) hdr->size);
+
+	if (span > seg->size - pos)
+		return 0;
+
+	if (hdr->crc != record_crc(hdr + 1, hdr->size))
+		return 0;
+
+	if (buf)
+		*buf = hdr + 1;
+
+	if (size)
+		*size = hdr->size;
+
+	return span;
+}
+
+
+// Writer
+
+static bool record_sync(MTY_RecordLog *ctx)
+{
+	if (ctx->seg.pos == ctx->synced)
+		return true;
+
+	// Linux writes back pages dirtied through a shared mapping on fdatasync,
+	// other platforms require an explicit msync
+	#if defined(__linux__)
+		if (fdatasync(ctx->seg.fd) != 0) {
+			MTY_Log("'fdatasync' failed with errno %d", errno);
+			return false;
+		}
+	#else
+		size_t page = sysconf(_SC_PAGESIZE);
+		size_t start = ctx->synced & ~(page - 1);
+
+		if (msync(ctx->seg.map + start, ctx->seg.pos - start, MS_SYNC) != 0) {
+			MTY_Log("'msync' failed with errno %d", errno);
+			return false;
+		}
+	#endif
+
+	ctx->synced = ctx->seg.pos;
+	ctx->last_sync = MTY_GetTime();
+
+	return true;
+}
+
+static bool record_sync_dir(const char *dir)
+{
+	int32_t fd = open(dir, O_RDONLY);
+	if (fd == -1) {
+		MTY_Log("'open' failed with errno %d", errno);
+		return false;
+	}
+
+	bool r = fsync(fd) == 0;
+	if (!r)
+		MTY_Log("'fsync' failed with errno %d", errno);
+
+	close(fd);
+
+	return r;
+}
+
+static bool record_seg_init(MTY_RecordLog *ctx)
+{
+	struct segment *seg = &ctx->seg;
+	seg->size = ctx->seg_size;
+	seg->pos = sizeof(struct record_segment);
+
+	// Reserve the blocks up front where possible so appends never hit ENOSPC
+	// as a SIGBUS on a page fault
+	#if defined(__linux__)
+		int32_t e = posix_fallocate(seg->fd, 0, seg->size);
+		if (e != 0) {
+			MTY_Log("'posix_fallocate' failed with error %d", e);
+			return false;
+		}
+	#else
+		if (ftruncate(seg->fd, seg->size) != 0) {
+			MTY_Log("'ftruncate' failed with errno %d", errno);
+			return false;
+		}
+	#endif
+
+	if (!record_seg_map(seg, true))
+		return false;
+
+	struct record_segment *hdr = (struct record_segment *) seg->map;
+	hdr->magic = RECORD_MAGIC;
+	hdr->version = RECORD_VERSION;
+	hdr->index = seg->index;
+
+	ctx->synced = 0;
+
+	return true;
+}
+
+static bool record_seg_create(MTY_RecordLog *ctx, uint64_t index)
+{
+	struct segment *seg = &ctx->seg;
+	seg->index = index;
+
+	seg->fd = open(record_seg_path(ctx->dir, index), O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+
+	if (seg->fd == -1) {
+		MTY_Log("'open' failed with errno %d", errno);
+		return false;
+	}
+
+	// Held for the lifetime of the segment, recovery must never truncate a
+	// segment that another process is still appending to
+	if (flock(seg->fd, LOCK_EX | LOCK_NB) != 0) {
+		MTY_Log("'flock' failed with errno %d", errno);
+		return false;
+	}
+
+	if (!record_seg_init(ctx))
+		return false;
+
+	// Records synced into the new segment are only durable once its directory
+	// entry is, a crash before this point is handled by recovery
+	return record_sync_dir(ctx->dir);
+}
+
+static bool record_seg_recover(MTY_RecordLog *ctx, const MTY_FileDesc *desc, uint64_t index)
+{
+	struct segment *seg = &ctx->seg;
+	seg->index = index;
+
+	seg->fd = open(desc->path, O_RDWR);
+	if (seg->fd == -1) {
+		MTY_Log("'open' failed with errno %d", errno);
+		return false;
+	}
+
+	if (flock(seg->fd, LOCK_EX | LOCK_NB) != 0) {
+		MTY_Log("'flock' failed with errno %d", errno);
+		return false;
+	}
+
+	struct stat st = {0};
+	if (fstat(seg->fd, &st) != 0) {
+		MTY_Log("'fstat' failed with errno %d", errno);
+		return false;
+	}
+
+	seg->size = st.st_size;
+
+	if (seg->size > 0 && !record_seg_map(seg, false))
+		return false;
+
+	// A crash while creating the newest segment can leave it empty or without
+	// a header, it cannot hold any records so it is reinitialized in place
+	const struct record_segment *hdr = (const struct record_segment *) seg->map;
+
+	if (!hdr || (seg->size >= sizeof(struct record_segment) && hdr->magic == 0)) {
+		MTY_Log("Segment '%s' has no header, reinitializing", desc->name);
+
+		if (seg->map && munmap(seg->map, seg->size) != 0)
+			MTY_Log("'munmap' failed with errno %d", errno);
+
+		seg->map = NULL;
+
+		if (ftruncate(seg->fd, 0) != 0) {
+			MTY_Log("'ftruncate' failed with errno %d", errno);
+			return false;
+		}
+
+		return record_seg_init(ctx);
+	}
+
+	if (!record_seg_valid(seg)) {
+		MTY_Log("Segment '%s' is not a valid record log segment", desc->name);
+		return false;
+	}
+
+	// Scan to the last record with a valid CRC, anything past it is a torn write
+	seg->pos = sizeof(struct record_segment);
+
+	for (size_t span = 1; span > 0; seg->pos += span)
+		span = record_seg_scan(seg, seg->pos, NULL, NULL);
+
+	if (munmap(seg->map, seg->size) != 0)
+		MTY_Log("'munmap' failed with errno %d", errno);
+
+	seg->map = NULL;
+
+	// Truncating then extending zero fills the torn tail without touching every page
+	size_t size = seg->size > ctx->seg_size ? seg->size : ctx->seg_size;
+
+	if (ftruncate(seg->fd, seg->pos) != 0 || ftruncate(seg->fd, size) != 0) {
+		MTY_Log("'ftruncate' failed with errno %d", errno);
+		return false;
+	}
+
+	seg->size = size;
+
+	if (!record_seg_map(seg, true))
+		return false;
+
+	ctx->synced = seg->pos;
+
+	return true;
+}
+
+static bool record_rotate(MTY_RecordLog *ctx)
+{
+	if (ctx->durability != MTY_DURABILITY_NONE && !record_sync(ctx))
+		return false;
+
+	// Completed segments are trimmed to their written length
+	struct segment *seg = &ctx->seg;
+	uint64_t index = seg->index + 1;
+
+	if (ftruncate(seg->fd, seg->pos) != 0)
+		MTY_Log("'ftruncate' failed with errno %d", errno);
+
+	record_seg_close(seg);
+
+	return record_seg_create(ctx, index);
+}
+
+MTY_RecordLog *MTY_RecordLogCreate(const char *dir, size_t segmentSize, MTY_Durability durability,
+	uint32_t interval)
+{
+	MTY_RecordLog *ctx = MTY_Alloc(1, sizeof(MTY_RecordLog));
+	ctx->dir = MTY_Strdup(dir);
+	ctx->seg_size = RECORD_PAD(segmentSize == 0 ? RECORD_DEF_SEG : segmentSize);
+	ctx->durability = durability;
+	ctx->interval = interval;
+	ctx->last_sync = MTY_GetTime();
+	ctx->seg.fd = -1;
+
+	if (ctx->seg_size < RECORD_MIN_SEG)
+		ctx->seg_size = RECORD_MIN_SEG;
+
+	bool r = true;
+
+	MTY_Mkdir(dir);
+
+	// Appending continues in the most recent segment
+	MTY_FileList *list = MTY_GetFileList(dir, RECORD_EXT);
+	MTY_FileDesc *last = NULL;
+
+	for (uint32_t x = 0; x < list->len; x++)
+		if (!list->files[x].dir)
+			last = &list->files[x];
+
+	if (last) {
+		r = record_seg_recover(ctx, last, strtoull(last->name, NULL, 16));
+
+	} else {
+		r = record_seg_create(ctx, 0);
+	}
+
+	MTY_FreeFileList(&list);
+
+	if (!r)
+		MTY_RecordLogDestroy(&ctx);
+
+	return ctx;
+}
+
+void MTY_RecordLogDestroy(MTY_RecordLog **log)
+{
+	if (!log || !*log)
+		return;
+
+	MTY_RecordLog *ctx = *log;
+
+	if (ctx->seg.map && ctx->durability != MTY_DURABILITY_NONE)
+		record_sync(ctx);
+
+	record_seg_close(&ctx->seg);
+
+	MTY_Free(ctx->dir);
+
+	MTY_Free(ctx);
+	*log = NULL;
+}
+
+bool MTY_RecordLogAppend(MTY_RecordLog *ctx, const void *buf, size_t size)
+{
+	size_t span = sizeof(struct record_header) + RECORD_PAD(size);
+
+	if (span > ctx->seg_size - sizeof(struct record_segment)) {
+		MTY_Log("Record of %zu bytes exceeds the segment size", size);
+		return false;
+	}
+
+	if (span > ctx->seg.size - ctx->seg.pos && !record_rotate(ctx))
+		return false;
+
+	// The payload is written before its header so the CRC is never published
+	// ahead of the data it covers
+	struct record_header *hdr = (struct record_header *) (ctx->seg.map + ctx->seg.pos);
+	memcpy(hdr + 1, buf, size);
+
+	hdr->crc = record_crc(buf, (uint32_t) size);
+	hdr->size = (uint32_t) size;
+
+	ctx->seg.pos += span;
+
+	switch (ctx->durability) {
+		case MTY_DURABILITY_RECORD:
+			return record_sync(ctx);
+		case MTY_DURABILITY_PERIODIC:
+			if (MTY_TimeDiff(ctx->last_sync, MTY_GetTime()) >= ctx->interval)
+				return record_sync(ctx);
+			break;
+	}
+
+	return true;
+}
+
+bool MTY_RecordLogSync(MTY_RecordLog *ctx)
+{
+	return record_sync(ctx);
+}
+
+
+// Reader
+
+MTY_RecordReader *MTY_RecordReaderCreate(const char *dir)
+{
+	MTY_RecordReader *ctx = MTY_Alloc(1, sizeof(MTY_RecordReader));
+	ctx->list = MTY_GetFileList(dir, RECORD_EXT);
+	ctx->seg.fd = -1;
+
+	return ctx;
+}
+
+void MTY_RecordReaderDestroy(MTY_RecordReader **reader)
+{
+	if (!reader || !*reader)
+		return;
+
+	MTY_RecordReader *ctx = *reader;
+
+	record_seg_close(&ctx->seg);
+	MTY_FreeFileList(&ctx->list);
+
+	MTY_Free(ctx);
+	*reader = NULL;
+}
+
+static bool record_reader_next_seg(MTY_RecordReader *ctx)
+{
+	record_seg_close(&ctx->seg);
+
+	while (ctx->next < ctx->list->len) {
+		MTY_FileDesc *desc = &ctx->list->files[ctx->next++];
+		if (desc->dir)
+			continue;
+
+		struct segment *seg = &ctx->seg;
+		seg->index = strtoull(desc->name, NULL, 16);
+		seg->fd = open(desc->path, O_RDONLY);
+
+		if (seg->fd == -1) {
+			MTY_Log("'open' failed with errno %d", errno);
+			continue;
+		}
+
+		struct stat st = {0};
+		if (fstat(seg->fd, &st) == 0 && st.st_size > 0) {
+			seg->size = st.st_size;
+
+			if (record_seg_map(seg, false) && record_seg_valid(seg)) {
+				seg->pos = sizeof(struct record_segment);
+
+				// Sequential reads, let the kernel read ahead aggressively
+				posix_madvise(seg->map, seg->size, POSIX_MADV_SEQUENTIAL);
+
+				return true;
+			}
+		}
+
+		record_seg_close(seg);
+	}
+
+	return false;
+}
+
+const void *MTY_RecordReaderNext(MTY_RecordReader *ctx, size_t *size)
+{
+	while (ctx->seg.map || record_reader_next_seg(ctx)) {
+		const void *buf = NULL;
+		size_t span = record_seg_scan(&ctx->seg, ctx->seg.pos, &buf, size);
+
+		if (span > 0) {
+			ctx->seg.pos += span;
+			return buf;
+		}
+
+		if (!record_reader_next_seg(ctx))
+			break;
+	}
+
+	return NULL;
+}
@@ -4,6 +4,12 @@
 // If a copy of the MIT License was not distributed with this file,
 // You can obtain one at https://spdx.org/licenses/MIT.html.
 
+#if defined(__linux__)
+	#define _GNU_SOURCE // syscall, REG_RIP et al.
+#elif defined(__APPLE__)
+	#define _DARWIN_C_SOURCE // pthread_getname_np, pthread_threadid_np
+#endif
+
 #include "matoya.h"
 
 #include <string.h>
@@ -13,12 +19,37 @@
 
 #include <unistd.h>
 
+#if !defined(__wasi__)
+	#include <pthread.h>
+	#include <sys/ucontext.h>
+#endif
+
+#if defined(__linux__)
+	#include <sys/prctl.h>
+	#include <sys/syscall.h>
+#endif
+
+#if defined(__GLIBC__) || defined(__APPLE__)
+	#include <execinfo.h>
+	#define SYSTEM_BACKTRACE
+#endif
+
 #include "tlocal.h"
 #include "dlopen.h"
+#include "crash.h"
+#include "log.h"
+
+#define SYSTEM_ALT_STACK  (64 * 1024)
+#define SYSTEM_FRAMES_MAX 64
 
 static MTY_CrashFunc SYSTEM_CRASH_FUNC;
 static void *SYSTEM_OPAQUE;
 
+static MTY_Atomic32 SYSTEM_CRASH_INIT;
+static int32_t SYSTEM_CRASH_FD = -1;
+static uint32_t SYSTEM_CRASH_LOGS;
+static TLOCAL void *SYSTEM_ALT_STACK_PTR;
+
 MTY_SO *MTY_SOLoad(const char *path)
 {
 	MTY_SO *so = dlopen(path, DLOPEN_FLAGS);
@@ -79,6 +110,11 @@ const char *MTY_GetHostname(void)
 	return mty_tlocal_strcpy(tmp);
 }
 
+
+// Crash handling
+
+#if defined(__wasi__)
+
 static void system_signal_handler(int32_t sig)
 {
 	if (SYSTEM_CRASH_FUNC)
@@ -88,15 +124,317 @@ static void system_signal_handler(int32_t sig)
 	raise(sig);
 }
 
-void MTY_SetCrashFunc(MTY_CrashFunc func, void *opaque)
+static void system_crash_init(void)
 {
 	signal(SIGINT, system_signal_handler);
 	signal(SIGSEGV, system_signal_handler);
 	signal(SIGABRT, system_signal_handler);
 	signal(SIGTERM, system_signal_handler);
+}
+
+void mty_crash_thread_start(void)
+{
+}
+
+void mty_crash_thread_end(void)
+{
+}
+
+#else
+
+static const int32_t SYSTEM_SIGNALS[] = {
+	SIGINT,
+	SIGTERM,
+	SIGSEGV,
+	SIGBUS,
+	SIGILL,
+	SIGFPE,
+	SIGABRT,
+};
+
+#define SYSTEM_NUM_SIGNALS (sizeof(SYSTEM_SIGNALS) / sizeof(int32_t))
+
+static const char *system_signal_name(int32_t sig)
+{
+	switch (sig) {
+		case SIGINT:  return "SIGINT";
+		case SIGTERM: return "SIGTERM";
+		case SIGSEGV: return "SIGSEGV";
+		case SIGBUS:  return "SIGBUS";
+		case SIGILL:  return "SIGILL";
+		case SIGFPE:  return "SIGFPE";
+		case SIGABRT: return "SIGABRT";
+	}
+
+	return "UNKNOWN";
+}
+
+// Everything below until the handler must be async-signal-safe: no allocation, no stdio
+
+static void system_write(const char *str)
+{
+	for (size_t len = strlen(str); len > 0;) {
+		ssize_t n = write(SYSTEM_CRASH_FD, str, len);
+
+		if (n <= 0) {
+			if (n < 0 && errno == EINTR)
+				continue;
+
+			break;
+		}
+
+		str += n;
+		len -= n;
+	}
+}
+
+static void system_write_uint(uint64_t v, uint32_t base, uint32_t digits)
+{
+	char buf[24];
+	uint32_t n = sizeof(buf) - 1;
+	buf[n] = '\0';
+
+	do {
+		buf[--n] = "0123456789abcdef"[v % base];
+		v /= base;
+
+	} while ((v > 0 || sizeof(buf) - 1 - n < digits) && n > 0);
+
+	system_write(buf + n);
+}
+
+static void system_write_reg(const char *name, uint64_t val)
+{
+	system_write(name);
+	system_write(" 0x");
+	system_write_uint(val, 16, 16);
+}
+
+static void system_write_regs(const ucontext_t *uc)
+{
+	system_write("registers:");
+
+	#if defined(__linux__) && defined(__x86_64__)
+		const greg_t *r = uc->uc_mcontext.gregs;
+
+		const char *names[] = {"rip", "rsp", "rbp", "rax", "rbx", "rcx", "rdx", "rsi",
+			"rdi", "r8", "r9", "r10", "r11", "r12", "r13", "r14", "r15"};
+		const int32_t regs[] = {REG_RIP, REG_RSP, REG_RBP, REG_RAX, REG_RBX, REG_RCX, REG_RDX,
+			REG_RSI, REG_RDI, REG_R8, REG_R9, REG_R10, REG_R11, REG_R12, REG_R13, REG_R14, REG_R15};
+
+		for (uint32_t x = 0; x < sizeof(regs) / sizeof(int32_t); x++) {
+			system_write(x % 4 == 0 ? "\n  " : "  ");
+			system_write_reg(names[x], r[regs[x]]);
+		}
+
+	#elif defined(__linux__) && defined(__aarch64__)
+		const mcontext_t *m = &uc->uc_mcontext;
+
+		system_write("\n  ");
+		system_write_reg("pc", m->pc);
+		system_write("  ");
+		system_write_reg("sp", m->sp);
+
+		for (uint32_t x = 0; x < 31; x++) {
+			char name[4] = {'x', (char) ('0' + x / 10), (char) ('0' + x % 10), '\0'};
+
+			system_write(x % 4 == 0 ? "\n  " : "  ");
+			system_write_reg(name, m->regs[x]);
+		}
+
+	#elif defined(__APPLE__) && defined(__x86_64__)
+		const _STRUCT_X86_THREAD_STATE64 *ss = &uc->uc_mcontext->__ss;
+
+		system_write("\n  ");
+		system_write_reg("rip", ss->__rip);
+		system_write("  ");
+		system_write_reg("rsp", ss->__rsp);
+		system_write("  ");
+		system_write_reg("rbp", ss->__rbp);
+
+	#elif defined(__APPLE__) && defined(__aarch64__)
+		const _STRUCT_ARM_THREAD_STATE64 *ss = &uc->uc_mcontext->__ss;
+
+		system_write("\n  ");
+		system_write_reg("pc", ss->__pc);
+		system_write("  ");
+		system_write_reg("sp", ss->__sp);
+		system_write("  ");
+		system_write_reg("fp", ss->__fp);
+		system_write("  ");
+		system_write_reg("lr", ss->__lr);
+
+	#else
+		system_write(" unavailable");
+	#endif
+
+	system_write("\n");
+}
+
+static void system_write_thread(void)
+{
+	char name[32] = {0};
 
+	#if defined(__linux__)
+		prctl(PR_GET_NAME, name, 0, 0, 0);
+		uint64_t tid = syscall(SYS_gettid);
+
+	#elif defined(__APPLE__)
+		pthread_getname_np(pthread_self(), name, sizeof(name));
+		uint64_t tid = 0;
+		pthread_threadid_np(NULL, &tid);
+
+	#else
+		uint64_t tid = 0;
+	#endif
+
+	system_write("thread: ");
+	system_write_uint(tid, 10, 0);
+	system_write(" '");
+	system_write(name);
+	system_write("'\n");
+}
+
+static void system_write_report(int32_t sig, const siginfo_t *info, const ucontext_t *uc)
+{
+	system_write("*** libmatoya crash report ***\n");
+
+	system_write("signal: ");
+	system_write(system_signal_name(sig));
+	system_write(" (");
+	system_write_uint(sig, 10, 0);
+	system_write("), code ");
+	system_write_uint((uint32_t) info->si_code, 10, 0);
+	system_write("\n");
+
+	system_write("fault address: 0x");
+	system_write_uint((uintptr_t) info->si_addr, 16, 16);
+	system_write("\n");
+
+	system_write_thread();
+	system_write_regs(uc);
+
+	system_write("backtrace:\n");
+
+	#if defined(SYSTEM_BACKTRACE)
+		void *frames[SYSTEM_FRAMES_MAX];
+		int32_t n = backtrace(frames, SYSTEM_FRAMES_MAX);
+		backtrace_symbols_fd(frames, n, SYSTEM_CRASH_FD);
+	#else
+		system_write("  unavailable\n");
+	#endif
+
+	system_write("log:\n");
+
+	// Oldest first so the report reads chronologically
+	for (uint32_t x = SYSTEM_CRASH_LOGS; x > 0; x--) {
+		char msg[256];
+
+		if (mty_log_get_recent(x - 1, msg, sizeof(msg))) {
+			system_write("  ");
+			system_write(msg);
+			system_write("\n");
+		}
+	}
+
+	system_write("*** end of crash report ***\n");
+}
+
+static void system_signal_handler(int32_t sig, siginfo_t *info, void *uctx)
+{
+	bool forced = sig == SIGTERM || sig == SIGINT;
+
+	int32_t e = errno;
+
+	if (!forced && SYSTEM_CRASH_FD >= 0)
+		system_write_report(sig, info, uctx);
+
+	if (SYSTEM_CRASH_FUNC)
+		SYSTEM_CRASH_FUNC(forced, SYSTEM_OPAQUE);
+
+	errno = e;
+
+	// SA_RESETHAND has restored the default action, the signal is delivered on return
+	raise(sig);
+}
+
+static void system_alt_stack_set(void)
+{
+	if (SYSTEM_ALT_STACK_PTR)
+		return;
+
+	SYSTEM_ALT_STACK_PTR = MTY_Alloc(SYSTEM_ALT_STACK, 1);
+
+	stack_t ss = {0};
+	ss.ss_sp = SYSTEM_ALT_STACK_PTR;
+	ss.ss_size = SYSTEM_ALT_STACK;
+
+	if (sigaltstack(&ss, NULL) != 0)
+		MTY_Log("'sigaltstack' failed with errno %d", errno);
+}
+
+static void system_crash_init(void)
+{
+	// The handler runs on an alternate stack so stack overflows can still be reported
+	system_alt_stack_set();
+
+	if (MTY_Atomic32Get(&SYSTEM_CRASH_INIT) == 1)
+		return;
+
+	#if defined(SYSTEM_BACKTRACE)
+		// The first call to backtrace may load libraries, which is not safe in a handler
+		void *frames[1];
+		backtrace(frames, 1);
+	#endif
+
+	for (uint32_t x = 0; x < SYSTEM_NUM_SIGNALS; x++) {
+		struct sigaction sa = {0};
+		sa.sa_sigaction = system_signal_handler;
+		sa.sa_flags = SA_SIGINFO | SA_ONSTACK | SA_RESETHAND;
+		sigemptyset(&sa.sa_mask);
+
+		if (sigaction(SYSTEM_SIGNALS[x], &sa, NULL) != 0)
+			MTY_Log("'sigaction' failed with errno %d", errno);
+	}
+
+	MTY_Atomic32Set(&SYSTEM_CRASH_INIT, 1);
+}
+
+void mty_crash_thread_start(void)
+{
+	if (MTY_Atomic32Get(&SYSTEM_CRASH_INIT) == 1)
+		system_alt_stack_set();
+}
+
+void mty_crash_thread_end(void)
+{
+	if (!SYSTEM_ALT_STACK_PTR)
+		return;
+
+	stack_t ss = {0};
+	ss.ss_flags = SS_DISABLE;
+	sigaltstack(&ss, NULL);
+
+	MTY_Free(SYSTEM_ALT_STACK_PTR);
+	SYSTEM_ALT_STACK_PTR = NULL;
+}
+
+#endif
+
+void MTY_SetCrashFunc(MTY_CrashFunc func, void *opaque)
+{
 	SYSTEM_CRASH_FUNC = func;
 	SYSTEM_OPAQUE = opaque;
+
+	system_crash_init();
+}
+
+void MTY_SetCrashReport(int32_t fd, uint32_t numLogs)
+{
+	SYSTEM_CRASH_FD = fd;
+	SYSTEM_CRASH_LOGS = numLogs > LOG_RECENT_MAX ? LOG_RECENT_MAX : numLogs;
+
+	system_crash_init();
 }
 
 void MTY_OpenConsole(const char *title)
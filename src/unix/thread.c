@@ -4,6 +4,10 @@
 // If a copy of the MIT License was not distributed with this file,
 // You can obtain one at https://spdx.org/licenses/MIT.html.
 
+#if defined(__linux__)
+	#define _GNU_SOURCE // CPU_ALLOC, sched_setaffinity
+#endif
+
 #include "matoya.h"
 
 #include <stdlib.h>
@@ -11,8 +15,13 @@
 #include <errno.h>
 #include <time.h>
 
+#if defined(__linux__)
+	#include <sched.h>
+#endif
+
 #include "thread.h"
 #include "gettime.h"
+#include "crash.h"
 
 
 // Thread
@@ -29,7 +38,9 @@ static void *thread_func(void *opaque)
 {
 	MTY_Thread *ctx = (MTY_Thread *) opaque;
 
+	mty_crash_thread_start();
 	ctx->ret = ctx->func(ctx->opaque);
+	mty_crash_thread_end();
 
 	if (ctx->detach)
 		MTY_Free(ctx);
@@ -100,6 +111,39 @@ int64_t MTY_ThreadGetID(MTY_Thread *ctx)
 	return (int64_t) (ctx ? ctx->thread : pthread_self());
 }
 
+bool MTY_ThreadSetAffinity(const uint32_t *cpus, uint32_t len)
+{
+	#if defined(__linux__)
+		if (len == 0)
+			return false;
+
+		uint32_t max = 0;
+		for (uint32_t x = 0; x < len; x++)
+			if (cpus[x] > max)
+				max = cpus[x];
+
+		cpu_set_t *set = CPU_ALLOC(max + 1);
+		size_t size = CPU_ALLOC_SIZE(max + 1);
+		CPU_ZERO_S(size, set);
+
+		for (uint32_t x = 0; x < len; x++)
+			CPU_SET_S(cpus[x], size, set);
+
+		bool r = sched_setaffinity(0, size, set) == 0;
+		if (!r)
+			MTY_Log("'sched_setaffinity' failed with errno %d", errno);
+
+		CPU_FREE(set);
+
+		return r;
+
+	#else
+		MTY_Log("Thread affinity is unsupported");
+
+		return false;
+	#endif
+}
+
 
 // Mutex
 
@@ -0,0 +1,17 @@
+// Copyright (c) Christopher D. Dickson <cdd@matoya.group>
+//
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+#pragma once
+
+static void mty_cpu_get_os_info(MTY_CPUInfo *info)
+{
+	// WASM exposes neither CPU features nor topology, the defaults are used
+}
+
+static bool mty_cpu_get_os_topology(MTY_CPUTopology *topo)
+{
+	return false;
+}
@@ -0,0 +1,761 @@
+// Copyright (c) Christopher D. Dickson <cdd@matoya.group>
+//
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+#include "matoya.h"
+
+#include <string.h>
+
+
+// Character sets
+
+// Each set is a bitmap indexed by the low nibble of a byte, with bit N set if the
+// byte with high nibble N belongs to the set. Bytes >= 0x80 never belong to a set.
+// The same 16 bytes drive the scalar lookup and a pair of SIMD byte shuffles
+
+enum url_set {
+	URL_SET_COMPONENT      = MTY_URL_ENCODE_COMPONENT,
+	URL_SET_PATH           = MTY_URL_ENCODE_PATH,
+	URL_SET_FORM           = MTY_URL_ENCODE_FORM,
+	URL_SET_DECODE         = 3,
+	URL_SET_DECODE_FORM    = 4,
+	URL_SET_SPLIT_PATH     = 5,
+	URL_SET_SPLIT_QUERY    = 6,
+	URL_SET_SPLIT_FRAGMENT = 7,
+	URL_SET_REG_NAME       = 8,
+	URL_SET_USERINFO       = 9,
+};
+
+static const uint8_t URL_SETS[][16] = {
+	// ALPHA DIGIT -._~
+	{0xA8, 0xF8, 0xF8, 0xF8, 0xF8, 0xF8, 0xF8, 0xF8, 0xF8, 0xF8, 0xF0, 0x50, 0x50, 0x54, 0xD4, 0x70},
+
+	// Unreserved, sub-delims, :@/
+	{0xB8, 0xFC, 0xF8, 0xF8, 0xFC, 0xF8, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0x5C, 0x54, 0x5C, 0xD4, 0x74},
+
+	// ALPHA DIGIT *-._
+	{0xA8, 0xF8, 0xF8, 0xF8, 0xF8, 0xF8, 0xF8, 0xF8, 0xF8, 0xF8, 0xF4, 0x50, 0x50, 0x54, 0x54, 0x70},
+
+	// ASCII except %
+	{0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFB, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF},
+
+	// ASCII except % and +
+	{0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFB, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFB, 0xFF, 0xFF, 0xFF, 0xFF},
+
+	// VCHAR except ? and #
+	{0xF8, 0xFC, 0xFC, 0xF8, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0x74},
+
+	// VCHAR except #
+	{0xF8, 0xFC, 0xFC, 0xF8, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0x7C},
+
+	// VCHAR
+	{0xF8, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0x7C},
+
+	// Unreserved, sub-delims, %
+	{0xA8, 0xFC, 0xF8, 0xF8, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xF4, 0x5C, 0x54, 0x5C, 0xD4, 0x70},
+
+	// Unreserved, sub-delims, %:
+	{0xA8, 0xFC, 0xF8, 0xF8, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0x5C, 0x54, 0x5C, 0xD4, 0x70},
+};
+
+// Bit for each high nibble, 0 for non-ASCII
+static const uint8_t URL_BITS[16] = {
+	0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0, 0, 0, 0, 0, 0, 0, 0,
+};
+
+static bool url_in_set(char c, enum url_set set)
+{
+	uint8_t b = (uint8_t) c;
+
+	return b < 0x80 && (URL_SETS[set][b & 0x0F] & URL_BITS[b >> 4]);
+}
+
+static int32_t url_hex(char c)
+{
+	if (c >= '0' && c <= '9')
+		return c - '0';
+
+	if (c >= 'A' && c <= 'F')
+		return c - 'A' + 10;
+
+	if (c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+
+	return -1;
+}
+
+
+// SIMD scanning
+
+// Each scanner returns the first byte at or after `p` that is not in `set`, or
+// `end` if every byte is in the set
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+	#define URL_X86
+
+	#if defined(_MSC_VER)
+		#include <intrin.h>
+		#define URL_TARGET(t)
+	#else
+		#include <immintrin.h>
+		#define URL_TARGET(t) __attribute__((target(t)))
+	#endif
+
+#elif defined(__aarch64__) || defined(_M_ARM64)
+	#define URL_NEON
+	#include <arm_neon.h>
+#endif
+
+typedef const char *(*URL_SCAN_FUNC)(const char *p, const char *end, const uint8_t *set);
+
+static const char *url_scan_c(const char *p, const char *end, const uint8_t *set)
+{
+	for (; p < end; p++) {
+		uint8_t c = *p;
+
+		if (!(set[c & 0x0F] & URL_BITS[c >> 4]))
+			break;
+	}
+
+	return p;
+}
+
+#if defined(URL_X86)
+
+static uint32_t url_ctz(uint32_t v)
+{
+	#if defined(_MSC_VER)
+		unsigned long i = 0;
+		_BitScanForward(&i, v);
+
+		return i;
+	#else
+		return __builtin_ctz(v);
+	#endif
+}
+
+URL_TARGET("sse4.2")
+static const char *url_scan_sse42(const char *p, const char *end, const uint8_t *set)
+{
+	const __m128i lut = _mm_loadu_si128((const __m128i *) set);
+	const __m128i bits = _mm_loadu_si128((const __m128i *) URL_BITS);
+	const __m128i nib = _mm_set1_epi8(0x0F);
+	const __m128i zero = _mm_setzero_si128();
+
+	for (; end - p >= 16; p += 16) {
+		__m128i v = _mm_loadu_si128((const __m128i *) p);
+
+		__m128i row = _mm_shuffle_epi8(lut, _mm_and_si128(v, nib));
+		__m128i bit = _mm_shuffle_epi8(bits, _mm_and_si128(_mm_srli_epi16(v, 4), nib));
+
+		uint32_t mask = (uint32_t) _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(row, bit), zero));
+
+		if (mask)
+			return p + url_ctz(mask);
+	}
+
+	return url_scan_c(p, end, set);
+}
+
+URL_TARGET("avx2")
+static const char *url_scan_avx2(const char *p, const char *end, const uint8_t *set)
+{
+	// Shuffles work within 128-bit lanes, so the tables are repeated in both
+	const __m256i lut = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *) set));
+	const __m256i bits = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *) URL_BITS));
+	const __m256i nib = _mm256_set1_epi8(0x0F);
+	const __m256i zero = _mm256_setzero_si256();
+
+	for (; end - p >= 32; p += 32) {
+		__m256i v = _mm256_loadu_si256((const __m256i *) p);
+
+		__m256i row = _mm256_shuffle_epi8(lut, _mm256_and_si256(v, nib));
+		__m256i bit = _mm256_shuffle_epi8(bits, _mm256_and_si256(_mm256_srli_epi16(v, 4), nib));
+
+		uint32_t mask = (uint32_t) _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_and_si256(row, bit), zero));
+
+		if (mask)
+			return p + url_ctz(mask);
+	}
+
+	return url_scan_c(p, end, set);
+}
+
+#elif defined(URL_NEON)
+
+static const char *url_scan_neon(const char *p, const char *end, const uint8_t *set)
+{
+	const uint8x16_t lut = vld1q_u8(set);
+	const uint8x16_t bits = vld1q_u8(URL_BITS);
+	const uint8x16_t nib = vdupq_n_u8(0x0F);
+	const uint8x16_t zero = vdupq_n_u8(0);
+
+	for (; end - p >= 16; p += 16) {
+		uint8x16_t v = vld1q_u8((const uint8_t *) p);
+
+		uint8x16_t row = vqtbl1q_u8(lut, vandq_u8(v, nib));
+		uint8x16_t bit = vqtbl1q_u8(bits, vshrq_n_u8(v, 4));
+		uint8x16_t bad = vceqq_u8(vandq_u8(row, bit), zero);
+
+		// Narrow each byte of the mask to 4 bits so it fits in a 64-bit lane
+		uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(bad), 4)), 0);
+
+		if (mask) {
+			#if defined(_MSC_VER)
+				unsigned long i = 0;
+				_BitScanForward64(&i, mask);
+
+				return p + (i >> 2);
+			#else
+				return p + (__builtin_ctzll(mask) >> 2);
+			#endif
+		}
+	}
+
+	return url_scan_c(p, end, set);
+}
+
+#endif
+
+static URL_SCAN_FUNC url_get_scan(void)
+{
+	static const MTY_CPUImpl impls[] = {
+		#if defined(URL_X86)
+			{MTY_CPU_AVX2,  (void *) url_scan_avx2},
+			{MTY_CPU_SSE42, (void *) url_scan_sse42},
+		#elif defined(URL_NEON)
+			{MTY_CPU_NEON,  (void *) url_scan_neon},
+		#endif
+		{0, (void *) url_scan_c},
+	};
+
+	return (URL_SCAN_FUNC) MTY_SelectCPUImpl(impls, sizeof(impls) / sizeof(impls[0]));
+}
+
+
+// Percent-encoding
+
+bool MTY_HttpPercentEncode(const void *src, size_t len, MTY_UrlEncoding encoding, char *dst, size_t size)
+{
+	static const char HEX[] = "0123456789ABCDEF";
+
+	if (size == 0)
+		return false;
+
+	if (encoding < MTY_URL_ENCODE_COMPONENT || encoding > MTY_URL_ENCODE_FORM)
+		encoding = MTY_URL_ENCODE_COMPONENT;
+
+	URL_SCAN_FUNC scan = url_get_scan();
+	const uint8_t *set = URL_SETS[encoding];
+
+	const char *p = src;
+	const char *end = p + len;
+	size_t n = 0;
+	bool r = true;
+
+	while (p < end) {
+		// Runs of characters that are kept as is are copied in one step
+		const char *run = scan(p, end, set);
+		size_t run_len = run - p;
+
+		if (run_len >= size - n) {
+			memcpy(dst + n, p, size - n - 1);
+			n = size - 1;
+			r = false;
+			break;
+		}
+
+		memcpy(dst + n, p, run_len);
+		n += run_len;
+		p = run;
+
+		if (p == end)
+			break;
+
+		uint8_t c = *p++;
+
+		if (c == ' ' && encoding == MTY_URL_ENCODE_FORM) {
+			if (size - n < 2) {
+				r = false;
+				break;
+			}
+
+			dst[n++] = '+';
+
+		} else {
+			// An escape is never split
+			if (size - n < 4) {
+				r = false;
+				break;
+			}
+
+			dst[n++] = '%';
+			dst[n++] = HEX[c >> 4];
+			dst[n++] = HEX[c & 0x0F];
+		}
+	}
+
+	dst[n] = '\0';
+
+	return r;
+}
+
+bool MTY_HttpPercentDecode(const char *src, size_t len, bool form, char *dst, size_t size)
+{
+	if (size == 0)
+		return false;
+
+	URL_SCAN_FUNC scan = url_get_scan();
+	const uint8_t *set = URL_SETS[form ? URL_SET_DECODE_FORM : URL_SET_DECODE];
+
+	const char *end = src + len;
+	size_t n = 0;
+	bool r = true;
+
+	while (src < end) {
+		const char *run = scan(src, end, set);
+		size_t run_len = run - src;
+
+		if (run_len >= size - n) {
+			memcpy(dst + n, src, size - n - 1);
+			n = size - 1;
+			r = false;
+			break;
+		}
+
+		memcpy(dst + n, src, run_len);
+		n += run_len;
+		src = run;
+
+		if (src == end)
+			break;
+
+		if (size - n < 2) {
+			r = false;
+			break;
+		}
+
+		// Malformed escapes and non-ASCII bytes are copied as is
+		char c = *src++;
+
+		if (c == '%' && end - src >= 2 && url_hex(src[0]) >= 0 && url_hex(src[1]) >= 0) {
+			c = (char) (url_hex(src[0]) << 4 | url_hex(src[1]));
+			src += 2;
+
+		} else if (c == '+' && form) {
+			c = ' ';
+		}
+
+		dst[n++] = c;
+	}
+
+	dst[n] = '\0';
+
+	return r;
+}
+
+
+// Splitting
+
+static bool url_valid(const char *p, const char *end, enum url_set set)
+{
+	for (; p < end; p++) {
+		if (!url_in_set(*p, set))
+			return false;
+
+		if (*p == '%' && (end - p < 3 || url_hex(p[1]) < 0 || url_hex(p[2]) < 0))
+			return false;
+	}
+
+	return true;
+}
+
+static bool url_dec_octet(const char **p, const char *end)
+{
+	const char *s = *p;
+	uint32_t val = 0;
+
+	for (; *p < end && *p - s < 3 && **p >= '0' && **p <= '9'; (*p)++)
+		val = val * 10 + (**p - '0');
+
+	size_t n = *p - s;
+
+	// Leading zeros are not allowed
+	return n > 0 && val <= 255 && !(n > 1 && *s == '0');
+}
+
+static bool url_ipv4(const char *p, const char *end)
+{
+	for (uint8_t x = 0; x < 4; x++) {
+		if (x > 0) {
+			if (p == end || *p != '.')
+				return false;
+
+			p++;
+		}
+
+		if (!url_dec_octet(&p, end))
+			return false;
+	}
+
+	return p == end;
+}
+
+static bool url_ipv6(const char *p, const char *end)
+{
+	uint32_t groups = 0;
+	bool elided = false;
+
+	if (end - p >= 2 && p[0] == ':' && p[1] == ':') {
+		elided = true;
+		p += 2;
+	}
+
+	while (p < end) {
+		const char *s = p;
+
+		while (p < end && p - s < 4 && url_hex(*p) >= 0)
+			p++;
+
+		// A trailing IPv4 address takes the place of the last two groups
+		if (p < end && *p == '.') {
+			if (!url_ipv4(s, end))
+				return false;
+
+			groups += 2;
+			break;
+		}
+
+		if (p == s)
+			return false;
+
+		groups++;
+
+		if (p == end)
+			break;
+
+		if (*p != ':' || ++p == end)
+			return false;
+
+		if (*p == ':') {
+			if (elided)
+				return false;
+
+			elided = true;
+			p++;
+		}
+	}
+
+	return elided ? groups <= 7 : groups == 8;
+}
+
+static bool url_ipvfuture(const char *p, const char *end)
+{
+	if (p == end || (*p != 'v' && *p != 'V'))
+		return false;
+
+	const char *s = ++p;
+
+	while (p < end && url_hex(*p) >= 0)
+		p++;
+
+	if (p == s || p == end || *p != '.' || ++p == end)
+		return false;
+
+	for (; p < end; p++)
+		if (*p == '%' || !url_in_set(*p, URL_SET_USERINFO))
+			return false;
+
+	return true;
+}
+
+static bool url_split_authority(const char *p, const char *end, MTY_HttpUrl *parts)
+{
+	// User information, a second @ would make the host ambiguous
+	const char *at = NULL;
+
+	for (const char *s = p; s < end; s++) {
+		if (*s == '@') {
+			if (at)
+				return false;
+
+			at = s;
+		}
+	}
+
+	if (at) {
+		if (!url_valid(p, at, URL_SET_USERINFO))
+			return false;
+
+		parts->userinfo = p;
+		parts->userinfoLen = at - p;
+		p = at + 1;
+	}
+
+	// Host
+	if (p < end && *p == '[') {
+		const char *close = memchr(p, ']', end - p);
+
+		if (!close || !(url_ipv6(p + 1, close) || url_ipvfuture(p + 1, close)))
+			return false;
+
+		parts->host = p + 1;
+		parts->hostLen = close - p - 1;
+		parts->ipLiteral = true;
+		p = close + 1;
+
+	} else {
+		const char *s = p;
+
+		while (p < end && *p != ':')
+			p++;
+
+		if (!url_valid(s, p, URL_SET_REG_NAME))
+			return false;
+
+		parts->host = s;
+		parts->hostLen = p - s;
+	}
+
+	// Port, which may be empty
+	if (p < end) {
+		if (*p != ':')
+			return false;
+
+		parts->port = ++p;
+		parts->portLen = end - p;
+
+		uint32_t port = 0;
+
+		for (; p < end; p++) {
+			if (*p < '0' || *p > '9')
+				return false;
+
+			port = port * 10 + (*p - '0');
+
+			if (port > UINT16_MAX)
+				return false;
+		}
+
+		parts->portNum = (uint16_t) port;
+	}
+
+	return true;
+}
+
+static uint16_t url_default_port(const char *scheme, size_t len)
+{
+	static const struct {
+		const char *name;
+		uint16_t port;
+	} PORTS[] = {
+		{"http",  80},
+		{"https", 443},
+		{"ws",    80},
+		{"wss",   443},
+	};
+
+	for (size_t x = 0; x < sizeof(PORTS) / sizeof(PORTS[0]); x++) {
+		if (strlen(PORTS[x].name) != len)
+			continue;
+
+		bool match = true;
+
+		for (size_t y = 0; y < len && match; y++)
+			match = (scheme[y] | 0x20) == PORTS[x].name[y];
+
+		if (match)
+			return PORTS[x].port;
+	}
+
+	return 0;
+}
+
+static const char *url_split_span(URL_SCAN_FUNC scan, const char *p, const char *end, enum url_set set)
+{
+	// Non-ASCII bytes are allowed in the path, query and fragment
+	while (true) {
+		p = scan(p, end, URL_SETS[set]);
+
+		if (p == end || (uint8_t) *p < 0x80)
+			return p;
+
+		p++;
+	}
+}
+
+bool MTY_HttpSplitUrl(const char *url, size_t len, MTY_HttpUrl *parts)
+{
+	memset(parts, 0, sizeof(MTY_HttpUrl));
+
+	const char *p = url;
+	const char *end = url + len;
+
+	// Scheme, a leading segment that is not a valid scheme is part of the path
+	const char *s = p;
+
+	if (s < end && url_in_set(*s, URL_SET_COMPONENT) && (*s | 0x20) >= 'a' && (*s | 0x20) <= 'z') {
+		// ALPHA DIGIT +-.
+		for (s++; s < end && (url_in_set(*s, URL_SET_COMPONENT) || *s == '+') && *s != '_' && *s != '~'; s++)
+			continue;
+
+		if (s < end && *s == ':') {
+			parts->scheme = p;
+			parts->schemeLen = s - p;
+			p = s + 1;
+		}
+	}
+
+	// Authority
+	if (end - p >= 2 && p[0] == '/' && p[1] == '/') {
+		p += 2;
+		s = p;
+
+		while (p < end && *p != '/' && *p != '?' && *p != '#')
+			p++;
+
+		if (!url_split_authority(s, p, parts))
+			return false;
+	}
+
+	URL_SCAN_FUNC scan = url_get_scan();
+
+	// Path
+	parts->path = p;
+	p = url_split_span(scan, p, end, URL_SET_SPLIT_PATH);
+	parts->pathLen = p - parts->path;
+
+	// Without a scheme or authority, a colon in the first segment would be read
+	// as a scheme
+	if (!parts->scheme && !parts->host) {
+		for (s = parts->path; s < p && *s != '/'; s++)
+			if (*s == ':')
+				return false;
+	}
+
+	// Query
+	if (p < end && *p == '?') {
+		parts->query = ++p;
+		p = url_split_span(scan, p, end, URL_SET_SPLIT_QUERY);
+		parts->queryLen = p - parts->query;
+	}
+
+	// Fragment
+	if (p < end && *p == '#') {
+		parts->fragment = ++p;
+		p = url_split_span(scan, p, end, URL_SET_SPLIT_FRAGMENT);
+		parts->fragmentLen = p - parts->fragment;
+	}
+
+	if (parts->portLen == 0 && parts->scheme)
+		parts->portNum = url_default_port(parts->scheme, parts->schemeLen);
+
+	// Whitespace and control characters are never allowed
+	return p == end;
+}
+
+
+// Query strings
+
+bool MTY_HttpGetNextQueryParam(const char *query, size_t len, size_t *iter, MTY_HttpField *param)
+{
+	while (*iter < len) {
+		const char *p = query + *iter;
+		const char *end = memchr(p, '&', len - *iter);
+
+		if (end) {
+			*iter = end - query + 1;
+
+		} else {
+			end = query + len;
+			*iter = len;
+		}
+
+		// Empty pairs such as in "a=1&&b=2" are skipped
+		if (end == p)
+			continue;
+
+		const char *eq = memchr(p, '=', end - p);
+
+		param->name = p;
+		param->nameLen = (eq ? eq : end) - p;
+		param->value = eq ? eq + 1 : end;
+		param->valueLen = end - param->value;
+
+		return true;
+	}
+
+	return false;
+}
+
+static bool url_name_equal(const char *name, size_t len, const char *cmp)
+{
+	const char *end = name + len;
+
+	while (name < end) {
+		char c = *name++;
+
+		if (c == '%' && end - name >= 2 && url_hex(name[0]) >= 0 && url_hex(name[1]) >= 0) {
+			c = (char) (url_hex(name[0]) << 4 | url_hex(name[1]));
+			name += 2;
+
+		} else if (c == '+') {
+			c = ' ';
+		}
+
+		if (*cmp == '\0' || c != *cmp++)
+			return false;
+	}
+
+	return *cmp == '\0';
+}
+
+bool MTY_HttpGetQueryParam(const char *query, size_t len, const char *name, char *value, size_t size)
+{
+	MTY_HttpField param = {0};
+	size_t iter = 0;
+
+	while (MTY_HttpGetNextQueryParam(query, len, &iter, &param))
+		if (url_name_equal(param.name, param.nameLen, name))
+			return MTY_HttpPercentDecode(param.value, param.valueLen, true, value, size);
+
+	return false;
+}
+
+bool MTY_HttpAppendQueryParam(char *query, size_t size, const char *name, const char *value)
+{
+	size_t len = strlen(query);
+	if (len + 1 >= size)
+		return false;
+
+	char *p = query + len;
+	bool r = true;
+
+	if (len > 0)
+		*p++ = '&';
+
+	r = MTY_HttpPercentEncode(name, strlen(name), MTY_URL_ENCODE_FORM, p, size - (p - query));
+	if (!r)
+		goto except;
+
+	if (value) {
+		p += strlen(p);
+
+		r = size - (p - query) >= 2;
+		if (!r)
+			goto except;
+
+		*p++ = '=';
+
+		r = MTY_HttpPercentEncode(value, strlen(value), MTY_URL_ENCODE_FORM, p, size - (p - query));
+	}
+
+	except:
+
+	if (!r)
+		query[len] = '\0';
+
+	return r;
+}
@@ -0,0 +1,151 @@
+// Copyright (c) Christopher D. Dickson <cdd@matoya.group>
+//
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+#pragma once
+
+#include <windows.h>
+
+static uint32_t cpuinfo_popcount(ULONG_PTR mask)
+{
+	uint32_t n = 0;
+
+	for (; mask; mask &= mask - 1)
+		n++;
+
+	return n;
+}
+
+static void mty_cpu_get_os_info(MTY_CPUInfo *info)
+{
+	DWORD size = 0;
+	GetLogicalProcessorInformation(NULL, &size);
+
+	SYSTEM_LOGICAL_PROCESSOR_INFORMATION *slpi = MTY_Alloc(size, 1);
+
+	if (GetLogicalProcessorInformation(slpi, &size)) {
+		for (DWORD x = 0; x < size / sizeof(SYSTEM_LOGICAL_PROCESSOR_INFORMATION); x++) {
+			switch (slpi[x].Relationship) {
+				case RelationProcessorCore:
+					info->cores++;
+					info->threads += cpuinfo_popcount(slpi[x].ProcessorMask);
+					break;
+				case RelationCache: {
+					CACHE_DESCRIPTOR *cache = &slpi[x].Cache;
+
+					if (cache->Type == CacheInstruction)
+						break;
+
+					if (cache->Level == 1) {
+						info->l1Size = cache->Size;
+						info->cacheLine = cache->LineSize;
+
+					} else if (cache->Level == 2) {
+						info->l2Size = cache->Size;
+
+					} else if (cache->Level == 3) {
+						info->l3Size = cache->Size;
+					}
+					break;
+				}
+			}
+		}
+	} else {
+		MTY_Log("'GetLogicalProcessorInformation' failed with error 0x%X", GetLastError());
+	}
+
+	MTY_Free(slpi);
+
+	#if defined(_M_ARM64)
+		if (IsProcessorFeaturePresent(PF_ARM_NEON_INSTRUCTIONS_AVAILABLE))
+			info->features |= MTY_CPU_NEON;
+
+		if (IsProcessorFeaturePresent(PF_ARM_V8_CRC32_INSTRUCTIONS_AVAILABLE))
+			info->features |= MTY_CPU_CRC32;
+
+		// The crypto extensions are reported as a single feature
+		if (IsProcessorFeaturePresent(PF_ARM_V8_CRYPTO_INSTRUCTIONS_AVAILABLE))
+			info->features |= MTY_CPU_ARM_AES | MTY_CPU_PMULL | MTY_CPU_ARM_SHA;
+	#endif
+}
+
+static uint32_t cpuinfo_lowest(ULONG_PTR mask)
+{
+	uint32_t n = 0;
+
+	for (; mask && !(mask & 1); mask >>= 1)
+		n++;
+
+	return n;
+}
+
+static bool mty_cpu_get_os_topology(MTY_CPUTopology *topo)
+{
+	DWORD size = 0;
+	GetLogicalProcessorInformation(NULL, &size);
+
+	SYSTEM_LOGICAL_PROCESSOR_INFORMATION *slpi = MTY_Alloc(size, 1);
+
+	bool r = GetLogicalProcessorInformation(slpi, &size);
+	if (!r) {
+		MTY_Log("'GetLogicalProcessorInformation' failed with error 0x%X", GetLastError());
+		goto except;
+	}
+
+	// Only the processor group of the calling process is reported, which covers
+	// up to 64 logical processors
+	DWORD len = size / sizeof(SYSTEM_LOGICAL_PROCESSOR_INFORMATION);
+	ULONG_PTR online = 0;
+	BYTE level = 0;
+
+	for (DWORD x = 0; x < len; x++) {
+		if (slpi[x].Relationship == RelationProcessorCore)
+			online |= slpi[x].ProcessorMask;
+
+		if (slpi[x].Relationship == RelationCache && slpi[x].Cache.Type != CacheInstruction &&
+			slpi[x].Cache.Level > level)
+			level = slpi[x].Cache.Level;
+	}
+
+	topo->cpus = MTY_Alloc(cpuinfo_popcount(online), sizeof(MTY_LogicalCPU));
+
+	for (uint32_t x = 0; x < sizeof(ULONG_PTR) * 8; x++)
+		if (online & ((ULONG_PTR) 1 << x))
+			topo->cpus[topo->numCPUs++].id = x;
+
+	// Cores and cache groups are keyed by the lowest logical processor in their
+	// mask, keys are made dense by the caller
+	for (DWORD x = 0; x < len; x++) {
+		ULONG_PTR mask = slpi[x].ProcessorMask;
+
+		for (uint32_t y = 0; y < topo->numCPUs; y++) {
+			MTY_LogicalCPU *cpu = &topo->cpus[y];
+			ULONG_PTR bit = (ULONG_PTR) 1 << cpu->id;
+
+			if (!(mask & bit))
+				continue;
+
+			switch (slpi[x].Relationship) {
+				case RelationProcessorCore:
+					cpu->core = cpuinfo_lowest(mask);
+					cpu->smt = cpuinfo_popcount(mask & (bit - 1));
+					break;
+				case RelationCache:
+					if (slpi[x].Cache.Type != CacheInstruction && slpi[x].Cache.Level == level)
+						cpu->llc = cpuinfo_lowest(mask);
+					break;
+				case RelationNumaNode:
+					cpu->node = slpi[x].NumaNode.NodeNumber;
+					break;
+			}
+		}
+	}
+
+	except:
+
+	MTY_Free(slpi);
+
+	return r && topo->numCPUs > 0;
+}
@@ -328,7 +328,23 @@ bool mty_d3d11_ctx_has_ui_texture(struct gfx_ctx *gfx_ctx, uint32_t id)
 	return MTY_RendererHasUITexture(ctx->renderer, id);
 }
 
+void mty_d3d11_ctx_set_ui_atlas(struct gfx_ctx *gfx_ctx, uint32_t page_size)
+{
+	struct d3d11_ctx *ctx = (struct d3d11_ctx *) gfx_ctx;
+
+	MTY_RendererSetUIAtlas(ctx->renderer, page_size);
+}
+
 bool mty_d3d11_ctx_make_current(struct gfx_ctx *gfx_ctx, bool current)
 {
 	return false;
 }
+
+void mty_d3d11_ctx_set_frames_in_flight(struct gfx_ctx *gfx_ctx, uint32_t frames)
+{
+}
+
+bool mty_d3d11_ctx_get_present_stats(struct gfx_ctx *gfx_ctx, MTY_PresentStats *stats)
+{
+	return false;
+}
@@ -429,6 +429,25 @@ void *mty_d3d11_ui_create_texture(MTY_Device *device, const void *rgba, uint32_t
 	return srv;
 }
 
+bool mty_d3d11_ui_update_texture(MTY_Device *device, MTY_Context *context, void *texture,
+	const void *rgba, uint32_t stride, uint32_t x, uint32_t y, uint32_t width, uint32_t height)
+{
+	ID3D11DeviceContext *_context = (ID3D11DeviceContext *) context;
+	ID3D11ShaderResourceView *srv = (ID3D11ShaderResourceView *) texture;
+
+	ID3D11Resource *res = NULL;
+	ID3D11ShaderResourceView_GetResource(srv, &res);
+
+	if (!res)
+		return false;
+
+	D3D11_BOX box = {x, y, 0, x + width, y + height, 1};
+	ID3D11DeviceContext_UpdateSubresource(_context, res, 0, &box, rgba, stride * 4, 0);
+	ID3D11Resource_Release(res);
+
+	return true;
+}
+
 void mty_d3d11_ui_destroy_texture(void **texture)
 {
 	if (!texture || !*texture)
@@ -273,6 +273,37 @@ void *mty_d3d9_ui_create_texture(MTY_Device *device, const void *rgba, uint32_t
 	return texture;
 }
 
+bool mty_d3d9_ui_update_texture(MTY_Device *device, MTY_Context *context, void *texture,
+	const void *rgba, uint32_t stride, uint32_t x, uint32_t y, uint32_t width, uint32_t height)
+{
+	IDirect3DTexture9 *_texture = (IDirect3DTexture9 *) texture;
+
+	D3DLOCKED_RECT rect = {0};
+	RECT area = {x, y, x + width, y + height};
+
+	HRESULT e = IDirect3DTexture9_LockRect(_texture, 0, &rect, &area, 0);
+	if (e != D3D_OK) {
+		MTY_Log("'IDirect3DTexture9_LockRect' failed with HRESULT 0x%X", e);
+		return false;
+	}
+
+	for (uint32_t h = 0; h < height; h++) {
+		for (uint32_t w = 0; w < width * 4; w += 4) {
+			uint8_t *dest = (uint8_t *) rect.pBits + (h * rect.Pitch);
+			const uint8_t *src = (const uint8_t *) rgba + (h * stride * 4);
+
+			dest[w + 0] = src[w + 2];
+			dest[w + 1] = src[w + 1];
+			dest[w + 2] = src[w + 0];
+			dest[w + 3] = src[w + 3];
+		}
+	}
+
+	IDirect3DTexture9_UnlockRect(_texture, 0);
+
+	return true;
+}
+
 void mty_d3d9_ui_destroy_texture(void **texture)
 {
 	if (!texture || !*texture)
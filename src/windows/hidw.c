@@ -5,6 +5,7 @@
 // You can obtain one at https://spdx.org/licenses/MIT.html.
 
 #include "hid/hid.h"
+#include "hid/replay.h"
 
 #include "hidpi.h"
 
@@ -359,8 +360,10 @@ void mty_hid_win32_device_change(struct hid *ctx, intptr_t wparam, intptr_t lpar
 	} else if (wparam == GIDC_REMOVAL) {
 		struct hid_dev *dev = MTY_HashPopInt(ctx->devices, lparam);
 		if (dev) {
-			if (!dev->is_xinput)
+			if (!dev->is_xinput) {
+				mty_hid_record_disconnect(dev->id);
 				ctx->disconnect(dev, ctx->opaque);
+			}
 
 			MTY_HashPopInt(ctx->devices_rev, dev->id);
 			hid_device_destroy(dev);
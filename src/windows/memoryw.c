@@ -5,6 +5,7 @@
 // You can obtain one at https://spdx.org/licenses/MIT.html.
 
 #include "matoya.h"
+#include "pool.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -29,6 +30,47 @@ void MTY_FreeAligned(void *mem)
 	_aligned_free(mem);
 }
 
+void *mty_pages_alloc(size_t *size, bool huge, bool *hugetlb)
+{
+	// Large pages require SeLockMemoryPrivilege, which is rarely granted
+	*hugetlb = false;
+
+	void *mem = VirtualAlloc(NULL, *size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+
+	if (!mem)
+		MTY_LogFatal("'VirtualAlloc' failed with error 0x%X", GetLastError());
+
+	return mem;
+}
+
+void mty_pages_free(void *mem, size_t size)
+{
+	VirtualFree(mem, 0, MEM_RELEASE);
+}
+
+void *MTY_AllocNode(size_t size, uint32_t node)
+{
+	// Node placement is a preference, pages come from other nodes when it is full
+	void *mem = VirtualAllocExNuma(GetCurrentProcess(), NULL, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE, node);
+
+	if (!mem) {
+		MTY_Log("'VirtualAllocExNuma' failed with error 0x%X", GetLastError());
+
+		bool hugetlb = false;
+		mem = mty_pages_alloc(&size, false, &hugetlb);
+	}
+
+	return mem;
+}
+
+void MTY_FreeNode(void *mem, size_t size)
+{
+	if (!mem)
+		return;
+
+	mty_pages_free(mem, size);
+}
+
 int32_t MTY_Strcasecmp(const char *s0, const char *s1)
 {
 	return _stricmp(s0, s1);
@@ -14,6 +14,7 @@
 
 #include "net/http.h"
 #include "net/gzip.h"
+#include "metrics.h"
 
 #define MTY_USER_AGENTW L"libmatoya/v" MTY_VERSION_STRINGW
 
@@ -123,6 +124,12 @@ bool MTY_HttpRequest(const char *host, uint16_t port, bool secure, const char *m
 
 	*status = (uint16_t) _wtoi(wheader);
 
+	#if defined(MTY_METRICS)
+		char name[64];
+		snprintf(name, 64, "mty_http_requests{code=\"%u\"}", *status);
+		METRIC_COUNT_NAMED(name, "HTTP requests by response status.", 1);
+	#endif
+
 	// Content encoding query
 	buf_len = 128 * sizeof(WCHAR);
 	if (WinHttpQueryHeaders(request, WINHTTP_QUERY_CONTENT_ENCODING, NULL, wheader, &buf_len, NULL))
@@ -96,6 +96,26 @@ int64_t MTY_ThreadGetID(MTY_Thread *ctx)
 	return ctx ? GetThreadId(ctx->thread) : GetCurrentThreadId();
 }
 
+bool MTY_ThreadSetAffinity(const uint32_t *cpus, uint32_t len)
+{
+	// Logical processors are numbered within the process's processor group
+	DWORD_PTR mask = 0;
+
+	for (uint32_t x = 0; x < len; x++)
+		if (cpus[x] < sizeof(DWORD_PTR) * 8)
+			mask |= (DWORD_PTR) 1 << cpus[x];
+
+	if (mask == 0)
+		return false;
+
+	if (SetThreadAffinityMask(GetCurrentThread(), mask) == 0) {
+		MTY_Log("'SetThreadAffinityMask' failed with error 0x%X", GetLastError());
+		return false;
+	}
+
+	return true;
+}
+
 
 // Mutex
 
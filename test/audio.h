@@ -0,0 +1,266 @@
+// Copyright (c) Christopher D. Dickson <cdd@matoya.group>
+//
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+#if defined(__linux__) && !defined(__ANDROID__)
+
+#define AUDIO_RATE    48000
+#define AUDIO_PERIODS 50
+
+struct audio_capture_state {
+	uint32_t periods;
+	uint64_t frames;
+	int64_t prev;
+	bool monotonic;
+};
+
+static void audio_capture_func(const void *frames, uint32_t count, int64_t timestamp, void *opaque)
+{
+	struct audio_capture_state *state = opaque;
+
+	state->monotonic = state->monotonic && timestamp >= state->prev && timestamp <= MTY_GetTime();
+	state->prev = timestamp;
+	state->frames += count;
+	state->periods++;
+}
+
+static bool audio_capture_queue(const char *device)
+{
+	MTY_AudioCaptureDesc desc = {0};
+	desc.device = device;
+	desc.format = MTY_AUDIO_FORMAT_S16;
+	desc.sampleRate = AUDIO_RATE;
+	desc.channels = 2;
+
+	MTY_AudioCapture *ctx = MTY_AudioCaptureCreate(&desc, NULL, NULL);
+	test_cmp("MTY_AudioCaptureCreate", ctx != NULL);
+	test_cmp("MTY_AudioCaptureStart", MTY_AudioCaptureStart(ctx));
+
+	uint64_t frames = 0;
+	int64_t prev = 0;
+	bool monotonic = true;
+	bool silent = true;
+
+	for (uint32_t x = 0; x < AUDIO_PERIODS; x++) {
+		const int16_t *buf = NULL;
+		uint32_t count = 0;
+		int64_t ts = 0;
+
+		test_cmp("MTY_AudioCaptureGetPeriod", MTY_AudioCaptureGetPeriod(ctx, 1000, (const void **) &buf, &count, &ts));
+
+		for (uint32_t y = 0; y < count * 2; y++)
+			silent = silent && buf[y] == 0;
+
+		monotonic = monotonic && ts >= prev;
+		prev = ts;
+		frames += count;
+
+		MTY_AudioCapturePop(ctx);
+	}
+
+	MTY_AudioCaptureStop(ctx);
+
+	MTY_AudioCaptureStats stats = {0};
+	MTY_AudioCaptureGetStats(ctx, &stats);
+
+	// The null device captures silence
+	test_cmp("MTY_AudioCapture (Silent)", silent || strcmp(device, "null"));
+	test_cmp("MTY_AudioCapture (Time)", monotonic && prev <= MTY_GetTime());
+	test_cmpi64("MTY_AudioCaptureStats", stats.frames >= frames, stats.frames);
+	test_cmpf("MTY_AudioCapture (Latency)", stats.latency >= 0.0f, stats.latency);
+	test_cmpi32("MTY_AudioCapture (Overrun)", true, stats.overruns + stats.dropped);
+
+	MTY_AudioCaptureDestroy(&ctx);
+	test_cmp("MTY_AudioCaptureDestroy", ctx == NULL);
+
+	return true;
+}
+
+static bool audio_capture_callback(const char *device)
+{
+	MTY_AudioCaptureDesc desc = {0};
+	desc.device = device;
+	desc.format = MTY_AUDIO_FORMAT_FLOAT;
+	desc.sampleRate = AUDIO_RATE;
+	desc.channels = 1;
+	desc.periodSize = 256;
+
+	struct audio_capture_state state = {0};
+	state.monotonic = true;
+
+	MTY_AudioCapture *ctx = MTY_AudioCaptureCreate(&desc, audio_capture_func, &state);
+	test_cmp("MTY_AudioCaptureCreate", ctx != NULL);
+
+	const void *buf = NULL;
+	uint32_t count = 0;
+	test_cmp("MTY_AudioCaptureGetPeriod", !MTY_AudioCaptureGetPeriod(ctx, 0, &buf, &count, NULL));
+
+	test_cmp("MTY_AudioCaptureStart", MTY_AudioCaptureStart(ctx));
+	MTY_Sleep(100);
+	MTY_AudioCaptureStop(ctx);
+
+	MTY_AudioCaptureStats stats = {0};
+	MTY_AudioCaptureGetStats(ctx, &stats);
+
+	test_cmp("MTY_AudioCaptureFunc", state.periods > 0 && state.monotonic);
+	test_cmpi64("MTY_AudioCaptureStats", stats.frames == state.frames, stats.frames);
+
+	// The capture thread has been joined, no more callbacks
+	uint32_t periods = state.periods;
+	MTY_Sleep(20);
+	test_cmp("MTY_AudioCaptureStop", state.periods == periods);
+
+	MTY_AudioCaptureDestroy(&ctx);
+
+	return true;
+}
+
+static bool audio_devices(void)
+{
+	MTY_AudioDeviceList *list = MTY_AudioGetDevices();
+	test_cmp("MTY_AudioGetDevices", list != NULL);
+
+	bool null = false;
+	bool valid = true;
+
+	for (uint32_t x = 0; x < list->len; x++) {
+		MTY_AudioDevice *dev = &list->devices[x];
+
+		valid = valid && dev->id && dev->name && !strchr(dev->name, '\n') && (dev->input || dev->output);
+		null = null || !strcmp(dev->id, "null");
+	}
+
+	test_cmp("MTY_AudioDevice", valid);
+	test_cmp("MTY_AudioGetDevices (null)", null);
+
+	MTY_AudioFreeDevices(&list);
+	test_cmp("MTY_AudioFreeDevices", list == NULL);
+
+	test_cmp("MTY_AudioCreateDevice", MTY_AudioCreateDevice("mty-missing", AUDIO_RATE, 0, 100) == NULL);
+
+	// ALSA's file plugin tees everything written to a null sink into a raw file
+	MTY_DeleteFile("audio.raw");
+
+	MTY_Audio *ctx = MTY_AudioCreateDevice("file:FILE=audio.raw,FORMAT=raw", AUDIO_RATE, 0, 500);
+	test_cmp("MTY_AudioCreateDevice", ctx != NULL);
+
+	MTY_AudioHardware hw = {0};
+	test_cmp("MTY_AudioGetHardware", MTY_AudioGetHardware(ctx, &hw));
+	test_cmpi32("MTY_AudioHardware", hw.sampleRate == AUDIO_RATE, hw.sampleRate);
+	test_cmp("MTY_AudioHardware", hw.periodSize > 0 && hw.bufferSize >= hw.periodSize);
+
+	int16_t frames[AUDIO_RATE / 100 * 2];
+	for (uint32_t x = 0; x < AUDIO_RATE / 100; x++)
+		frames[x * 2] = frames[x * 2 + 1] = (int16_t) (sinf((float) x * 0.1f) * 10000.0f);
+
+	MTY_AudioQueue(ctx, frames, AUDIO_RATE / 100);
+	MTY_AudioDestroy(&ctx);
+
+	size_t size = 0;
+	int16_t *raw = MTY_ReadFile("audio.raw", &size);
+	test_cmp("MTY_AudioQueue (File)", raw && size >= sizeof(frames) && !memcmp(raw, frames, sizeof(frames)));
+
+	MTY_Free(raw);
+	MTY_DeleteFile("audio.raw");
+
+	return true;
+}
+
+static bool audio_main(void)
+{
+	MTY_AudioCaptureDesc desc = {0};
+	desc.format = MTY_AUDIO_FORMAT_MAKE_32;
+	test_cmp("MTY_AudioCaptureCreate", MTY_AudioCaptureCreate(&desc, NULL, NULL) == NULL);
+
+	// ALSA's null plugin, or a snd-aloop capture device for an end to end measurement
+	const char *device = getenv("MTY_TEST_CAPTURE_DEVICE");
+	if (!device)
+		device = "null";
+
+	desc.device = device;
+	desc.format = MTY_AUDIO_FORMAT_S16;
+	desc.sampleRate = AUDIO_RATE;
+	desc.channels = 2;
+
+	MTY_AudioCapture *probe = MTY_AudioCaptureCreate(&desc, NULL, NULL);
+
+	if (!probe) {
+		test_passed("MTY_AudioCaptureCreate (No ALSA)");
+		return true;
+	}
+
+	MTY_AudioCaptureDestroy(&probe);
+
+	if (!audio_devices())
+		return false;
+
+	if (!audio_capture_queue(device))
+		return false;
+
+	if (!audio_capture_callback(device))
+		return false;
+
+	return true;
+}
+
+#else
+
+static bool audio_devices(void)
+{
+	MTY_AudioDeviceList *list = MTY_AudioGetDevices();
+	test_cmp("MTY_AudioGetDevices", list != NULL);
+
+	bool null = false;
+	bool valid = true;
+
+	for (uint32_t x = 0; x < list->len; x++) {
+		MTY_AudioDevice *dev = &list->devices[x];
+
+		valid = valid && dev->id && dev->name && !strchr(dev->name, '\n') && (dev->input || dev->output);
+		null = null || !strcmp(dev->id, "null");
+	}
+
+	test_cmp("MTY_AudioDevice", valid);
+	test_cmp("MTY_AudioGetDevices (null)", null);
+
+	MTY_AudioFreeDevices(&list);
+	test_cmp("MTY_AudioFreeDevices", list == NULL);
+
+	test_cmp("MTY_AudioCreateDevice", MTY_AudioCreateDevice("mty-missing", AUDIO_RATE, 0, 100) == NULL);
+
+	// ALSA's file plugin tees everything written to a null sink into a raw file
+	MTY_DeleteFile("audio.raw");
+
+	MTY_Audio *ctx = MTY_AudioCreateDevice("file:FILE=audio.raw,FORMAT=raw", AUDIO_RATE, 0, 500);
+	test_cmp("MTY_AudioCreateDevice", ctx != NULL);
+
+	MTY_AudioHardware hw = {0};
+	test_cmp("MTY_AudioGetHardware", MTY_AudioGetHardware(ctx, &hw));
+	test_cmpi32("MTY_AudioHardware", hw.sampleRate == AUDIO_RATE, hw.sampleRate);
+	test_cmp("MTY_AudioHardware", hw.periodSize > 0 && hw.bufferSize >= hw.periodSize);
+
+	int16_t frames[AUDIO_RATE / 100 * 2];
+	for (uint32_t x = 0; x < AUDIO_RATE / 100; x++)
+		frames[x * 2] = frames[x * 2 + 1] = (int16_t) (sinf((float) x * 0.1f) * 10000.0f);
+
+	MTY_AudioQueue(ctx, frames, AUDIO_RATE / 100);
+	MTY_AudioDestroy(&ctx);
+
+	size_t size = 0;
+	int16_t *raw = MTY_ReadFile("audio.raw", &size);
+	test_cmp("MTY_AudioQueue (File)", raw && size >= sizeof(frames) && !memcmp(raw, frames, sizeof(frames)));
+
+	MTY_Free(raw);
+	MTY_DeleteFile("audio.raw");
+
+	return true;
+}
+
+static bool audio_main(void)
+{
+	return true;
+}
+
+#endif
@@ -0,0 +1,448 @@
+// Copyright (c) Christopher D. Dickson <cdd@matoya.group>
+//
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+#define CONTROLLER_TIMEOUT 3000.0f
+#define CONTROLLER_BENCH   1000000
+
+// DualShock 4 shaped descriptor: 64 byte input report 0x01, output 0x05, feature 0x12
+static const uint8_t CONTROLLER_DESC[] = {
+	0x05, 0x01, 0x09, 0x05, 0xA1, 0x01,
+	0x85, 0x01, 0x06, 0x00, 0xFF, 0x09, 0x20, 0x15, 0x00, 0x26, 0xFF, 0x00, 0x75, 0x08, 0x95, 0x3F, 0x81, 0x02,
+	0x85, 0x05, 0x09, 0x21, 0x95, 0x1F, 0x91, 0x02,
+	0x85, 0x12, 0x09, 0x22, 0x95, 0x0F, 0xB1, 0x02,
+	0xC0,
+};
+
+// Wired DS4 reports: neutral, Cross held, left stick full left with L2 fully pulled
+static const uint8_t CONTROLLER_REPORTS[][10] = {
+	{0x01, 0x80, 0x80, 0x80, 0x80, 0x08, 0x00, 0x00, 0x00, 0x00},
+	{0x01, 0x80, 0x80, 0x80, 0x80, 0x28, 0x00, 0x00, 0x00, 0x00},
+	{0x01, 0x00, 0x80, 0x80, 0x80, 0x08, 0x04, 0x00, 0xFF, 0x00},
+};
+
+#define CONTROLLER_REPORTS_LEN (sizeof(CONTROLLER_REPORTS) / sizeof(CONTROLLER_REPORTS[0]))
+
+
+// Replay
+
+// Recording format, see src/hid/replay.c
+#define CONTROLLER_HID_CONNECT   1
+#define CONTROLLER_HID_REPORT    2
+#define CONTROLLER_DISCONNECT    3
+#define CONTROLLER_EVDEV_CONNECT 4
+#define CONTROLLER_EVDEV_EVENT   5
+
+struct controller_rec {
+	uint8_t *buf;
+	size_t size;
+};
+
+static void controller_rec_add(struct controller_rec *rec, uint8_t type, uint32_t id, uint64_t ts,
+	const void *payload, uint16_t size)
+{
+	uint8_t hdr[16] = {type, 0};
+	memcpy(hdr + 2, &size, 2);
+	memcpy(hdr + 4, &id, 4);
+	memcpy(hdr + 8, &ts, 8);
+
+	rec->buf = MTY_Realloc(rec->buf, rec->size + 16 + size, 1);
+	memcpy(rec->buf + rec->size, hdr, 16);
+	memcpy(rec->buf + rec->size + 16, payload, size);
+	rec->size += 16 + size;
+}
+
+static void controller_rec_report(struct controller_rec *rec, uint32_t id, uint64_t ts, const uint8_t *report, size_t size)
+{
+	uint8_t full[64] = {0};
+	memcpy(full, report, size);
+
+	controller_rec_add(rec, CONTROLLER_HID_REPORT, id, ts, full, 64);
+}
+
+static struct controller_rec controller_rec_ds4(void)
+{
+	struct controller_rec rec = {0};
+	rec.buf = MTY_Dup("MTYCTRL1", 8);
+	rec.size = 8;
+
+	uint8_t connect[8] = {0x4C, 0x05, 0xCC, 0x09, 64, 0, 0, 0};
+	controller_rec_add(&rec, CONTROLLER_HID_CONNECT, 7, 0, connect, 8);
+
+	for (uint32_t x = 0; x < CONTROLLER_REPORTS_LEN; x++)
+		controller_rec_report(&rec, 7, (x + 1) * 4000, CONTROLLER_REPORTS[x], sizeof(CONTROLLER_REPORTS[0]));
+
+	// Unknown report IDs are ignored by the driver
+	uint8_t unknown[2] = {0x7F};
+	controller_rec_add(&rec, CONTROLLER_HID_REPORT, 7, 20000, unknown, 2);
+
+	controller_rec_add(&rec, CONTROLLER_DISCONNECT, 7, 24000, NULL, 0);
+
+	return rec;
+}
+
+static bool controller_replay_ds4(void)
+{
+	struct controller_rec rec = controller_rec_ds4();
+
+	MTY_ControllerReplay *ctx = MTY_ControllerReplayCreate(rec.buf, rec.size);
+	test_cmp("MTY_ControllerReplayCreate", ctx != NULL);
+
+	MTY_Event evt = {0};
+	uint64_t ts = 0;
+
+	test_cmp("MTY_ControllerReplayNext", MTY_ControllerReplayNext(ctx, &evt, &ts));
+	test_cmp("MTY_EVENT_CONNECT", evt.type == MTY_EVENT_CONNECT && evt.controller.id == 7 &&
+		evt.controller.vid == 0x054C && evt.controller.pid == 0x09CC && ts == 0);
+
+	MTY_ControllerEvent c[CONTROLLER_REPORTS_LEN];
+
+	for (uint32_t x = 0; x < CONTROLLER_REPORTS_LEN; x++) {
+		test_cmp("MTY_ControllerReplayNext", MTY_ControllerReplayNext(ctx, &evt, &ts));
+		test_cmp("MTY_EVENT_CONTROLLER", evt.type == MTY_EVENT_CONTROLLER && ts == (x + 1) * 4000);
+		c[x] = evt.controller;
+	}
+
+	// Golden values from the DS4 report layout
+	test_cmpi32("MTY_CTYPE_PS4", c[0].type == MTY_CTYPE_PS4, c[0].type);
+	test_cmp("MTY_ControllerEvent", c[0].numButtons == 14 && c[0].numAxes == 7 && c[0].id == 7);
+	test_cmpi32("MTY_CAXIS_DPAD", c[0].axes[MTY_CAXIS_DPAD].value == 8, c[0].axes[MTY_CAXIS_DPAD].value);
+	test_cmp("MTY_CBUTTON_A", !c[0].buttons[MTY_CBUTTON_A] && c[1].buttons[MTY_CBUTTON_A]);
+	test_cmpi32("MTY_CAXIS_THUMB_LX", c[0].axes[MTY_CAXIS_THUMB_LX].value == 128,
+		c[0].axes[MTY_CAXIS_THUMB_LX].value);
+	test_cmpi32("MTY_CAXIS_THUMB_LX", c[2].axes[MTY_CAXIS_THUMB_LX].value == INT16_MIN,
+		c[2].axes[MTY_CAXIS_THUMB_LX].value);
+	test_cmpi32("MTY_CAXIS_TRIGGER_L", c[2].axes[MTY_CAXIS_TRIGGER_L].value == UINT8_MAX,
+		c[2].axes[MTY_CAXIS_TRIGGER_L].value);
+	test_cmp("MTY_CBUTTON_LEFT_TRIGGER", c[2].buttons[MTY_CBUTTON_LEFT_TRIGGER]);
+
+	// Feature requests fail during replay so the driver assumes Bluetooth
+	size_t size = 0;
+	uint8_t out[128] = {0};
+	size_t out_size = MTY_ControllerReplayRumble(ctx, 7, 0xFFFF, 0x8000, out, sizeof(out));
+	test_cmpi64("MTY_ControllerReplayRumble", out_size == 78 && out[0] == 0x11 &&
+		out[6] == 0x80 && out[7] == 0xFF, out_size);
+
+	test_cmp("MTY_ControllerReplayGetTouchp", MTY_ControllerReplayGetTouchpad(ctx, 7, &size) && size == 10);
+
+	test_cmp("MTY_ControllerReplayNext", MTY_ControllerReplayNext(ctx, &evt, &ts));
+	test_cmp("MTY_EVENT_DISCONNECT", evt.type == MTY_EVENT_DISCONNECT && evt.controller.id == 7 && ts == 24000);
+	test_cmp("MTY_ControllerReplayNext", !MTY_ControllerReplayNext(ctx, &evt, &ts));
+	test_cmp("MTY_ControllerReplayRumble", MTY_ControllerReplayRumble(ctx, 7, 0, 0, out, sizeof(out)) == 0);
+
+	MTY_ControllerReplayDestroy(&ctx);
+	test_cmp("MTY_ControllerReplayDestroy", ctx == NULL);
+
+	// Truncations of a valid recording must be handled, the stride lands on every header field
+	bool clean = true;
+
+	for (size_t x = 0; x < rec.size; x += 7) {
+		ctx = MTY_ControllerReplayCreate(rec.buf, x);
+
+		for (uint32_t y = 0; ctx && y < 16 && MTY_ControllerReplayNext(ctx, &evt, NULL); y++);
+
+		clean = clean && (x < 8) == (ctx == NULL);
+		MTY_ControllerReplayDestroy(&ctx);
+	}
+
+	test_cmp("MTY_ControllerReplay (Trunc)", clean);
+
+	MTY_Free(rec.buf);
+
+	// An empty recording is just the header
+	test_cmp("MTY_ControllerRecordStart", MTY_ControllerRecordStart("controller.rec"));
+	test_cmp("MTY_ControllerRecordStart", !MTY_ControllerRecordStart("controller.rec"));
+	test_cmp("MTY_ControllerRecordStop", MTY_ControllerRecordStop());
+
+	size = 0;
+	void *empty = MTY_ReadFile("controller.rec", &size);
+	test_cmp("MTY_ControllerRecordStop", empty && size == 8);
+
+	ctx = MTY_ControllerReplayCreate(empty, size);
+	test_cmp("MTY_ControllerReplayNext", ctx && !MTY_ControllerReplayNext(ctx, &evt, NULL));
+
+	MTY_ControllerReplayDestroy(&ctx);
+	MTY_Free(empty);
+	MTY_DeleteFile("controller.rec");
+
+	return true;
+}
+
+static bool controller_replay_evdev(void)
+{
+	#if defined(__linux__) && !defined(__ANDROID__)
+		struct controller_rec rec = {0};
+		rec.buf = MTY_Dup("MTYCTRL1", 8);
+		rec.size = 8;
+
+		// Gamepad with ABS_X (0x00) and ABS_RZ (0x05), 0-255
+		int32_t connect[8] = {0x045E | (0x0B12 << 16), 2, 0x00, 0, 255, 0x05, 0, 255};
+		controller_rec_add(&rec, CONTROLLER_EVDEV_CONNECT, 3, 0, connect, sizeof(connect));
+
+		// BTN_SOUTH, ABS_X to 0, ABS_HAT0Y up, EV_SYN
+		int32_t events[][2] = {{0x0001 | (0x130 << 16), 1}, {0x0003 | (0x00 << 16), 0},
+			{0x0003 | (0x11 << 16), -1}, {0x0000, 0}};
+
+		for (uint32_t x = 0; x < 4; x++)
+			controller_rec_add(&rec, CONTROLLER_EVDEV_EVENT, 3, x * 1000, events[x], 8);
+
+		controller_rec_add(&rec, CONTROLLER_DISCONNECT, 3, 5000, NULL, 0);
+
+		MTY_ControllerReplay *ctx = MTY_ControllerReplayCreate(rec.buf, rec.size);
+
+		MTY_Event evt[6] = {0};
+		uint32_t n = 0;
+
+		while (n < 6 && MTY_ControllerReplayNext(ctx, &evt[n], NULL))
+			n++;
+
+		// EV_SYN does not produce an event
+		test_cmpi32("MTY_ControllerReplay (evdev)", n == 5, n);
+		test_cmp("MTY_EVENT_CONNECT", evt[0].type == MTY_EVENT_CONNECT && evt[0].controller.vid == 0x045E &&
+			evt[0].controller.pid == 0x0B12 && evt[0].controller.numAxes == MTY_CAXIS_DPAD + 1);
+		test_cmp("MTY_CBUTTON_A", evt[1].type == MTY_EVENT_CONTROLLER && evt[1].controller.buttons[MTY_CBUTTON_A]);
+		test_cmpi32("MTY_CAXIS_THUMB_LX", evt[2].controller.axes[MTY_CAXIS_THUMB_LX].value == INT16_MIN,
+			evt[2].controller.axes[MTY_CAXIS_THUMB_LX].value);
+		test_cmp("MTY_DPAD_UP", MTY_DPAD_UP(&evt[3].controller) && !MTY_DPAD_UP(&evt[2].controller));
+		test_cmp("MTY_EVENT_DISCONNECT", evt[4].type == MTY_EVENT_DISCONNECT && evt[4].controller.id == 3);
+
+		MTY_ControllerReplayDestroy(&ctx);
+		MTY_Free(rec.buf);
+	#endif
+
+	return true;
+}
+
+static bool controller_replay_bench(void)
+{
+	struct controller_rec rec = {0};
+	rec.buf = MTY_Dup("MTYCTRL1", 8);
+	rec.size = 8;
+
+	uint8_t connect[8] = {0x4C, 0x05, 0xCC, 0x09, 64, 0, 0, 0};
+	controller_rec_add(&rec, CONTROLLER_HID_CONNECT, 1, 0, connect, 8);
+
+	for (uint32_t x = 0; x < CONTROLLER_BENCH; x++)
+		controller_rec_report(&rec, 1, x, CONTROLLER_REPORTS[x % CONTROLLER_REPORTS_LEN], sizeof(CONTROLLER_REPORTS[0]));
+
+	MTY_ControllerReplay *ctx = MTY_ControllerReplayCreate(rec.buf, rec.size);
+
+	MTY_Event evt = {0};
+	uint32_t n = 0;
+	MTY_Time ts = MTY_GetTime();
+
+	while (MTY_ControllerReplayNext(ctx, &evt, NULL))
+		n++;
+
+	float ms = MTY_TimeDiff(ts, MTY_GetTime());
+
+	test_cmpf("Replay PS4 (reports/ms)", n == CONTROLLER_BENCH + 1, CONTROLLER_BENCH / ms);
+
+	MTY_ControllerReplayDestroy(&ctx);
+	MTY_Free(rec.buf);
+
+	return true;
+}
+
+
+// uhid
+
+#if defined(__linux__) && !defined(__ANDROID__)
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <linux/uhid.h>
+
+struct controller_test {
+	int32_t fd;
+	MTY_App *app;
+	MTY_Time start;
+	MTY_Atomic32 done;
+	MTY_Atomic32 rumble;
+	uint32_t id;
+	uint32_t sent;
+	uint32_t connects;
+	MTY_ControllerEvent last[CONTROLLER_REPORTS_LEN];
+	uint32_t received;
+};
+
+static void *controller_uhid_thread(void *opaque)
+{
+	struct controller_test *ctx = opaque;
+
+	while (!MTY_Atomic32Get(&ctx->done)) {
+		struct uhid_event ev = {0};
+		if (read(ctx->fd, &ev, sizeof(ev)) <= 0) {
+			MTY_Sleep(1);
+			continue;
+		}
+
+		// The serial number feature report is answered so the driver takes the wired path
+		if (ev.type == UHID_GET_REPORT) {
+			struct uhid_event reply = {0};
+			reply.type = UHID_GET_REPORT_REPLY;
+			reply.u.get_report_reply.id = ev.u.get_report.id;
+			reply.u.get_report_reply.size = 16;
+			reply.u.get_report_reply.data[0] = ev.u.get_report.rnum;
+			memset(reply.u.get_report_reply.data + 1, 0xAB, 15);
+
+			if (write(ctx->fd, &reply, sizeof(reply)) != sizeof(reply))
+				break;
+
+		// Rumble arrives as output report 0x05 with the strong motor at byte 5
+		} else if (ev.type == UHID_OUTPUT) {
+			if (ev.u.output.data[0] == 0x05 && ev.u.output.data[5] == 0xFF)
+				MTY_Atomic32Set(&ctx->rumble, 1);
+		}
+	}
+
+	return NULL;
+}
+
+static void controller_input(struct controller_test *ctx, const uint8_t *report, size_t size)
+{
+	struct uhid_event ev = {0};
+	ev.type = UHID_INPUT2;
+	ev.u.input2.size = 64;
+	memcpy(ev.u.input2.data, report, size);
+
+	if (write(ctx->fd, &ev, sizeof(ev)) != sizeof(ev))
+		MTY_Log("'write' failed with errno %d", errno);
+}
+
+static void controller_event_func(const MTY_Event *evt, void *opaque)
+{
+	struct controller_test *ctx = opaque;
+
+	if (evt->type == MTY_EVENT_CONNECT && evt->controller.vid == 0x054C && evt->controller.pid == 0x09CC) {
+		ctx->id = evt->controller.id;
+		ctx->connects++;
+
+	} else if (evt->type == MTY_EVENT_CONTROLLER && evt->controller.id == ctx->id && ctx->sent > 0) {
+		if (ctx->received < CONTROLLER_REPORTS_LEN)
+			ctx->last[ctx->received++] = evt->controller;
+	}
+}
+
+static bool controller_app_func(void *opaque)
+{
+	struct controller_test *ctx = opaque;
+
+	if (MTY_TimeDiff(ctx->start, MTY_GetTime()) > CONTROLLER_TIMEOUT)
+		return false;
+
+	if (ctx->id == 0)
+		return true;
+
+	// Replay one report per frame once the device has been claimed
+	if (ctx->sent < CONTROLLER_REPORTS_LEN) {
+		controller_input(ctx, CONTROLLER_REPORTS[ctx->sent], sizeof(CONTROLLER_REPORTS[0]));
+		ctx->sent++;
+	}
+
+	if (ctx->sent == CONTROLLER_REPORTS_LEN && (ctx->received == CONTROLLER_REPORTS_LEN || !MTY_AppIsActive(ctx->app))) {
+		MTY_AppRumbleController(ctx->app, ctx->id, 0xFFFF, 0);
+		return false;
+	}
+
+	return true;
+}
+
+static bool controller_uhid(void)
+{
+	// Requires an X server and a writable /dev/uhid (root or a udev rule)
+	struct controller_test ctx = {0};
+	ctx.fd = getenv("DISPLAY") ? open("/dev/uhid", O_RDWR | O_NONBLOCK | O_CLOEXEC) : -1;
+
+	if (ctx.fd == -1) {
+		test_passed("uhid (Unavailable)");
+		return true;
+	}
+
+	struct uhid_event ev = {0};
+	ev.type = UHID_CREATE2;
+	snprintf((char *) ev.u.create2.name, sizeof(ev.u.create2.name), "libmatoya test DS4");
+	memcpy(ev.u.create2.rd_data, CONTROLLER_DESC, sizeof(CONTROLLER_DESC));
+	ev.u.create2.rd_size = sizeof(CONTROLLER_DESC);
+	ev.u.create2.bus = BUS_VIRTUAL; // Keeps the kernel's own Sony driver from binding
+	ev.u.create2.vendor = 0x054C;
+	ev.u.create2.product = 0x09CC;
+
+	test_cmp("UHID_CREATE2", write(ctx.fd, &ev, sizeof(ev)) == sizeof(ev));
+
+	MTY_Thread *thread = MTY_ThreadCreate(controller_uhid_thread, &ctx);
+
+	ctx.app = MTY_AppCreate(controller_app_func, controller_event_func, &ctx);
+	test_cmp("MTY_AppCreate", ctx.app != NULL);
+
+	MTY_WindowDesc desc = {0};
+	desc.title = "Controller";
+	desc.api = MTY_GFX_GL;
+	desc.width = 320;
+	desc.height = 240;
+
+	MTY_Window window = MTY_WindowCreate(ctx.app, &desc);
+	test_cmp("MTY_WindowCreate", window >= 0);
+	MTY_WindowActivate(ctx.app, window, true);
+
+	ctx.start = MTY_GetTime();
+	MTY_AppRun(ctx.app);
+
+	test_cmpi32("MTY_EVENT_CONNECT", ctx.connects == 1, ctx.connects);
+
+	// Gamepad input is only delivered while the app has focus, which needs a window manager
+	if (MTY_AppIsActive(ctx.app)) {
+		test_cmpi32("MTY_EVENT_CONTROLLER", ctx.received == CONTROLLER_REPORTS_LEN, ctx.received);
+		test_cmpi32("MTY_CTYPE_PS4", ctx.last[0].type == MTY_CTYPE_PS4, ctx.last[0].type);
+		test_cmp("MTY_CBUTTON_A", !ctx.last[0].buttons[MTY_CBUTTON_A] && ctx.last[1].buttons[MTY_CBUTTON_A]);
+		test_cmpi32("MTY_CAXIS_THUMB_LX", ctx.last[2].axes[MTY_CAXIS_THUMB_LX].value == INT16_MIN,
+			ctx.last[2].axes[MTY_CAXIS_THUMB_LX].value);
+		test_cmpi32("MTY_CAXIS_TRIGGER_L", ctx.last[2].axes[MTY_CAXIS_TRIGGER_L].value == UINT8_MAX,
+			ctx.last[2].axes[MTY_CAXIS_TRIGGER_L].value);
+		test_cmp("MTY_CBUTTON_LEFT_TRIGGER", ctx.last[2].buttons[MTY_CBUTTON_LEFT_TRIGGER]);
+	}
+
+	for (uint32_t x = 0; x < 100 && !MTY_Atomic32Get(&ctx.rumble); x++)
+		MTY_Sleep(10);
+
+	test_cmp("MTY_AppRumbleController", MTY_Atomic32Get(&ctx.rumble));
+
+	MTY_AppDestroy(&ctx.app);
+
+	MTY_Atomic32Set(&ctx.done, 1);
+	MTY_ThreadDestroy(&thread);
+
+	// Closing the uhid fd destroys the device
+	close(ctx.fd);
+
+	return true;
+}
+
+#else
+
+static bool controller_uhid(void)
+{
+	return true;
+}
+
+#endif
+
+static bool controller_main(void)
+{
+	if (!controller_replay_ds4())
+		return false;
+
+	if (!controller_replay_evdev())
+		return false;
+
+	if (!controller_replay_bench())
+		return false;
+
+	if (!controller_uhid())
+		return false;
+
+	return true;
+}
@@ -0,0 +1,213 @@
+// Copyright (c) Christopher D. Dickson <cdd@matoya.group>
+//
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+#if defined(__linux__) && !defined(__ANDROID__)
+
+#include <unistd.h>
+#include <sys/resource.h>
+
+#define FIBER_SWITCHES 100000
+#define FIBER_CONNS    1000
+#define FIBER_PORT     5361
+#define FIBER_TIMEOUT  5000
+
+struct fiber_conns {
+	MTY_WebSocketServer *server;
+	MTY_WebSocket **children;
+	uint32_t conns;
+	MTY_Atomic32 connected;
+	uint32_t received;
+	int64_t rss;
+};
+
+static uint32_t FIBER_ORDER[3];
+static uint32_t FIBER_ORDER_LEN;
+
+static int64_t fiber_rss(void)
+{
+	long pages = 0;
+
+	FILE *f = fopen("/proc/self/statm", "r");
+	if (f) {
+		if (fscanf(f, "%*s %ld", &pages) != 1)
+			pages = 0;
+
+		fclose(f);
+	}
+
+	return (int64_t) pages * sysconf(_SC_PAGESIZE);
+}
+
+static void fiber_yield_loop(void *opaque)
+{
+	uint32_t *n = opaque;
+
+	for (uint32_t x = 0; x < FIBER_SWITCHES; x++) {
+		(*n)++;
+		MTY_FiberYield();
+	}
+}
+
+static void fiber_sleeper(void *opaque)
+{
+	uint32_t ms = (uint32_t) (uintptr_t) opaque;
+
+	MTY_FiberSleep(ms);
+	FIBER_ORDER[FIBER_ORDER_LEN++] = ms;
+}
+
+static void fiber_client(void *opaque)
+{
+	struct fiber_conns *ctx = opaque;
+
+	uint16_t us = 0;
+	MTY_WebSocket *ws = MTY_WebSocketConnect("127.0.0.1", FIBER_PORT, false, "/",
+		"Origin: http://127.0.0.1:8080", FIBER_TIMEOUT, &us);
+
+	if (!ws)
+		return;
+
+	// The last fiber to connect samples memory while the rest are parked in a read
+	if (MTY_Atomic32Add(&ctx->connected, 1) == (int32_t) ctx->conns)
+		ctx->rss = fiber_rss();
+
+	char msg[64];
+	MTY_Async r = MTY_ASYNC_CONTINUE;
+
+	for (uint32_t x = 0; x < 10 && r == MTY_ASYNC_CONTINUE; x++)
+		r = MTY_WebSocketRead(ws, FIBER_TIMEOUT, msg, sizeof(msg));
+
+	if (r == MTY_ASYNC_OK && !strcmp(msg, "fiber"))
+		ctx->received++;
+
+	MTY_WebSocketDestroy(&ws);
+}
+
+static void *fiber_acceptor(void *opaque)
+{
+	struct fiber_conns *ctx = opaque;
+
+	for (uint32_t x = 0; x < ctx->conns; x++) {
+		ctx->children[x] = MTY_WebSocketServerAccept(ctx->server, FIBER_TIMEOUT);
+		if (!ctx->children[x])
+			return NULL;
+	}
+
+	// Only write once every client has finished its upgrade
+	for (uint32_t x = 0; x < FIBER_TIMEOUT && MTY_Atomic32Get(&ctx->connected) != (int32_t) ctx->conns; x++)
+		MTY_Sleep(1);
+
+	for (uint32_t x = 0; x < ctx->conns; x++)
+		MTY_WebSocketWrite(ctx->children[x], "fiber");
+
+	return NULL;
+}
+
+static bool fiber_switch(void)
+{
+	MTY_FiberScheduler *sched = MTY_FiberSchedulerCreate(0);
+	test_cmp("MTY_FiberSchedulerCreate", sched != NULL);
+
+	uint32_t a = 0;
+	uint32_t b = 0;
+	test_cmp("MTY_FiberSpawn", MTY_FiberSpawn(sched, fiber_yield_loop, &a));
+	test_cmp("MTY_FiberSpawn", MTY_FiberSpawn(sched, fiber_yield_loop, &b));
+
+	MTY_Time start = MTY_GetTime();
+	MTY_FiberSchedulerRun(sched);
+	float ms = MTY_TimeDiff(start, MTY_GetTime());
+
+	MTY_FiberStats stats = {0};
+	MTY_FiberSchedulerGetStats(sched, &stats);
+
+	test_cmp("MTY_FiberSchedulerRun", a == FIBER_SWITCHES && b == FIBER_SWITCHES && stats.fibers == 0);
+	test_cmpf("MTY_FiberYield (ns/Switch)", stats.switches > 0, ms * 1000000.0f / (stats.switches * 2));
+
+	// Timers fire in deadline order regardless of spawn order
+	MTY_FiberSpawn(sched, fiber_sleeper, (void *) (uintptr_t) 30);
+	MTY_FiberSpawn(sched, fiber_sleeper, (void *) (uintptr_t) 10);
+	MTY_FiberSpawn(sched, fiber_sleeper, (void *) (uintptr_t) 20);
+	MTY_FiberSchedulerRun(sched);
+
+	test_cmp("MTY_FiberSleep", FIBER_ORDER_LEN == 3 && FIBER_ORDER[0] == 10 &&
+		FIBER_ORDER[1] == 20 && FIBER_ORDER[2] == 30);
+
+	MTY_FiberSchedulerDestroy(&sched);
+	test_cmp("MTY_FiberSchedulerDestroy", sched == NULL);
+
+	return true;
+}
+
+static bool fiber_connections(void)
+{
+	struct fiber_conns ctx = {0};
+
+	// Each connection costs a descriptor on both ends
+	struct rlimit rl = {0};
+	getrlimit(RLIMIT_NOFILE, &rl);
+
+	ctx.conns = FIBER_CONNS;
+	if (rl.rlim_cur != RLIM_INFINITY && rl.rlim_cur < ctx.conns * 2 + 64)
+		ctx.conns = rl.rlim_cur > 128 ? (uint32_t) (rl.rlim_cur - 64) / 2 : 32;
+
+	MTY_WebSocketServerDesc desc = {0};
+	desc.ip = "127.0.0.1";
+	desc.port = FIBER_PORT;
+	desc.origins = ORIGINS;
+	desc.numOrigins = NUM_ORIGINS;
+	desc.maxPending = ctx.conns;
+
+	ctx.server = MTY_WebSocketServerCreate(&desc);
+	test_cmp("MTY_WebSocketServerCreate (Fibers)", ctx.server != NULL);
+
+	ctx.children = MTY_Alloc(ctx.conns, sizeof(MTY_WebSocket *));
+
+	MTY_FiberScheduler *sched = MTY_FiberSchedulerCreate(0);
+	int64_t base = fiber_rss();
+
+	for (uint32_t x = 0; x < ctx.conns; x++)
+		MTY_FiberSpawn(sched, fiber_client, &ctx);
+
+	MTY_Thread *thread = MTY_ThreadCreate(fiber_acceptor, &ctx);
+	MTY_FiberSchedulerRun(sched);
+	MTY_ThreadDestroy(&thread);
+
+	test_cmpi32("MTY_FiberSpawn (Connections)", ctx.received == ctx.conns, ctx.received);
+	test_cmpi64("MTY_FiberSpawn (Bytes/Conn)", ctx.rss > base, (ctx.rss - base) / ctx.conns);
+
+	MTY_FiberStats stats = {0};
+	MTY_FiberSchedulerGetStats(sched, &stats);
+	test_cmpi64("MTY_FiberSchedulerGetStats (Reserved)", stats.reserved > 0, (int64_t) stats.reserved);
+
+	for (uint32_t x = 0; x < ctx.conns; x++)
+		MTY_WebSocketDestroy(&ctx.children[x]);
+
+	MTY_Free(ctx.children);
+	MTY_FiberSchedulerDestroy(&sched);
+	MTY_WebSocketServerDestroy(&ctx.server);
+
+	return true;
+}
+
+static bool fiber_main(void)
+{
+	if (!fiber_switch())
+		return false;
+
+	if (!fiber_connections())
+		return false;
+
+	return true;
+}
+
+#else
+
+static bool fiber_main(void)
+{
+	return true;
+}
+
+#endif
@@ -23,6 +23,163 @@ that we here highly resolve that these dead shall not have died in vain -- that
 under God, shall have a new birth of freedom -- and that government of the people, by the people, \
 for the people, shall not perish from the earth.";
 
+#if !defined(_WIN32) && !defined(__wasi__)
+
+#define FILE_RECORDS 100000
+
+static void file_record_clean(const char *dir)
+{
+	MTY_FileList *list = MTY_GetFileList(dir, ".log");
+
+	for (uint32_t x = 0; x < list->len; x++)
+		if (!list->files[x].dir)
+			MTY_DeleteFile(list->files[x].path);
+
+	MTY_FreeFileList(&list);
+}
+
+static uint32_t file_record_read(const char *dir, uint32_t *last)
+{
+	MTY_RecordReader *reader = MTY_RecordReaderCreate(dir);
+	uint32_t n = 0;
+	bool ok = true;
+
+	for (size_t size = 0;; n++) {
+		const uint8_t *rec = MTY_RecordReaderNext(reader, &size);
+		if (!rec)
+			break;
+
+		memcpy(last, rec, sizeof(uint32_t));
+		ok = ok && size == sizeof(uint32_t) + *last % 64;
+	}
+
+	MTY_RecordReaderDestroy(&reader);
+
+	return ok ? n : 0;
+}
+
+static bool file_record_append(const char *dir, MTY_Durability durability, uint32_t n, const char *name)
+{
+	MTY_RecordLog *log = MTY_RecordLogCreate(dir, 1024 * 1024, durability, 10);
+	test_cmp("MTY_RecordLogCreate", log != NULL);
+
+	uint8_t buf[sizeof(uint32_t) + 64] = {0};
+	MTY_Time ts = MTY_GetTime();
+	bool ok = true;
+
+	for (uint32_t x = 0; x < n; x++) {
+		memcpy(buf, &x, sizeof(uint32_t));
+		ok = ok && MTY_RecordLogAppend(log, buf, sizeof(uint32_t) + x % 64);
+	}
+
+	float elapsed = MTY_TimeDiff(ts, MTY_GetTime());
+	test_cmpf(name, ok, n / elapsed);
+
+	MTY_RecordLogDestroy(&log);
+	test_cmp("MTY_RecordLogDestroy", log == NULL);
+
+	return true;
+}
+
+static bool file_record_log(void)
+{
+	const char *dir = MTY_JoinPath(MTY_GetDir(MTY_DIR_CWD), "test_records");
+	file_record_clean(dir);
+
+	// Appends per millisecond for each durability mode
+	if (!file_record_append(dir, MTY_DURABILITY_RECORD, 200, "MTY_DURABILITY_RECORD"))
+		return false;
+
+	file_record_clean(dir);
+
+	if (!file_record_append(dir, MTY_DURABILITY_PERIODIC, FILE_RECORDS, "MTY_DURABILITY_PERIODIC"))
+		return false;
+
+	file_record_clean(dir);
+
+	if (!file_record_append(dir, MTY_DURABILITY_NONE, FILE_RECORDS, "MTY_DURABILITY_NONE"))
+		return false;
+
+	uint32_t last = 0;
+	uint32_t n = file_record_read(dir, &last);
+	test_cmpi32("MTY_RecordReaderNext", n == FILE_RECORDS && last == FILE_RECORDS - 1, n);
+
+	// Tear the final record by corrupting its last payload byte
+	MTY_FileList *list = MTY_GetFileList(dir, ".log");
+	const char *seg = list->len > 0 ? list->files[list->len - 1].path : "";
+
+	size_t size = 0;
+	uint8_t *data = MTY_ReadFile(seg, &size);
+	test_cmp("MTY_RecordLogCreate (Seg)", data != NULL && size > 0);
+
+	size_t end = size;
+	while (end > 0 && data[end - 1] == 0)
+		end--;
+
+	data[end - 1] ^= 0xFF;
+	MTY_WriteFile(seg, data, size);
+	MTY_Free(data);
+	MTY_FreeFileList(&list);
+
+	MTY_Time ts = MTY_GetTime();
+	MTY_RecordLog *log = MTY_RecordLogCreate(dir, 1024 * 1024, MTY_DURABILITY_NONE, 0);
+	float recovery = MTY_TimeDiff(ts, MTY_GetTime());
+	test_cmpf("MTY_RecordLogCreate (ms)", log != NULL, recovery);
+
+	n = file_record_read(dir, &last);
+	test_cmpi32("MTY_RecordLogCreate (Rec)", n == FILE_RECORDS - 1 && last == FILE_RECORDS - 2, n);
+
+	// Appending resumes directly after the last valid record
+	uint8_t buf[sizeof(uint32_t) + 64] = {0};
+	uint32_t val = FILE_RECORDS + 64;
+	memcpy(buf, &val, sizeof(uint32_t));
+
+	test_cmp("MTY_RecordLogAppend", MTY_RecordLogAppend(log, buf, sizeof(uint32_t) + val % 64));
+	test_cmp("MTY_RecordLogSync", MTY_RecordLogSync(log));
+
+	// Only one writer is allowed at a time
+	MTY_RecordLog *log2 = MTY_RecordLogCreate(dir, 1024 * 1024, MTY_DURABILITY_NONE, 0);
+	test_cmp("MTY_RecordLogCreate (L)", log2 == NULL);
+
+	n = file_record_read(dir, &last);
+	test_cmpi32("MTY_RecordReaderNext", n == FILE_RECORDS && last == val, n);
+
+	MTY_RecordLogDestroy(&log);
+
+	// A crash while creating a segment leaves it empty or without a header
+	const char *empty = MTY_JoinPath(dir, "00000000fffffffe.log");
+	MTY_WriteFile(empty, "", 0);
+
+	log = MTY_RecordLogCreate(dir, 1024 * 1024, MTY_DURABILITY_NONE, 0);
+	test_cmp("MTY_RecordLogCreate (Empty)", log != NULL && MTY_RecordLogAppend(log, buf, sizeof(uint32_t) + val % 64));
+	MTY_RecordLogDestroy(&log);
+
+	uint8_t zero[64] = {0};
+	const char *headerless = MTY_JoinPath(dir, "00000000ffffffff.log");
+	MTY_WriteFile(headerless, zero, sizeof(zero));
+
+	log = MTY_RecordLogCreate(dir, 1024 * 1024, MTY_DURABILITY_NONE, 0);
+	test_cmp("MTY_RecordLogCreate (Hdr)", log != NULL && MTY_RecordLogAppend(log, buf, sizeof(uint32_t) + val % 64));
+	MTY_RecordLogDestroy(&log);
+
+	n = file_record_read(dir, &last);
+	test_cmpi32("MTY_RecordReaderNext", n == FILE_RECORDS + 2 && last == val, n);
+
+	file_record_clean(dir);
+	MTY_DeleteFile(dir);
+
+	return true;
+}
+
+#else
+
+static bool file_record_log(void)
+{
+	return true;
+}
+
+#endif
+
 static bool file_main (void)
 {
 	const char *origin_file = "test_file.txt";
@@ -49,6 +206,7 @@ static bool file_main (void)
 	size_t read_bytes;
 	char *g_address_2 = (char *) MTY_ReadFile(full_path, &read_bytes);
 	test_cmp("MTY_ReadFile", strlen(g_address_2) == strlen(file_g_address));
+	test_cmp("MTY_GetFileSize", MTY_GetFileSize(full_path) == read_bytes);
 	MTY_Free(g_address_2);
 
 	MTY_WriteTextFile(full_path, "%s", "a");
@@ -70,6 +228,7 @@ static bool file_main (void)
 
 	MTY_DeleteFile(full_path);
 	test_cmp("MTY_DeleteFile1", !MTY_FileExists(full_path));
+	test_cmp("MTY_GetFileSize", MTY_GetFileSize(full_path) == 0);
 	test_cmp("MTY_DeleteFile2", !MTY_DeleteFile(full_path)); // Make sure it handles missing file
 
 	MTY_MoveFile(full_path_2, full_path);
@@ -100,5 +259,8 @@ static bool file_main (void)
 
 	// FIXME: This will leave an orphaned dir.
 
+	if (!file_record_log())
+		return false;
+
 	return true;
 }
@@ -0,0 +1,59 @@
+// Copyright (c) Christopher D. Dickson <cdd@matoya.group>
+//
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+#include "../fuzz/targets.h"
+
+#define FUZZ_CORPUS "../fuzz/corpus"
+
+static void fuzz_log(const char *msg, void *opaque)
+{
+}
+
+static bool fuzz_replay(const struct fuzz_target *target, uint32_t *n)
+{
+	*n = 0;
+
+	MTY_FileList *list = MTY_GetFileList(MTY_JoinPath(FUZZ_CORPUS, target->name), NULL);
+	if (!list)
+		return false;
+
+	for (uint32_t x = 0; x < list->len; x++) {
+		if (list->files[x].dir)
+			continue;
+
+		size_t size = 0;
+		void *data = MTY_ReadFile(list->files[x].path, &size);
+		if (!data)
+			continue;
+
+		// Failed invariants abort, which fails the whole run
+		target->func(data, size);
+		MTY_Free(data);
+
+		(*n)++;
+	}
+
+	MTY_FreeFileList(&list);
+
+	return true;
+}
+
+static bool fuzz_main(void)
+{
+	// Most of the corpus is malformed on purpose
+	MTY_SetLogFunc(fuzz_log, NULL);
+
+	for (size_t x = 0; x < FUZZ_TARGETS_LEN; x++) {
+		uint32_t n = 0;
+		bool r = fuzz_replay(&FUZZ_TARGETS[x], &n);
+
+		char name[32];
+		snprintf(name, 32, "fuzz_%s", FUZZ_TARGETS[x].name);
+		test_cmpi32(name, r && n > 0, n);
+	}
+
+	return true;
+}
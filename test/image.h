@@ -0,0 +1,230 @@
+// Copyright (c) Christopher D. Dickson <cdd@matoya.group>
+//
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+#if !defined(_WIN32)
+	#include <sys/resource.h>
+#endif
+
+#define IMAGE_W     640
+#define IMAGE_H     480
+#define IMAGE_BATCH 64
+
+struct image_state {
+	MTY_Atomic32 done;
+	MTY_Atomic32 valid;
+	MTY_Atomic32 failed;
+};
+
+static uint8_t *image_gradient(uint32_t w, uint32_t h)
+{
+	uint8_t *rgba = MTY_Alloc(w * h, 4);
+
+	for (uint32_t y = 0; y < h; y++) {
+		for (uint32_t x = 0; x < w; x++) {
+			uint8_t *p = rgba + (y * w + x) * 4;
+			p[0] = (uint8_t) (x * 255 / (w - 1));
+			p[1] = (uint8_t) (y * 255 / (h - 1));
+			p[2] = 128;
+			p[3] = 255;
+		}
+	}
+
+	return rgba;
+}
+
+static int64_t image_peak_rss(void)
+{
+	#if !defined(_WIN32)
+		struct rusage usage = {0};
+		getrusage(RUSAGE_SELF, &usage);
+
+		return usage.ru_maxrss;
+	#else
+		return 0;
+	#endif
+}
+
+static void image_batch_func(const MTY_ImageJob *job, const void *output, size_t size,
+	uint32_t width, uint32_t height, void *opaque)
+{
+	struct image_state *state = opaque;
+
+	if (!output) {
+		MTY_Atomic32Add(&state->failed, 1);
+
+	} else {
+		uint32_t w = 0;
+		uint32_t h = 0;
+		void *image = MTY_DecompressImage(output, size, &w, &h);
+
+		// 640x480 center cropped to 480x480, then fit to 128x128
+		if (image && w == width && h == height && w == 128 && h == 128)
+			MTY_Atomic32Add(&state->valid, 1);
+
+		MTY_Free(image);
+	}
+
+	MTY_Atomic32Add(&state->done, 1);
+}
+
+static void *image_serial(const void *input, size_t size, size_t *output_size)
+{
+	uint32_t w = 0;
+	uint32_t h = 0;
+	void *image = MTY_DecompressImage(input, size, &w, &h);
+
+	void *cropped = MTY_CropImage(image, IMAGE_H, IMAGE_H, &w, &h);
+	void *resized = MTY_ResizeImage(cropped, w, h, 128, 128);
+	void *output = MTY_CompressImage(MTY_IMAGE_COMPRESSION_PNG, resized, 128, 128, output_size);
+
+	MTY_Free(resized);
+	MTY_Free(cropped);
+	MTY_Free(image);
+
+	return output;
+}
+
+static bool image_resize(void)
+{
+	// 2x2 blocks average down to one pixel
+	uint8_t src[4 * 4 * 4] = {0};
+	for (uint32_t x = 0; x < 16; x++)
+		src[x * 4] = (uint8_t) ((x % 4) * 40 + (x / 4) * 10);
+
+	uint8_t *dst = MTY_ResizeImage(src, 4, 4, 2, 2);
+	test_cmp("MTY_ResizeImage", dst != NULL);
+	test_cmpi32("MTY_ResizeImage (Shrink)", dst[0] == 25 && dst[4] == 105 && dst[8] == 45 && dst[12] == 125, dst[0]);
+	MTY_Free(dst);
+
+	// Pixels repeat when enlarging
+	dst = MTY_ResizeImage(src, 4, 4, 8, 8);
+	test_cmpi32("MTY_ResizeImage (Grow)", dst[0] == 0 && dst[4] == 0 && dst[8] == 40 && dst[8 * 4 * 2] == 10, dst[8]);
+	MTY_Free(dst);
+
+	test_cmp("MTY_ResizeImage (Empty)", MTY_ResizeImage(src, 4, 4, 0, 2) == NULL);
+
+	return true;
+}
+
+static bool image_main(void)
+{
+	if (!image_resize())
+		return false;
+
+	uint8_t *rgba = image_gradient(IMAGE_W, IMAGE_H);
+
+	size_t png_size = 0;
+	void *png = MTY_CompressImage(MTY_IMAGE_COMPRESSION_PNG, rgba, IMAGE_W, IMAGE_H, &png_size);
+	test_cmp("MTY_CompressImage (PNG)", png != NULL);
+
+	// The JPEG writer emits many small writes that must all be kept
+	size_t jpg_size = 0;
+	void *jpg = MTY_CompressImage(MTY_IMAGE_COMPRESSION_JPEG, rgba, IMAGE_W, IMAGE_H, &jpg_size);
+	test_cmpi64("MTY_CompressImage (JPEG)", jpg && jpg_size > 1024, jpg_size);
+
+	uint32_t w = 0;
+	uint32_t h = 0;
+	void *image = MTY_DecompressImage(jpg, jpg_size, &w, &h);
+	test_cmp("MTY_DecompressImage (JPEG)", image && w == IMAGE_W && h == IMAGE_H);
+	test_cmpi32("MTY_DecompressImage (JPEG)", abs((int32_t) ((uint8_t *) image)[(240 * IMAGE_W + 320) * 4] - rgba[(240 * IMAGE_W + 320) * 4]) < 8,
+		((uint8_t *) image)[(240 * IMAGE_W + 320) * 4]);
+	MTY_Free(image);
+
+	test_cmp("MTY_WriteFile", MTY_WriteFile("image.png", png, png_size));
+
+	// Serial baseline
+	int64_t rss = image_peak_rss();
+	MTY_Time ts = MTY_GetTime();
+
+	for (uint32_t x = 0; x < IMAGE_BATCH; x++) {
+		size_t size = 0;
+		MTY_Free(image_serial(x % 2 ? jpg : png, x % 2 ? jpg_size : png_size, &size));
+	}
+
+	float serial = IMAGE_BATCH / (MTY_TimeDiff(ts, MTY_GetTime()) / 1000.0f);
+	test_cmpf("Image serial (images/s)", serial > 0.0f, serial);
+	test_cmpi64("Image serial (RSS KB)", true, image_peak_rss() - rss);
+
+	// Batch on every logical processor
+	struct image_state state = {0};
+	MTY_ImageBatch *batch = MTY_ImageBatchCreate(0, 64 * 1024 * 1024, image_batch_func, &state);
+	test_cmp("MTY_ImageBatchCreate", batch != NULL);
+
+	MTY_ImageJob job = {0};
+	job.cropWidth = IMAGE_H;
+	job.cropHeight = IMAGE_H;
+	job.maxWidth = 128;
+	job.maxHeight = 128;
+	job.compress = true;
+	job.method = MTY_IMAGE_COMPRESSION_PNG;
+
+	rss = image_peak_rss();
+	ts = MTY_GetTime();
+
+	for (uint32_t x = 0; x < IMAGE_BATCH; x++) {
+		job.input = x % 2 ? jpg : png;
+		job.size = x % 2 ? jpg_size : png_size;
+		MTY_ImageBatchSubmit(batch, &job);
+	}
+
+	MTY_ImageBatchWait(batch);
+
+	float batched = IMAGE_BATCH / (MTY_TimeDiff(ts, MTY_GetTime()) / 1000.0f);
+	test_cmpf("Image batch (images/s)", MTY_Atomic32Get(&state.valid) == IMAGE_BATCH, batched);
+	test_cmpi64("Image batch (RSS KB)", true, image_peak_rss() - rss);
+
+	// From a file, and a failure
+	job.input = NULL;
+	job.size = 0;
+	job.path = "image.png";
+	MTY_ImageBatchSubmit(batch, &job);
+
+	uint8_t garbage[64] = {0x89, 'P', 'N', 'G'};
+	job.path = NULL;
+	job.input = garbage;
+	job.size = sizeof(garbage);
+	MTY_ImageBatchSubmit(batch, &job);
+
+	MTY_ImageBatchDestroy(&batch);
+	test_cmp("MTY_ImageBatchDestroy", batch == NULL);
+	test_cmpi32("MTY_ImageJob (Path)", MTY_Atomic32Get(&state.valid) == IMAGE_BATCH + 1, MTY_Atomic32Get(&state.valid));
+	test_cmpi32("MTY_ImageJob (Failed)", MTY_Atomic32Get(&state.failed) == 1, MTY_Atomic32Get(&state.failed));
+
+	// A 1 byte memory limit lets only one image through at a time
+	memset(&state, 0, sizeof(struct image_state));
+	batch = MTY_ImageBatchCreate(4, 1, image_batch_func, &state);
+
+	job.input = png;
+	job.size = png_size;
+
+	for (uint32_t x = 0; x < 16; x++)
+		MTY_ImageBatchSubmit(batch, &job);
+
+	MTY_ImageBatchWait(batch);
+	test_cmpi32("MTY_ImageBatch (Limit)", MTY_Atomic32Get(&state.valid) == 16, MTY_Atomic32Get(&state.valid));
+
+	// Files are reserved before they're read, missing files release their reservation
+	job.input = NULL;
+	job.size = 0;
+
+	for (uint32_t x = 0; x < 16; x++) {
+		job.path = x % 4 == 3 ? "missing.png" : "image.png";
+		MTY_ImageBatchSubmit(batch, &job);
+	}
+
+	MTY_ImageBatchWait(batch);
+	test_cmpi32("MTY_ImageBatch (Limit Path)", MTY_Atomic32Get(&state.valid) == 28, MTY_Atomic32Get(&state.valid));
+	test_cmpi32("MTY_ImageBatch (Limit Path)", MTY_Atomic32Get(&state.failed) == 4, MTY_Atomic32Get(&state.failed));
+
+	MTY_ImageBatchDestroy(&batch);
+
+	MTY_DeleteFile("image.png");
+	MTY_Free(jpg);
+	MTY_Free(png);
+	MTY_Free(rgba);
+
+	return true;
+}
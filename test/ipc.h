@@ -0,0 +1,392 @@
+// Copyright (c) Christopher D. Dickson <cdd@matoya.group>
+//
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+#if defined(__linux__) && !defined(__ANDROID__)
+
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#define IPC_RECORDS    100000
+#define IPC_PRODUCERS  4
+#define IPC_CHUNK      (64 * 1024)
+#define IPC_BENCH_SIZE (256 * 1024 * 1024)
+#define IPC_WRAP_RING  1024
+#define IPC_WRAP_N     20000
+
+struct ipc_record {
+	uint32_t producer;
+	uint32_t seq;
+};
+
+static void ipc_name(char *name, size_t size, const char *tag)
+{
+	snprintf(name, size, "test-%s-%d", tag, (int32_t) getpid());
+}
+
+static void ipc_produce(const char *name, uint32_t producer, uint32_t n)
+{
+	MTY_SharedRing *ctx = MTY_SharedRingOpen(name);
+	if (!ctx)
+		_exit(1);
+
+	for (uint32_t x = 0; x < n; x++) {
+		size_t size = sizeof(struct ipc_record) + x % 200;
+
+		struct ipc_record *rec = MTY_SharedRingGetInputBuffer(ctx, size, -1);
+		if (!rec)
+			_exit(1);
+
+		rec->producer = producer;
+		rec->seq = x;
+		MTY_SharedRingPush(ctx, size);
+	}
+
+	MTY_SharedRingDestroy(&ctx);
+	_exit(0);
+}
+
+static bool ipc_wait_children(uint32_t n)
+{
+	bool r = true;
+
+	for (uint32_t x = 0; x < n; x++) {
+		int32_t status = 0;
+		wait(&status);
+
+		r = r && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+	}
+
+	return r;
+}
+
+static bool ipc_spsc_mpsc(void)
+{
+	char name[64];
+	ipc_name(name, sizeof(name), "mpsc");
+
+	MTY_SharedRing *ctx = MTY_SharedRingCreate(name, MTY_SHARED_RING_MPSC, 64 * 1024, 0, 0);
+	test_cmp("MTY_SharedRingCreate", ctx != NULL);
+
+	for (uint32_t x = 0; x < IPC_PRODUCERS; x++)
+		if (fork() == 0)
+			ipc_produce(name, x, IPC_RECORDS);
+
+	uint32_t next[IPC_PRODUCERS] = {0};
+	uint32_t total = 0;
+	bool ordered = true;
+
+	while (true) {
+		void *buf = NULL;
+		size_t size = 0;
+
+		MTY_Async r = MTY_SharedRingGetOutputBuffer(ctx, 5000, &buf, &size);
+		if (r != MTY_ASYNC_OK) {
+			test_cmp("MTY_SharedRingGetOutput", r == MTY_ASYNC_DONE);
+			break;
+		}
+
+		// Records from each producer must arrive in order and with the pushed size
+		struct ipc_record *rec = buf;
+		ordered = ordered && rec->producer < IPC_PRODUCERS && rec->seq == next[rec->producer] &&
+			size == sizeof(struct ipc_record) + rec->seq % 200;
+
+		if (rec->producer < IPC_PRODUCERS)
+			next[rec->producer]++;
+
+		total++;
+		MTY_SharedRingPop(ctx);
+	}
+
+	test_cmp("MTY_SharedRingOpen", ipc_wait_children(IPC_PRODUCERS));
+	test_cmp("MTY_SharedRingPop", ordered);
+	test_cmpi32("MTY_SharedRingPush", total == IPC_RECORDS * IPC_PRODUCERS, total);
+
+	MTY_SharedRingDestroy(&ctx);
+	test_cmp("MTY_SharedRingDestroy", ctx == NULL);
+
+	// A second producer may not attach to an SPSC ring
+	ipc_name(name, sizeof(name), "spsc");
+	ctx = MTY_SharedRingCreate(name, MTY_SHARED_RING_SPSC, 4096, 0, 0);
+
+	MTY_SharedRing *p0 = MTY_SharedRingOpen(name);
+	MTY_SharedRing *p1 = MTY_SharedRingOpen(name);
+	test_cmp("MTY_SharedRingOpen (SPSC)", p0 && !p1);
+
+	MTY_SharedRingDestroy(&p0);
+	MTY_SharedRingDestroy(&ctx);
+
+	return true;
+}
+
+static bool ipc_wrap(void)
+{
+	char name[64];
+	ipc_name(name, sizeof(name), "wrap");
+
+	MTY_SharedRing *ctx = MTY_SharedRingCreate(name, MTY_SHARED_RING_SPSC, IPC_WRAP_RING, 0, 0);
+	MTY_SharedRing *p = MTY_SharedRingOpen(name);
+	test_cmp("MTY_SharedRingOpen", ctx && p);
+
+	// Mixed record sizes put new headers in the middle of old payloads, which are
+	// filled with bytes that look like committed flags
+	bool pending = true;
+	bool ordered = true;
+
+	for (uint32_t x = 0; x < IPC_WRAP_N && pending && ordered; x++) {
+		size_t size = sizeof(uint32_t) + (x * 37) % 300;
+
+		uint8_t *buf = MTY_SharedRingGetInputBuffer(p, size, 0);
+		if (!buf) {
+			ordered = false;
+			break;
+		}
+
+		// A reserved record must not be visible before it is pushed
+		void *out = NULL;
+		size_t out_size = 0;
+		pending = MTY_SharedRingGetOutputBuffer(ctx, 0, &out, &out_size) == MTY_ASYNC_CONTINUE;
+
+		memset(buf, 0xFF, size);
+		memcpy(buf, &x, sizeof(uint32_t));
+		MTY_SharedRingPush(p, size);
+
+		uint32_t seq = UINT32_MAX;
+
+		if (MTY_SharedRingGetOutputBuffer(ctx, 0, &out, &out_size) == MTY_ASYNC_OK)
+			memcpy(&seq, out, sizeof(uint32_t));
+
+		ordered = seq == x && out_size == size;
+		MTY_SharedRingPop(ctx);
+	}
+
+	test_cmp("MTY_SharedRingGetOutput (Wrap)", pending);
+	test_cmp("MTY_SharedRingPop (Wrap)", ordered);
+
+	MTY_SharedRingDestroy(&p);
+	MTY_SharedRingDestroy(&ctx);
+
+	return true;
+}
+
+static bool ipc_dead_peer(void)
+{
+	char name[64];
+	ipc_name(name, sizeof(name), "dead");
+
+	MTY_SharedRing *ctx = MTY_SharedRingCreate(name, MTY_SHARED_RING_MPSC, 4096, 4096, 2);
+
+	// The child reserves a record and both blocks then dies without committing
+	if (fork() == 0) {
+		MTY_SharedRing *p = MTY_SharedRingOpen(name);
+		uint32_t index = 0;
+
+		if (!p || !MTY_SharedRingGetBlock(p, 0, &index) || !MTY_SharedRingGetBlock(p, 0, &index))
+			_exit(1);
+
+		if (MTY_SharedRingGetBlock(p, 0, &index) || !MTY_SharedRingGetInputBuffer(p, 16, 0))
+			_exit(1);
+
+		_exit(0);
+	}
+
+	test_cmp("MTY_SharedRingGetBlock", ipc_wait_children(1));
+
+	void *buf = NULL;
+	MTY_Time ts = MTY_GetTime();
+	MTY_Async r = MTY_SharedRingGetOutputBuffer(ctx, 5000, &buf, NULL);
+	float elapsed = MTY_TimeDiff(ts, MTY_GetTime());
+
+	test_cmpf("MTY_SharedRingGetOutput", r == MTY_ASYNC_DONE && elapsed < 1000.0f, elapsed);
+	test_cmp("MTY_SharedRingIsPeerAlive", !MTY_SharedRingIsPeerAlive(ctx));
+
+	// Blocks owned by the dead producer must have been reclaimed
+	MTY_SharedRing *p = MTY_SharedRingOpen(name);
+	uint32_t a = 0, b = 0;
+	test_cmp("MTY_SharedRingGetBlock", MTY_SharedRingGetBlock(p, 0, &a) && MTY_SharedRingGetBlock(p, 0, &b));
+	MTY_SharedRingDestroy(&p);
+	MTY_SharedRingDestroy(&ctx);
+
+	// Taking over a dead producer's slot must return its blocks even if the consumer
+	// has not noticed the death yet
+	ipc_name(name, sizeof(name), "takeover");
+	ctx = MTY_SharedRingCreate(name, MTY_SHARED_RING_SPSC, 4096, 4096, 2);
+
+	if (fork() == 0) {
+		MTY_SharedRing *c = MTY_SharedRingOpen(name);
+		uint32_t index = 0;
+
+		_exit(c && MTY_SharedRingGetBlock(c, 0, &index) && MTY_SharedRingGetBlock(c, 0, &index) ? 0 : 1);
+	}
+
+	test_cmp("MTY_SharedRingGetBlock", ipc_wait_children(1));
+
+	p = MTY_SharedRingOpen(name);
+	test_cmp("MTY_SharedRingOpen (Takeover)", p && MTY_SharedRingGetBlock(p, 0, &a) &&
+		MTY_SharedRingGetBlock(p, 0, &b));
+
+	MTY_SharedRingDestroy(&p);
+
+	// A producer must notice the consumer has gone away rather than block forever
+	MTY_SharedRing *orphan = NULL;
+	ipc_name(name, sizeof(name), "orphan");
+
+	if (fork() == 0) {
+		MTY_SharedRing *c = MTY_SharedRingCreate(name, MTY_SHARED_RING_SPSC, 4096, 0, 0);
+		MTY_Sleep(200);
+		_exit(c ? 0 : 1);
+	}
+
+	for (uint32_t x = 0; x < 100 && !orphan; x++) {
+		MTY_Sleep(5);
+		orphan = MTY_SharedRingOpen(name);
+	}
+
+	test_cmp("MTY_SharedRingOpen", orphan != NULL);
+
+	while (MTY_SharedRingGetInputBuffer(orphan, 1024, 0))
+		MTY_SharedRingPush(orphan, 1024);
+
+	// Once reaped the consumer is gone, so an indefinite wait must return
+	test_cmp("MTY_SharedRingCreate", ipc_wait_children(1));
+	test_cmp("MTY_SharedRingGetInput", !MTY_SharedRingGetInputBuffer(orphan, 1024, -1));
+	test_cmp("MTY_SharedRingIsPeerAlive", !MTY_SharedRingIsPeerAlive(orphan));
+
+	MTY_SharedRingDestroy(&orphan);
+	MTY_SharedRingDestroy(&ctx);
+
+	// The consumer died without unlinking, so its name must be taken over
+	ctx = MTY_SharedRingCreate(name, MTY_SHARED_RING_SPSC, 4096, 0, 0);
+	test_cmp("MTY_SharedRingCreate (Stale)", ctx != NULL);
+	MTY_SharedRingDestroy(&ctx);
+
+	return true;
+}
+
+static bool ipc_benchmark(void)
+{
+	uint8_t *chunk = MTY_Alloc(IPC_CHUNK, 1);
+
+	// Shared ring, each chunk is copied once into a zero-copy block
+	char name[64];
+	ipc_name(name, sizeof(name), "bench");
+
+	MTY_SharedRing *ctx = MTY_SharedRingCreate(name, MTY_SHARED_RING_SPSC, 4096, IPC_CHUNK, 8);
+
+	if (fork() == 0) {
+		MTY_SharedRing *p = MTY_SharedRingOpen(name);
+
+		for (uint32_t x = 0; p && x < IPC_BENCH_SIZE / IPC_CHUNK; x++) {
+			uint32_t index = 0;
+			void *block = MTY_SharedRingGetBlock(p, -1, &index);
+			if (!block)
+				_exit(1);
+
+			memcpy(block, chunk, IPC_CHUNK);
+			MTY_SharedRingPushBlock(p, index, IPC_CHUNK, -1);
+		}
+
+		bool ok = p != NULL;
+		MTY_SharedRingDestroy(&p);
+		_exit(ok ? 0 : 1);
+	}
+
+	size_t total = 0;
+	MTY_Time ts = MTY_GetTime();
+
+	while (true) {
+		void *buf = NULL;
+		size_t size = 0;
+
+		if (MTY_SharedRingGetOutputBuffer(ctx, 5000, &buf, &size) != MTY_ASYNC_OK)
+			break;
+
+		memcpy(chunk, buf, size);
+		total += size;
+		MTY_SharedRingPop(ctx);
+	}
+
+	float ring_ms = MTY_TimeDiff(ts, MTY_GetTime());
+	ipc_wait_children(1);
+	MTY_SharedRingDestroy(&ctx);
+
+	test_cmpf("MTY_SharedRing (MB/s)", total == IPC_BENCH_SIZE, IPC_BENCH_SIZE / 1048.576f / ring_ms);
+
+	// Loopback TCP baseline
+	int32_t s = socket(AF_INET, SOCK_STREAM, 0);
+
+	struct sockaddr_in addr = {0};
+	socklen_t len = sizeof(addr);
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	bind(s, (struct sockaddr *) &addr, sizeof(addr));
+	listen(s, 1);
+	getsockname(s, (struct sockaddr *) &addr, &len);
+
+	if (fork() == 0) {
+		int32_t c = socket(AF_INET, SOCK_STREAM, 0);
+		if (connect(c, (struct sockaddr *) &addr, sizeof(addr)) != 0)
+			_exit(1);
+
+		for (size_t sent = 0; sent < IPC_BENCH_SIZE;) {
+			ssize_t n = send(c, chunk, IPC_CHUNK, 0);
+			if (n <= 0)
+				_exit(1);
+
+			sent += n;
+		}
+
+		close(c);
+		_exit(0);
+	}
+
+	int32_t c = accept(s, NULL, NULL);
+	total = 0;
+	ts = MTY_GetTime();
+
+	for (ssize_t n = 1; n > 0; total += n)
+		n = recv(c, chunk, IPC_CHUNK, 0);
+
+	float tcp_ms = MTY_TimeDiff(ts, MTY_GetTime());
+	ipc_wait_children(1);
+	close(c);
+	close(s);
+
+	test_cmpf("Loopback TCP (MB/s)", total == IPC_BENCH_SIZE, IPC_BENCH_SIZE / 1048.576f / tcp_ms);
+
+	MTY_Free(chunk);
+
+	return true;
+}
+
+static bool ipc_main(void)
+{
+	if (!ipc_spsc_mpsc())
+		return false;
+
+	if (!ipc_wrap())
+		return false;
+
+	if (!ipc_dead_peer())
+		return false;
+
+	if (!ipc_benchmark())
+		return false;
+
+	return true;
+}
+
+#else
+
+static bool ipc_main(void)
+{
+	return true;
+}
+
+#endif
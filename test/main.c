@@ -10,6 +10,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
 #include <inttypes.h>
 #include <locale.h>
 #include <math.h>
@@ -20,16 +21,26 @@
 
 /// Modules
 #include "memory.h"
+#include "metrics.h"
 #include "json.h"
 #include "version.h"
 #include "time.h"
+#include "timer.h"
 #include "log.h"
 #include "file.h"
+#include "image.h"
 #include "struct.h"
 #include "system.h"
 #include "thread.h"
+#include "ipc.h"
+#include "window.h"
+#include "controller.h"
+#include "audio.h"
 #include "crypto.h"
+#include "http.h"
+#include "fuzz.h"
 #include "net.h"
+#include "fiber.h"
 
 static void main_log(const char *msg, void *opaque)
 {
@@ -57,12 +68,21 @@ int32_t main(int32_t argc, char **argv)
 	if (!time_main())
 		return 1;
 
+	if (!timer_main())
+		return 1;
+
 	if (!file_main())
 		return 1;
 
+	if (!image_main())
+		return 1;
+
 	if (!memory_main())
 		return 1;
 
+	if (!metrics_main())
+		return 1;
+
 	if (!log_main())
 		return 1;
 
@@ -71,9 +91,32 @@ int32_t main(int32_t argc, char **argv)
 	if (!crypto_main())
 		return 1;
 
+	if (!http_main())
+		return 1;
+
+	if (!fuzz_main())
+		return 1;
+
+	MTY_SetLogFunc(main_log, NULL);
+
 	if (!thread_main())
 		return 1;
 
+	if (!ipc_main())
+		return 1;
+
+	if (!window_main())
+		return 1;
+
+	if (!controller_main())
+		return 1;
+
+	if (!audio_main())
+		return 1;
+
+	if (!fiber_main())
+		return 1;
+
 	if (!net_main())
 		return 1;
 
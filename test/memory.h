@@ -5,6 +5,100 @@
 // If a copy of the MIT License was not distributed with this file,
 // You can obtain one at https://spdx.org/licenses/MIT.html.
 
+#if !defined(_WIN32)
+	#include <sys/resource.h>
+#endif
+
+#define MEMORY_FRAME_SIZE (1920 * 1080 * 4)
+#define MEMORY_FRAMES     120
+
+static int64_t memory_faults(void)
+{
+	#if !defined(_WIN32)
+		struct rusage ru = {0};
+		getrusage(RUSAGE_SELF, &ru);
+
+		return ru.ru_minflt + ru.ru_majflt;
+	#else
+		return 0;
+	#endif
+}
+
+static bool memory_pool(void)
+{
+	// Baseline, a new zeroed frame every iteration
+	int64_t faults = memory_faults();
+	MTY_Time start = MTY_GetTime();
+
+	for (uint32_t x = 0; x < MEMORY_FRAMES; x++) {
+		uint8_t *frame = MTY_Alloc(MEMORY_FRAME_SIZE, 1);
+		memset(frame, x, MEMORY_FRAME_SIZE);
+		MTY_Free(frame);
+	}
+
+	float ms = MTY_TimeDiff(start, MTY_GetTime());
+	test_cmpf("MTY_Alloc (ms/Frame)", ms >= 0.0f, ms / MEMORY_FRAMES);
+	test_cmpi64("MTY_Alloc (Faults/Frame)", true, (memory_faults() - faults) / MEMORY_FRAMES);
+
+	MTY_BufferPool *pool = MTY_BufferPoolCreate(0, true);
+	test_cmp("MTY_BufferPoolCreate", pool != NULL);
+
+	faults = memory_faults();
+	start = MTY_GetTime();
+
+	for (uint32_t x = 0; x < MEMORY_FRAMES; x++) {
+		uint8_t *frame = MTY_BufferPoolAlloc(pool, MEMORY_FRAME_SIZE, false);
+		memset(frame, x, MEMORY_FRAME_SIZE);
+		MTY_BufferPoolFree(pool, frame);
+	}
+
+	ms = MTY_TimeDiff(start, MTY_GetTime());
+	test_cmpf("MTY_BufferPoolAlloc (ms/Frame)", ms >= 0.0f, ms / MEMORY_FRAMES);
+	test_cmpi64("MTY_BufferPoolAlloc (Faults/Frame)", true, (memory_faults() - faults) / MEMORY_FRAMES);
+
+	MTY_BufferPoolStats stats = {0};
+	MTY_BufferPoolGetStats(pool, &stats);
+	test_cmp("MTY_BufferPoolGetStats", stats.mapped == 1 && stats.reused == MEMORY_FRAMES - 1);
+	test_cmp("MTY_BufferPoolGetStats", stats.used == 0 && stats.cached >= MEMORY_FRAME_SIZE);
+
+	// Recycled buffers keep their contents unless zeroing is requested
+	uint8_t *frame = MTY_BufferPoolAlloc(pool, MEMORY_FRAME_SIZE, false);
+	test_cmp("MTY_BufferPoolAlloc", frame[0] == MEMORY_FRAMES - 1);
+	MTY_BufferPoolFree(pool, frame);
+
+	frame = MTY_BufferPoolAlloc(pool, MEMORY_FRAME_SIZE, true);
+	test_cmp("MTY_BufferPoolAlloc", frame[0] == 0 && frame[MEMORY_FRAME_SIZE - 1] == 0);
+	test_cmp("MTY_BufferPoolAlloc", (uintptr_t) frame % 4096 == 0);
+
+	// Nearby sizes share a class
+	uint8_t *other = MTY_BufferPoolAlloc(pool, MEMORY_FRAME_SIZE - 4096, false);
+	MTY_BufferPoolFree(pool, frame);
+	frame = MTY_BufferPoolAlloc(pool, MEMORY_FRAME_SIZE - 4096, false);
+	MTY_BufferPoolGetStats(pool, &stats);
+	test_cmp("MTY_BufferPoolAlloc", frame != other && stats.mapped == 2 && stats.reused == MEMORY_FRAMES + 2);
+
+	MTY_BufferPoolFree(pool, frame);
+	MTY_BufferPoolTrim(pool, 0);
+	MTY_BufferPoolGetStats(pool, &stats);
+	test_cmp("MTY_BufferPoolTrim", stats.cached == 0 && stats.trimmed == 1);
+
+	// `other` is still outstanding and is released with the pool
+	MTY_BufferPoolDestroy(&pool);
+	test_cmp("MTY_BufferPoolDestroy", pool == NULL);
+
+	// Only explicit huge pages round the mapping up to 2 MiB, the fallback maps the class size
+	pool = MTY_BufferPoolCreate(0, true);
+	frame = MTY_BufferPoolAlloc(pool, 3 * 1024 * 1024, false);
+	MTY_BufferPoolGetStats(pool, &stats);
+	test_cmpi64("MTY_BufferPoolAlloc (Huge)", stats.used == (stats.huge > 0 ? 4 : 3) * 1024 * 1024,
+		(int64_t) stats.used);
+
+	MTY_BufferPoolFree(pool, frame);
+	MTY_BufferPoolDestroy(&pool);
+
+	return true;
+}
+
 static bool test_specific_printf(const char *function, char *buffer, const char *compare)
 {
 	int32_t cmp_val = strcmp(buffer, compare);
@@ -112,6 +206,9 @@ static bool memory_main(void)
 	MTY_FreeAligned(NULL);
 	test_cmp("MTY_FreeAligned", !failed);
 
+	if (!memory_pool())
+		return false;
+
 	size_t fail_value = 0;
 	for (size_t x = 0; x < 128 * 1024 * 1024; x += UINT16_MAX) {
 		char *buf = (char *) MTY_Alloc(1, x);
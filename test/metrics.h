@@ -0,0 +1,177 @@
+// Copyright (c) Christopher D. Dickson <cdd@matoya.group>
+//
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+#define METRICS_THREADS 4
+#define METRICS_UPDATES 100000
+#define METRICS_BENCH   2000000
+
+static void *metrics_thread(void *opaque)
+{
+	MTY_Metric *counter = MTY_GetMetric("test_updates", NULL, MTY_METRIC_COUNTER, NULL, 0);
+	MTY_Metric *hist = opaque;
+
+	for (uint32_t x = 0; x < METRICS_UPDATES; x++) {
+		MTY_MetricAdd(counter, 1);
+		MTY_MetricObserve(hist, 0.5);
+	}
+
+	return NULL;
+}
+
+static const MTY_MetricValue *metrics_find(const MTY_MetricList *list, const char *name)
+{
+	for (uint32_t x = 0; x < list->len; x++)
+		if (!strcmp(list->metrics[x].name, name))
+			return &list->metrics[x];
+
+	return NULL;
+}
+
+static uint64_t metrics_count(const char *name)
+{
+	MTY_MetricList *list = MTY_GetMetricList();
+	const MTY_MetricValue *v = list ? metrics_find(list, name) : NULL;
+	uint64_t count = v ? v->count : 0;
+
+	MTY_FreeMetricList(&list);
+
+	return count;
+}
+
+static bool metrics_bench(void)
+{
+	MTY_Metric *counter = MTY_GetMetric("test_bench", NULL, MTY_METRIC_COUNTER, NULL, 0);
+	MTY_Metric *hist = MTY_GetMetric("test_bench_hist", NULL, MTY_METRIC_HISTOGRAM, NULL, 0);
+
+	MTY_Time start = MTY_GetTime();
+
+	for (uint32_t x = 0; x < METRICS_BENCH; x++)
+		MTY_MetricAdd(counter, 1);
+
+	float ns = MTY_TimeDiff(start, MTY_GetTime()) * 1000000.0f / METRICS_BENCH;
+	test_cmpf("MTY_MetricAdd (ns/update)", ns > 0.0f, ns);
+
+	start = MTY_GetTime();
+
+	for (uint32_t x = 0; x < METRICS_BENCH; x++)
+		MTY_MetricObserve(hist, (double) (x % 1000) / 100.0);
+
+	ns = MTY_TimeDiff(start, MTY_GetTime()) * 1000000.0f / METRICS_BENCH;
+	test_cmpf("MTY_MetricObserve (ns/update)", ns > 0.0f, ns);
+
+	return true;
+}
+
+static bool metrics_main(void)
+{
+	// Registration
+	MTY_Metric *ok = MTY_GetMetric("test_requests{code=\"200\"}", "Requests.", MTY_METRIC_COUNTER, NULL, 0);
+	MTY_Metric *nf = MTY_GetMetric("test_requests{code=\"404\"}", "Requests.", MTY_METRIC_COUNTER, NULL, 0);
+	test_cmp("MTY_GetMetric", ok && nf && ok != nf);
+	test_cmp("MTY_GetMetric (Same)", MTY_GetMetric("test_requests{code=\"200\"}", NULL, MTY_METRIC_COUNTER, NULL, 0) == ok);
+
+	MTY_DisableLog(true);
+	test_cmp("MTY_GetMetric (Type)", !MTY_GetMetric("test_requests{code=\"200\"}", NULL, MTY_METRIC_GAUGE, NULL, 0));
+	test_cmp("MTY_GetMetric (Name)", !MTY_GetMetric("0test", NULL, MTY_METRIC_GAUGE, NULL, 0));
+	test_cmp("MTY_GetMetric (Labels)", !MTY_GetMetric("test{code=\"1\"", NULL, MTY_METRIC_GAUGE, NULL, 0));
+
+	const double bad[] = {2.0, 1.0};
+	test_cmp("MTY_GetMetric (Buckets)", !MTY_GetMetric("test_bad", NULL, MTY_METRIC_HISTOGRAM, bad, 2));
+	MTY_DisableLog(false);
+
+	MTY_MetricAdd(ok, 3);
+	MTY_MetricAdd(nf, 1);
+
+	MTY_Metric *gauge = MTY_GetMetric("test_depth", "Depth.", MTY_METRIC_GAUGE, NULL, 0);
+	MTY_MetricSet(gauge, 10);
+	MTY_MetricAdd(gauge, -3);
+
+	const double buckets[] = {1.0, 2.0, 5.0};
+	MTY_Metric *latency = MTY_GetMetric("test_latency", "Latency.", MTY_METRIC_HISTOGRAM, buckets, 3);
+
+	const double values[] = {0.5, 1.0, 1.5, 3.0, 10.0};
+	for (uint32_t x = 0; x < 5; x++)
+		MTY_MetricObserve(latency, values[x]);
+
+	// Concurrent updates from several threads
+	MTY_Metric *shared = MTY_GetMetric("test_shared", NULL, MTY_METRIC_HISTOGRAM, buckets, 3);
+	MTY_Thread *threads[METRICS_THREADS];
+
+	for (uint32_t x = 0; x < METRICS_THREADS; x++)
+		threads[x] = MTY_ThreadCreate(metrics_thread, shared);
+
+	for (uint32_t x = 0; x < METRICS_THREADS; x++)
+		MTY_ThreadDestroy(&threads[x]);
+
+	// Snapshot
+	MTY_MetricList *list = MTY_GetMetricList();
+	test_cmp("MTY_GetMetricList", list != NULL);
+
+	const MTY_MetricValue *v = metrics_find(list, "test_requests{code=\"200\"}");
+	test_cmpi64("MTY_GetMetricList (Counter)", v && v->value == 3, v ? v->value : -1);
+
+	v = metrics_find(list, "test_depth");
+	test_cmpi64("MTY_GetMetricList (Gauge)", v && v->value == 7, v ? v->value : -1);
+
+	v = metrics_find(list, "test_latency");
+	test_cmp("MTY_GetMetricList (Histogram)", v && v->numBuckets == 3 && v->count == 5 &&
+		v->bucketCounts[0] == 2 && v->bucketCounts[1] == 3 && v->bucketCounts[2] == 4);
+	test_cmpf("MTY_GetMetricList (Sum)", v && v->sum == 16.0, v ? v->sum : 0.0);
+
+	v = metrics_find(list, "test_updates");
+	test_cmpi64("MTY_MetricAdd (Threads)", v && v->value == METRICS_THREADS * METRICS_UPDATES, v ? v->value : -1);
+
+	v = metrics_find(list, "test_shared");
+	test_cmp("MTY_MetricObserve (Threads)", v && v->count == METRICS_THREADS * METRICS_UPDATES &&
+		v->bucketCounts[0] == v->count && v->sum == 0.5 * METRICS_THREADS * METRICS_UPDATES);
+
+	MTY_FreeMetricList(&list);
+	test_cmp("MTY_FreeMetricList", list == NULL);
+
+	// OpenMetrics
+	char *text = MTY_SerializeMetrics();
+	test_cmp("MTY_SerializeMetrics", text != NULL);
+
+	const char *type = strstr(text, "# TYPE test_requests counter\n# HELP test_requests Requests.\n");
+	test_cmp("MTY_SerializeMetrics (Family)", type && !strstr(type + 1, "# TYPE test_requests "));
+	test_cmp("MTY_SerializeMetrics (Labels)", strstr(text, "test_requests_total{code=\"200\"} 3\n") &&
+		strstr(text, "test_requests_total{code=\"404\"} 1\n"));
+	test_cmp("MTY_SerializeMetrics (Gauge)", strstr(text, "# TYPE test_depth gauge\n") &&
+		strstr(text, "\ntest_depth 7\n"));
+	test_cmp("MTY_SerializeMetrics (Histogram)", strstr(text, "test_latency_bucket{le=\"1\"} 2\n") &&
+		strstr(text, "test_latency_bucket{le=\"5\"} 4\n") && strstr(text, "test_latency_bucket{le=\"+Inf\"} 5\n") &&
+		strstr(text, "test_latency_count 5\n") && strstr(text, "test_latency_sum 16\n"));
+
+	size_t len = strlen(text);
+	test_cmp("MTY_SerializeMetrics (EOF)", len > 6 && !strcmp(text + len - 6, "# EOF\n"));
+
+	MTY_Free(text);
+
+	// Internal queue depth, only registered when the library is built with METRICS=1
+	MTY_Queue *q = MTY_QueueCreate(4, sizeof(uint32_t));
+	MTY_QueueGetInputBuffer(q);
+	MTY_QueuePush(q, 4);
+
+	uint64_t before = metrics_count("mty_queue_depth");
+
+	if (before > 0) {
+		void *bufs[3];
+		size_t sizes[3] = {4, 4, 4};
+
+		uint32_t n = MTY_QueueGetInputBuffers(q, bufs, 3);
+		MTY_QueuePushMany(q, sizes, n);
+
+		uint64_t after = metrics_count("mty_queue_depth");
+		test_cmpi64("MTY_QueuePushMany (Metric)", n == 3 && after == before + 1, after - before);
+	}
+
+	MTY_QueueDestroy(&q);
+
+	if (!metrics_bench())
+		return false;
+
+	return true;
+}
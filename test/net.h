@@ -8,6 +8,13 @@
 #include <windows.h>
 #endif
 
+#if defined(__linux__) && !defined(__ANDROID__)
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#endif
+
 #define header_agent "User-Agent: Mozilla/5.0 (Windows NT 10.0; Win64; x64; rv:87.0) Gecko/20100101 Firefox/87.0"
 
 static const char *ORIGINS[] = {
@@ -81,6 +88,132 @@ static bool net_websocket(void)
 	return true;
 }
 
+#define NET_SERVER_PORT    5360
+#define NET_SERVER_CONNS   200
+#define NET_SERVER_TIMEOUT 500
+#define NET_SLOW_CLIENTS   32
+
+#if defined(__linux__) && !defined(__ANDROID__)
+
+static bool net_websocket_slowloris(MTY_WebSocketServer *server)
+{
+	int32_t slow[NET_SLOW_CLIENTS];
+
+	struct sockaddr_in addr = {0};
+	addr.sin_family = AF_INET;
+	addr.sin_port = htons(NET_SERVER_PORT);
+	inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+
+	// Idle clients that send a partial upgrade request and then stall
+	const char *partial = "GET / HTTP/1.1\r\nHost: 127.0.0.1\r\n";
+
+	bool ok = true;
+
+	for (uint32_t x = 0; x < NET_SLOW_CLIENTS; x++) {
+		slow[x] = socket(AF_INET, SOCK_STREAM, 0);
+
+		ok = ok && slow[x] >= 0 && connect(slow[x], (struct sockaddr *) &addr, sizeof(addr)) == 0 &&
+			send(slow[x], partial, strlen(partial), 0) == (ssize_t) strlen(partial);
+	}
+
+	test_cmp("MTY_WebSocketServer (Slow Clients)", ok);
+
+	// A well behaved client must not wait on the stalled ones
+	uint16_t us = 0;
+	MTY_Time start = MTY_GetTime();
+	MTY_WebSocket *client = MTY_WebSocketConnect("127.0.0.1", NET_SERVER_PORT, false, "/",
+		"Origin: http://127.0.0.1:8080", 1000, &us);
+	test_cmp("MTY_WebSocketConnect (Slowloris)", client != NULL);
+
+	MTY_WebSocket *child = MTY_WebSocketServerAccept(server, 1000);
+	float ms = MTY_TimeDiff(start, MTY_GetTime());
+	test_cmpf("MTY_WebSocketServerAccept (Slowloris)", child != NULL && ms < NET_SERVER_TIMEOUT, ms);
+
+	MTY_WebSocketDestroy(&child);
+	MTY_WebSocketDestroy(&client);
+
+	// Stalled clients are closed by the server at the handshake deadline
+	MTY_Sleep(NET_SERVER_TIMEOUT * 2);
+
+	bool closed = true;
+
+	for (uint32_t x = 0; x < NET_SLOW_CLIENTS; x++) {
+		char c = 0;
+		closed = closed && recv(slow[x], &c, 1, 0) <= 0;
+		close(slow[x]);
+	}
+
+	test_cmp("MTY_WebSocketServer (Deadline)", closed);
+
+	MTY_WebSocketServerStats stats = {0};
+	MTY_WebSocketServerGetStats(server, &stats);
+	test_cmpi64("MTY_WebSocketServerGetStats (Timeouts)", stats.timeouts == NET_SLOW_CLIENTS, stats.timeouts);
+
+	return true;
+}
+
+#else
+
+static bool net_websocket_slowloris(MTY_WebSocketServer *server)
+{
+	return true;
+}
+
+#endif
+
+static bool net_websocket_server(void)
+{
+	MTY_WebSocketServerDesc desc = {0};
+	desc.ip = "127.0.0.1";
+	desc.port = NET_SERVER_PORT;
+	desc.origins = ORIGINS;
+	desc.numOrigins = NUM_ORIGINS;
+	desc.shards = 2;
+	desc.handshakeTimeout = NET_SERVER_TIMEOUT;
+
+	MTY_WebSocketServer *server = MTY_WebSocketServerCreate(&desc);
+	test_cmp("MTY_WebSocketServerCreate", server != NULL);
+
+	// Connection rate, each connection completes the full upgrade
+	bool ok = true;
+	MTY_Time start = MTY_GetTime();
+
+	for (uint32_t x = 0; x < NET_SERVER_CONNS && ok; x++) {
+		uint16_t us = 0;
+		MTY_WebSocket *client = MTY_WebSocketConnect("127.0.0.1", NET_SERVER_PORT, false, "/",
+			"Origin: http://127.0.0.1:8080", 1000, &us);
+		MTY_WebSocket *child = MTY_WebSocketServerAccept(server, 1000);
+
+		ok = client && child && us == 101;
+
+		MTY_WebSocketDestroy(&child);
+		MTY_WebSocketDestroy(&client);
+	}
+
+	float rate = NET_SERVER_CONNS / (MTY_TimeDiff(start, MTY_GetTime()) / 1000.0f);
+	test_cmpf("MTY_WebSocketServerAccept (Conn/s)", ok, rate);
+
+	// Disallowed origins are rejected without reaching the ready queue
+	uint16_t us = 0;
+	MTY_WebSocket *client = MTY_WebSocketConnect("127.0.0.1", NET_SERVER_PORT, false, "/",
+		"Origin: http://example.com", 1000, &us);
+	test_cmp("MTY_WebSocketConnect (Origin)", client == NULL);
+	test_cmp("MTY_WebSocketServerAccept (Origin)", MTY_WebSocketServerAccept(server, 100) == NULL);
+
+	if (!net_websocket_slowloris(server))
+		return false;
+
+	MTY_WebSocketServerStats stats = {0};
+	MTY_WebSocketServerGetStats(server, &stats);
+	test_cmpi64("MTY_WebSocketServerGetStats (Accepted)", stats.accepted == NET_SERVER_CONNS + 1, stats.accepted);
+	test_cmpi64("MTY_WebSocketServerGetStats (Rejected)", stats.rejected == 1, stats.rejected);
+
+	MTY_WebSocketServerDestroy(&server);
+	test_cmp("MTY_WebSocketServerDestroy", server == NULL);
+
+	return true;
+}
+
 #define badssl_test(host, should_fail) \
 	ok = MTY_HttpRequest(host, 0, true, "GET", "/", header_agent, NULL, 0, 10000, &resp, &resp_size, &resp_code); \
 	MTY_Free(resp); \
@@ -174,6 +307,9 @@ static bool net_main(void)
 	if (!net_websocket())
 		return false;
 
+	if (!net_websocket_server())
+		return false;
+
 	if (!net_websocket_echo())
 		return false;
 
@@ -19,6 +19,116 @@ static void* struct_thread(void* opaque)
 };
 */
 
+#define STRUCT_QUEUE_ITEMS 200000
+#define STRUCT_QUEUE_BATCH 32
+
+struct struct_queue_data {
+	MTY_Queue *q;
+	uint32_t batch;
+};
+
+static void *struct_queue_producer(void *opaque)
+{
+	struct struct_queue_data *data = opaque;
+
+	for (uint32_t x = 0; x < STRUCT_QUEUE_ITEMS;) {
+		if (data->batch == 1) {
+			uint32_t *buf = MTY_QueueGetInputBuffer(data->q);
+
+			if (buf) {
+				*buf = x++;
+				MTY_QueuePush(data->q, sizeof(uint32_t));
+			}
+
+		} else {
+			void *bufs[STRUCT_QUEUE_BATCH];
+			size_t sizes[STRUCT_QUEUE_BATCH];
+
+			uint32_t n = MTY_QueueGetInputBuffers(data->q, bufs, data->batch);
+
+			for (uint32_t y = 0; y < n && x < STRUCT_QUEUE_ITEMS; y++) {
+				*(uint32_t *) bufs[y] = x++;
+				sizes[y] = sizeof(uint32_t);
+			}
+
+			if (n > 0)
+				MTY_QueuePushMany(data->q, sizes, n);
+		}
+	}
+
+	return NULL;
+}
+
+static bool struct_queue_run(uint32_t batch, float *rate)
+{
+	struct struct_queue_data data = {0};
+	data.q = MTY_QueueCreate(256, sizeof(uint32_t));
+	data.batch = batch;
+
+	bool ordered = true;
+	uint32_t next = 0;
+
+	MTY_Time ts = MTY_GetTime();
+	MTY_Thread *thread = MTY_ThreadCreate(struct_queue_producer, &data);
+
+	while (next < STRUCT_QUEUE_ITEMS) {
+		void *bufs[STRUCT_QUEUE_BATCH];
+		size_t sizes[STRUCT_QUEUE_BATCH];
+
+		uint32_t n = MTY_QueueGetOutputBuffers(data.q, 1000, bufs, sizes, batch);
+		if (n == 0)
+			break;
+
+		for (uint32_t x = 0; x < n; x++)
+			ordered = ordered && sizes[x] == sizeof(uint32_t) && *(uint32_t *) bufs[x] == next++;
+
+		MTY_QueuePopMany(data.q, n);
+	}
+
+	MTY_ThreadDestroy(&thread);
+
+	*rate = (float) STRUCT_QUEUE_ITEMS / MTY_TimeDiff(ts, MTY_GetTime()) * 1000.0f;
+
+	MTY_QueueDestroy(&data.q);
+
+	return ordered && next == STRUCT_QUEUE_ITEMS;
+}
+
+static bool struct_queue_batch(void)
+{
+	MTY_Queue *q = MTY_QueueCreate(4, sizeof(uint32_t));
+
+	void *bufs[8];
+	size_t sizes[8] = {4, 4, 4, 0};
+
+	uint32_t n = MTY_QueueGetInputBuffers(q, bufs, 8);
+	test_cmpi32("MTY_QueueGetInputBuffers", n == 4, n);
+
+	MTY_QueuePushMany(q, sizes, n);
+	test_cmpi32("MTY_QueuePushMany", MTY_QueueGetLength(q) == 3, MTY_QueueGetLength(q));
+
+	n = MTY_QueueGetOutputBuffers(q, 0, bufs, sizes, 8);
+	test_cmpi32("MTY_QueueGetOutputBuffers", n == 3, n);
+
+	MTY_QueuePopMany(q, n);
+	test_cmp("MTY_QueuePopMany", MTY_QueueGetLength(q) == 0);
+
+	n = MTY_QueueGetOutputBuffers(q, 0, bufs, sizes, 8);
+	test_cmp("MTY_QueueGetOutputBuffers", n == 0);
+
+	MTY_QueueDestroy(&q);
+
+	float single = 0;
+	bool r = struct_queue_run(1, &single);
+	test_cmpf("MTY_Queue (items/s)", r, single);
+
+	float batch = 0;
+	r = struct_queue_run(STRUCT_QUEUE_BATCH, &batch);
+	test_cmpf("MTY_Queue (batch items/s)", r, batch);
+
+	return true;
+}
+
 static bool struct_main(void)
 {
 	char stringkey[] = "I'm a test string key!";
@@ -112,6 +222,9 @@ static bool struct_main(void)
 	MTY_QueueDestroy(&queuectx);
 	test_cmp("MTY_QueueDestroy", queuectx == NULL);
 
+	if (!struct_queue_batch())
+		return false;
+
 	MTY_List* listctx = MTY_ListCreate();
 	test_cmp("MTY_ListCreate", listctx != NULL);
 
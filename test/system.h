@@ -32,6 +32,234 @@ typedef DWORD (WINAPI *PGetVersion)(void);
 
 #endif // _WIN32
 
+#if !defined(_WIN32)
+
+#include <signal.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#define SYSTEM_REPORT_MAX (64 * 1024)
+
+enum {
+	SYSTEM_CRASH_SEGV,
+	SYSTEM_CRASH_OVERFLOW,
+	SYSTEM_CRASH_THREAD_OVERFLOW,
+	SYSTEM_CRASH_FPE,
+	SYSTEM_CRASH_ILL,
+	SYSTEM_CRASH_BUS,
+};
+
+static volatile uint32_t SYSTEM_DEPTH = UINT32_MAX;
+static volatile uint32_t * volatile SYSTEM_BAD_PTR = (uint32_t *) 0x10;
+
+static void system_crash_func(bool forced, void *opaque)
+{
+	const char *msg = forced ? "crash func: forced\n" : "crash func\n";
+	write(*(int32_t *) opaque, msg, strlen(msg));
+}
+
+static uint32_t system_overflow(volatile uint8_t *prev)
+{
+	volatile uint8_t buf[1024];
+	buf[0] = prev ? prev[0] + 1 : 0;
+
+	if (SYSTEM_DEPTH-- == 0)
+		return 0;
+
+	// Not a tail call, each frame stays on the stack
+	return system_overflow(buf) + buf[0];
+}
+
+static void *system_overflow_thread(void *opaque)
+{
+	system_overflow(NULL);
+
+	return NULL;
+}
+
+static void system_crash_child(int32_t fd, uint32_t type)
+{
+	MTY_SetCrashReport(fd, 4);
+	MTY_SetCrashFunc(system_crash_func, &fd);
+
+	// Only the most recent four should make it into the report
+	for (uint32_t x = 0; x < 6; x++)
+		MTY_LogParams("system_crash_child", "flight %u", x);
+
+	switch (type) {
+		case SYSTEM_CRASH_SEGV:
+			*SYSTEM_BAD_PTR = 1;
+			break;
+		case SYSTEM_CRASH_OVERFLOW:
+			system_overflow(NULL);
+			break;
+		case SYSTEM_CRASH_THREAD_OVERFLOW: {
+			MTY_Thread *thread = MTY_ThreadCreate(system_overflow_thread, NULL);
+			MTY_ThreadDestroy(&thread);
+			break;
+		}
+		case SYSTEM_CRASH_FPE:
+			raise(SIGFPE);
+			break;
+		case SYSTEM_CRASH_ILL:
+			raise(SIGILL);
+			break;
+		case SYSTEM_CRASH_BUS:
+			raise(SIGBUS);
+			break;
+	}
+
+	_exit(0);
+}
+
+static bool system_crash_run(uint32_t type, int32_t sig, const char *name)
+{
+	int32_t fds[2];
+	test_cmp("pipe", pipe(fds) == 0);
+
+	pid_t pid = fork();
+	test_cmp("fork", pid >= 0);
+
+	if (pid == 0) {
+		close(fds[0]);
+		system_crash_child(fds[1], type);
+	}
+
+	close(fds[1]);
+
+	char *report = MTY_Alloc(SYSTEM_REPORT_MAX, 1);
+
+	for (size_t len = 0; len < SYSTEM_REPORT_MAX - 1;) {
+		ssize_t n = read(fds[0], report + len, SYSTEM_REPORT_MAX - 1 - len);
+		if (n <= 0)
+			break;
+
+		len += n;
+	}
+
+	close(fds[0]);
+
+	int32_t status = 0;
+	waitpid(pid, &status, 0);
+
+	char expected[64];
+	snprintf(expected, 64, "signal: %s (%d)", name, sig);
+
+	bool ok = WIFSIGNALED(status) && WTERMSIG(status) == sig &&
+		strstr(report, expected) && strstr(report, "fault address: 0x") &&
+		strstr(report, "thread: ") && strstr(report, "registers:") &&
+		strstr(report, "backtrace:\n") && strstr(report, "end of crash report") &&
+		strstr(report, "flight 5") && strstr(report, "flight 2") && !strstr(report, "flight 1") &&
+		strstr(report, "crash func\n");
+
+	#if defined(__GLIBC__) || defined(__APPLE__)
+		ok = ok && strstr(report, "[0x");
+	#endif
+
+	if (!ok)
+		printf("%s\n", report);
+
+	MTY_Free(report);
+
+	test_cmpi32("MTY_SetCrashReport", ok, sig);
+
+	return true;
+}
+
+static bool system_crash(void)
+{
+	if (!system_crash_run(SYSTEM_CRASH_SEGV, SIGSEGV, "SIGSEGV"))
+		return false;
+
+	if (!system_crash_run(SYSTEM_CRASH_OVERFLOW, SIGSEGV, "SIGSEGV"))
+		return false;
+
+	if (!system_crash_run(SYSTEM_CRASH_THREAD_OVERFLOW, SIGSEGV, "SIGSEGV"))
+		return false;
+
+	if (!system_crash_run(SYSTEM_CRASH_FPE, SIGFPE, "SIGFPE"))
+		return false;
+
+	if (!system_crash_run(SYSTEM_CRASH_ILL, SIGILL, "SIGILL"))
+		return false;
+
+	if (!system_crash_run(SYSTEM_CRASH_BUS, SIGBUS, "SIGBUS"))
+		return false;
+
+	return true;
+}
+
+#else
+
+static bool system_crash(void)
+{
+	return true;
+}
+
+#endif
+
+static int32_t system_impl_generic(void) { return 0; }
+static int32_t system_impl_avx2(void) { return 2; }
+static int32_t system_impl_avx512(void) { return 512; }
+
+static bool system_cpu(void)
+{
+	// Must be set before the first query, the result is cached
+	#if defined(_WIN32)
+		_putenv_s("MTY_CPU_DISABLE", "avx512");
+	#else
+		setenv("MTY_CPU_DISABLE", "avx512", 1);
+	#endif
+
+	uint32_t features = MTY_GetCPUFeatures();
+	test_cmpi32("MTY_GetCPUFeatures", !(features & MTY_CPU_AVX512), features);
+
+	MTY_CPUInfo info = {0};
+	MTY_GetCPUInfo(&info);
+
+	test_cmp("MTY_GetCPUInfo", info.features == features);
+	test_cmpi32("MTY_GetCPUInfo (Line)", info.cacheLine >= 16 && (info.cacheLine & (info.cacheLine - 1)) == 0, info.cacheLine);
+	test_cmpi32("MTY_GetCPUInfo (L1)", true, info.l1Size);
+	test_cmpi32("MTY_GetCPUInfo (L2)", true, info.l2Size);
+	test_cmpi32("MTY_GetCPUInfo (L3)", true, info.l3Size);
+	test_cmpi32("MTY_GetCPUInfo (Cores)", info.cores > 0 && info.cores <= info.threads, info.cores);
+	test_cmpi32("MTY_GetCPUInfo (Threads)", info.threads > 0, info.threads);
+
+	MTY_CPUImpl impls[] = {
+		{MTY_CPU_AVX512 | MTY_CPU_AVX2, (void *) system_impl_avx512},
+		{MTY_CPU_AVX2,                  (void *) system_impl_avx2},
+		{0,                             (void *) system_impl_generic},
+	};
+
+	int32_t (*func)(void) = (int32_t (*)(void)) MTY_SelectCPUImpl(impls, 3);
+	int32_t expected = (features & MTY_CPU_AVX2) ? 2 : 0;
+	test_cmpi32("MTY_SelectCPUImpl", func && func() == expected, func ? func() : -1);
+
+	test_cmp("MTY_SelectCPUImpl", !MTY_SelectCPUImpl(impls, 1));
+
+	MTY_CPUTopology *topo = MTY_GetCPUTopology();
+	test_cmpi32("MTY_GetCPUTopology (CPUs)", topo->numCPUs == info.threads, topo->numCPUs);
+	test_cmpi32("MTY_GetCPUTopology (Cores)", topo->numCores >= info.cores && topo->numCores <= topo->numCPUs, topo->numCores);
+	test_cmpi32("MTY_GetCPUTopology (LLCs)", topo->numLLCs > 0 && topo->numLLCs <= topo->numCores, topo->numLLCs);
+	test_cmpi32("MTY_GetCPUTopology (Nodes)", topo->numNodes > 0 && topo->numNodes <= topo->numCPUs, topo->numNodes);
+
+	bool valid = true;
+
+	for (uint32_t x = 0; x < topo->numCPUs; x++) {
+		const MTY_LogicalCPU *cpu = &topo->cpus[x];
+
+		if (cpu->core >= topo->numCores || cpu->llc >= topo->numLLCs || (x > 0 && cpu->id <= topo->cpus[x - 1].id))
+			valid = false;
+	}
+
+	test_cmp("MTY_GetCPUTopology", valid);
+
+	MTY_FreeCPUTopology(&topo);
+	test_cmp("MTY_FreeCPUTopology", topo == NULL);
+
+	return true;
+}
+
 static bool system_main(void)
 {
 	#if defined(_WIN32)
@@ -79,5 +307,11 @@ static bool system_main(void)
 	const char* verstring = MTY_GetPlatformString(plat);
 	test_cmps("MTY_GetVersionString", verstring, verstring);
 
+	if (!system_cpu())
+		return false;
+
+	if (!system_crash())
+		return false;
+
 	return true;
 }
@@ -60,6 +60,136 @@ static bool test_threadpools()
 	return true;
 }
 
+#define test_stream_size   (16 * 1024 * 1024)
+#define test_stream_passes 8
+#define test_stream_max    32
+
+struct test_stream_data {
+	uint64_t *buf;
+	uint64_t sum;
+};
+
+static void test_stream_thread(void *opaque)
+{
+	struct test_stream_data *data = (struct test_stream_data *) opaque;
+
+	data->sum = 0;
+
+	for (uint32_t x = 0; x < test_stream_passes; x++)
+		for (size_t y = 0; y < test_stream_size / sizeof(uint64_t); y++)
+			data->sum += data->buf[y];
+}
+
+static void *test_thread_affinity(void *opaque)
+{
+	MTY_CPUTopology *topo = (MTY_CPUTopology *) opaque;
+
+	uint32_t *cpus = MTY_Alloc(topo->numCPUs, sizeof(uint32_t));
+	for (uint32_t x = 0; x < topo->numCPUs; x++)
+		cpus[x] = topo->cpus[x].id;
+
+	bool r = MTY_ThreadSetAffinity(cpus, topo->numCPUs);
+	MTY_Free(cpus);
+
+	return r ? topo : NULL;
+}
+
+static float test_stream_run(MTY_ThreadPool *pool, struct test_stream_data *data, uint32_t n)
+{
+	uint32_t index[test_stream_max];
+
+	MTY_Time start = MTY_GetTime();
+
+	for (uint32_t x = 0; x < n; x++)
+		index[x] = MTY_ThreadPoolDispatch(pool, test_stream_thread, &data[x]);
+
+	for (uint32_t x = 0; x < n; x++) {
+		void *opaque = NULL;
+
+		while (index[x] > 0 && MTY_ThreadPoolPoll(pool, index[x], &opaque) != MTY_ASYNC_OK)
+			MTY_Sleep(1);
+
+		MTY_ThreadPoolDetach(pool, index[x], NULL);
+	}
+
+	float ms = MTY_TimeDiff(start, MTY_GetTime());
+
+	return ms > 0.0f ? (float) n * test_stream_size * test_stream_passes / (ms * 1000000.0f) : 0.0f;
+}
+
+static bool test_threadpools_topology()
+{
+	MTY_CPUTopology *topo = MTY_GetCPUTopology();
+
+	MTY_Thread *t = MTY_ThreadCreate(test_thread_affinity, topo);
+	void *r = MTY_ThreadDestroy(&t);
+
+	#if defined(_WIN32) || (defined(__linux__) && !defined(__EMSCRIPTEN__))
+		test_cmp("MTY_ThreadSetAffinity", r == topo);
+	#else
+		test_cmp("MTY_ThreadSetAffinity", r == NULL);
+	#endif
+
+	uint32_t n = topo->numCores < test_stream_max ? topo->numCores : test_stream_max;
+	struct test_stream_data data[test_stream_max] = {0};
+	uint64_t expected = 0;
+
+	for (size_t x = 0; x < test_stream_size / sizeof(uint64_t); x++)
+		expected += x * test_stream_passes;
+
+	// Baseline, every buffer is faulted in by this thread and lands on its node
+	MTY_ThreadPool *pool = MTY_ThreadPoolCreate(n);
+
+	for (uint32_t x = 0; x < n; x++) {
+		data[x].buf = MTY_Alloc(test_stream_size, 1);
+
+		for (size_t y = 0; y < test_stream_size / sizeof(uint64_t); y++)
+			data[x].buf[y] = y;
+	}
+
+	float base = test_stream_run(pool, data, n);
+
+	bool valid = true;
+	for (uint32_t x = 0; x < n; x++) {
+		valid = valid && data[x].sum == expected;
+		MTY_Free(data[x].buf);
+	}
+
+	test_cmp("MTY_ThreadPoolCreate (Stream)", valid);
+	test_cmpf("MTY_ThreadPoolCreate (GB/s)", base > 0.0f, base);
+
+	MTY_ThreadPoolDestroy(&pool, NULL);
+
+	// One pinned thread per core, each buffer lives on its thread's node. A fresh
+	// pool dispatches to indices 1 through n in order
+	pool = MTY_ThreadPoolCreateWithPolicy(MTY_THREAD_POLICY_CORE, n);
+	test_cmp("MTY_ThreadPoolCreateWithPolicy", pool != NULL);
+	test_cmp("MTY_ThreadPoolGetNode", MTY_ThreadPoolGetNode(pool, 0) == 0);
+
+	for (uint32_t x = 0; x < n; x++) {
+		data[x].buf = MTY_AllocNode(test_stream_size, MTY_ThreadPoolGetNode(pool, x + 1));
+
+		for (size_t y = 0; y < test_stream_size / sizeof(uint64_t); y++)
+			data[x].buf[y] = y;
+	}
+
+	float local = test_stream_run(pool, data, n);
+
+	valid = true;
+	for (uint32_t x = 0; x < n; x++) {
+		valid = valid && data[x].sum == expected;
+		MTY_FreeNode(data[x].buf, test_stream_size);
+	}
+
+	test_cmp("MTY_ThreadPoolCreateWithPolicy (Stream)", valid);
+	test_cmpf("MTY_ThreadPoolCreateWithPolicy (GB/s)", local > 0.0f, local);
+
+	MTY_ThreadPoolDestroy(&pool, NULL);
+	MTY_FreeCPUTopology(&topo);
+
+	return true;
+}
+
 struct test_rw_lock_data {
 	int32_t counter;
 	MTY_Cond *cond;
@@ -454,6 +584,9 @@ static bool thread_main()
 	if (!test_threadpools())
 		return false;
 
+	if (!test_threadpools_topology())
+		return false;
+
 	if (!test_rw_locks())
 		return false;
 
@@ -0,0 +1,196 @@
+// Copyright (c) Christopher D. Dickson <cdd@matoya.group>
+//
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+#define TIMER_SCALE_NUM 100000
+
+struct timer_test_data {
+	MTY_Time start;
+	float fired_at;
+	MTY_Atomic32 fired;
+};
+
+static void timer_test_func(uint32_t id, void *opaque)
+{
+	struct timer_test_data *data = opaque;
+
+	data->fired_at = MTY_TimeDiff(data->start, MTY_GetTime());
+	MTY_Atomic32Add(&data->fired, 1);
+}
+
+static void timer_test_count(uint32_t id, void *opaque)
+{
+	(*(uint32_t *) opaque)++;
+}
+
+struct timer_cancel_data {
+	MTY_TimerWheel *ctx;
+	bool first;
+	bool second;
+};
+
+static void timer_test_cancel(uint32_t id, void *opaque)
+{
+	struct timer_cancel_data *data = opaque;
+
+	data->first = MTY_TimerWheelCancel(data->ctx, id);
+	data->second = MTY_TimerWheelCancel(data->ctx, id);
+}
+
+static bool timer_accuracy(void)
+{
+	MTY_TimerWheel *ctx = MTY_TimerWheelCreate(1, true);
+	test_cmp("MTY_TimerWheelCreate", ctx != NULL);
+
+	struct timer_test_data once = {0};
+	struct timer_test_data cancelled = {0};
+	struct timer_test_data periodic = {0};
+
+	once.start = cancelled.start = periodic.start = MTY_GetTime();
+
+	uint32_t oid = MTY_TimerWheelSet(ctx, 50, 0, timer_test_func, &once);
+	test_cmp("MTY_TimerWheelSet", oid > 0);
+
+	uint32_t id = MTY_TimerWheelSet(ctx, 20, 0, timer_test_func, &cancelled);
+	test_cmp("MTY_TimerWheelCancel", MTY_TimerWheelCancel(ctx, id));
+	test_cmp("MTY_TimerWheelCancel", !MTY_TimerWheelCancel(ctx, id));
+
+	uint32_t pid = MTY_TimerWheelSet(ctx, 10, 10, timer_test_func, &periodic);
+
+	MTY_Sleep(105);
+	MTY_TimerWheelCancel(ctx, pid);
+
+	test_cmp("MTY_TimerWheelSet", MTY_Atomic32Get(&once.fired) == 1);
+	test_cmpf("MTY_TimerWheelSet (Err)", once.fired_at >= 50.0f && once.fired_at < 150.0f, once.fired_at - 50.0f);
+	test_cmp("MTY_TimerWheelCancel", !MTY_TimerWheelCancel(ctx, oid));
+	test_cmp("MTY_TimerWheelCancel", MTY_Atomic32Get(&cancelled.fired) == 0);
+
+	int32_t n = MTY_Atomic32Get(&periodic.fired);
+	test_cmpi32("MTY_TimerWheelSet (Per)", n >= 8 && n <= 10, n);
+	test_cmp("MTY_TimerWheelGetLength", MTY_TimerWheelGetLength(ctx) == 0);
+
+	MTY_TimerWheelDestroy(&ctx);
+	test_cmp("MTY_TimerWheelDestroy", ctx == NULL);
+
+	return true;
+}
+
+static bool timer_scale(void)
+{
+	MTY_TimerWheel *ctx = MTY_TimerWheelCreate(1, false);
+	test_cmpi32("MTY_TimerWheelGetTimeout", MTY_TimerWheelGetTimeout(ctx) == -1, MTY_TimerWheelGetTimeout(ctx));
+
+	uint32_t *ids = MTY_Alloc(TIMER_SCALE_NUM, sizeof(uint32_t));
+	uint32_t fired = 0;
+
+	// Spread timeouts across multiple levels of the wheel
+	MTY_Time ts = MTY_GetTime();
+
+	for (uint32_t x = 0; x < TIMER_SCALE_NUM; x++)
+		ids[x] = MTY_TimerWheelSet(ctx, x % 300, 0, timer_test_count, &fired);
+
+	float arm = MTY_TimeDiff(ts, MTY_GetTime());
+	test_cmpf("MTY_TimerWheelSet (ns)", ids[TIMER_SCALE_NUM - 1] > 0, arm * 1000000.0f / TIMER_SCALE_NUM);
+
+	ts = MTY_GetTime();
+
+	for (uint32_t x = 0; x < TIMER_SCALE_NUM; x += 2)
+		MTY_TimerWheelCancel(ctx, ids[x]);
+
+	float cancel = MTY_TimeDiff(ts, MTY_GetTime());
+	test_cmpf("MTY_TimerWheelCancel (ns)", MTY_TimerWheelGetLength(ctx) == TIMER_SCALE_NUM / 2,
+		cancel * 1000000.0f / (TIMER_SCALE_NUM / 2));
+
+	int32_t timeout = MTY_TimerWheelGetTimeout(ctx);
+	test_cmpi32("MTY_TimerWheelGetTimeout", timeout >= 0 && timeout <= 1, timeout);
+
+	while (MTY_TimerWheelGetLength(ctx) > 0) {
+		MTY_Sleep(MTY_TimerWheelGetTimeout(ctx));
+		MTY_TimerWheelPoll(ctx);
+	}
+
+	test_cmpi32("MTY_TimerWheelPoll", fired == TIMER_SCALE_NUM / 2, fired);
+
+	// An idle wheel must not have to catch up on the time it spent empty
+	MTY_Sleep(300);
+	uint32_t id = MTY_TimerWheelSet(ctx, 50, 0, timer_test_count, &fired);
+	timeout = MTY_TimerWheelGetTimeout(ctx);
+	test_cmpi32("MTY_TimerWheelGetTimeout (Idle)", timeout >= 40 && timeout <= 50, timeout);
+	test_cmp("MTY_TimerWheelCancel", MTY_TimerWheelCancel(ctx, id));
+
+	// Cancelling from inside the callback only succeeds once, and only if periodic
+	struct timer_cancel_data once = {ctx, false, false};
+	struct timer_cancel_data periodic = {ctx, false, false};
+
+	uint32_t oid = MTY_TimerWheelSet(ctx, 0, 0, timer_test_cancel, &once);
+	uint32_t pid = MTY_TimerWheelSet(ctx, 0, 1, timer_test_cancel, &periodic);
+
+	while (MTY_TimerWheelGetLength(ctx) > 0) {
+		MTY_Sleep(MTY_TimerWheelGetTimeout(ctx));
+		MTY_TimerWheelPoll(ctx);
+	}
+
+	test_cmp("MTY_TimerWheelCancel (Once)", !once.first && !once.second && !MTY_TimerWheelCancel(ctx, oid));
+	test_cmp("MTY_TimerWheelCancel (Per)", periodic.first && !periodic.second && !MTY_TimerWheelCancel(ctx, pid));
+
+	// A timer far beyond the range of the wheel must still be accepted
+	id = MTY_TimerWheelSet(ctx, UINT32_MAX, 0, timer_test_count, &fired);
+	test_cmp("MTY_TimerWheelSet (L)", id > 0 && MTY_TimerWheelPoll(ctx) == 0);
+	test_cmp("MTY_TimerWheelCancel (L)", MTY_TimerWheelCancel(ctx, id));
+
+	MTY_Free(ids);
+	MTY_TimerWheelDestroy(&ctx);
+
+	return true;
+}
+
+static bool timer_ticks(void)
+{
+	MTY_Time start = MTY_GetTime();
+	MTY_TimerWheel *ctx = MTY_TimerWheelCreate(2, false);
+
+	// Expires on the first tick of the second base wheel revolution, reached by cascade
+	uint32_t fired = 0;
+	MTY_TimerWheelSet(ctx, 512, 0, timer_test_count, &fired);
+
+	while (MTY_TimeDiff(start, MTY_GetTime()) < 513.0f)
+		MTY_Sleep(1);
+
+	MTY_TimerWheelPoll(ctx);
+	test_cmpi32("MTY_TimerWheelPoll (Cascade)", fired == 1, fired);
+
+	// Intervals are rounded up to whole ticks so periodic timers never fire early
+	MTY_TimerWheelDestroy(&ctx);
+	ctx = MTY_TimerWheelCreate(10, false);
+	start = MTY_GetTime();
+	fired = 0;
+
+	MTY_TimerWheelSet(ctx, 15, 15, timer_test_count, &fired);
+
+	while (MTY_TimeDiff(start, MTY_GetTime()) < 200.0f) {
+		MTY_Sleep(MTY_TimerWheelGetTimeout(ctx));
+		MTY_TimerWheelPoll(ctx);
+	}
+
+	test_cmpi32("MTY_TimerWheelSet (Interval)", fired >= 8 && fired <= 11, fired);
+
+	MTY_TimerWheelDestroy(&ctx);
+
+	return true;
+}
+
+static bool timer_main(void)
+{
+	if (!timer_accuracy())
+		return false;
+
+	if (!timer_scale())
+		return false;
+
+	if (!timer_ticks())
+		return false;
+
+	return true;
+}
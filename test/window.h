@@ -0,0 +1,788 @@
+// Copyright (c) Christopher D. Dickson <cdd@matoya.group>
+//
+// This Source Code Form is subject to the terms of the MIT License.
+// If a copy of the MIT License was not distributed with this file,
+// You can obtain one at https://spdx.org/licenses/MIT.html.
+
+#if defined(__linux__) && !defined(__ANDROID__)
+
+#define WINDOW_FRAMES 120
+
+#define WINDOW_ATLAS_PAGE  64
+#define WINDOW_ATLAS_ICON  14
+#define WINDOW_ATLAS_CELL  16
+#define WINDOW_ATLAS_ICONS 128
+#define WINDOW_ATLAS_EXTRA 1000
+
+#define WINDOW_GL_RGBA          0x1908
+#define WINDOW_GL_UNSIGNED_BYTE 0x1401
+
+typedef void (*WINDOW_GL_READ_PIXELS)(int32_t x, int32_t y, int32_t width, int32_t height,
+	uint32_t format, uint32_t type, void *pixels);
+
+typedef void (*WINDOW_GL_FINISH)(void);
+typedef void *(*WINDOW_GLX_GET_CURRENT_CONTEXT)(void);
+typedef void *(*WINDOW_GLX_GET_CURRENT_DISPLAY)(void);
+typedef const char *(*WINDOW_GLX_QUERY_EXTENSIONS_STRING)(void *dpy, int32_t screen);
+typedef int32_t (*WINDOW_X_DEFAULT_SCREEN)(void *dpy);
+
+static bool window_app_func(void *opaque)
+{
+	return false;
+}
+
+static void window_event_func(const MTY_Event *evt, void *opaque)
+{
+}
+
+static bool window_has_oml(void)
+{
+	MTY_SO *gl = MTY_SOLoad("libGL.so.1");
+	MTY_SO *x11 = MTY_SOLoad("libX11.so.6");
+
+	WINDOW_GLX_GET_CURRENT_DISPLAY get_display = gl ?
+		(WINDOW_GLX_GET_CURRENT_DISPLAY) MTY_SOGetSymbol(gl, "glXGetCurrentDisplay") : NULL;
+	WINDOW_GLX_QUERY_EXTENSIONS_STRING query = gl ?
+		(WINDOW_GLX_QUERY_EXTENSIONS_STRING) MTY_SOGetSymbol(gl, "glXQueryExtensionsString") : NULL;
+	WINDOW_X_DEFAULT_SCREEN default_screen = x11 ?
+		(WINDOW_X_DEFAULT_SCREEN) MTY_SOGetSymbol(x11, "XDefaultScreen") : NULL;
+
+	bool r = false;
+	void *dpy = get_display ? get_display() : NULL;
+
+	if (dpy && query && default_screen) {
+		const char *name = "GLX_OML_sync_control";
+		const char *exts = query(dpy, default_screen(dpy));
+		size_t len = strlen(name);
+
+		for (const char *ext = exts ? strstr(exts, name) : NULL; ext && !r; ext = strstr(ext + len, name))
+			r = (ext == exts || ext[-1] == ' ') && (ext[len] == ' ' || ext[len] == '\0');
+	}
+
+	MTY_SOUnload(&x11);
+	MTY_SOUnload(&gl);
+
+	return r;
+}
+
+static bool window_present_stats(MTY_App *app, MTY_Window window)
+{
+	MTY_PresentStats stats = {0};
+	MTY_Time start = MTY_GetTime();
+	bool monotonic = true;
+
+	for (uint32_t x = 0; x < WINDOW_FRAMES; x++) {
+		MTY_PresentStats prev = stats;
+
+		MTY_WindowPresent(app, window, 1);
+		test_cmp("MTY_WindowGetPresentStats", MTY_WindowGetPresentStats(app, window, &stats));
+
+		monotonic = monotonic && stats.presentID == x + 1 && stats.displayedID >= prev.displayedID &&
+			stats.displayTime >= prev.displayTime && stats.missedFrames >= prev.missedFrames;
+	}
+
+	test_cmp("MTY_PresentStats", monotonic);
+	test_cmpi64("MTY_PresentStats (ID)", stats.presentID == WINDOW_FRAMES, stats.presentID);
+	test_cmpi64("MTY_PresentStats (Shown)", stats.displayedID <= stats.presentID &&
+		stats.presentID - stats.displayedID <= 3, stats.displayedID);
+	test_cmp("MTY_PresentStats (Time)", stats.displayTime >= start && stats.displayTime <= MTY_GetTime());
+	test_cmpi64("MTY_PresentStats (Missed)", stats.missedFrames < WINDOW_FRAMES, stats.missedFrames);
+	test_cmpf("MTY_PresentStats (Refresh)", stats.refreshInterval > 0.0f &&
+		stats.refreshInterval < 1000.0f, stats.refreshInterval);
+
+	// Real display times are only available through GLX_OML_sync_control
+	bool oml = window_has_oml();
+	test_cmpi32("MTY_PresentStats (Est)", stats.estimated == !oml, stats.estimated);
+
+	return true;
+}
+
+
+// CPU reference for the GL color conversion, written from the standards
+
+static float window_pq_to_nits(float e)
+{
+	float p = powf(fmaxf(e, 0.0f), 1.0f / 78.84375f);
+	float l = fmaxf(p - 0.8359375f, 0.0f) / (18.8515625f - 18.6875f * p);
+
+	return powf(l, 1.0f / 0.1593017578125f) * 10000.0f;
+}
+
+static float window_srgb(float l)
+{
+	return l <= 0.0031308f ? l * 12.92f : 1.055f * powf(l, 1.0f / 2.4f) - 0.055f;
+}
+
+static float window_hlg_inverse_oetf(float e)
+{
+	return e <= 0.5f ? e * e / 3.0f : (expf((e - 0.55991073f) / 0.17883277f) + 0.28466892f) / 12.0f;
+}
+
+static uint16_t window_half(float f)
+{
+	// Only exactly representable normal values are written by the tests
+	uint32_t b = 0;
+	memcpy(&b, &f, sizeof(float));
+
+	if ((b & 0x7FFFFFFF) == 0)
+		return 0;
+
+	return (uint16_t) (((b >> 16) & 0x8000) | ((((b >> 23) & 0xFF) - 127 + 15) << 10) | ((b >> 13) & 0x3FF));
+}
+
+static void window_yuv(const MTY_RenderDesc *desc, uint32_t bits, float y, float u, float v, float *rgb)
+{
+	float max = (float) ((1u << bits) - 1);
+	float step = (float) (1u << (bits - 8));
+
+	// Code values to normalized Y and centered U, V
+	if (desc->fullRange) {
+		y = y / max;
+		u = (u - 128.0f * step) / max;
+		v = (v - 128.0f * step) / max;
+
+	} else {
+		y = (y - 16.0f * step) / (219.0f * step);
+		u = (u - 128.0f * step) / (224.0f * step);
+		v = (v - 128.0f * step) / (224.0f * step);
+	}
+
+	float kr = 0.2126f;
+	float kb = 0.0722f;
+
+	if (desc->matrix == MTY_COLOR_MATRIX_BT601) {
+		kr = 0.299f;
+		kb = 0.114f;
+
+	} else if (desc->matrix == MTY_COLOR_MATRIX_BT2020) {
+		kr = 0.2627f;
+		kb = 0.0593f;
+	}
+
+	rgb[0] = y + 2.0f * (1.0f - kr) * v;
+	rgb[2] = y + 2.0f * (1.0f - kb) * u;
+	rgb[1] = (y - kr * rgb[0] - kb * rgb[2]) / (1.0f - kr - kb);
+}
+
+static void window_reference(const MTY_RenderDesc *desc, const float *signal, uint8_t *out)
+{
+	float rgb[3] = {signal[0], signal[1], signal[2]};
+
+	if (desc->transfer != MTY_TRANSFER_SDR) {
+		float white = (desc->maxLuminance > 0.0f ? desc->maxLuminance : 1000.0f) / 203.0f;
+		float n[3];
+
+		if (desc->transfer == MTY_TRANSFER_PQ) {
+			for (uint8_t x = 0; x < 3; x++)
+				n[x] = window_pq_to_nits(rgb[x]);
+
+		} else if (desc->transfer == MTY_TRANSFER_HLG) {
+			float s[3];
+			for (uint8_t x = 0; x < 3; x++)
+				s[x] = window_hlg_inverse_oetf(rgb[x]);
+
+			float ys = 0.2627f * s[0] + 0.6780f * s[1] + 0.0593f * s[2];
+
+			for (uint8_t x = 0; x < 3; x++)
+				n[x] = s[x] * white * 203.0f * powf(fmaxf(ys, 1e-6f), 0.2f);
+
+		} else {
+			for (uint8_t x = 0; x < 3; x++)
+				n[x] = rgb[x] * 80.0f;
+		}
+
+		// scRGB is already in BT.709 primaries
+		if (desc->matrix == MTY_COLOR_MATRIX_BT2020 && desc->transfer != MTY_TRANSFER_LINEAR) {
+			rgb[0] =  1.6605f * n[0] - 0.5876f * n[1] - 0.0728f * n[2];
+			rgb[1] = -0.1246f * n[0] + 1.1329f * n[1] - 0.0083f * n[2];
+			rgb[2] = -0.0182f * n[0] - 0.1006f * n[1] + 1.1187f * n[2];
+
+		} else {
+			memcpy(rgb, n, sizeof(n));
+		}
+
+		float m = 0.0f;
+
+		for (uint8_t x = 0; x < 3; x++) {
+			rgb[x] = fmaxf(rgb[x] / 203.0f, 0.0f);
+			m = fmaxf(m, rgb[x]);
+		}
+
+		for (uint8_t x = 0; x < 3; x++) {
+			if (m > 0.0f)
+				rgb[x] *= (1.0f + m / (white * white)) / (1.0f + m);
+
+			rgb[x] = window_srgb(fminf(rgb[x], 1.0f));
+		}
+	}
+
+	for (uint8_t x = 0; x < 3; x++)
+		out[x] = (uint8_t) lrintf(fminf(fmaxf(rgb[x], 0.0f), 1.0f) * 255.0f);
+}
+
+static uint32_t window_compare(MTY_App *app, MTY_Window window, WINDOW_GL_READ_PIXELS read_pixels,
+	const void *image, const MTY_RenderDesc *desc, const float *signal)
+{
+	uint32_t w = desc->imageWidth;
+	uint32_t h = desc->imageHeight;
+
+	MTY_WindowDrawQuad(app, window, image, desc);
+
+	uint8_t *rgba = MTY_Alloc(w * h, 4);
+	read_pixels(0, 0, w, h, WINDOW_GL_RGBA, WINDOW_GL_UNSIGNED_BYTE, rgba);
+
+	uint32_t max_diff = 0;
+
+	for (uint32_t y = 0; y < h; y++) {
+		for (uint32_t x = 0; x < w; x++) {
+			uint8_t expected[3];
+			window_reference(desc, signal + (y * w + x) * 3, expected);
+
+			// Rows are read back bottom up
+			const uint8_t *actual = rgba + ((h - 1 - y) * w + x) * 4;
+
+			for (uint8_t c = 0; c < 3; c++) {
+				uint32_t diff = abs((int32_t) actual[c] - (int32_t) expected[c]);
+
+				if (diff > max_diff)
+					max_diff = diff;
+			}
+		}
+	}
+
+	MTY_Free(rgba);
+
+	return max_diff;
+}
+
+static bool window_hdr_formats(MTY_App *app, MTY_Window window)
+{
+	MTY_SO *gl = MTY_SOLoad("libGL.so.1");
+	test_cmp("MTY_SOLoad", gl != NULL);
+
+	WINDOW_GL_READ_PIXELS read_pixels = (WINDOW_GL_READ_PIXELS) MTY_SOGetSymbol(gl, "glReadPixels");
+	test_cmp("MTY_SOGetSymbol", read_pixels != NULL);
+
+	uint32_t w = 0;
+	uint32_t h = 0;
+	MTY_WindowGetSize(app, window, &w, &h);
+
+	// Even dimensions keep the 4:2:0 chroma planes exact
+	w &= ~1u;
+	h &= ~1u;
+
+	// Nearest filtering with the image the same size as the viewport samples each texel once
+	MTY_RenderDesc desc = {0};
+	desc.filter = MTY_FILTER_NEAREST;
+	desc.imageWidth = desc.cropWidth = w;
+	desc.imageHeight = desc.cropHeight = h;
+	desc.aspectRatio = (float) w / (float) h;
+
+	// Nonlinear RGB per pixel before tone mapping, large enough for RGBA16F
+	float *signal = MTY_Alloc(w * h * 3, sizeof(float));
+	uint16_t *image = MTY_Alloc(w * h * 4, sizeof(uint16_t));
+
+	// P010, BT.2020 limited range, PQ tone mapped to SDR
+	uint16_t *py = image;
+	uint16_t *puv = image + w * h;
+
+	for (uint32_t y = 0; y < h; y++) {
+		for (uint32_t x = 0; x < w; x++) {
+			uint16_t cy = 64 + (x * 876) / (w - 1);
+			uint16_t cu = 64 + ((x / 2) * 896) / (w / 2);
+			uint16_t cv = 64 + ((y / 2) * 896) / (h / 2);
+
+			py[y * w + x] = cy << 6;
+			puv[(y / 2) * w + (x / 2) * 2] = cu << 6;
+			puv[(y / 2) * w + (x / 2) * 2 + 1] = cv << 6;
+		}
+	}
+
+	desc.format = MTY_COLOR_FORMAT_P010;
+	desc.matrix = MTY_COLOR_MATRIX_BT2020;
+	desc.transfer = MTY_TRANSFER_PQ;
+	desc.maxLuminance = 1000.0f;
+
+	for (uint32_t y = 0; y < h; y++)
+		for (uint32_t x = 0; x < w; x++)
+			window_yuv(&desc, 16, py[y * w + x], puv[(y / 2) * w + (x / 2) * 2],
+				puv[(y / 2) * w + (x / 2) * 2 + 1], signal + (y * w + x) * 3);
+
+	uint32_t diff = window_compare(app, window, read_pixels, image, &desc, signal);
+	test_cmpi32("MTY_COLOR_FORMAT_P010", diff <= 1, diff);
+
+	// P016, BT.2020 limited range over the full 16-bit code range, PQ
+	for (uint32_t y = 0; y < h; y++) {
+		for (uint32_t x = 0; x < w; x++) {
+			py[y * w + x] = 4096 + (uint16_t) (((uint64_t) y * 56064) / (h - 1));
+			puv[(y / 2) * w + (x / 2) * 2] = 61440 - (uint16_t) (((uint64_t) (y / 2) * 57344) / (h / 2));
+			puv[(y / 2) * w + (x / 2) * 2 + 1] = 4096 + (uint16_t) (((uint64_t) (x / 2) * 57344) / (w / 2));
+		}
+	}
+
+	desc.format = MTY_COLOR_FORMAT_P016;
+	desc.maxLuminance = 4000.0f;
+
+	for (uint32_t y = 0; y < h; y++)
+		for (uint32_t x = 0; x < w; x++)
+			window_yuv(&desc, 16, py[y * w + x], puv[(y / 2) * w + (x / 2) * 2],
+				puv[(y / 2) * w + (x / 2) * 2 + 1], signal + (y * w + x) * 3);
+
+	diff = window_compare(app, window, read_pixels, image, &desc, signal);
+	test_cmpi32("MTY_COLOR_FORMAT_P016", diff <= 1, diff);
+
+	// I010, BT.709 full range SDR
+	uint16_t *iy = image;
+	uint16_t *iu = image + w * h;
+	uint16_t *iv = iu + (w / 2) * (h / 2);
+
+	desc.format = MTY_COLOR_FORMAT_I010;
+	desc.matrix = MTY_COLOR_MATRIX_BT709;
+	desc.transfer = MTY_TRANSFER_SDR;
+	desc.fullRange = true;
+
+	for (uint32_t y = 0; y < h; y++) {
+		for (uint32_t x = 0; x < w; x++) {
+			uint16_t cy = (y * 1023) / (h - 1);
+			uint16_t cu = ((x / 2) * 1023) / (w / 2);
+			uint16_t cv = 1023 - ((y / 2) * 1023) / (h / 2);
+
+			iy[y * w + x] = cy;
+			iu[(y / 2) * (w / 2) + x / 2] = cu;
+			iv[(y / 2) * (w / 2) + x / 2] = cv;
+
+			window_yuv(&desc, 10, cy, cu, cv, signal + (y * w + x) * 3);
+		}
+	}
+
+	diff = window_compare(app, window, read_pixels, image, &desc, signal);
+	test_cmpi32("MTY_COLOR_FORMAT_I010", diff <= 1, diff);
+
+	// I410, BT.601 limited range SDR, full resolution chroma
+	iu = image + w * h;
+	iv = iu + w * h;
+
+	desc.format = MTY_COLOR_FORMAT_I410;
+	desc.matrix = MTY_COLOR_MATRIX_BT601;
+	desc.fullRange = false;
+
+	for (uint32_t y = 0; y < h; y++) {
+		for (uint32_t x = 0; x < w; x++) {
+			uint16_t cy = 64 + ((x + y) * 876) / (w + h - 2);
+			uint16_t cu = 64 + (x * 896) / (w - 1);
+			uint16_t cv = 960 - (y * 896) / (h - 1);
+
+			iy[y * w + x] = cy;
+			iu[y * w + x] = cu;
+			iv[y * w + x] = cv;
+
+			window_yuv(&desc, 10, cy, cu, cv, signal + (y * w + x) * 3);
+		}
+	}
+
+	diff = window_compare(app, window, read_pixels, image, &desc, signal);
+	test_cmpi32("MTY_COLOR_FORMAT_I410", diff <= 1, diff);
+
+	// I410, BT.2020 limited range, HLG with a 1000 nit display peak
+	desc.matrix = MTY_COLOR_MATRIX_BT2020;
+	desc.transfer = MTY_TRANSFER_HLG;
+	desc.maxLuminance = 1000.0f;
+
+	for (uint32_t y = 0; y < h; y++)
+		for (uint32_t x = 0; x < w; x++)
+			window_yuv(&desc, 10, iy[y * w + x], iu[y * w + x], iv[y * w + x], signal + (y * w + x) * 3);
+
+	diff = window_compare(app, window, read_pixels, image, &desc, signal);
+	test_cmpi32("MTY_TRANSFER_HLG", diff <= 1, diff);
+
+	// Y410, BT.2020 limited range SDR, packed U in bits 0-9, Y in 10-19, V in 20-29
+	uint32_t *packed = (uint32_t *) image;
+
+	desc.format = MTY_COLOR_FORMAT_Y410;
+	desc.transfer = MTY_TRANSFER_SDR;
+
+	for (uint32_t y = 0; y < h; y++) {
+		for (uint32_t x = 0; x < w; x++) {
+			uint32_t cy = 64 + (y * 876) / (h - 1);
+			uint32_t cu = 960 - (x * 896) / (w - 1);
+			uint32_t cv = 64 + ((x + y) * 896) / (w + h - 2);
+
+			packed[y * w + x] = 0xC0000000 | (cv << 20) | (cy << 10) | cu;
+
+			window_yuv(&desc, 10, (float) cy, (float) cu, (float) cv, signal + (y * w + x) * 3);
+		}
+	}
+
+	diff = window_compare(app, window, read_pixels, image, &desc, signal);
+	test_cmpi32("MTY_COLOR_FORMAT_Y410", diff <= 1, diff);
+
+	// RGB10A2, BT.2020 primaries, PQ
+	desc.format = MTY_COLOR_FORMAT_RGB10A2;
+	desc.transfer = MTY_TRANSFER_PQ;
+
+	for (uint32_t y = 0; y < h; y++) {
+		for (uint32_t x = 0; x < w; x++) {
+			uint32_t r = (x * 1023) / (w - 1);
+			uint32_t g = (y * 1023) / (h - 1);
+			uint32_t b = 1023 - ((x + y) * 1023) / (w + h - 2);
+
+			packed[y * w + x] = 0xC0000000 | (b << 20) | (g << 10) | r;
+
+			float *s = signal + (y * w + x) * 3;
+			s[0] = (float) r / 1023.0f;
+			s[1] = (float) g / 1023.0f;
+			s[2] = (float) b / 1023.0f;
+		}
+	}
+
+	diff = window_compare(app, window, read_pixels, image, &desc, signal);
+	test_cmpi32("MTY_COLOR_FORMAT_RGB10A2", diff <= 1, diff);
+
+	// RGBA16F scRGB, multiples of 1/64 up to 1000 nits are exact in half float
+	desc.format = MTY_COLOR_FORMAT_RGBA16F;
+	desc.matrix = MTY_COLOR_MATRIX_BT709;
+	desc.transfer = MTY_TRANSFER_LINEAR;
+
+	for (uint32_t y = 0; y < h; y++) {
+		for (uint32_t x = 0; x < w; x++) {
+			float *s = signal + (y * w + x) * 3;
+			s[0] = (float) ((x * 800) / (w - 1)) / 64.0f;
+			s[1] = (float) ((y * 800) / (h - 1)) / 64.0f;
+			s[2] = (float) (((x + y) * 100) / (w + h - 2)) / 64.0f;
+
+			uint16_t *p = image + (y * w + x) * 4;
+			p[0] = window_half(s[0]);
+			p[1] = window_half(s[1]);
+			p[2] = window_half(s[2]);
+			p[3] = window_half(1.0f);
+		}
+	}
+
+	diff = window_compare(app, window, read_pixels, image, &desc, signal);
+	test_cmpi32("MTY_COLOR_FORMAT_RGBA16F", diff <= 1, diff);
+
+	MTY_Free(image);
+	MTY_Free(signal);
+	MTY_SOUnload(&gl);
+
+	return true;
+}
+
+
+// UI atlas, every icon is a solid color so its center identifies which texels were sampled
+
+static void window_icon(uint32_t id, uint8_t *rgba)
+{
+	for (uint32_t x = 0; x < WINDOW_ATLAS_ICON * WINDOW_ATLAS_ICON; x++) {
+		rgba[x * 4 + 0] = (uint8_t) (id * 37);
+		rgba[x * 4 + 1] = (uint8_t) (id * 101);
+		rgba[x * 4 + 2] = (uint8_t) (id * 173);
+		rgba[x * 4 + 3] = 0xFF;
+	}
+}
+
+static uint32_t window_atlas_draw(MTY_App *app, MTY_Window window, WINDOW_GL_READ_PIXELS read_pixels,
+	const uint32_t *ids, uint32_t n, uint32_t w, uint32_t h)
+{
+	MTY_Vtx *vtx = MTY_Alloc(n * 4, sizeof(MTY_Vtx));
+	uint16_t *idx = MTY_Alloc(n * 6, sizeof(uint16_t));
+	MTY_Cmd *cmd = MTY_Alloc(n, sizeof(MTY_Cmd));
+
+	uint32_t cols = w / WINDOW_ATLAS_CELL;
+
+	for (uint32_t x = 0; x < n; x++) {
+		float l = (float) ((x % cols) * WINDOW_ATLAS_CELL + 1);
+		float t = (float) ((x / cols) * WINDOW_ATLAS_CELL + 1);
+		float r = l + WINDOW_ATLAS_ICON;
+		float b = t + WINDOW_ATLAS_ICON;
+
+		MTY_Vtx *v = vtx + x * 4;
+		v[0] = (MTY_Vtx) {{l, t}, {0.0f, 0.0f}, 0xFFFFFFFF};
+		v[1] = (MTY_Vtx) {{r, t}, {1.0f, 0.0f}, 0xFFFFFFFF};
+		v[2] = (MTY_Vtx) {{r, b}, {1.0f, 1.0f}, 0xFFFFFFFF};
+		v[3] = (MTY_Vtx) {{l, b}, {0.0f, 1.0f}, 0xFFFFFFFF};
+
+		uint16_t *i = idx + x * 6;
+		i[0] = x * 4 + 0; i[1] = x * 4 + 1; i[2] = x * 4 + 2;
+		i[3] = x * 4 + 0; i[4] = x * 4 + 2; i[5] = x * 4 + 3;
+
+		cmd[x].clip = (MTY_Rect) {0.0f, 0.0f, (float) w, (float) h};
+		cmd[x].texture = ids[x];
+		cmd[x].elemCount = 6;
+		cmd[x].idxOffset = x * 6;
+	}
+
+	MTY_CmdList list = {0};
+	list.cmd = cmd;
+	list.vtx = vtx;
+	list.idx = idx;
+	list.cmdLength = list.cmdMax = n;
+	list.vtxLength = list.vtxMax = n * 4;
+	list.idxLength = list.idxMax = n * 6;
+
+	MTY_DrawData dd = {0};
+	dd.displaySize = (MTY_Point) {(float) w, (float) h};
+	dd.cmdList = &list;
+	dd.cmdListLength = dd.cmdListMax = 1;
+	dd.vtxTotalLength = list.vtxLength;
+	dd.idxTotalLength = list.idxLength;
+	dd.clear = true;
+
+	MTY_WindowDrawUI(app, window, &dd);
+
+	uint32_t wrong = 0;
+
+	if (read_pixels) {
+		uint8_t *rgba = MTY_Alloc(w * h, 4);
+		read_pixels(0, 0, w, h, WINDOW_GL_RGBA, WINDOW_GL_UNSIGNED_BYTE, rgba);
+
+		for (uint32_t x = 0; x < n; x++) {
+			uint32_t cx = (x % cols) * WINDOW_ATLAS_CELL + WINDOW_ATLAS_CELL / 2;
+			uint32_t cy = (x / cols) * WINDOW_ATLAS_CELL + WINDOW_ATLAS_CELL / 2;
+
+			uint8_t expected[4];
+			window_icon(ids[x], expected);
+
+			// Rows are read back bottom up
+			if (memcmp(rgba + ((h - 1 - cy) * w + cx) * 4, expected, 3))
+				wrong++;
+		}
+
+		MTY_Free(rgba);
+	}
+
+	MTY_Free(cmd);
+	MTY_Free(idx);
+	MTY_Free(vtx);
+
+	return wrong;
+}
+
+static uint32_t window_atlas_live(MTY_App *app, MTY_Window window, uint32_t *ids)
+{
+	uint32_t n = 0;
+
+	for (uint32_t x = 1; x <= WINDOW_ATLAS_ICONS; x++)
+		if (MTY_WindowHasUITexture(app, window, x))
+			ids[n++] = x;
+
+	if (MTY_WindowHasUITexture(app, window, WINDOW_ATLAS_EXTRA))
+		ids[n++] = WINDOW_ATLAS_EXTRA;
+
+	return n;
+}
+
+static float window_atlas_time(MTY_App *app, MTY_Window window, WINDOW_GL_FINISH finish,
+	const uint32_t *ids, uint32_t n, uint32_t w, uint32_t h)
+{
+	MTY_Time ts = MTY_GetTime();
+
+	for (uint32_t x = 0; x < WINDOW_FRAMES; x++)
+		window_atlas_draw(app, window, NULL, ids, n, w, h);
+
+	finish();
+
+	return MTY_TimeDiff(ts, MTY_GetTime()) / WINDOW_FRAMES;
+}
+
+static bool window_ui_atlas(MTY_App *app, MTY_Window window)
+{
+	MTY_SO *gl = MTY_SOLoad("libGL.so.1");
+	test_cmp("MTY_SOLoad", gl != NULL);
+
+	WINDOW_GL_READ_PIXELS read_pixels = (WINDOW_GL_READ_PIXELS) MTY_SOGetSymbol(gl, "glReadPixels");
+	WINDOW_GL_FINISH finish = (WINDOW_GL_FINISH) MTY_SOGetSymbol(gl, "glFinish");
+	test_cmp("MTY_SOGetSymbol", read_pixels != NULL && finish != NULL);
+
+	uint32_t w = 0;
+	uint32_t h = 0;
+	MTY_WindowGetSize(app, window, &w, &h);
+	test_cmp("MTY_WindowGetSize", (w / WINDOW_ATLAS_CELL) * (h / WINDOW_ATLAS_CELL) > WINDOW_ATLAS_ICONS);
+
+	uint8_t rgba[WINDOW_ATLAS_ICON * WINDOW_ATLAS_ICON * 4];
+	uint32_t ids[WINDOW_ATLAS_ICONS + 1];
+	bool ok = true;
+
+	// Packing: sixteen padded icons fill each page, so this fills every page
+	MTY_WindowSetUIAtlas(app, window, WINDOW_ATLAS_PAGE);
+
+	for (uint32_t x = 1; x <= WINDOW_ATLAS_ICONS; x++) {
+		window_icon(x, rgba);
+		ok = ok && MTY_WindowSetUITexture(app, window, x, rgba, WINDOW_ATLAS_ICON, WINDOW_ATLAS_ICON);
+	}
+
+	uint32_t n = window_atlas_live(app, window, ids);
+	test_cmpi32("MTY_WindowSetUIAtlas", ok && n == WINDOW_ATLAS_ICONS, n);
+
+	uint32_t wrong = window_atlas_draw(app, window, read_pixels, ids, n, w, h);
+	test_cmpi32("MTY_WindowSetUIAtlas (UV)", wrong == 0, wrong);
+
+	// Eviction: removed icons leave holes that are only reclaimed by defragmenting
+	for (uint32_t x = 2; x <= WINDOW_ATLAS_ICONS; x += 2)
+		MTY_WindowSetUITexture(app, window, x, NULL, 0, 0);
+
+	n = window_atlas_live(app, window, ids);
+	wrong = window_atlas_draw(app, window, read_pixels, ids, n, w, h);
+	test_cmpi32("MTY_WindowSetUIAtlas (Evict)", n == WINDOW_ATLAS_ICONS / 2 && wrong == 0, wrong);
+
+	// Defragmentation: every page is full, so this repacks the survivors
+	window_icon(WINDOW_ATLAS_EXTRA, rgba);
+	ok = MTY_WindowSetUITexture(app, window, WINDOW_ATLAS_EXTRA, rgba, WINDOW_ATLAS_ICON, WINDOW_ATLAS_ICON);
+
+	n = window_atlas_live(app, window, ids);
+	wrong = window_atlas_draw(app, window, read_pixels, ids, n, w, h);
+	test_cmpi32("MTY_WindowSetUIAtlas (Defrag)", ok && n == WINDOW_ATLAS_ICONS / 2 + 1 && wrong == 0, wrong);
+
+	// Draw calls: with the atlas consecutive icons merge into one draw per page
+	float atlas = window_atlas_time(app, window, finish, ids, n, w, h);
+
+	MTY_WindowSetUIAtlas(app, window, 0);
+
+	for (uint32_t x = 0; x < n; x++) {
+		window_icon(ids[x], rgba);
+		MTY_WindowSetUITexture(app, window, ids[x], rgba, WINDOW_ATLAS_ICON, WINDOW_ATLAS_ICON);
+	}
+
+	float single = window_atlas_time(app, window, finish, ids, n, w, h);
+	wrong = window_atlas_draw(app, window, read_pixels, ids, n, w, h);
+
+	test_cmpf("MTY_WindowDrawUI (Atlas ms)", wrong == 0, atlas);
+	test_cmpf("MTY_WindowDrawUI (Single ms)", wrong == 0, single);
+
+	for (uint32_t x = 0; x < n; x++)
+		MTY_WindowSetUITexture(app, window, ids[x], NULL, 0, 0);
+
+	MTY_SOUnload(&gl);
+
+	return true;
+}
+
+static bool window_shared(MTY_App *app, const MTY_WindowDesc *desc)
+{
+	MTY_SO *gl = MTY_SOLoad("libGL.so.1");
+	test_cmp("MTY_SOLoad", gl != NULL);
+
+	WINDOW_GLX_GET_CURRENT_CONTEXT get_current =
+		(WINDOW_GLX_GET_CURRENT_CONTEXT) MTY_SOGetSymbol(gl, "glXGetCurrentContext");
+	test_cmp("MTY_SOGetSymbol", get_current != NULL);
+
+	// The first window in the group compiles the programs, the second only creates
+	// its own staging textures and buffers
+	MTY_Time ts = MTY_GetTime();
+	MTY_Window a = MTY_WindowCreate(app, desc);
+	float first = MTY_TimeDiff(ts, MTY_GetTime());
+
+	ts = MTY_GetTime();
+	MTY_Window b = MTY_WindowCreate(app, desc);
+	float second = MTY_TimeDiff(ts, MTY_GetTime());
+
+	test_cmp("MTY_WindowCreate (Shared)", a >= 0 && b >= 0);
+	test_cmpf("MTY_WindowCreate (First ms)", first >= 0.0f, first);
+	test_cmpf("MTY_WindowCreate (Compile ms saved)", true, first - second);
+
+	// A texture uploaded through one window is visible to every window in the group
+	uint8_t rgba[16 * 16 * 4];
+	memset(rgba, 0xFF, sizeof(rgba));
+
+	MTY_WindowMakeCurrent(app, a, true);
+	test_cmp("MTY_WindowSetUITexture", MTY_WindowSetUITexture(app, a, 1, rgba, 16, 16));
+	MTY_WindowPresent(app, a, 1);
+	MTY_WindowMakeCurrent(app, a, false);
+
+	test_cmp("MTY_WindowHasUITexture", MTY_WindowHasUITexture(app, b, 1));
+	test_cmpi64("MTY_WindowSetUITexture (Bytes saved)", true, (int64_t) sizeof(rgba));
+
+	// Both windows draw in turn, each with its own quad staging textures
+	MTY_RenderDesc rd = {0};
+	rd.format = MTY_COLOR_FORMAT_BGRA;
+	rd.imageWidth = rd.cropWidth = 16;
+	rd.imageHeight = rd.cropHeight = 16;
+	rd.aspectRatio = 1.0f;
+
+	for (uint32_t x = 0; x < 4; x++) {
+		MTY_Window w = x % 2 ? b : a;
+
+		MTY_WindowMakeCurrent(app, w, true);
+		MTY_WindowDrawQuad(app, w, rgba, &rd);
+		MTY_WindowPresent(app, w, 1);
+		MTY_WindowMakeCurrent(app, w, false);
+	}
+
+	// The window that uploaded the texture goes away first, with fences outstanding
+	MTY_WindowSetGFX(app, a, MTY_GFX_NONE, false);
+	MTY_WindowDestroy(app, a);
+
+	MTY_WindowMakeCurrent(app, b, true);
+	test_cmp("MTY_WindowHasUITexture (Teardown)", MTY_WindowHasUITexture(app, b, 1));
+	MTY_WindowPresent(app, b, 1);
+
+	// The last window tears down the group while its own context is current
+	MTY_WindowSetGFX(app, b, MTY_GFX_NONE, false);
+	test_cmp("MTY_WindowSetGFX (Current)", get_current() == NULL);
+	MTY_WindowDestroy(app, b);
+
+	// A new group starts out empty
+	MTY_Window c = MTY_WindowCreate(app, desc);
+	test_cmp("MTY_WindowHasUITexture (Group)", c >= 0 && !MTY_WindowHasUITexture(app, c, 1));
+
+	MTY_WindowSetGFX(app, c, MTY_GFX_NONE, false);
+	MTY_WindowDestroy(app, c);
+
+	MTY_SOUnload(&gl);
+
+	return true;
+}
+
+static bool window_main(void)
+{
+	// Requires an X server, i.e. run under Xvfb on headless machines
+	if (!getenv("DISPLAY")) {
+		test_passed("MTY_WindowCreate (No X11)");
+		return true;
+	}
+
+	MTY_App *app = MTY_AppCreate(window_app_func, window_event_func, NULL);
+	test_cmp("MTY_AppCreate", app != NULL);
+
+	MTY_WindowDesc desc = {0};
+	desc.title = "Window";
+	desc.api = MTY_GFX_GL;
+	desc.width = 320;
+	desc.height = 240;
+	desc.vsync = true;
+
+	MTY_Window window = MTY_WindowCreate(app, &desc);
+	test_cmp("MTY_WindowCreate", window >= 0);
+
+	MTY_WindowMakeCurrent(app, window, true);
+
+	if (!window_present_stats(app, window))
+		return false;
+
+	if (!window_hdr_formats(app, window))
+		return false;
+
+	if (!window_ui_atlas(app, window))
+		return false;
+
+	MTY_WindowMakeCurrent(app, window, false);
+	MTY_WindowSetGFX(app, window, MTY_GFX_NONE, false);
+	MTY_WindowDestroy(app, window);
+
+	if (!window_shared(app, &desc))
+		return false;
+
+	MTY_AppDestroy(&app);
+	test_cmp("MTY_AppDestroy", app == NULL);
+
+	return true;
+}
+
+#else
+
+static bool window_main(void)
+{
+	return true;
+}
+
+#endif